@@ -0,0 +1,34 @@
+#--
+# = SpiceRub
+#
+# == bench/compare.rb
+#
+# Compares two benchmark result files of the same suite, printing the change
+# in ns/op and allocations per op (micro) or in run time and RSS growth (macro)
+# of every benchmark present in both.
+#
+#   ruby bench/compare.rb bench/results/micro-abc123.json bench/results/micro-def456.json
+#
+#++
+
+require 'json'
+
+abort "usage: ruby bench/compare.rb BEFORE.json AFTER.json" unless ARGV.length == 2
+
+before, after = ARGV.map do |path|
+  JSON.parse(File.read(path))["results"].reject { |result| result["error"] }.map do |result|
+    [result["name"] || "#{result["scenario"]} (#{result["variant"]})", result]
+  end.to_h
+end
+
+(before.keys & after.keys).each do |name|
+  old, new = before[name], after[name]
+
+  if old["ns_per_op"]
+    printf("%-44s %14.1f -> %14.1f ns/op %+7.1f%% %10.2f -> %10.2f allocs/op\n", name, old["ns_per_op"], new["ns_per_op"],
+           (new["ns_per_op"] / old["ns_per_op"] - 1) * 100, old["allocations_per_op"], new["allocations_per_op"])
+  else
+    printf("%-44s %9.3f -> %9.3f s %+7.1f%% %9s -> %9s kB RSS growth\n", name, old["seconds"], new["seconds"],
+           (new["seconds"] / old["seconds"] - 1) * 100, old["rss_growth_kb"] || "n/a", new["rss_growth_kb"] || "n/a")
+  end
+end
@@ -0,0 +1,161 @@
+#--
+# = SpiceRub
+#
+# == bench/macro.rb
+#
+# End to end scenarios modelled on the example notebooks and common
+# pipelines, each run with the scalar Ruby API and with the batch API
+# where one exists. Every run happens in a forked child that loads the
+# kernels itself. A child inherits the peak RSS (VmHWM) of its parent, so the
+# peak is reset where the kernel allows it and the table reports how far the
+# run grew the peak above the RSS it started with.
+# Prints a table and writes bench/results/macro-<revision>.json.
+#
+#   ruby -Ilib bench/macro.rb [scenario filter]
+#
+#++
+
+require './bench/support'
+
+# A scenario variant returns the number of items it produced
+Scenario = Struct.new(:name, :variants)
+
+YEAR = 365 * 86400
+HOUR = 3600.0
+
+def epochs(from, span, step)
+  Array.new((span / step).floor + 1) { |index| from + index * step }
+end
+
+scenarios = [
+  # moon_distance.ipynb over a year instead of a month
+  Scenario.new("moon distance, 1 year hourly", {
+    scalar: -> {
+      earth, moon = SpiceRub::Body.new(:earth), SpiceRub::Body.new(:moon)
+      start = SpiceRub::Time.parse("2010 JAN 01")
+      times = SpiceRub::Time.time_series(start, start + YEAR, step: HOUR)
+      times.map { |time| moon.distance_from(earth, time) }.length
+    },
+    batch: -> {
+      start = SpiceRub::Native.str2et("2010 JAN 01")
+      positions = SpiceRub::Body[:moon].position_matrix(epochs(start, YEAR, HOUR), observer: :earth)
+      positions.to_a.map { |x, y, z| Math.sqrt(x * x + y * y + z * z) }.length
+    }
+  }),
+
+  # earth_xyz.ipynb
+  Scenario.new("earth orbit, 1 year daily", {
+    scalar: -> {
+      earth = SpiceRub::Body.new(:earth)
+      start = SpiceRub::Time.parse("2010 JAN 01")
+      SpiceRub::Time.time_series(start, start + YEAR, step: 86400).map { |time| earth.position_at(time) }.length
+    },
+    batch: -> {
+      start = SpiceRub::Native.str2et("2010 JAN 01")
+      SpiceRub::Body[:earth].position_matrix(epochs(start, YEAR, 86400.0)).shape[0]
+    }
+  }),
+
+  # Perigee windows of the Moon over ten years
+  Scenario.new("moon within 370000 km, 10 years", {
+    gfdist: -> {
+      spice = SpiceRub::Native
+      confines = [spice.str2et("2005 JAN 01"), spice.str2et("2015 JAN 01")]
+      spice.gfdist(:MOON, :NONE, :EARTH, :<, 370000, 0, spice.spd, 300, confines).length
+    },
+    sampled: -> {
+      start = SpiceRub::Native.str2et("2005 JAN 01")
+      positions = SpiceRub::Body[:moon].position_matrix(epochs(start, 10 * YEAR, HOUR), observer: :earth)
+      inside = positions.to_a.map { |x, y, z| x * x + y * y + z * z < 370000.0 ** 2 }
+      inside.each_cons(2).count { |before, after| after and not before }
+    }
+  }),
+
+  # Ground track of the generated spacecraft every 10 seconds for a day
+  Scenario.new("ground track, 1 day at 10 s", {
+    scalar: -> {
+      craft = SpiceRubBench::SPACECRAFT.to_s.to_sym
+      epochs(SpiceRubBench::ORBIT_START, 86400.0, 10.0).map do |et|
+        position = SpiceRub::Native.spkpos(craft, et, :IAU_EARTH, :NONE, :EARTH)[0]
+        SpiceRub::CartesianPoint.new(position.to_flat_a).to_geodetic(399)
+      end.length
+    },
+    batch: -> {
+      positions = SpiceRub::Body.query(SpiceRubBench::SPACECRAFT, 399, epochs(SpiceRubBench::ORBIT_START, 86400.0, 10.0),
+                                       frame: :IAU_EARTH, velocities: false)
+      SpiceRub::Body[:earth].geodetic(positions).shape[0]
+    }
+  }),
+
+  # One rotation applied to a cloud of points
+  Scenario.new("frame rotation, 10k points", {
+    scalar: -> {
+      random = Random.new(7)
+      rotation = SpiceRub::Native.pxform(:J2000, :IAU_EARTH, 0.0)
+      Array.new(10_000) { SpiceRub::CartesianPoint.new(Array.new(3) { random.rand * 7000.0 }) }
+        .map { |point| point.transform_frame(rotation) }.length
+    },
+    batch: -> {
+      random = Random.new(7)
+      rotation = SpiceRub::Native.pxform(:J2000, :IAU_EARTH, 0.0)
+      points = NMatrix.new([10_000, 3], Array.new(30_000) { random.rand * 7000.0 }, dtype: :float64)
+      points.dot(rotation.transpose).shape[0]
+    }
+  }),
+]
+
+# Runs one variant in a forked child, returns its measurements
+def isolated(spk, scenario, variant, work)
+  reader, writer = IO.pipe
+
+  pid = fork do
+    reader.close
+    result = begin
+               SpiceRubBench.load_kernels(spk)
+               GC.start
+               reset = SpiceRubBench.reset_peak_rss
+               baseline = SpiceRubBench.rss
+               started = SpiceRubBench.monotonic
+               items = work.call
+               seconds = SpiceRubBench.monotonic - started
+               peak = SpiceRubBench.peak_rss
+
+               { items: items, seconds: seconds.round(6), items_per_second: (items / seconds).round(1),
+                 peak_rss_kb: peak, rss_before_kb: baseline, peak_reset: reset,
+                 rss_growth_kb: peak && baseline && peak - baseline }
+             rescue StandardError => e
+               { error: "#{e.class}: #{e.message.strip}" }
+             end
+
+    writer.write(result.to_json)
+    writer.close
+    exit!(0)
+  end
+
+  writer.close
+  output = reader.read
+  Process.wait(pid)
+
+  { scenario: scenario.name, variant: variant }.merge(JSON.parse(output, symbolize_names: true))
+end
+
+filter = ARGV[0] && Regexp.new(ARGV[0])
+spk = SpiceRubBench.generated_spk
+
+results = scenarios.select { |scenario| filter.nil? or scenario.name =~ filter }.flat_map do |scenario|
+  scenario.variants.map do |variant, work|
+    result = isolated(spk, scenario, variant, work)
+
+    if result[:error]
+      printf("%-34s %-8s %s\n", scenario.name, variant, result[:error])
+    else
+      printf("%-34s %-8s %9d items %9.3f s %12.1f items/s %9s kB RSS growth%s\n", scenario.name, variant,
+             result[:items], result[:seconds], result[:items_per_second], result[:rss_growth_kb] || "n/a",
+             result[:peak_reset] ? "" : " (inherited peak)")
+    end
+
+    result
+  end
+end
+
+puts "Results written to #{SpiceRubBench.write_results("macro", results)}"
@@ -0,0 +1,219 @@
+#--
+# = SpiceRub
+#
+# == bench/micro.rb
+#
+# Per call cost of the SpiceRub::Native functions and of the Body, Time and
+# CartesianPoint methods built on them, over the spec kernels and a
+# generated SPK. Prints a table, the natives left out and why, and writes
+# bench/results/micro-<revision>.json.
+#
+#   ruby -Ilib bench/micro.rb [name filter]
+#
+#++
+
+require './bench/support'
+
+kernel_pool = SpiceRubBench.load_kernels
+# Frames, instruments and a spacecraft clock for the geometry, FOV and SCLK natives
+['sem.tf', 'instrument.ti', 'mk00062a.tsc'].each { |kernel| kernel_pool.load(kernel) }
+
+spice = SpiceRub::Native
+filter = ARGV[0] && Regexp.new(ARGV[0])
+
+et = spice.str2et('2006 JAN 31 01:00')
+craft_et = SpiceRubBench::ORBIT_START + 3600.0
+craft_epochs = Array.new(1000) { |index| SpiceRubBench::ORBIT_START + index * 86.0 }
+epochs = Array.new(1000) { |index| et + index * 3600.0 }
+epoch_matrix = NMatrix.new([1000, 1], epochs, dtype: :float64)
+points = NMatrix.new([1000, 3], Array.new(3000) { |index| 6000.0 + index }, dtype: :float64)
+point = SpiceRub::CartesianPoint.new([6378.0, 1200.0, 300.0])
+positions = NMatrix.new([1000, 3], 0.0, dtype: :float64)
+time = SpiceRub::Time.new(et)
+earth, moon = SpiceRub::Body[:earth], SpiceRub::Body[:moon]
+station = NMatrix.new([3, 1], [6378.0, 0.0, 0.0], dtype: :float64)
+station_state = NMatrix.new([6, 1], [6378.0, 0.0, 0.0, 0.0, 0.0, 0.0], dtype: :float64)
+moon_direction = spice.spkpos(:moon, et, :J2000, :none, :earth)[0]
+lunar_point = NMatrix.new([3, 1], [1737.4, 0.0, 0.0], dtype: :float64)
+spk_path = File.join(SpiceRubBench::KERNEL_PATH, 'de405_1960_2020.bsp')
+pck_path = File.join(SpiceRubBench::KERNEL_PATH, 'moon_pa_de421_1900-2050.bpc')
+confines = [spice.str2et('2007 JAN 1'), spice.str2et('2007 FEB 1')]
+distance = SpiceRub::Quantity.norm(SpiceRub::Quantity.position(:MOON, :EARTH))
+listener = ->(*) {}
+
+# A text kernel of its own, so loading and unloading it leaves the other kernels alone
+scratch_kernel = File.join(Dir.tmpdir, "spice_rub_bench_#{Process.pid}.tk")
+File.write(scratch_kernel, "\\begindata\nSPICE_RUB_BENCH = 1\n\\begintext\n")
+at_exit { File.delete(scratch_kernel) if File.exist?(scratch_kernel) }
+
+# Natives deliberately left out, printed after the table
+skipped = {
+  "ckcov"          => "no CK among the benchmark kernels",
+  "ckobj"          => "no CK among the benchmark kernels",
+  "gftfov"         => "needs an instrument frame kernel the benchmark kernels lack",
+  "gfrfov"         => "needs an instrument frame kernel the benchmark kernels lack",
+  "spkopn"         => "writes SPK files, run once to generate the benchmark SPK",
+  "spkw13"         => "writes SPK files, run once to generate the benchmark SPK",
+  "spkcls"         => "writes SPK files, run once to generate the benchmark SPK",
+  "kclear"         => "would unload the kernels the other benchmarks run on",
+  "pool_dump"      => "snapshots are measured by bench/macro.rb",
+  "pool_restore"   => "would replace the kernels the other benchmarks run on",
+  "reopen_kernels" => "only meaningful in a forked child, measured by bench/macro.rb",
+  "gf_control"     => "would change the control of every later search",
+  "gf_release"     => "would change the control of every later search",
+  "gf_cancel"      => "would cancel every later search",
+}
+
+benchmarks = {
+  # Time conversions
+  "Native.str2et"                => -> { spice.str2et('2006 JAN 31 01:00') },
+  "Native.timout"                => -> { spice.timout(et, 'YYYY MON DD HR:MN:SC.### ::UTC', 32) },
+  "Native.deltet"                => -> { spice.deltet(et, :et) },
+  "Native.unitim"                => -> { spice.unitim(et, :tdb, :tai) },
+  "Native.j2000"                 => -> { spice.j2000 },
+
+  # Names, constants and coverage
+  "Native.bodn2c"                => -> { spice.bodn2c(:moon) },
+  "Native.bodc2n"                => -> { spice.bodc2n(301) },
+  "Native.bodvrd"                => -> { spice.bodvrd(:earth, :RADII, 3) },
+  "Native.body_constants"        => -> { spice.body_constants(399) },
+  "Native.namfrm"                => -> { spice.namfrm(:IAU_EARTH) },
+  "Native.bodvcd"                => -> { spice.bodvcd(399, :RADII, 3) },
+  "Native.frinfo"                => -> { spice.frinfo(10013) },
+  "Native.ktotal"                => -> { spice.ktotal(:all) },
+  "Native.coverage"              => -> { spice.coverage(:spk, 301) },
+  "Native.coverage_window"       => -> { spice.coverage_window(:spk, 301) },
+  "Native.coverage_gaps x1000"   => -> { spice.coverage_gaps(:spk, [301, 399], epochs) },
+  "Native.coverage_kernels"      => -> { spice.coverage_kernels(:spk, [301], et) },
+  "Native.spkobj"                => -> { spice.spkobj(spk_path) },
+  "Native.spkcov"                => -> { spice.spkcov(spk_path, 301) },
+  "Native.pckfrm"                => -> { spice.pckfrm(pck_path) },
+  "Native.pckcov"                => -> { spice.pckcov(pck_path, 31006) },
+  "Native.getfov"                => -> { spice.getfov(-999001, 4, 32, 32) },
+  "Native.b1900"                 => -> { spice.b1900 },
+  "Native.b1950"                 => -> { spice.b1950 },
+  "Native.j1900"                 => -> { spice.j1900 },
+  "Native.j1950"                 => -> { spice.j1950 },
+  "Native.j2100"                 => -> { spice.j2100 },
+  "Native.dpr"                   => -> { spice.dpr },
+  "Native.rpd"                   => -> { spice.rpd },
+
+  # Spacecraft clock
+  "Native.sce2c"                 => -> { spice.sce2c(-77, 10000) },
+  "Native.sctiks"                => -> { spice.sctiks(-77, "      0:01:000") },
+  "Native.scencd"                => -> { spice.scencd(-77, "0:01:001") },
+  "Native.scdecd"                => -> { spice.scdecd(-77, 11389, 40) },
+  "Native.scs2e"                 => -> { spice.scs2e(-77, "11389.29.768") },
+  "Native.sct2e"                 => -> { spice.sct2e(-77, 11389.0) },
+
+  # Kernel pool
+  "Native.furnsh/unload"         => -> { spice.furnsh(scratch_kernel); spice.unload(scratch_kernel) },
+  "Native.pool_generation"       => -> { spice.pool_generation },
+  "Native.subscribe_pool/unsubscribe_pool" => -> { spice.unsubscribe_pool(spice.subscribe_pool(listener)) },
+  "Native.defer_pool_changes"    => -> { spice.defer_pool_changes {} },
+
+  # Scalar ephemerides
+  "Native.spkpos"                => -> { spice.spkpos(:moon, et, :J2000, :none, :earth) },
+  "Native.spkpos lt+s"           => -> { spice.spkpos(:moon, et, :J2000, :"LT+S", :earth) },
+  "Native.spkezr"                => -> { spice.spkezr(:moon, et, :J2000, :none, :earth) },
+  "Native.spkpos generated"      => -> { spice.spkpos(SpiceRubBench::SPACECRAFT.to_s.to_sym, craft_et, :J2000, :none, :earth) },
+  "Native.pxform"                => -> { spice.pxform(:J2000, :IAU_EARTH, et) },
+  "Native.pxform binary pck"     => -> { spice.pxform(:J2000, :MOON_PA, et) },
+  "Native.pxfrm2"                => -> { spice.pxfrm2(:IAU_EARTH, :J2000, et, et + 3600.0) },
+  "Native.sxform"                => -> { spice.sxform(:J2000, :IAU_EARTH, et) },
+  "Native.spkcpo"                => -> { spice.spkcpo(:moon, et, :IAU_EARTH, :OBSERVER, :none, station, :earth, :IAU_EARTH) },
+  "Native.spkcvo"                => -> { spice.spkcvo(:moon, et, :IAU_EARTH, :OBSERVER, :none, station_state, et, :earth, :IAU_EARTH) },
+  "Native.spkcpt"                => -> { spice.spkcpt(station, :earth, :IAU_EARTH, et, :J2000, :TARGET, :none, :moon) },
+  "Native.spkcvt"                => -> { spice.spkcvt(station_state, et, :earth, :IAU_EARTH, et, :J2000, :TARGET, :none, :moon) },
+
+  # Batches of 1000 epochs
+  "Native.spkpos_batch x1000"    => -> { spice.spkpos_batch(:moon, epochs, :J2000, :none, :earth, positions) },
+  "Native.spkezr_batch x1000"    => -> { spice.spkezr_batch(:moon, epochs, :J2000, :none, :earth, nil) },
+  "Native.spkpos_lt_batch x1000" => -> { spice.spkpos_lt_batch(:moon, epochs, :J2000, :cn, :earth, positions) },
+  "Native.spk_batch x1000"       => -> { spice.spk_batch(301, 399, epoch_matrix, :J2000, 3, 1, positions) },
+  "Native.spk_tensor 3x2x1000"   => -> { spice.spk_tensor([301, 499, 599], [399, 10], epochs, :J2000, :none, 3, nil) },
+  "Native.spk_snapshot 5 bodies" => -> { spice.spk_snapshot([199, 299, 301, 499, 599], 399, et, :J2000, :none, 6, nil) },
+  "Native.spk_requests x1000"    => -> { spice.spk_requests(301, 399, epochs, :J2000, :none, 3, true, positions) },
+  "Native.pxform_batch x1000"    => -> { spice.pxform_batch(:J2000, :MOON_PA, epochs, 1, nil) },
+  "Native.pck_angles x1000"      => -> { spice.pck_angles(31006, epochs, 3, 1, nil) },
+  "Native.recgeo_batch x1000"    => -> { spice.recgeo_batch(399, points, nil) },
+  "Native.recpgr_batch x1000"    => -> { spice.recpgr_batch(499, points, nil) },
+
+  # Coordinates
+  "Native.reclat"                => -> { spice.reclat(point) },
+  "Native.latrec"                => -> { spice.latrec(6378.0, 0.5, 0.25) },
+  "Native.recsph"                => -> { spice.recsph(point) },
+  "Native.sphrec"                => -> { spice.sphrec(6378.0, 0.5, 0.25) },
+  "Native.recgeo"                => -> { spice.recgeo(point, 6378.1366, 0.0033528) },
+  "Native.georec"                => -> { spice.georec(0.5, 0.25, 10.0, 6378.1366, 0.0033528) },
+  "Native.recrad"                => -> { spice.recrad(point) },
+  "Native.radrec"                => -> { spice.radrec(1.0, 0.5, 0.25) },
+  "Native.latsph"                => -> { spice.latsph(6378.0, 0.5, 0.25) },
+  "Native.sphlat"                => -> { spice.sphlat(6378.0, 0.5, 0.25) },
+  "Native.srfrec"                => -> { spice.srfrec(399, 0.5, 0.25) },
+  "Native.recpgr"                => -> { spice.recpgr(:earth, point, 6378.1366, 0.0033528) },
+  "Native.pgrrec"                => -> { spice.pgrrec(:earth, 0.5, 0.25, 10.0, 6378.1366, 0.0033528) },
+
+  # Geometry
+  "Native.sincpt"                => -> { spice.sincpt("Ellipsoid", :moon, et, :IAU_MOON, :none, :earth, :J2000, moon_direction) },
+  "Native.subpnt"                => -> { spice.subpnt("Near point: ellipsoid", :moon, et, :IAU_MOON, :none, :earth) },
+  "Native.subslr"                => -> { spice.subslr("Near point: ellipsoid", :moon, et, :IAU_MOON, :none, :earth) },
+  "Native.lspcn"                 => -> { spice.lspcn(:earth, et, :none) },
+  "Native.phaseq"                => -> { spice.phaseq(et, :moon, :sun, :earth, :none) },
+
+  # GF searches over one month, one step per day
+  "Native.gfdist"                => -> { spice.gfdist(:MOON, :NONE, :EARTH, :<, 400000, 0, spice.spd, 100, confines) },
+  "Native.gfposc"                => -> { spice.gfposc(:MOON, :J2000, :NONE, :EARTH, :LATITUDINAL, :LATITUDE, :>, 0, 0, spice.spd, 100, confines) },
+  "Native.gfsntc"                => -> { spice.gfsntc(:EARTH, :IAU_EARTH, :Ellipsoid, :NONE, :SUN, :SEM, NMatrix.new([3, 1], [1.0, 0, 0]), :LATITUDINAL, :LATITUDE, :>, 0, 0, spice.spd, 100, confines) },
+  "Native.gfsep"                 => -> { spice.gfsep(:MOON, :SPHERE, :NULL, :EARTH, :SPHERE, :NULL, :NONE, :SUN, :LOCMAX, 0, 0, 6 * spice.spd, 40, confines) },
+  "Native.gfoclt"                => -> { spice.gfoclt(:any, :MOON, :Ellipsoid, :IAU_MOON, :Sun, :Ellipsoid, :iau_sun, :lt, :earth, 3600.0, confines) },
+  "Native.gfilum"                => -> { spice.gfilum(:Ellipsoid, :PHASE, :MOON, :SUN, :IAU_MOON, :NONE, :EARTH, lunar_point, :<, 1, 0, spice.spd, 100, confines) },
+  "Native.gfpa"                  => -> { spice.gfpa(:MOON, :SUN, :NONE, :EARTH, :<, 1, 0, spice.spd, 100, confines) },
+  "Native.gfrr"                  => -> { spice.gfrr(:MOON, :NONE, :EARTH, :>, 0, 0, spice.spd, 100, confines) },
+  "Native.gfuds"                 => -> { spice.gfuds(distance, :<, 400000, 0, spice.spd, 100, confines) },
+  "Native.gfudb"                 => -> { spice.gfudb(SpiceRub::Quantity.lt(distance, 400000), spice.spd, confines) },
+  "Native.gfuds_batch 2"         => -> { spice.gfuds_batch(distance, [[:<, 370000], [:>, 400000]], 0, spice.spd, 100, confines) },
+  "Native.quantity_values x1000" => -> { spice.quantity_values(distance, epochs) },
+  "Native.gf_status"             => -> { spice.gf_status },
+
+  # Ruby level API
+  "Time.parse"                   => -> { SpiceRub::Time.parse('2006 JAN 31 01:00') },
+  "Time#+"                       => -> { time + 60 },
+  "Time#to_utc"                  => -> { time.to_utc },
+  "Time.time_series x168"        => -> { SpiceRub::Time.time_series(time, time + 7 * 86400, step: 3600) },
+  "Body[]"                       => -> { SpiceRub::Body[:moon] },
+  "Body.new"                     => -> { SpiceRub::Body.new(:moon) },
+  "Body#position_at"             => -> { moon.position_at(time, observer: :earth) },
+  "Body#state_at"                => -> { moon.state_at(time, observer: :earth) },
+  "Body#distance_from"           => -> { earth.distance_from(moon, time) },
+  "Body#position_matrix x1000"   => -> { moon.position_matrix(epochs, observer: :earth, out: positions) },
+  "Body.query x1000"             => -> { SpiceRub::Body.query(301, 399, epochs, velocities: false, out: positions) },
+  "Body.query generated x1000"   => -> { SpiceRub::Body.query(SpiceRubBench::SPACECRAFT, 399, craft_epochs, velocities: false, out: positions) },
+  "Body.snapshot 5 bodies"       => -> { SpiceRub::Body.snapshot([199, 299, 301, 499, 599], et, observer: :earth) },
+  "Body#geodetic x1000"          => -> { earth.geodetic(points) },
+  "CartesianPoint.new"           => -> { SpiceRub::CartesianPoint.new([6378.0, 1200.0, 300.0]) },
+  "CartesianPoint#to_latitudinal"=> -> { point.to_latitudinal },
+  "CartesianPoint#to_spherical"  => -> { point.to_spherical },
+  "CartesianPoint#to_geodetic"   => -> { point.to_geodetic(399) },
+}
+
+results = benchmarks.select { |name, _| filter.nil? or name =~ filter }.map do |name, function|
+  result = SpiceRubBench.measure(name, &function)
+
+  if result[:error]
+    printf("%-32s %s\n", name, result[:error])
+  else
+    printf("%-32s %14.1f ns/op %10.2f allocs/op %5d GC\n", name, result[:ns_per_op], result[:allocations_per_op], result[:gc_runs])
+  end
+
+  result
+end
+
+benchmarked = benchmarks.keys.flat_map { |name| name[/\ANative\.([\w\/]+)/, 1].to_s.split("/") }
+unknown = spice.singleton_methods.map(&:to_s) - benchmarked - skipped.keys
+
+puts "Skipped natives :"
+skipped.each { |name, reason| printf("  %-30s %s\n", "Native.#{name}", reason) }
+puts "  #{unknown.sort.map { |name| "Native.#{name}" }.join(", ")} : not benchmarked yet" unless unknown.empty?
+
+puts "Results written to #{SpiceRubBench.write_results("micro", results)}"
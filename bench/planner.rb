@@ -0,0 +1,35 @@
+#--
+# = SpiceRub
+#
+# == bench/planner.rb
+#
+# Throughput of Body.query over requests in random order, evaluated in
+# input order and through the query planner.
+#
+#   ruby -Ilib bench/planner.rb [requests]
+#
+#++
+
+require 'benchmark'
+require 'nmatrix'
+require './lib/spice_rub'
+
+kernel_pool = SpiceRub::KernelPool.instance
+kernel_pool.path = 'spec/data/kernels'
+['naif0011.tls', 'de405_1960_2020.bsp'].each { |kernel| kernel_pool.load(kernel) }
+
+count = (ARGV[0] || 100_000).to_i
+bodies = [1, 2, 3, 4, 5, 6, 10, 199, 299, 301, 399, 499]
+start, finish = SpiceRub::Native.str2et('1961 JAN 01'), SpiceRub::Native.str2et('2019 DEC 01')
+random = Random.new(42)
+
+targets = Array.new(count) { bodies.sample(random: random) }
+epochs = Array.new(count) { start + random.rand * (finish - start) }
+
+#Warm up CSPICE's buffers and the coverage index before timing either order
+SpiceRub::Body.query(targets.first(1000), :sun, epochs.first(1000), plan: true)
+
+[false, true].each do |plan|
+  seconds = Benchmark.realtime { SpiceRub::Body.query(targets, :sun, epochs, plan: plan) }
+  printf("%-10s %10d requests %8.3f s %12.0f requests/s\n", plan ? "planned" : "unplanned", count, seconds, count / seconds)
+end
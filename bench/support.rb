@@ -0,0 +1,138 @@
+#--
+# = SpiceRub
+#
+# == bench/support.rb
+#
+# Shared setup of the benchmark suites: kernel loading, a generated SPK for
+# a synthetic spacecraft, timing with allocation and GC counts, and JSON
+# result files named after the git revision so runs can be compared.
+#
+#++
+
+require 'json'
+require 'time'
+require 'tmpdir'
+require 'fileutils'
+require 'nmatrix'
+require './lib/spice_rub'
+
+module SpiceRubBench
+  KERNEL_PATH = 'spec/data/kernels'
+  KERNELS = ['naif0011.tls', 'de405_1960_2020.bsp', 'moon_pa_de421_1900-2050.bpc', 'pck00010.tpc']
+  MOON_FRAMES = 'spec/data/moon.tf'
+  RESULTS = 'bench/results'
+
+  # Synthetic spacecraft of the generated SPK, on a circular low Earth orbit
+  SPACECRAFT = -999100
+  ORBIT_RADIUS = 7000.0
+  ORBIT_PERIOD = 5828.5
+  ORBIT_START = 0.0
+  ORBIT_STEP = 60.0
+  ORBIT_STATES = 1441
+
+  module_function
+
+  def load_kernels(spk = generated_spk)
+    kernel_pool = SpiceRub::KernelPool.instance
+    kernel_pool.clear! unless kernel_pool.empty?
+    kernel_pool.path = KERNEL_PATH
+    KERNELS.each { |kernel| kernel_pool.load(kernel) }
+    kernel_pool.load(MOON_FRAMES, absolute: true)
+    kernel_pool.load(spk, absolute: true)
+    kernel_pool
+  end
+
+  # Writes one day of the synthetic spacecraft relative to the Earth as a type 13 SPK
+  def generated_spk
+    path = File.join(Dir.tmpdir, "spice_rub_bench_#{Process.pid}.bsp")
+    File.delete(path) if File.exist?(path)
+
+    rate = 2 * Math::PI / ORBIT_PERIOD
+    epochs = Array.new(ORBIT_STATES) { |index| ORBIT_START + index * ORBIT_STEP }
+    states = epochs.flat_map do |et|
+      angle = rate * (et - ORBIT_START)
+      [ORBIT_RADIUS * Math.cos(angle), ORBIT_RADIUS * Math.sin(angle), 0.0,
+       -ORBIT_RADIUS * rate * Math.sin(angle), ORBIT_RADIUS * rate * Math.cos(angle), 0.0]
+    end
+
+    handle = SpiceRub::Native.spkopn(path, "spice_rub bench", 0)
+    SpiceRub::Native.spkw13(handle, SPACECRAFT, 399, :J2000, epochs.first, epochs.last, "BENCH ORBIT", 7,
+                            NMatrix.new([ORBIT_STATES, 6], states, dtype: :float64), epochs)
+    SpiceRub::Native.spkcls(handle)
+
+    at_exit { File.delete(path) if File.exist?(path) }
+    path
+  end
+
+  # Peak resident set size of this process in kB, nil where /proc is missing
+  def peak_rss
+    File.read("/proc/self/status")[/^VmHWM:\s+(\d+)/, 1]&.to_i
+  rescue SystemCallError
+    nil
+  end
+
+  # Current resident set size of this process in kB, nil where /proc is missing
+  def rss
+    File.read("/proc/self/status")[/^VmRSS:\s+(\d+)/, 1]&.to_i
+  rescue SystemCallError
+    nil
+  end
+
+  # Resets the peak to the current resident set size (Linux 4.0 and later), a
+  # forked child otherwise inherits the peak of its parent
+  def reset_peak_rss
+    File.write("/proc/self/clear_refs", "5")
+    true
+  rescue SystemCallError
+    false
+  end
+
+  def monotonic
+    Process.clock_gettime(Process::CLOCK_MONOTONIC)
+  end
+
+  #
+  # Times +block+ over enough iterations to fill about +seconds+ after a short
+  # warm up. Returns a Hash with ns/op, Ruby objects allocated per op and the
+  # number of GC runs, or the error when the block raises.
+  #
+  def measure(name, seconds: 0.25, &block)
+    3.times { yield }
+
+    iterations = 1
+    iterations *= 2 while iterations < 1_000_000 and timed(iterations, &block) < seconds / 8
+    iterations *= 8
+
+    GC.start
+    allocated, gc_runs = GC.stat(:total_allocated_objects), GC.count
+    elapsed = timed(iterations, &block)
+
+    { name: name,
+      iterations: iterations,
+      ns_per_op: (elapsed * 1e9 / iterations).round(1),
+      allocations_per_op: ((GC.stat(:total_allocated_objects) - allocated).to_f / iterations).round(2),
+      gc_runs: GC.count - gc_runs }
+  rescue StandardError => e
+    { name: name, error: "#{e.class}: #{e.message.strip}" }
+  end
+
+  def timed(iterations)
+    started = monotonic
+    iterations.times { yield }
+    monotonic - started
+  end
+
+  def revision
+    `git rev-parse --short HEAD 2>/dev/null`.strip.then { |sha| sha.empty? ? "unknown" : sha }
+  end
+
+  # Writes the results of suite +kind+, BENCH_OUTPUT overrides the file name
+  def write_results(kind, results)
+    path = ENV['BENCH_OUTPUT'] || File.join(RESULTS, "#{kind}-#{revision}.json")
+    FileUtils.mkdir_p(File.dirname(path))
+
+    File.write(path, JSON.pretty_generate(suite: kind, revision: revision, ruby: RUBY_DESCRIPTION,
+                                          recorded_at: Time.now.utc.iso8601, results: results))
+    path
+  end
+end
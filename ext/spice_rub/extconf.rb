@@ -21,6 +21,16 @@ abort "Cannot locate necessary header files : SpiceUsr.h" unless find_header("Sp
 abort "C SPICE Library is not exposed (Incorrect Configuration/Invalid installation)" unless find_library("cspice", "furnsh_c")
 abort "C SPICE Library is not exposed (Incorrect Configuration/Invalid installation)" unless find_library("cspice", "spkez_c")
 
+#The native SPK reader maps kernels and evaluates batches on a thread pool
+abort "Cannot locate POSIX threads" unless have_library("pthread", "pthread_create")
+abort "Cannot locate necessary header files : sys/mman.h" unless have_header("sys/mman.h")
+
+#USDT probes for perf, bpftrace and systemtap : gem install spice_rub -- --enable-usdt
+if enable_config("usdt", false)
+  abort "Cannot locate necessary header files : sys/sdt.h (systemtap-sdt-dev)" unless have_header("sys/sdt.h")
+  $defs.push("-DSR_USDT")
+end
+
 $defs.push("-std=gnu99")
 #$defs.push("-Wall")
 #$defs.push("-Werror")
@@ -0,0 +1,139 @@
+#include "spice_bodies.h"
+
+/* Body name/code registry.
+
+ bodn2c_c and bodc2n_c search CSPICE's name tables on every call, and the Ruby wrappers used to add a heap
+ buffer and a Symbol lookup on top. Both directions are memoised here in st_tables keyed by NAIF code and
+ by normalised name (upper case, runs of blanks collapsed, as bodn2c_c compares them). Names assigned in
+ kernels through NAIF_BODY_NAME/NAIF_BODY_CODE are preloaded the first time the registry is used after a
+ kernel pool change; built-in names, which CSPICE gives no way to enumerate, are memoised on first use.
+ Misses are remembered too, so a loop over an unknown name does not search again either.
+
+ The tables are dropped on the first use after the kernel pool generation changed.
+*/
+
+//Body names are up to 36 characters, plus the terminating NUL
+#define SR_BODIES_NAMELEN 37
+#define SR_BODIES_CHUNK 100
+#define SR_BODIES_MISSING INT_MIN
+
+static st_table * codes = NULL;   //normalised name -> code, SR_BODIES_MISSING when unknown
+static st_table * names = NULL;   //code -> Symbol, Qnil when unknown
+//Kernel pool generation the tables were filled for
+static unsigned long filled_for = 0;
+
+static void normalise(const char * name, char * key) {
+  int length = 0;
+  bool blank = false;
+
+  while (isspace((unsigned char) *name)) name++;
+
+  for (; *name && length < SR_BODIES_NAMELEN - 1; name++) {
+    if (isspace((unsigned char) *name)) {
+      blank = true;
+      continue;
+    }
+
+    if (blank && length < SR_BODIES_NAMELEN - 2) key[length++] = ' ';
+    key[length++] = toupper((unsigned char) *name);
+    blank = false;
+  }
+
+  key[length] = '\0';
+}
+
+static int free_key(st_data_t key, st_data_t value, st_data_t unused) {
+  xfree((char *) key);
+  return ST_DELETE;
+}
+
+static void clear_tables(void) {
+  st_foreach(codes, free_key, 0);
+  st_clear(names);
+}
+
+static void remember_code(const char * key, SpiceInt code) {
+  //st_insert keeps the stored key of an existing entry, so only new entries need a copy
+  if (st_lookup(codes, (st_data_t) key, NULL)) st_insert(codes, (st_data_t) key, (st_data_t) code);
+  else st_insert(codes, (st_data_t) ruby_strdup(key), (st_data_t) code);
+}
+
+/* Kernel defined names, read in chunks of the NAIF_BODY_NAME and NAIF_BODY_CODE pool variables */
+static void preload(void) {
+  char chunk[SR_BODIES_CHUNK][SR_BODIES_NAMELEN], key[SR_BODIES_NAMELEN];
+  SpiceInt values[SR_BODIES_CHUNK], name_count, code_count, start, index;
+  SpiceBoolean found_names, found_codes;
+
+  if (!codes) {
+    codes = st_init_strtable();
+    names = st_init_numtable();
+  }
+
+  if (filled_for == sr_pool_generation()) return;
+
+  clear_tables();
+
+  for (start = 0; ; start += SR_BODIES_CHUNK) {
+    gcpool_c("NAIF_BODY_NAME", start, SR_BODIES_CHUNK, SR_BODIES_NAMELEN, &name_count, chunk, &found_names);
+    gipool_c("NAIF_BODY_CODE", start, SR_BODIES_CHUNK, &code_count, values, &found_codes);
+
+    if (failed_c() || !found_names || !found_codes) break;
+
+    //Later assignments win in CSPICE, and these run in assignment order
+    for (index = 0; index < name_count && index < code_count; index++) {
+      normalise(chunk[index], key);
+      remember_code(key, values[index]);
+    }
+
+    if (name_count < SR_BODIES_CHUNK) break;
+  }
+
+  //A failed read, or an error pending before the call, is raised and the tables are filled again on next use
+  spice_error(SPICE_ERROR_SHORT);
+
+  filled_for = sr_pool_generation();
+}
+
+bool sr_bodies_code(const char * name, SpiceInt * code) {
+  char key[SR_BODIES_NAMELEN];
+  st_data_t cached;
+  SpiceBoolean found;
+
+  preload();
+  normalise(name, key);
+
+  if (st_lookup(codes, (st_data_t) key, &cached)) sr_cache_count(SR_CACHE_BODIES, true);
+  else {
+    sr_cache_count(SR_CACHE_BODIES, false);
+    bodn2c_c(name, code, &found);
+    if (failed_c()) return false;
+
+    cached = found ? (st_data_t) *code : (st_data_t) SR_BODIES_MISSING;
+    remember_code(key, (SpiceInt) cached);
+  }
+
+  *code = (SpiceInt) cached;
+
+  return (SpiceInt) cached != SR_BODIES_MISSING;
+}
+
+VALUE sr_bodies_name(SpiceInt code) {
+  char name[SR_BODIES_NAMELEN];
+  st_data_t cached;
+  SpiceBoolean found;
+
+  preload();
+
+  if (st_lookup(names, (st_data_t) code, &cached)) sr_cache_count(SR_CACHE_BODIES, true);
+  else {
+    sr_cache_count(SR_CACHE_BODIES, false);
+    bodc2n_c(code, SR_BODIES_NAMELEN, name, &found);
+    if (failed_c()) return Qnil;
+
+    //Symbols from rb_intern are never collected, so the table needs no marking
+    cached = found ? (st_data_t) RB_STR2SYM(name) : (st_data_t) Qnil;
+    st_insert(names, (st_data_t) code, cached);
+  }
+
+  return (VALUE) cached;
+}
@@ -0,0 +1,15 @@
+#include "ruby.h"
+#include "SpiceUsr.h"
+#include <stdbool.h>
+#include <ctype.h>
+#include <limits.h>
+#include "ruby/st.h"
+#include "ruby/util.h"
+#include "spice_rub_utils.h"
+#include "spice_generation.h"
+#include "spice_stats.h"
+
+//Cached bodn2c_c and bodc2n_c, the name is returned as an interned Symbol or Qnil. Both raise SpiceError
+//when the kernel defined names cannot be read
+bool sr_bodies_code(const char * name, SpiceInt * code);
+VALUE sr_bodies_name(SpiceInt code);
@@ -0,0 +1,119 @@
+#include "spice_buffer.h"
+
+/* Buffer layer between NMatrix and CSPICE.
+
+ CSPICE reads and writes plain double arrays, so an NMatrix may only be handed to it when it is dense,
+ float64 and owns its storage (a slice references the storage of its parent, with offsets and strides
+ CSPICE knows nothing about). Every input is checked once here instead of trusting whatever the caller
+ passed, and results are allocated as NMatrix storage up front so CSPICE writes straight into them.
+*/
+
+size_t sr_dense_count(VALUE matrix) {
+  size_t count = 1, dimension;
+
+  for (dimension = 0; dimension < NM_DIM(matrix); dimension++) count *= NM_SHAPE(matrix, dimension);
+
+  return count;
+}
+
+static void check_dense(VALUE matrix) {
+  if (!rb_obj_is_kind_of(matrix, cNMatrix))
+    rb_raise(rb_eTypeError, "expected an NMatrix, got %s", rb_obj_classname(matrix));
+  if (NM_STYPE(matrix) != DENSE_STORE)
+    rb_raise(rb_eTypeError, "expected a dense NMatrix");
+  if (NM_DTYPE(matrix) != FLOAT64)
+    rb_raise(rb_eTypeError, "expected a float64 NMatrix");
+  if (NM_SRC(matrix) != NM_STORAGE(matrix))
+    rb_raise(rb_eArgError, "NMatrix slices are not contiguous, pass a copy (#dup)");
+}
+
+/* Returns the elements of a dense float64 NMatrix holding exactly count values */
+double * sr_dense_buffer(VALUE matrix, size_t count) {
+  check_dense(matrix);
+
+  if (sr_dense_count(matrix) != count)
+    rb_raise(rb_eArgError, "expected an NMatrix of %lu elements, got %lu", (unsigned long) count, (unsigned long) sr_dense_count(matrix));
+
+  return NM_STORAGE_DENSE(matrix)->elements;
+}
+
+/* Returns the elements of a dense float64 NMatrix of shape rows x columns */
+double * sr_dense_matrix(VALUE matrix, size_t rows, size_t columns) {
+  check_dense(matrix);
+
+  if (NM_DIM(matrix) != 2 || NM_SHAPE(matrix, 0) != rows || NM_SHAPE(matrix, 1) != columns)
+    rb_raise(rb_eArgError, "expected a %lux%lu NMatrix", (unsigned long) rows, (unsigned long) columns);
+
+  return NM_STORAGE_DENSE(matrix)->elements;
+}
+
+double * sr_dense_elements(VALUE matrix) {
+  return NM_STORAGE_DENSE(matrix)->elements;
+}
+
+/* Allocates a zeroed float64 NMatrix of any shape for CSPICE to write into, empty dimensions (an empty batch) included */
+VALUE sr_dense_alloc_shape(size_t * shape, size_t dimensions) {
+  double zero = 0.0;
+
+  //NMatrix repeats a short initial buffer over the whole storage, so nothing is staged on our side
+  return rb_nmatrix_dense_create(FLOAT64, shape, dimensions, (void *) &zero, 1);
+}
+
+/* Allocates a zeroed rows x columns float64 NMatrix */
+VALUE sr_dense_alloc(size_t rows, size_t columns) {
+  size_t shape[2] = {rows, columns};
+
+  return sr_dense_alloc_shape(shape, 2);
+}
+
+/* Returns out if it can take a rows x columns result, or a new matrix when out is nil */
+VALUE sr_dense_output(VALUE out, size_t rows, size_t columns) {
+  if (NIL_P(out)) return sr_dense_alloc(rows, columns);
+
+  sr_dense_matrix(out, rows, columns);
+
+  return out;
+}
+
+/* sr_dense_output for results of any shape */
+VALUE sr_dense_output_shape(VALUE out, size_t * shape, size_t dimensions) {
+  size_t dimension;
+
+  if (NIL_P(out)) return sr_dense_alloc_shape(shape, dimensions);
+
+  check_dense(out);
+
+  if (NM_DIM(out) != dimensions)
+    rb_raise(rb_eArgError, "expected an NMatrix of %lu dimensions", (unsigned long) dimensions);
+
+  for (dimension = 0; dimension < dimensions; dimension++)
+    if (NM_SHAPE(out, dimension) != shape[dimension])
+      rb_raise(rb_eArgError, "NMatrix dimension %lu should be %lu", (unsigned long) dimension, (unsigned long) shape[dimension]);
+
+  return out;
+}
+
+/*
+ Returns a dense float64 NMatrix of epochs and sets count: a valid epoch matrix is used as is, an Array of
+ epochs is copied into a new N x 1 matrix. The buffer is owned by Ruby, so a conversion error
+ halfway through leaks nothing.
+*/
+VALUE sr_epochs_from(VALUE ets, long * count) {
+  VALUE rb_epochs;
+  double * epochs;
+  long index;
+
+  if (!RB_TYPE_P(ets, T_ARRAY)) {
+    check_dense(ets);
+    *count = sr_dense_count(ets);
+    return ets;
+  }
+
+  *count = RARRAY_LEN(ets);
+  rb_epochs = sr_dense_alloc(*count, 1);
+  epochs = sr_dense_elements(rb_epochs);
+
+  for (index = 0; index < *count; index++) epochs[index] = NUM2DBL(rb_to_float(RARRAY_AREF(ets, index)));
+
+  return rb_epochs;
+}
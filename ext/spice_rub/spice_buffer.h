@@ -0,0 +1,16 @@
+#include "ruby.h"
+#include "SpiceUsr.h"
+#include <stdbool.h>
+#include "spice_rub_utils.h"
+#include "nmatrix.h"
+
+//Validated access to dense float64 NMatrix storage, see spice_buffer.c
+size_t sr_dense_count(VALUE matrix);
+double * sr_dense_buffer(VALUE matrix, size_t count);
+double * sr_dense_matrix(VALUE matrix, size_t rows, size_t columns);
+VALUE sr_dense_alloc_shape(size_t * shape, size_t dimensions);
+VALUE sr_dense_alloc(size_t rows, size_t columns);
+VALUE sr_dense_output(VALUE out, size_t rows, size_t columns);
+VALUE sr_dense_output_shape(VALUE out, size_t * shape, size_t dimensions);
+double * sr_dense_elements(VALUE matrix);
+VALUE sr_epochs_from(VALUE ets, long * count);
@@ -0,0 +1,198 @@
+#include "spice_constants.h"
+#include <math.h>
+
+/* Body constants cache.
+
+ Radii, GM and the pole and prime meridian coefficients of a body are read from the kernel pool with
+ bodvcd_c the first time the body is used and kept until the kernel pool generation changes. Batch
+ coordinate conversions take their ellipsoid from here, so converting N points costs one lookup instead
+ of N calls that each search the pool for the radii, and recpgr_c's per call search for the longitude
+ sense is replaced by one made when the body is cached.
+*/
+
+#define SR_CONSTANTS_NAMELEN 36
+#define SR_CONSTANTS_KEYLEN 64
+
+static st_table * bodies = NULL;
+
+static int free_constants(st_data_t key, st_data_t value, st_data_t unused) {
+  xfree((sr_body_constants *) value);
+  return ST_DELETE;
+}
+
+//Kernel pool generation the cached bodies were read from
+static unsigned long read_for = 0;
+
+static bool read_item(SpiceInt code, const char * item, int size, double * values) {
+  SpiceInt count;
+
+  memset(values, 0, size * sizeof(double));
+  if (!bodfnd_c(code, item)) return false;
+
+  bodvcd_c(code, item, size, &count, values);
+
+  return !failed_c();
+}
+
+/*
+ The rules of recpgr_c: the Earth, Moon and Sun count longitude eastwards, other bodies westwards when
+ they rotate prograde, unless BODY<code>_PGR_POSITIVE_LON says otherwise. Without either the sense is left
+ unknown, recpgr_c signals SPICE(MISSINGDATA) for such bodies.
+*/
+static void longitude_sense(SpiceInt code, sr_body_constants * constants) {
+  char key[SR_CONSTANTS_KEYLEN], sense[SR_CONSTANTS_NAMELEN];
+  SpiceInt count;
+  SpiceBoolean found;
+
+  snprintf(key, sizeof(key), "BODY%d_PGR_POSITIVE_LON", code);
+  gcpool_c(key, 0, 1, SR_CONSTANTS_NAMELEN, &count, sense, &found);
+
+  constants->has_sense = true;
+
+  if (found) constants->positive_west = eqstr_c(sense, "WEST");
+  else if (code == 399 || code == 301 || code == 10) constants->positive_west = false;
+  else if (constants->has_pm) constants->positive_west = constants->pm[1] >= 0.0;
+  else constants->has_sense = constants->positive_west = false;
+}
+
+const sr_body_constants * sr_constants_of(SpiceInt code) {
+  sr_body_constants * constants;
+  st_data_t cached;
+
+  if (!bodies) bodies = st_init_numtable();
+
+  if (read_for != sr_pool_generation()) {
+    st_foreach(bodies, free_constants, 0);
+    read_for = sr_pool_generation();
+  }
+
+  if (st_lookup(bodies, (st_data_t) code, &cached)) {
+    sr_cache_count(SR_CACHE_CONSTANTS, true);
+    return (const sr_body_constants *) cached;
+  }
+
+  sr_cache_count(SR_CACHE_CONSTANTS, false);
+
+  constants = ALLOC(sr_body_constants);
+  constants->has_radii = read_item(code, "RADII", 3, constants->radii);
+  constants->has_gm = read_item(code, "GM", 1, &constants->gm);
+  constants->has_pole = read_item(code, "POLE_RA", 3, constants->pole_ra) & read_item(code, "POLE_DEC", 3, constants->pole_dec);
+  constants->has_pm = read_item(code, "PM", 3, constants->pm);
+  longitude_sense(code, constants);
+
+  //A failed lookup is reported by the caller and not cached
+  if (failed_c()) {
+    xfree(constants);
+    return NULL;
+  }
+
+  st_insert(bodies, (st_data_t) code, (st_data_t) constants);
+
+  return constants;
+}
+
+/* Constants of a body with radii, raising when the kernel pool has none */
+static const sr_body_constants * ellipsoid_of(VALUE body, double * equatorial, double * flattening) {
+  SpiceInt code = sr_body_code(body);
+  const sr_body_constants * constants = sr_constants_of(code);
+
+  spice_error(SPICE_ERROR_SHORT);
+  if (!constants->has_radii) rb_raise(rb_spice_error, "no radii for body %d in the kernel pool", code);
+
+  *equatorial = constants->radii[0];
+  *flattening = (constants->radii[0] - constants->radii[2]) / constants->radii[0];
+
+  return constants;
+}
+
+static VALUE pack(const double * values, int count) {
+  VALUE rb_values = rb_ary_new2(count);
+  int index;
+
+  for (index = 0; index < count; index++) rb_ary_push(rb_values, DBL2NUM(values[index]));
+
+  return rb_values;
+}
+
+/* Cached constants of a body as a Hash holding :radii, :gm, :pole_ra, :pole_dec and :pm when known */
+VALUE sr_body_constants_of(VALUE self, VALUE body) {
+  const sr_body_constants * constants;
+  VALUE result = rb_hash_new();
+
+  SR_NATIVE_ENTRY("body_constants", 1, 1);
+
+  constants = sr_constants_of(sr_body_code(body));
+  SR_NATIVE_EXIT("body_constants", failed_c());
+  if (spice_error(SPICE_ERROR_SHORT)) return Qnil;
+
+  if (constants->has_radii) rb_hash_aset(result, RB_STR2SYM("radii"), pack(constants->radii, 3));
+  if (constants->has_gm) rb_hash_aset(result, RB_STR2SYM("gm"), DBL2NUM(constants->gm));
+  if (constants->has_pole) {
+    rb_hash_aset(result, RB_STR2SYM("pole_ra"), pack(constants->pole_ra, 3));
+    rb_hash_aset(result, RB_STR2SYM("pole_dec"), pack(constants->pole_dec, 3));
+  }
+  if (constants->has_pm) rb_hash_aset(result, RB_STR2SYM("pm"), pack(constants->pm, 3));
+
+  return result;
+}
+
+/* Geodetic rows of points on an ellipsoid, into out when given, counted in *count */
+static VALUE geodetic_rows(const char * function, double equatorial, double flattening, VALUE points, VALUE out, long * count) {
+  double * input, * output;
+  long index;
+  VALUE rb_output;
+
+  *count = sr_dense_count(points) / 3;
+  input = sr_dense_buffer(points, 3 * *count);
+  rb_output = sr_dense_output(out, *count, 3);
+  output = sr_dense_elements(rb_output);
+
+  SR_NATIVE_ENTRY(function, 3, *count);
+
+  for (index = 0; index < *count; index++) {
+    recgeo_c(input + 3 * index, equatorial, flattening, output + 3 * index, output + 3 * index + 1, output + 3 * index + 2);
+  }
+
+  SR_NATIVE_EXIT(function, failed_c());
+  spice_error(SPICE_ERROR_SHORT);
+
+  return rb_output;
+}
+
+/*
+ Geodetic co-ordinates of points, an N x 3 (or any 3N element) dense float64 NMatrix of rectangular
+ co-ordinates in the body fixed frame of body, on the body's reference ellipsoid. Returns N x 3
+ [longitude, latitude, altitude] rows, written into out when given.
+*/
+VALUE sr_recgeo_batch(VALUE self, VALUE body, VALUE points, VALUE out) {
+  double equatorial, flattening;
+  long count;
+
+  ellipsoid_of(body, &equatorial, &flattening);
+
+  return geodetic_rows("recgeo_batch", equatorial, flattening, points, out, &count);
+}
+
+/*
+ Planetographic counterpart of sr_recgeo_batch, longitudes in [0, 2pi) as recpgr_c returns them. Raises
+ like recpgr_c when the kernel pool does not tell which way the body's longitudes grow.
+*/
+VALUE sr_recpgr_batch(VALUE self, VALUE body, VALUE points, VALUE out) {
+  double equatorial, flattening, * output;
+  const sr_body_constants * constants = ellipsoid_of(body, &equatorial, &flattening);
+  long count, index;
+  VALUE rb_output;
+
+  if (!constants->has_sense) rb_raise(rb_spice_error, "SPICE(MISSINGDATA): no prime meridian data for body %d in the kernel pool", sr_body_code(body));
+
+  rb_output = geodetic_rows("recpgr_batch", equatorial, flattening, points, out, &count);
+  output = sr_dense_elements(rb_output);
+
+  for (index = 0; index < count; index++) {
+    double longitude = constants->positive_west ? -output[3 * index] : output[3 * index];
+
+    output[3 * index] = longitude < 0.0 ? longitude + twopi_c() : longitude;
+  }
+
+  return rb_output;
+}
@@ -0,0 +1,23 @@
+#include "ruby.h"
+#include "SpiceUsr.h"
+#include <stdbool.h>
+#include "ruby/st.h"
+#include "spice_rub_utils.h"
+#include "nmatrix.h"
+#include "spice_buffer.h"
+#include "spice_tensor.h"
+#include "spice_generation.h"
+#include "spice_stats.h"
+
+extern VALUE rb_spice_error;
+
+//Constants of one body as read from the kernel pool, each group flagged when present
+typedef struct {
+  bool has_radii, has_gm, has_pole, has_pm;
+  double radii[3], gm, pole_ra[3], pole_dec[3], pm[3];
+  //Planetographic longitudes grow westwards, only known when has_sense is set
+  bool has_sense, positive_west;
+} sr_body_constants;
+
+//Cached constants of a body, NULL when reading the kernel pool failed
+const sr_body_constants * sr_constants_of(SpiceInt code);
@@ -0,0 +1,746 @@
+#include "spice_coverage.h"
+#include "ruby/st.h"
+
+/* Coverage index for loaded binary kernels.
+
+ Every SPK, binary PCK and CK file that enters the kernel pool is summarised once with spkobj_c/spkcov_c,
+ pckfrm_c/pckcov_c or ckobj_c/ckcov_c. The resulting windows are filed per (kind, body/frame) entry as
+ intervals tagged with the kernel they came from, so queries never touch the files again.
+
+ Each entry keeps its intervals sorted by start time and indexed as an implicit augmented interval tree
+ (the layout used by cgranges): node i sits at level k where k is the number of trailing 1 bits of i, and
+ max_end holds the largest end time in the subtree rooted at i. Stabbing queries are O(log n + hits).
+ A merged, disjoint window is also kept per entry so "is this epoch covered at all" is a binary search.
+
+ Indices are rebuilt lazily on the first query after the entry changes.
+*/
+
+#define SR_COVERAGE_MAX_IDS 10000
+#define SR_COVERAGE_MAX_INTERVALS 100000
+#define SR_COVERAGE_STACK 64
+#define SR_COVERAGE_TYPLEN 32
+#define SR_COVERAGE_PATHLEN 1024
+
+typedef struct {
+  char * path;
+  int kind;
+  //Load order of the kernel, larger values take priority as they do in CSPICE
+  long sequence;
+} coverage_kernel;
+
+typedef struct {
+  double start, end, max_end;
+  long kernel;
+} coverage_interval;
+
+typedef struct {
+  int kind, id;
+  long count, capacity;
+  coverage_interval * intervals;
+  int max_level;
+
+  //Union of all intervals as [start, end] pairs
+  double * window;
+  long window_count;
+
+  bool dirty;
+} coverage_entry;
+
+typedef struct {
+  long x;
+  int k, w;
+} coverage_stack_frame;
+
+static coverage_kernel * kernels = NULL;
+static long kernel_count = 0, kernel_capacity = 0, load_sequence = 0;
+static st_table * entries = NULL;
+
+static const char * COVERAGE_KINDS[3] = {"SPK", "PCK", "CK"};
+
+static st_data_t entry_key(int kind, int id) {
+  return (st_data_t) (((unsigned long) kind << 32) | (unsigned int) id);
+}
+
+static int kind_from_symbol(VALUE kind) {
+  const char * name = RB_SYM2STR(kind);
+
+  if (!strcasecmp(name, "spk")) return SR_COVERAGE_SPK;
+  if (!strcasecmp(name, "pck")) return SR_COVERAGE_PCK;
+  if (!strcasecmp(name, "ck")) return SR_COVERAGE_CK;
+
+  rb_raise(rb_eArgError, "coverage kind must be one of :spk, :pck or :ck");
+  return -1;
+}
+
+static coverage_entry * find_entry(int kind, int id) {
+  st_data_t entry;
+
+  if (entries && st_lookup(entries, entry_key(kind, id), &entry)) return (coverage_entry *) entry;
+
+  return NULL;
+}
+
+static coverage_entry * fetch_entry(int kind, int id) {
+  coverage_entry * entry = find_entry(kind, id);
+
+  if (entry) return entry;
+
+  if (!entries) entries = st_init_numtable();
+
+  entry = ALLOC(coverage_entry);
+  memset(entry, 0, sizeof(coverage_entry));
+  entry->kind = kind;
+  entry->id = id;
+  entry->max_level = -1;
+  st_insert(entries, entry_key(kind, id), (st_data_t) entry);
+
+  return entry;
+}
+
+static void append_interval(coverage_entry * entry, double start, double end, long kernel) {
+  if (entry->count == entry->capacity) {
+    entry->capacity = entry->capacity ? entry->capacity * 2 : 8;
+    REALLOC_N(entry->intervals, coverage_interval, entry->capacity);
+  }
+
+  entry->intervals[entry->count].start = start;
+  entry->intervals[entry->count].end = end;
+  entry->intervals[entry->count].kernel = kernel;
+  entry->count++;
+  entry->dirty = true;
+}
+
+static int compare_intervals(const void * a, const void * b) {
+  double x = ((const coverage_interval *) a)->start,
+         y = ((const coverage_interval *) b)->start;
+
+  return (x > y) - (x < y);
+}
+
+static int compare_priority(const void * a, const void * b) {
+  long x = kernels[((const coverage_interval *) a)->kernel].sequence,
+       y = kernels[((const coverage_interval *) b)->kernel].sequence;
+
+  if (x != y) return (y > x) - (y < x);
+
+  return compare_intervals(a, b);
+}
+
+/* Builds the implicit interval tree over intervals sorted by start, returns the level of the root */
+static int index_intervals(coverage_interval * a, long n) {
+  long i, last_i = 0;
+  double last = 0.0;
+  int k;
+
+  if (n == 0) return -1;
+
+  for (i = 0; i < n; i += 2) {
+    last_i = i;
+    last = a[i].max_end = a[i].end;
+  }
+
+  for (k = 1; (1L << k) <= n; ++k) {
+    long x = 1L << (k - 1), i0 = (x << 1) - 1, step = x << 2;
+
+    for (i = i0; i < n; i += step) {
+      double left = a[i - x].max_end,
+             right = i + x < n ? a[i + x].max_end : last,
+             end = a[i].end;
+
+      if (left > end) end = left;
+      if (right > end) end = right;
+      a[i].max_end = end;
+    }
+
+    last_i = (last_i >> k & 1) ? last_i - x : last_i + x;
+    if (last_i < n && a[last_i].max_end > last) last = a[last_i].max_end;
+  }
+
+  return k - 1;
+}
+
+static void rebuild_entry(coverage_entry * entry) {
+  long count, merged = 0;
+
+  if (!entry->dirty) return;
+
+  qsort(entry->intervals, entry->count, sizeof(coverage_interval), compare_intervals);
+  entry->max_level = index_intervals(entry->intervals, entry->count);
+
+  REALLOC_N(entry->window, double, 2 * (entry->count ? entry->count : 1));
+
+  for (count = 0; count < entry->count; count++) {
+    coverage_interval * interval = &entry->intervals[count];
+
+    if (merged && interval->start <= entry->window[2 * merged - 1]) {
+      if (interval->end > entry->window[2 * merged - 1]) entry->window[2 * merged - 1] = interval->end;
+    }
+    else {
+      entry->window[2 * merged] = interval->start;
+      entry->window[2 * merged + 1] = interval->end;
+      merged++;
+    }
+  }
+
+  entry->window_count = merged;
+  entry->dirty = false;
+}
+
+/* Collects the indices of every interval containing et, returns the number of hits */
+static long stab_entry(coverage_entry * entry, double et, long * hits, long room) {
+  coverage_interval * a = entry->intervals;
+  coverage_stack_frame stack[SR_COVERAGE_STACK];
+  long n = entry->count, found = 0;
+  int top = 0;
+
+  rebuild_entry(entry);
+  if (entry->max_level < 0) return 0;
+
+  stack[top].k = entry->max_level;
+  stack[top].x = (1L << entry->max_level) - 1;
+  stack[top++].w = 0;
+
+  while (top) {
+    coverage_stack_frame z = stack[--top];
+
+    if (z.k <= 3) {
+      //Small subtree, scan it linearly
+      long i, i0 = z.x >> z.k << z.k, i1 = i0 + (1L << (z.k + 1)) - 1;
+
+      if (i1 >= n) i1 = n;
+      for (i = i0; i < i1 && a[i].start <= et; ++i) {
+        if (et <= a[i].end && found < room) hits[found++] = i;
+      }
+    }
+    else if (z.w == 0) {
+      long y = z.x - (1L << (z.k - 1));
+
+      stack[top].k = z.k;
+      stack[top].x = z.x;
+      stack[top++].w = 1;
+
+      if (y >= n || a[y].max_end >= et) {
+        stack[top].k = z.k - 1;
+        stack[top].x = y;
+        stack[top++].w = 0;
+      }
+    }
+    else if (z.x < n && a[z.x].start <= et) {
+      if (et <= a[z.x].end && found < room) hits[found++] = z.x;
+
+      stack[top].k = z.k - 1;
+      stack[top].x = z.x + (1L << (z.k - 1));
+      stack[top++].w = 0;
+    }
+  }
+
+  return found;
+}
+
+static bool window_covers(coverage_entry * entry, double et) {
+  long low = 0, high;
+
+  rebuild_entry(entry);
+  high = entry->window_count;
+
+  //Find the last merged interval starting at or before et
+  while (low < high) {
+    long middle = (low + high) / 2;
+
+    if (entry->window[2 * middle] <= et) low = middle + 1;
+    else high = middle;
+  }
+
+  return low > 0 && et <= entry->window[2 * (low - 1) + 1];
+}
+
+bool sr_coverage_covers(int kind, int id, double et) {
+  coverage_entry * entry = find_entry(kind, id);
+
+  return entry && window_covers(entry, et);
+}
+
+/*
+ Returns the slot of the highest priority kernel covering et for an entry, or -1. Only a bounded number of
+ overlapping intervals is examined, which is plenty for ordering work by the kernel that will serve it.
+*/
+long sr_coverage_source(int kind, int id, double et) {
+  coverage_entry * entry = find_entry(kind, id);
+  long hits[SR_COVERAGE_STACK], hit_count, index, best = -1;
+
+  if (!entry) return -1;
+
+  hit_count = stab_entry(entry, et, hits, SR_COVERAGE_STACK);
+
+  for (index = 0; index < hit_count; index++) {
+    long kernel = entry->intervals[hits[index]].kernel;
+
+    if (best < 0 || kernels[kernel].sequence > kernels[best].sequence) best = kernel;
+  }
+
+  return best;
+}
+
+static long kernel_slot(const char * path) {
+  long count;
+
+  for (count = 0; count < kernel_count; count++) {
+    if (kernels[count].path && !strcmp(kernels[count].path, path)) return count;
+  }
+
+  return -1;
+}
+
+static int drop_kernel_intervals(st_data_t key, st_data_t value, st_data_t slot) {
+  coverage_entry * entry = (coverage_entry *) value;
+  long count, kept = 0;
+
+  for (count = 0; count < entry->count; count++) {
+    if (entry->intervals[count].kernel != (long) slot) entry->intervals[kept++] = entry->intervals[count];
+  }
+
+  if (kept != entry->count) {
+    entry->count = kept;
+    entry->dirty = true;
+  }
+
+  return ST_CONTINUE;
+}
+
+static void drop_kernel(long slot) {
+  if (entries) st_foreach(entries, drop_kernel_intervals, (st_data_t) slot);
+
+  xfree(kernels[slot].path);
+  kernels[slot].path = NULL;
+}
+
+static long add_kernel(const char * path, int kind) {
+  long slot;
+
+  for (slot = 0; slot < kernel_count; slot++) {
+    if (!kernels[slot].path) break;
+  }
+
+  if (slot == kernel_count) {
+    if (kernel_count == kernel_capacity) {
+      kernel_capacity = kernel_capacity ? kernel_capacity * 2 : 16;
+      REALLOC_N(kernels, coverage_kernel, kernel_capacity);
+    }
+    kernel_count++;
+  }
+
+  kernels[slot].path = ALLOC_N(char, strlen(path) + 1);
+  strcpy(kernels[slot].path, path);
+  kernels[slot].kind = kind;
+  kernels[slot].sequence = load_sequence++;
+
+  return slot;
+}
+
+static void collect_objects(const char * path, int kind, SpiceCell * ids) {
+  scard_c(0, ids);
+
+  switch (kind) {
+    case SR_COVERAGE_SPK :
+      spkobj_c(path, ids);
+      break;
+
+    case SR_COVERAGE_PCK :
+      pckfrm_c(path, ids);
+      break;
+
+    case SR_COVERAGE_CK :
+      ckobj_c(path, ids);
+      break;
+  }
+}
+
+static void collect_coverage(const char * path, int kind, int id, SpiceCell * cover) {
+  scard_c(0, cover);
+
+  switch (kind) {
+    case SR_COVERAGE_SPK :
+      spkcov_c(path, id, cover);
+      break;
+
+    case SR_COVERAGE_PCK :
+      pckcov_c(path, id, cover);
+      break;
+
+    case SR_COVERAGE_CK :
+      //Requires the SCLK and leapseconds kernels of the mission, skipped until they are loaded
+      ckcov_c(path, id, SPICEFALSE, "INTERVAL", 0.0, "TDB", cover);
+      break;
+  }
+}
+
+static void index_kernel(const char * path, int kind) {
+  SPICEINT_CELL(ids, SR_COVERAGE_MAX_IDS);
+  SPICEDOUBLE_CELL(cover, SR_COVERAGE_MAX_INTERVALS);
+  long slot, count, interval;
+  double start, end;
+
+  //Reloading a kernel moves it to the top of the priority order
+  slot = kernel_slot(path);
+  if (slot >= 0) drop_kernel(slot);
+
+  collect_objects(path, kind, &ids);
+
+  if (failed_c()) {
+    reset_c();
+    return;
+  }
+
+  slot = add_kernel(path, kind);
+
+  for (count = 0; count < card_c(&ids); count++) {
+    int id = SPICE_CELL_ELEM_I(&ids, count);
+    coverage_entry * entry;
+
+    collect_coverage(path, kind, id, &cover);
+
+    if (failed_c()) {
+      reset_c();
+      continue;
+    }
+
+    entry = fetch_entry(kind, id);
+
+    for (interval = 0; interval < wncard_c(&cover); interval++) {
+      wnfetd_c(&cover, interval, &start, &end);
+      append_interval(entry, start, end, slot);
+    }
+  }
+}
+
+static int kind_from_filtyp(const char * filtyp) {
+  if (!strcmp(filtyp, "SPK")) return SR_COVERAGE_SPK;
+  if (!strcmp(filtyp, "PCK")) return SR_COVERAGE_PCK;
+  if (!strcmp(filtyp, "CK")) return SR_COVERAGE_CK;
+
+  return -1;
+}
+
+static void index_loaded_kernels(void) {
+  char path[SR_COVERAGE_PATHLEN], filtyp[SR_COVERAGE_TYPLEN], source[SR_COVERAGE_PATHLEN];
+  SpiceInt count, total, handle;
+  SpiceBoolean found;
+  int kind;
+
+  for (kind = SR_COVERAGE_SPK; kind <= SR_COVERAGE_CK; kind++) {
+    ktotal_c(COVERAGE_KINDS[kind], &total);
+
+    for (count = 0; count < total; count++) {
+      kdata_c(count, COVERAGE_KINDS[kind], SR_COVERAGE_PATHLEN, SR_COVERAGE_TYPLEN, SR_COVERAGE_PATHLEN, path, filtyp, source, &handle, &found);
+
+      if (found && kernel_slot(path) < 0) index_kernel(path, kind);
+    }
+  }
+}
+
+void sr_coverage_loaded(const char * kernel) {
+  char filtyp[SR_COVERAGE_TYPLEN], source[SR_COVERAGE_PATHLEN];
+  SpiceInt handle;
+  SpiceBoolean found;
+  int kind;
+
+  kinfo_c(kernel, SR_COVERAGE_TYPLEN, SR_COVERAGE_PATHLEN, filtyp, source, &handle, &found);
+
+  if (failed_c()) {
+    reset_c();
+    return;
+  }
+
+  if (!found) return;
+
+  //Meta-kernels pull in any number of files, pick up whatever is not indexed yet
+  if (!strcmp(filtyp, "META")) {
+    index_loaded_kernels();
+    return;
+  }
+
+  kind = kind_from_filtyp(filtyp);
+  if (kind >= 0) index_kernel(kernel, kind);
+}
+
+void sr_coverage_unloaded(void) {
+  char filtyp[SR_COVERAGE_TYPLEN], source[SR_COVERAGE_PATHLEN];
+  SpiceInt handle;
+  SpiceBoolean found;
+  long slot;
+
+  //unload_c can take a meta-kernel along with it, so verify every indexed file
+  for (slot = 0; slot < kernel_count; slot++) {
+    if (!kernels[slot].path) continue;
+
+    kinfo_c(kernels[slot].path, SR_COVERAGE_TYPLEN, SR_COVERAGE_PATHLEN, filtyp, source, &handle, &found);
+
+    if (failed_c()) reset_c();
+    else if (!found) drop_kernel(slot);
+  }
+}
+
+static int free_entry(st_data_t key, st_data_t value, st_data_t arg) {
+  coverage_entry * entry = (coverage_entry *) value;
+
+  xfree(entry->intervals);
+  xfree(entry->window);
+  xfree(entry);
+
+  return ST_DELETE;
+}
+
+void sr_coverage_clear(void) {
+  long slot;
+
+  if (entries) st_foreach(entries, free_entry, 0);
+
+  for (slot = 0; slot < kernel_count; slot++) xfree(kernels[slot].path);
+  kernel_count = 0;
+}
+
+void sr_coverage_changed(int event, const char * kernel) {
+  switch (event) {
+    case SR_POOL_FURNSH : sr_coverage_loaded(kernel); break;
+    case SR_POOL_UNLOAD : sr_coverage_unloaded(); break;
+    case SR_POOL_KCLEAR : sr_coverage_clear(); break;
+    //Restoring pool variables loads no binary kernels
+    default : break;
+  }
+}
+
+static VALUE window_to_array(SpiceCell * cover) {
+  long count, interval_count = wncard_c(cover);
+  double beginning, end;
+  VALUE result = rb_ary_new2(interval_count);
+
+  for (count = 0; count < interval_count; count++) {
+    wnfetd_c(cover, count, &beginning, &end);
+    rb_ary_push(result, rb_ary_new3(2, DBL2NUM(beginning), DBL2NUM(end)));
+  }
+
+  return result;
+}
+
+static VALUE objects_to_array(SpiceCell * ids) {
+  long count;
+  VALUE result = rb_ary_new2(card_c(ids));
+
+  for (count = 0; count < card_c(ids); count++) rb_ary_push(result, INT2FIX(SPICE_CELL_ELEM_I(ids, count)));
+
+  return result;
+}
+
+VALUE sr_spkobj(VALUE self, VALUE spk_file) {
+  SPICEINT_CELL(output, SR_COVERAGE_MAX_IDS);
+
+  SR_NATIVE_ENTRY("spkobj", 1, 1);
+
+  collect_objects(StringValuePtr(spk_file), SR_COVERAGE_SPK, &output);
+
+  SR_NATIVE_EXIT("spkobj", failed_c());
+  if(spice_error(SPICE_ERROR_SHORT)) return Qnil;
+
+  return objects_to_array(&output);
+}
+
+VALUE sr_pckfrm(VALUE self, VALUE pck_file) {
+  SPICEINT_CELL(output, SR_COVERAGE_MAX_IDS);
+
+  SR_NATIVE_ENTRY("pckfrm", 1, 1);
+
+  collect_objects(StringValuePtr(pck_file), SR_COVERAGE_PCK, &output);
+
+  SR_NATIVE_EXIT("pckfrm", failed_c());
+  if(spice_error(SPICE_ERROR_SHORT)) return Qnil;
+
+  return objects_to_array(&output);
+}
+
+VALUE sr_ckobj(VALUE self, VALUE ck_file) {
+  SPICEINT_CELL(output, SR_COVERAGE_MAX_IDS);
+
+  SR_NATIVE_ENTRY("ckobj", 1, 1);
+
+  collect_objects(StringValuePtr(ck_file), SR_COVERAGE_CK, &output);
+
+  SR_NATIVE_EXIT("ckobj", failed_c());
+  if(spice_error(SPICE_ERROR_SHORT)) return Qnil;
+
+  return objects_to_array(&output);
+}
+
+VALUE sr_spkcov(VALUE self, VALUE spk_file, VALUE idcode) {
+  SPICEDOUBLE_CELL(cover, SR_COVERAGE_MAX_INTERVALS);
+
+  SR_NATIVE_ENTRY("spkcov", 2, 1);
+
+  collect_coverage(StringValuePtr(spk_file), SR_COVERAGE_SPK, FIX2INT(idcode), &cover);
+
+  SR_NATIVE_EXIT("spkcov", failed_c());
+  if(spice_error(SPICE_ERROR_SHORT)) return Qnil;
+
+  return window_to_array(&cover);
+}
+
+VALUE sr_pckcov(VALUE self, VALUE pck_file, VALUE idcode) {
+  SPICEDOUBLE_CELL(cover, SR_COVERAGE_MAX_INTERVALS);
+
+  SR_NATIVE_ENTRY("pckcov", 2, 1);
+
+  collect_coverage(StringValuePtr(pck_file), SR_COVERAGE_PCK, FIX2INT(idcode), &cover);
+
+  SR_NATIVE_EXIT("pckcov", failed_c());
+  if(spice_error(SPICE_ERROR_SHORT)) return Qnil;
+
+  return window_to_array(&cover);
+}
+
+VALUE sr_ckcov(VALUE self, VALUE ck_file, VALUE idcode, VALUE needav, VALUE level, VALUE tol, VALUE timsys) {
+  SPICEDOUBLE_CELL(cover, SR_COVERAGE_MAX_INTERVALS);
+
+  SR_NATIVE_ENTRY("ckcov", 6, 1);
+
+  scard_c(0, &cover);
+  ckcov_c(StringValuePtr(ck_file), FIX2INT(idcode), RTEST(needav), RB_SYM2STR(level), NUM2DBL(tol), RB_SYM2STR(timsys), &cover);
+
+  SR_NATIVE_EXIT("ckcov", failed_c());
+  if(spice_error(SPICE_ERROR_SHORT)) return Qnil;
+
+  return window_to_array(&cover);
+}
+
+/*
+ Returns [[kernel, start, end], ...] for every indexed interval of the body or frame,
+ highest priority kernel first.
+*/
+VALUE sr_coverage(VALUE self, VALUE kind, VALUE idcode) {
+  coverage_entry * entry = find_entry(kind_from_symbol(kind), FIX2INT(idcode));
+  long count;
+  coverage_interval * ordered;
+  VALUE result;
+
+  SR_NATIVE_ENTRY("coverage", 2, 1);
+
+  if (!entry) {
+    SR_NATIVE_EXIT("coverage", 0);
+    return rb_ary_new();
+  }
+
+  rebuild_entry(entry);
+  result = rb_ary_new2(entry->count);
+
+  //The tree keeps intervals sorted by start time, report them by kernel priority instead
+  ordered = ALLOC_N(coverage_interval, entry->count ? entry->count : 1);
+  memcpy(ordered, entry->intervals, entry->count * sizeof(coverage_interval));
+  qsort(ordered, entry->count, sizeof(coverage_interval), compare_priority);
+
+  for (count = 0; count < entry->count; count++) {
+    rb_ary_push(result, rb_ary_new3(3, rb_str_new2(kernels[ordered[count].kernel].path), DBL2NUM(ordered[count].start), DBL2NUM(ordered[count].end)));
+  }
+
+  xfree(ordered);
+
+  SR_NATIVE_EXIT("coverage", 0);
+  return result;
+}
+
+VALUE sr_coverage_window(VALUE self, VALUE kind, VALUE idcode) {
+  coverage_entry * entry = find_entry(kind_from_symbol(kind), FIX2INT(idcode));
+  long count;
+  VALUE result;
+
+  SR_NATIVE_ENTRY("coverage_window", 2, 1);
+
+  if (!entry) {
+    SR_NATIVE_EXIT("coverage_window", 0);
+    return rb_ary_new();
+  }
+
+  rebuild_entry(entry);
+  result = rb_ary_new2(entry->window_count);
+
+  for (count = 0; count < entry->window_count; count++) {
+    rb_ary_push(result, rb_ary_new3(2, DBL2NUM(entry->window[2 * count]), DBL2NUM(entry->window[2 * count + 1])));
+  }
+
+  SR_NATIVE_EXIT("coverage_window", 0);
+  return result;
+}
+
+/*
+ Returns the indices of the epochs that are not covered by every one of the given ids,
+ an empty Array means the whole batch can be evaluated.
+*/
+VALUE sr_coverage_gaps(VALUE self, VALUE kind, VALUE idcodes, VALUE ets) {
+  int coverage_kind = kind_from_symbol(kind);
+  long count, id_count = RARRAY_LEN(idcodes), epoch_count, index;
+  VALUE rb_epochs = sr_epochs_from(ets, &epoch_count);
+  coverage_entry ** selected = ALLOC_N(coverage_entry *, id_count ? id_count : 1);
+  double * epochs = sr_dense_elements(rb_epochs);
+  VALUE result = rb_ary_new();
+
+  SR_NATIVE_ENTRY("coverage_gaps", 3, epoch_count);
+
+  for (index = 0; index < id_count; index++) {
+    selected[index] = find_entry(coverage_kind, FIX2INT(RARRAY_AREF(idcodes, index)));
+    if (selected[index]) rebuild_entry(selected[index]);
+  }
+
+  for (count = 0; count < epoch_count; count++) {
+    for (index = 0; index < id_count; index++) {
+      if (!selected[index] || !window_covers(selected[index], epochs[count])) {
+        rb_ary_push(result, LONG2NUM(count));
+        break;
+      }
+    }
+  }
+
+  xfree(selected);
+  RB_GC_GUARD(rb_epochs);
+
+  SR_NATIVE_EXIT("coverage_gaps", 0);
+  return result;
+}
+
+/*
+ Returns the kernels that hold any coverage for the given ids at the given epoch (or at any time when et is nil).
+ Passing nil for the ids lists every indexed kernel of that kind.
+*/
+VALUE sr_coverage_kernels(VALUE self, VALUE kind, VALUE idcodes, VALUE et) {
+  int coverage_kind = kind_from_symbol(kind);
+  long index, count, hit_count;
+  long * hits = NULL;
+  bool * needed = ALLOC_N(bool, kernel_count ? kernel_count : 1);
+  VALUE result = rb_ary_new();
+
+  SR_NATIVE_ENTRY("coverage_kernels", 3, 1);
+
+  for (count = 0; count < kernel_count; count++) needed[count] = NIL_P(idcodes) && kernels[count].kind == coverage_kind;
+
+  for (index = 0; !NIL_P(idcodes) && index < RARRAY_LEN(idcodes); index++) {
+    coverage_entry * entry = find_entry(coverage_kind, FIX2INT(RARRAY_AREF(idcodes, index)));
+
+    if (!entry) continue;
+
+    if (NIL_P(et)) {
+      for (count = 0; count < entry->count; count++) needed[entry->intervals[count].kernel] = true;
+    }
+    else {
+      REALLOC_N(hits, long, entry->count ? entry->count : 1);
+      hit_count = stab_entry(entry, NUM2DBL(et), hits, entry->count);
+
+      for (count = 0; count < hit_count; count++) needed[entry->intervals[hits[count]].kernel] = true;
+    }
+  }
+
+  for (count = 0; count < kernel_count; count++) {
+    if (needed[count] && kernels[count].path) rb_ary_push(result, rb_str_new2(kernels[count].path));
+  }
+
+  xfree(hits);
+  xfree(needed);
+
+  SR_NATIVE_EXIT("coverage_kernels", 0);
+  return result;
+}
@@ -0,0 +1,23 @@
+#include "ruby.h"
+#include "SpiceUsr.h"
+#include <stdbool.h>
+#include "spice_rub_utils.h"
+#include "spice_probes.h"
+#include "nmatrix.h"
+#include "spice_buffer.h"
+#include "spice_generation.h"
+
+//Kinds of binary kernels tracked by the coverage index
+#define SR_COVERAGE_SPK 0
+#define SR_COVERAGE_PCK 1
+#define SR_COVERAGE_CK  2
+
+//Hooks that keep the index in sync with the pool, dispatched by sr_coverage_changed
+void sr_coverage_loaded(const char * kernel);
+void sr_coverage_unloaded(void);
+void sr_coverage_clear(void);
+void sr_coverage_changed(int event, const char * kernel);
+
+//Lookups used by other native modules
+bool sr_coverage_covers(int kind, int id, double et);
+long sr_coverage_source(int kind, int id, double et);
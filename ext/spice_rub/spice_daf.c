@@ -0,0 +1,111 @@
+#include "spice_daf.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/* Memory mapped DAF files.
+
+ CSPICE reads DAF records through its own file table and buffers, none of which may be touched from more
+ than one thread. The native evaluators map the files themselves instead: the mapping is read-only, shared
+ with the page cache and independent of the handles CSPICE keeps open, so it stays valid even while CSPICE
+ unloads the kernel. Only files in the native binary format are mapped, anything else is left to CSPICE.
+
+ DAF layout : 1024 byte records, the file record holds ND and NI at byte 8 and the first summary record at
+ byte 76. Summary records start with the next and previous record numbers and the summary count, followed
+ by summaries of ND doubles and NI integers (padded to a whole number of doubles). Addresses are 1-based
+ double precision word numbers.
+*/
+
+#define SR_DAF_RECORD 1024
+#define SR_DAF_WORDS (SR_DAF_RECORD / 8)
+
+static bool native_format(const char * format) {
+  static const uint16_t probe = 1;
+  const char * expected = (*(const char *) &probe) ? "LTL-IEEE" : "BIG-IEEE";
+
+  return !strncmp(format, expected, 8);
+}
+
+/* Maps path and reads its file record, returns false if the file is not a native format DAF */
+bool sr_daf_open(const char * path, sr_daf * daf) {
+  struct stat status;
+  int file = open(path, O_RDONLY);
+  void * base;
+
+  memset(daf, 0, sizeof(sr_daf));
+
+  if (file < 0) return false;
+
+  if (fstat(file, &status) || status.st_size < SR_DAF_RECORD) {
+    close(file);
+    return false;
+  }
+
+  base = mmap(NULL, status.st_size, PROT_READ, MAP_SHARED, file, 0);
+  close(file);
+
+  if (base == MAP_FAILED) return false;
+
+  daf->base = base;
+  daf->size = status.st_size;
+
+  if (strncmp(daf->base, "DAF/", 4) && strncmp(daf->base, "NAIF/DAF", 8)) {
+    sr_daf_close(daf);
+    return false;
+  }
+
+  if (!native_format(daf->base + 88)) {
+    sr_daf_close(daf);
+    return false;
+  }
+
+  memcpy(&daf->nd, daf->base + 8, sizeof(int));
+  memcpy(&daf->ni, daf->base + 12, sizeof(int));
+  {
+    int forward;
+    memcpy(&forward, daf->base + 76, sizeof(int));
+    daf->forward = forward;
+  }
+
+  return true;
+}
+
+void sr_daf_close(sr_daf * daf) {
+  if (daf->base) munmap((void *) daf->base, daf->size);
+  memset(daf, 0, sizeof(sr_daf));
+}
+
+/* Returns the words from begin to end (1-based, inclusive), or NULL if they are outside the file */
+const double * sr_daf_words(const sr_daf * daf, long begin, long end) {
+  if (begin < 1 || end < begin || (size_t) end * 8 > daf->size) return NULL;
+
+  return (const double *) (daf->base + (begin - 1) * 8);
+}
+
+/* Walks the summary records in file order, returns false if the chain runs out of the file */
+bool sr_daf_each_summary(const sr_daf * daf, sr_daf_summary_fn callback, void * data) {
+  long record = daf->forward, visited = 0, count, index;
+  long summary_size = daf->nd + (daf->ni + 1) / 2;
+  const double * words;
+
+  while (record > 0) {
+    //A corrupt chain could loop forever
+    if (++visited > (long) (daf->size / SR_DAF_RECORD)) return false;
+
+    words = sr_daf_words(daf, (record - 1) * SR_DAF_WORDS + 1, record * SR_DAF_WORDS);
+    if (!words) return false;
+
+    count = (long) words[2];
+
+    for (index = 0; index < count && 3 + (index + 1) * summary_size <= SR_DAF_WORDS; index++) {
+      const double * summary = words + 3 + index * summary_size;
+
+      if (!callback(daf, summary, (const int *) (summary + daf->nd), data)) return true;
+    }
+
+    record = (long) words[0];
+  }
+
+  return true;
+}
@@ -0,0 +1,25 @@
+#include "ruby.h"
+#include "SpiceUsr.h"
+#include <stdbool.h>
+#include "spice_rub_utils.h"
+
+#ifndef SPICE_DAF_H
+#define SPICE_DAF_H
+
+//Read-only memory mapped DAF file, see spice_daf.c
+typedef struct {
+  const char * base;
+  size_t size;
+  int nd, ni;
+  long forward;
+} sr_daf;
+
+//Called with the double and integer components of each segment summary, return false to stop
+typedef bool (* sr_daf_summary_fn)(const sr_daf * daf, const double * doubles, const int * ints, void * data);
+
+bool sr_daf_open(const char * path, sr_daf * daf);
+void sr_daf_close(sr_daf * daf);
+bool sr_daf_each_summary(const sr_daf * daf, sr_daf_summary_fn callback, void * data);
+const double * sr_daf_words(const sr_daf * daf, long begin, long end);
+
+#endif
@@ -0,0 +1,278 @@
+#include "spice_daf_index.h"
+#include <math.h>
+
+/* Segment index shared by the native SPK and PCK readers.
+
+ The index is built from the files CSPICE reports as loaded (kdata_c), in CSPICE's priority order: later
+ files first, and within a file later segments first. Segments are then grouped by body, keeping that order,
+ so the first segment of a body covering an epoch is the one CSPICE would use.
+
+ The index is rebuilt lazily after kernels are loaded or unloaded. A rebuild only swaps the index under the
+ write lock, batches hold the read lock for their whole evaluation, so mapped files are never unmapped under
+ a running batch.
+*/
+
+/* ---- Chebyshev segments ---- */
+
+void sr_chebyshev(const double * coefficients, long n, double s, double * value, double * derivative) {
+  double t0 = 1.0, t1 = s, d0 = 0.0, d1 = 1.0, t2, d2;
+  long k;
+
+  *value = coefficients[0];
+  *derivative = 0.0;
+
+  if (n > 1) {
+    *value += coefficients[1] * t1;
+    *derivative += coefficients[1] * d1;
+  }
+
+  for (k = 2; k < n; k++) {
+    t2 = 2.0 * s * t1 - t0;
+    d2 = 2.0 * t1 + 2.0 * s * d1 - d0;
+
+    *value += coefficients[k] * t2;
+    *derivative += coefficients[k] * d2;
+
+    t0 = t1; t1 = t2;
+    d0 = d1; d1 = d2;
+  }
+}
+
+/*
+ Types 2 and 3 of both SPK and PCK files : fixed length Chebyshev records of three components only (2), whose
+ rates are the derivatives, or of three components and their rates (3)
+*/
+int sr_daf_chebyshev(const sr_daf_segment * segment, double et, double values[6]) {
+  const double * tail = segment->data + segment->length - 4;
+  double init = tail[0], interval = tail[1], value, derivative;
+  long record_size = (long) tail[2], count = (long) tail[3], index, degree, component;
+  const double * record;
+
+  if (record_size < 5 || count < 1 || interval <= 0) return SR_DAF_UNSUPPORTED;
+
+  index = (long) floor((et - init) / interval);
+  if (index < 0) index = 0;
+  if (index >= count) index = count - 1;
+
+  record = segment->data + index * record_size;
+  degree = (record_size - 2) / (segment->type == 2 ? 3 : 6);
+
+  for (component = 0; component < 3; component++) {
+    sr_chebyshev(record + 2 + component * degree, degree, (et - record[0]) / record[1], &value, &derivative);
+    values[component] = value;
+
+    if (segment->type == 2) {
+      values[component + 3] = derivative / record[1];
+    }
+    else {
+      sr_chebyshev(record + 2 + (component + 3) * degree, degree, (et - record[0]) / record[1], &value, &derivative);
+      values[component + 3] = value;
+    }
+  }
+
+  return SR_DAF_OK;
+}
+
+/* ---- Lookups, all read-only ---- */
+
+const sr_daf_body * sr_daf_index_body(const sr_daf_index * index, int body) {
+  long low = 0, high = index->body_count;
+
+  while (low < high) {
+    long middle = (low + high) / 2;
+
+    if (index->bodies[middle].body == body) return &index->bodies[middle];
+    if (index->bodies[middle].body < body) low = middle + 1;
+    else high = middle;
+  }
+
+  return NULL;
+}
+
+/* Highest priority segment for body covering et */
+const sr_daf_segment * sr_daf_index_segment(const sr_daf_index * index, int body, double et) {
+  const sr_daf_body * entry = sr_daf_index_body(index, body);
+  long count;
+
+  if (!entry) return NULL;
+
+  for (count = 0; count < entry->count; count++) {
+    const sr_daf_segment * segment = &index->segments[entry->first + count];
+
+    if (segment->start <= et && et <= segment->end) return segment;
+  }
+
+  return NULL;
+}
+
+/* ---- Construction, needs the GVL since it reads the CSPICE kernel table ---- */
+
+typedef struct {
+  sr_daf_kind * kind;
+  sr_daf_index * index;
+} collector;
+
+static sr_daf_segment * new_segment(sr_daf_index * index) {
+  if (index->segment_count == index->segment_capacity) {
+    index->segment_capacity = index->segment_capacity ? 2 * index->segment_capacity : 64;
+    REALLOC_N(index->segments, sr_daf_segment, index->segment_capacity);
+  }
+
+  return &index->segments[index->segment_count++];
+}
+
+/* The data of SPK and PCK segments is addressed by the last two integer components */
+static bool collect_segment(const sr_daf * daf, const double * doubles, const int * ints, void * data) {
+  collector * collecting = data;
+  sr_daf_segment * segment;
+  const double * words;
+  int begin, end;
+
+  //A file of another layout cannot be indexed, leave its epochs to CSPICE rather than report no coverage
+  if (daf->nd != collecting->kind->nd || daf->ni != collecting->kind->ni) {
+    collecting->index->incomplete = true;
+    return false;
+  }
+
+  begin = ints[daf->ni - 2];
+  end = ints[daf->ni - 1];
+  words = sr_daf_words(daf, begin, end);
+  segment = new_segment(collecting->index);
+
+  memset(segment, 0, sizeof(sr_daf_segment));
+  segment->start = doubles[0];
+  segment->end = doubles[1];
+  segment->data = words;
+  segment->length = end - begin + 1;
+  segment->usable = collecting->kind->describe(segment, ints) && words && segment->length >= 4;
+
+  return true;
+}
+
+static int compare_priority(const void * a, const void * b) {
+  const sr_daf_segment * left = a, * right = b;
+
+  if (left->body != right->body) return left->body < right->body ? -1 : 1;
+
+  return left->priority < right->priority ? -1 : (left->priority > right->priority);
+}
+
+static void free_index(sr_daf_index * index) {
+  long file;
+
+  if (!index) return;
+
+  for (file = 0; file < index->file_count; file++) sr_daf_close(&index->files[file]);
+
+  xfree(index->files);
+  xfree(index->segments);
+  xfree(index->bodies);
+  xfree(index);
+}
+
+static sr_daf_index * build_index(sr_daf_kind * kind) {
+  sr_daf_index * index = ALLOC(sr_daf_index);
+  collector collecting = {kind, index};
+  SpiceInt total, handle, file;
+  SpiceBoolean found;
+  char path[SR_DAF_PATHLEN], type[SR_DAF_TYPLEN], source[SR_DAF_PATHLEN];
+  long count, first;
+
+  memset(index, 0, sizeof(sr_daf_index));
+
+  ktotal_c(kind->name, &total);
+  index->files = ALLOC_N(sr_daf, total ? total : 1);
+
+  //Later files take priority, so they are collected first
+  for (file = total - 1; file >= 0; file--) {
+    sr_daf * daf = &index->files[index->file_count];
+    long before = index->segment_count, low, high;
+
+    kdata_c(file, kind->name, SR_DAF_PATHLEN, SR_DAF_TYPLEN, SR_DAF_PATHLEN, path, type, source, &handle, &found);
+
+    if (!found || !sr_daf_open(path, daf)) {
+      index->incomplete = true;
+      continue;
+    }
+
+    index->file_count++;
+
+    if (!sr_daf_each_summary(daf, collect_segment, &collecting)) index->incomplete = true;
+
+    //Within a file later segments take priority
+    for (low = before, high = index->segment_count - 1; low < high; low++, high--) {
+      sr_daf_segment swap = index->segments[low];
+      index->segments[low] = index->segments[high];
+      index->segments[high] = swap;
+    }
+  }
+
+  reset_c();
+
+  for (count = 0; count < index->segment_count; count++) {
+    index->segments[count].priority = count;
+    if (index->segments[count].usable) kind->resolve(&index->segments[count]);
+  }
+
+  //Group segments by body, keeping the priority order inside each group
+  qsort(index->segments, index->segment_count, sizeof(sr_daf_segment), compare_priority);
+
+  index->bodies = ALLOC_N(sr_daf_body, index->segment_count ? index->segment_count : 1);
+
+  for (first = 0; first < index->segment_count; first = count) {
+    for (count = first; count < index->segment_count && index->segments[count].body == index->segments[first].body; count++);
+
+    index->bodies[index->body_count].body = index->segments[first].body;
+    index->bodies[index->body_count].first = first;
+    index->bodies[index->body_count].count = count - first;
+    index->body_count++;
+  }
+
+  return index;
+}
+
+static void * acquire_write_lock(void * data) {
+  sr_daf_kind * kind = data;
+
+  pthread_rwlock_wrlock(&kind->lock);
+  return NULL;
+}
+
+static void * acquire_read_lock(void * data) {
+  sr_daf_kind * kind = data;
+
+  pthread_rwlock_rdlock(&kind->lock);
+  return NULL;
+}
+
+/* Rebuilds the index of kind if kernels changed since it was built */
+void sr_daf_index_refresh(sr_daf_kind * kind) {
+  sr_daf_index * fresh, * previous;
+
+  if (kind->cache != SR_DAF_NO_CACHE) sr_cache_count(kind->cache, kind->built_for == sr_pool_generation());
+  if (kind->built_for == sr_pool_generation()) return;
+
+  fresh = build_index(kind);
+
+  //Running batches hold the read lock without the GVL, wait for them without holding it either
+  rb_thread_call_without_gvl(acquire_write_lock, kind, NULL, NULL);
+
+  previous = kind->current;
+  kind->current = fresh;
+  kind->built_for = sr_pool_generation();
+
+  pthread_rwlock_unlock(&kind->lock);
+
+  free_index(previous);
+}
+
+/* Takes the read lock without holding the GVL and returns the current index, valid until released */
+const sr_daf_index * sr_daf_index_acquire(sr_daf_kind * kind) {
+  rb_thread_call_without_gvl(acquire_read_lock, kind, NULL, NULL);
+
+  return kind->current;
+}
+
+void sr_daf_index_release(sr_daf_kind * kind) {
+  pthread_rwlock_unlock(&kind->lock);
+}
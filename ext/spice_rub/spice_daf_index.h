@@ -0,0 +1,83 @@
+#include "ruby.h"
+#include "SpiceUsr.h"
+#include <stdbool.h>
+#include <pthread.h>
+#include "spice_rub_utils.h"
+#include "spice_daf.h"
+#include "spice_parallel.h"
+#include "spice_generation.h"
+#include "spice_stats.h"
+
+#ifndef SPICE_DAF_INDEX_H
+#define SPICE_DAF_INDEX_H
+
+#define SR_DAF_PATHLEN 1024
+#define SR_DAF_TYPLEN 33
+
+//Evaluation status of a single epoch
+#define SR_DAF_OK 0
+#define SR_DAF_NO_DATA 1
+#define SR_DAF_UNSUPPORTED 2
+
+//Kinds without a cache counter
+#define SR_DAF_NO_CACHE -1
+
+//Segment of a loaded SPK or PCK file. For PCK segments body is the class ID and frame the base frame
+typedef struct {
+  int body, center, frame, type;
+  double start, end;
+  const double * data;
+  long length, priority;
+  bool usable, rotate;
+  //Constant frame rotation, its meaning is up to the kind that resolved it
+  double rotation[3][3];
+} sr_daf_segment;
+
+//Segments of one body, in priority order
+typedef struct {
+  int body;
+  long first, count;
+} sr_daf_body;
+
+typedef struct {
+  sr_daf * files;
+  long file_count;
+  sr_daf_segment * segments;
+  long segment_count, segment_capacity;
+  sr_daf_body * bodies;
+  long body_count;
+  //Set when a loaded file could not be mapped or read, its data would be missing from the index
+  bool incomplete;
+} sr_daf_index;
+
+/*
+ A kind of DAF file (SPK, PCK) and its current index. describe fills body, center, frame and type from the
+ integer components of a summary and returns whether the segment type is supported, resolve sets up the
+ frame rotation of a usable segment and may mark it unusable.
+*/
+typedef struct {
+  const char * name;
+  int nd, ni, cache;
+  bool (* describe)(sr_daf_segment * segment, const int * ints);
+  void (* resolve)(sr_daf_segment * segment);
+
+  sr_daf_index * current;
+  //Kernel pool generation the index was built for
+  unsigned long built_for;
+  pthread_rwlock_t lock;
+} sr_daf_kind;
+
+#define SR_DAF_KIND(name, nd, ni, cache, describe, resolve) {name, nd, ni, cache, describe, resolve, NULL, 0, PTHREAD_RWLOCK_INITIALIZER}
+
+void sr_daf_index_refresh(sr_daf_kind * kind);
+const sr_daf_index * sr_daf_index_acquire(sr_daf_kind * kind);
+void sr_daf_index_release(sr_daf_kind * kind);
+
+const sr_daf_body * sr_daf_index_body(const sr_daf_index * index, int body);
+const sr_daf_segment * sr_daf_index_segment(const sr_daf_index * index, int body, double et);
+
+//Chebyshev series of n coefficients at s in [-1, 1], with its derivative with respect to s
+void sr_chebyshev(const double * coefficients, long n, double s, double * value, double * derivative);
+int sr_daf_chebyshev(const sr_daf_segment * segment, double et, double values[6]);
+
+#endif
@@ -1,91 +1,182 @@
 #include "spice_ephemerides.h"
 
 VALUE sr_spkpos(VALUE self, VALUE targ, VALUE et, VALUE ref, VALUE abcorr, VALUE obs) {
-  double position[3], light_time;
-  VALUE rb_position;
+  double light_time;
+  VALUE rb_position = sr_dense_alloc(3, 1);
 
-  spkpos_c(RB_SYM2STR(targ), NUM2DBL(et), RB_SYM2STR(ref), RB_SYM2STR(abcorr), RB_SYM2STR(obs), position, &light_time);
+  SR_NATIVE_ENTRY("spkpos", 5, 1);
 
-  if(spice_error(SPICE_ERROR_SHORT)) return Qnil;
+  spkpos_c(RB_SYM2STR(targ), NUM2DBL(et), RB_SYM2STR(ref), RB_SYM2STR(abcorr), RB_SYM2STR(obs), sr_dense_elements(rb_position), &light_time);
 
-  rb_position = rb_nmatrix_dense_create(FLOAT64, (size_t *) EPHEM_POSITION_SHAPE, 2, (void *) position, 3);
+  SR_NATIVE_EXIT("spkpos", failed_c());
+  if(spice_error(SPICE_ERROR_SHORT)) return Qnil;
 
   return rb_ary_new3(2, rb_position, DBL2NUM(light_time));
 }
 
 VALUE sr_spkezr(VALUE self, VALUE targ, VALUE et, VALUE ref, VALUE abcorr, VALUE obs) {
-  double state[6], light_time;
-  VALUE rb_state;
+  double light_time;
+  VALUE rb_state = sr_dense_alloc(6, 1);
 
-  spkpos_c(RB_SYM2STR(targ), NUM2DBL(et), RB_SYM2STR(ref), RB_SYM2STR(abcorr), RB_SYM2STR(obs), state, &light_time);
- 
+  SR_NATIVE_ENTRY("spkezr", 5, 1);
+
+  spkezr_c(RB_SYM2STR(targ), NUM2DBL(et), RB_SYM2STR(ref), RB_SYM2STR(abcorr), RB_SYM2STR(obs), sr_dense_elements(rb_state), &light_time);
+
+  SR_NATIVE_EXIT("spkezr", failed_c());
+  if(spice_error(SPICE_ERROR_SHORT)) return Qnil;
+
+  return rb_ary_new3(2, rb_state, DBL2NUM(light_time));
+}
+
+#ifdef SR_USDT
+/* Fires spk__batch for a batch over body names, resolving their codes only while a tracer is attached */
+static void probe_batch(const char * function, const char * target, const char * observer, long count) {
+  SpiceInt target_code, observer_code;
+
+  if (!SR_PROBE_ENABLED(spk__batch)) return;
+
+  if (!sr_bodies_code(target, &target_code)) target_code = -1;
+  if (!sr_bodies_code(observer, &observer_code)) observer_code = -1;
+
+  SR_PROBE4(spk__batch, function, target_code, observer_code, count);
+}
+#else
+#define probe_batch(function, target, observer, count) do {} while (0)
+#endif
+
+/*
+ Batched spkpos_c : positions of targ at every epoch of ets (an Array or a dense float64 NMatrix)
+ as the rows of an N x 3 matrix, so each call writes one contiguous row. The matrix is written in
+ place when out is an N x 3 float64 NMatrix. Returns [positions, light times as an N x 1 matrix].
+*/
+VALUE sr_spkpos_batch(VALUE self, VALUE targ, VALUE ets, VALUE ref, VALUE abcorr, VALUE obs, VALUE out) {
+  long count, index;
+  VALUE rb_epochs = sr_epochs_from(ets, &count);
+  VALUE rb_positions = sr_dense_output(out, count, 3);
+  VALUE rb_light_times = sr_dense_alloc(count, 1);
+  double * epochs = sr_dense_elements(rb_epochs),
+         * positions = sr_dense_elements(rb_positions),
+         * light_times = sr_dense_elements(rb_light_times);
+  const char * target = RB_SYM2STR(targ),
+             * frame = RB_SYM2STR(ref),
+             * correction = RB_SYM2STR(abcorr),
+             * observer = RB_SYM2STR(obs);
+
+  probe_batch("spkpos_batch", target, observer, count);
+  SR_NATIVE_ENTRY("spkpos_batch", 6, count);
+
+  for (index = 0; index < count; index++) {
+    spkpos_c(target, epochs[index], frame, correction, observer, positions + 3 * index, light_times + index);
+    if (failed_c()) break;
+  }
+
+  SR_NATIVE_EXIT("spkpos_batch", failed_c());
+  if(spice_error(SPICE_ERROR_SHORT)) return Qnil;
+
+  RB_GC_GUARD(rb_epochs);
+
+  return rb_ary_new3(2, rb_positions, rb_light_times);
+}
+
+/* Batched spkezr_c, the N x 6 counterpart of sr_spkpos_batch */
+VALUE sr_spkezr_batch(VALUE self, VALUE targ, VALUE ets, VALUE ref, VALUE abcorr, VALUE obs, VALUE out) {
+  long count, index;
+  VALUE rb_epochs = sr_epochs_from(ets, &count);
+  VALUE rb_states = sr_dense_output(out, count, 6);
+  VALUE rb_light_times = sr_dense_alloc(count, 1);
+  double * epochs = sr_dense_elements(rb_epochs),
+         * states = sr_dense_elements(rb_states),
+         * light_times = sr_dense_elements(rb_light_times);
+  const char * target = RB_SYM2STR(targ),
+             * frame = RB_SYM2STR(ref),
+             * correction = RB_SYM2STR(abcorr),
+             * observer = RB_SYM2STR(obs);
+
+  probe_batch("spkezr_batch", target, observer, count);
+  SR_NATIVE_ENTRY("spkezr_batch", 6, count);
+
+  for (index = 0; index < count; index++) {
+    spkezr_c(target, epochs[index], frame, correction, observer, states + 6 * index, light_times + index);
+    if (failed_c()) break;
+  }
+
+  SR_NATIVE_EXIT("spkezr_batch", failed_c());
   if(spice_error(SPICE_ERROR_SHORT)) return Qnil;
 
-  rb_state = rb_nmatrix_dense_create(FLOAT64, (size_t *) EPHEM_STATE_SHAPE, 2, (void *) state, 6);
+  RB_GC_GUARD(rb_epochs);
 
-  return rb_ary_new3(2, rb_state, DBL2NUM(light_time));  
+  return rb_ary_new3(2, rb_states, rb_light_times);
 }
 
 VALUE sr_pxform(VALUE self, VALUE from , VALUE to , VALUE at) {
-  double position_transform[3][3];
-  size_t rotation_shape[2] = {3,3};
+  VALUE rb_transform = sr_dense_alloc(3, 3);
 
-  pxform_c(RB_SYM2STR(from), RB_SYM2STR(to), NUM2DBL(at), position_transform);
+  SR_NATIVE_ENTRY("pxform", 3, 1);
 
+  pxform_c(RB_SYM2STR(from), RB_SYM2STR(to), NUM2DBL(at), (SpiceDouble (*)[3]) sr_dense_elements(rb_transform));
+
+  SR_NATIVE_EXIT("pxform", failed_c());
   if(spice_error(SPICE_ERROR_SHORT)) return Qnil;
 
-  return rb_nmatrix_dense_create(FLOAT64, (size_t *) rotation_shape , 2, (void *) position_transform , 9);
+  return rb_transform;
 }
 
 VALUE sr_pxfrm2(VALUE self, VALUE from , VALUE to , VALUE epoch_at, VALUE epoch_to) {
-  double position_transform[3][3];
-  size_t rotation_shape[2] = {3,3};
+  VALUE rb_transform = sr_dense_alloc(3, 3);
+
+  SR_NATIVE_ENTRY("pxfrm2", 4, 1);
 
-  pxfrm2_c(RB_SYM2STR(from), RB_SYM2STR(to), NUM2DBL(epoch_at), NUM2DBL(epoch_to), position_transform);
+  pxfrm2_c(RB_SYM2STR(from), RB_SYM2STR(to), NUM2DBL(epoch_at), NUM2DBL(epoch_to), (SpiceDouble (*)[3]) sr_dense_elements(rb_transform));
 
+  SR_NATIVE_EXIT("pxfrm2", failed_c());
   if(spice_error(SPICE_ERROR_SHORT)) return Qnil;
 
-  return rb_nmatrix_dense_create(FLOAT64, (size_t *) rotation_shape , 2, (void *) position_transform , 9);
+  return rb_transform;
 }
 
 VALUE sr_sxform(VALUE self, VALUE from , VALUE to , VALUE at) {
-  double state_transform[6][6];
-  size_t rotation_shape[2] = {6,6};
+  VALUE rb_transform = sr_dense_alloc(6, 6);
+
+  SR_NATIVE_ENTRY("sxform", 3, 1);
 
-  sxform_c(RB_SYM2STR(from), RB_SYM2STR(to), NUM2DBL(at), state_transform);
+  sxform_c(RB_SYM2STR(from), RB_SYM2STR(to), NUM2DBL(at), (SpiceDouble (*)[6]) sr_dense_elements(rb_transform));
 
+  SR_NATIVE_EXIT("sxform", failed_c());
   if(spice_error(SPICE_ERROR_SHORT)) return Qnil;
 
-  return rb_nmatrix_dense_create(FLOAT64, (size_t *) rotation_shape , 2, (void *) state_transform , 36);
+  return rb_transform;
 }
 
 VALUE sr_spkcpo(VALUE self, VALUE target, VALUE et, VALUE outref, VALUE refloc, VALUE abcorr, VALUE obspos, VALUE obsctr, VALUE obsref) {
-  double state[6], light_time;
-  VALUE rb_state;
+  double light_time;
+  VALUE rb_state = sr_dense_alloc(6, 1);
+
+  SR_NATIVE_ENTRY("spkcpo", 8, 1);
   
   spkcpo_c( RB_SYM2STR(target), 
             NUM2DBL(et), 
             RB_SYM2STR(outref), 
             RB_SYM2STR(refloc),
             RB_SYM2STR(abcorr),
-            NM_STORAGE_DENSE(obspos)->elements,
+            sr_dense_buffer(obspos, 3),
             RB_SYM2STR(obsctr),
             RB_SYM2STR(obsref),
-            state,
+            sr_dense_elements(rb_state),
             &light_time );
 
+  SR_NATIVE_EXIT("spkcpo", failed_c());
   if(spice_error(SPICE_ERROR_SHORT)) return Qnil;
 
-  rb_state = rb_nmatrix_dense_create(FLOAT64, (size_t *) EPHEM_STATE_SHAPE, 2, (void *) state, 6);
-  
   return rb_ary_new3(2, rb_state, DBL2NUM(light_time)); 
 }
 
 VALUE sr_spkcpt(VALUE self, VALUE trgpos, VALUE trgctr, VALUE trgref, VALUE et, VALUE outref, VALUE refloc, VALUE abcorr, VALUE obsrvr) {
-  double state[6], light_time;
-  VALUE rb_state;  
+  double light_time;
+  VALUE rb_state = sr_dense_alloc(6, 1);  
+
+  SR_NATIVE_ENTRY("spkcpt", 8, 1);
   
-  spkcpt_c( NM_STORAGE_DENSE(trgpos)->elements,
+  spkcpt_c( sr_dense_buffer(trgpos, 3),
             RB_SYM2STR(trgctr),
             RB_SYM2STR(trgref),
             NUM2DBL(et),
@@ -93,103 +184,172 @@ VALUE sr_spkcpt(VALUE self, VALUE trgpos, VALUE trgctr, VALUE trgref, VALUE et,
             RB_SYM2STR(refloc),
             RB_SYM2STR(abcorr),
             RB_SYM2STR(obsrvr),
-            state,
+            sr_dense_elements(rb_state),
             &light_time );
 
+  SR_NATIVE_EXIT("spkcpt", failed_c());
   if(spice_error(SPICE_ERROR_SHORT)) return Qnil;
 
-  rb_state = rb_nmatrix_dense_create(FLOAT64, (size_t *) EPHEM_STATE_SHAPE, 2, (void *) state, 6);
-  
   return rb_ary_new3(2, rb_state, DBL2NUM(light_time)); 
 }
 
 VALUE sr_spkcvo(VALUE self, VALUE target, VALUE et, VALUE outref, VALUE refloc, VALUE abcorr, VALUE obssta, VALUE obsepc, VALUE obsctr, VALUE obsref) {
-  double state[6], light_time;
-  VALUE rb_state;
+  double light_time;
+  VALUE rb_state = sr_dense_alloc(6, 1);
+
+  SR_NATIVE_ENTRY("spkcvo", 9, 1);
 
   spkcvo_c( RB_SYM2STR(target),
             NUM2DBL(et),
             RB_SYM2STR(outref),
             RB_SYM2STR(refloc),
             RB_SYM2STR(abcorr),
-            NM_STORAGE_DENSE(obssta)->elements,
+            sr_dense_buffer(obssta, 6),
             NUM2DBL(obsepc),
             RB_SYM2STR(obsctr),
             RB_SYM2STR(obsref),
-            state,
+            sr_dense_elements(rb_state),
             &light_time );
  
+  SR_NATIVE_EXIT("spkcvo", failed_c());
   if(spice_error(SPICE_ERROR_SHORT)) return Qnil;
 
-  rb_state = rb_nmatrix_dense_create(FLOAT64, (size_t *) EPHEM_STATE_SHAPE, 2, (void *) state, 6);
-  
   return rb_ary_new3(2, rb_state, DBL2NUM(light_time));
 }
 
 VALUE sr_spkcvt(VALUE self, VALUE trgsta, VALUE trgepc, VALUE trgctr, VALUE trgref, VALUE et, VALUE outref, VALUE refloc, VALUE abcorr, VALUE obsrvr) {
-  double state[6], light_time;
-  VALUE rb_state;
+  double light_time;
+  VALUE rb_state = sr_dense_alloc(6, 1);
+
+  SR_NATIVE_ENTRY("spkcvt", 9, 1);
 
-  spkcvt_c( NM_STORAGE_DENSE(trgsta)->elements,
-            DBL2NUM(trgepc),
+  spkcvt_c( sr_dense_buffer(trgsta, 6),
+            NUM2DBL(trgepc),
             RB_SYM2STR(trgctr),
             RB_SYM2STR(trgref),
-            DBL2NUM(et),
+            NUM2DBL(et),
             RB_SYM2STR(outref),
             RB_SYM2STR(refloc),
             RB_SYM2STR(abcorr),
             RB_SYM2STR(obsrvr),
-            state,
+            sr_dense_elements(rb_state),
             &light_time );
 
+  SR_NATIVE_EXIT("spkcvt", failed_c());
   if(spice_error(SPICE_ERROR_SHORT)) return Qnil;
 
-  rb_state = rb_nmatrix_dense_create(FLOAT64, (size_t *) EPHEM_STATE_SHAPE, 2, (void *) state, 6);
-  
   return rb_ary_new3(2, rb_state, DBL2NUM(light_time));
 }
 
-VALUE sr_pckfrm(VALUE self, VALUE pck_file) {
-  SPICEINT_CELL(output, 1000);
+VALUE sr_namfrm(VALUE self, VALUE frame_name) {
+  int frame_code;
 
-  pckfrm_c(StringValuePtr(pck_file), &output);
-  
-  return Qnil;
-  //#TODO : Extract data from the SPICECELL
-}  
+  SR_NATIVE_ENTRY("namfrm", 1, 1);
 
-VALUE sr_spkobj(VALUE self, VALUE spk_file) {
-  SPICEINT_CELL(output, 1000);
+  namfrm_c(RB_SYM2STR(frame_name), &frame_code);
 
-  spkobj_c(StringValuePtr(spk_file), &output);  
-  
-  return Qnil;
-  //#TODO : Extract data from the SPICECELL
+  SR_NATIVE_EXIT("namfrm", failed_c());
+  if(spice_error(SPICE_ERROR_SHORT)) return Qnil;
+
+  //A frame code of 0 means the name is not recognised
+  if(frame_code) return INT2FIX(frame_code);
+  else return Qnil;
 }
 
-VALUE sr_bodn2c(VALUE self, VALUE body_name) {
+VALUE sr_frinfo(VALUE self, VALUE frame_code) {
   SpiceBoolean found;
-  int code;
+  int center, frame_class, class_id;
 
-  bodn2c_c(RB_SYM2STR(body_name), &code, &found);
-  
+  SR_NATIVE_ENTRY("frinfo", 1, 1);
+
+  frinfo_c(FIX2INT(frame_code), &center, &frame_class, &class_id, &found);
+
+  SR_NATIVE_EXIT("frinfo", failed_c());
   if(spice_error(SPICE_ERROR_SHORT)) return Qnil;
-  
+
+  if(found) return rb_ary_new3(3, INT2FIX(center), INT2FIX(frame_class), INT2FIX(class_id));
+  else return Qnil;
+}
+
+VALUE sr_bodn2c(VALUE self, VALUE body_name) {
+  SpiceInt code;
+  bool found;
+
+  SR_NATIVE_ENTRY("bodn2c", 1, 1);
+
+  found = sr_bodies_code(RB_SYM2STR(body_name), &code);
+
+  SR_NATIVE_EXIT("bodn2c", failed_c());
+  if(spice_error(SPICE_ERROR_SHORT)) return Qnil;
+
   if(found) return INT2FIX(code);
   else return Qnil;
 }
 
 VALUE sr_bodc2n(VALUE self, VALUE code_name) {
-  SpiceBoolean found;
-  char * name = ALLOC_N(char, 32);
-  VALUE rb_symbol = Qnil;
-  
-  bodc2n_c(FIX2INT(code_name), 32, name, &found);
-  
+  VALUE rb_symbol;
+
+  SR_NATIVE_ENTRY("bodc2n", 1, 1);
+
+  rb_symbol = sr_bodies_name(FIX2INT(code_name));
+
+  SR_NATIVE_EXIT("bodc2n", failed_c());
   if(spice_error(SPICE_ERROR_SHORT)) return Qnil;
-  
-  if(found) rb_symbol = RB_STR2SYM(name);
 
-  xfree(name);
   return rb_symbol;
 }
+
+/* SPK writing : opens a new SPK for writing, returns the DAF handle */
+VALUE sr_spkopn(VALUE self, VALUE path, VALUE internal_name, VALUE comment_characters) {
+  SpiceInt handle;
+
+  SR_NATIVE_ENTRY("spkopn", 3, 1);
+
+  spkopn_c(StringValuePtr(path), StringValuePtr(internal_name), NUM2INT(comment_characters), &handle);
+
+  SR_NATIVE_EXIT("spkopn", failed_c());
+  if(spice_error(SPICE_ERROR_SHORT)) return Qnil;
+
+  return INT2NUM(handle);
+}
+
+/*
+ Writes a type 13 (Hermite, unequal time steps) segment of body relative to center. states is an
+ N x 6 float64 NMatrix with one state per row and epochs the N increasing epochs of the rows.
+*/
+VALUE sr_spkw13(VALUE self, VALUE handle, VALUE body, VALUE center, VALUE frame, VALUE first, VALUE last, VALUE segid, VALUE degree, VALUE states, VALUE epochs) {
+  long count;
+  VALUE rb_epochs = sr_epochs_from(epochs, &count);
+
+  SR_NATIVE_ENTRY("spkw13", 10, count);
+
+  spkw13_c( NUM2INT(handle),
+            NUM2INT(body),
+            NUM2INT(center),
+            RB_SYM2STR(frame),
+            NUM2DBL(first),
+            NUM2DBL(last),
+            StringValuePtr(segid),
+            NUM2INT(degree),
+            count,
+            (ConstSpiceDouble (*)[6]) sr_dense_matrix(states, count, 6),
+            sr_dense_elements(rb_epochs) );
+
+  SR_NATIVE_EXIT("spkw13", failed_c());
+  if(spice_error(SPICE_ERROR_SHORT)) return Qnil;
+
+  RB_GC_GUARD(rb_epochs);
+
+  return Qtrue;
+}
+
+VALUE sr_spkcls(VALUE self, VALUE handle) {
+  SR_NATIVE_ENTRY("spkcls", 1, 1);
+
+  spkcls_c(NUM2INT(handle));
+
+  SR_NATIVE_EXIT("spkcls", failed_c());
+  if(spice_error(SPICE_ERROR_SHORT)) return Qnil;
+
+  return Qtrue;
+}
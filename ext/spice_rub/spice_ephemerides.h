@@ -3,6 +3,6 @@
 #include <stdbool.h>
 #include "spice_rub_utils.h"
 #include "nmatrix.h"
-
-const size_t EPHEM_POSITION_SHAPE[2] = {3,1};
-const size_t EPHEM_STATE_SHAPE[2] = {6,1};
\ No newline at end of file
+#include "spice_buffer.h"
+#include "spice_bodies.h"
+#include "spice_probes.h"
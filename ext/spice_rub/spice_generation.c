@@ -0,0 +1,165 @@
+#include "spice_generation.h"
+
+/* Kernel pool generation and change notifications.
+
+ Every successful furnsh, unload, kclear and snapshot restore bumps a monotonically increasing generation.
+ Native caches record the generation they were built for and compare it on use, so nothing is flushed
+ ahead of time and a cache nobody asks for never rebuilds. Components that follow changes incrementally
+ (the coverage index) register a native listener instead, and Ruby code can subscribe any callable, which
+ is called with (generation, event, kernel) after the native side is up to date.
+
+ Inside a defer_pool_changes block subscribers are only called once the block is done, so KernelPool
+ records a kernel before an exception from a subscriber can get in the way.
+*/
+
+#define SR_POOL_MAX_LISTENERS 16
+
+static unsigned long generation = 1;
+static sr_pool_listener listeners[SR_POOL_MAX_LISTENERS];
+static int listener_count = 0;
+static VALUE subscribers = Qnil;
+//[generation, event, kernel] of the changes made inside defer_pool_changes blocks
+static VALUE deferred = Qnil;
+static int deferring = 0;
+
+static const char * POOL_EVENTS[4] = {"furnsh", "unload", "kclear", "restore"};
+
+unsigned long sr_pool_generation(void) {
+  return generation;
+}
+
+void sr_pool_listen(sr_pool_listener listener) {
+  if (listener_count == SR_POOL_MAX_LISTENERS) rb_bug("too many kernel pool listeners");
+
+  listeners[listener_count++] = listener;
+}
+
+static VALUE notify(VALUE arguments) {
+  VALUE * values = (VALUE *) arguments;
+
+  return rb_funcall(values[0], rb_intern("call"), 3, values[1], values[2], values[3]);
+}
+
+/* Calls every subscriber, even after one unsubscribed others, and returns the first exception raised or nil */
+static VALUE notify_subscribers(VALUE change) {
+  VALUE arguments[4], notified, error = Qnil;
+  long index;
+  int state;
+
+  arguments[1] = RARRAY_AREF(change, 0);
+  arguments[2] = RARRAY_AREF(change, 1);
+  arguments[3] = RARRAY_AREF(change, 2);
+
+  notified = rb_ary_dup(subscribers);
+
+  for (index = 0; index < RARRAY_LEN(notified); index++) {
+    arguments[0] = RARRAY_AREF(notified, index);
+    rb_protect(notify, (VALUE) arguments, &state);
+
+    if (state && NIL_P(error)) error = rb_errinfo();
+    if (state) rb_set_errinfo(Qnil);
+  }
+
+  RB_GC_GUARD(notified);
+
+  return error;
+}
+
+void sr_pool_changed(int event, const char * kernel) {
+  VALUE change, error;
+  long index;
+
+  generation++;
+
+  for (index = 0; index < listener_count; index++) listeners[index](event, kernel);
+
+  if (NIL_P(subscribers) || !RARRAY_LEN(subscribers)) return;
+
+  change = rb_ary_new3(3, ULONG2NUM(generation), RB_STR2SYM(POOL_EVENTS[event]), kernel ? rb_str_new2(kernel) : Qnil);
+
+  if (deferring) {
+    rb_ary_push(deferred, change);
+    return;
+  }
+
+  error = notify_subscribers(change);
+  if (!NIL_P(error)) rb_exc_raise(error);
+}
+
+//Ensure clause of defer_pool_changes, the native exits once its block is done
+static VALUE deliver_deferred(VALUE unused) {
+  VALUE changes, error = Qnil, raised;
+  long index;
+
+  SR_NATIVE_EXIT("defer_pool_changes", 0);
+
+  if (--deferring) return Qnil;
+
+  changes = deferred;
+  deferred = rb_ary_new();
+
+  for (index = 0; index < RARRAY_LEN(changes) && !NIL_P(subscribers); index++) {
+    raised = notify_subscribers(RARRAY_AREF(changes, index));
+    if (NIL_P(error)) error = raised;
+  }
+
+  RB_GC_GUARD(changes);
+
+  if (!NIL_P(error)) rb_exc_raise(error);
+
+  return Qnil;
+}
+
+/*
+ Yields, calling subscribers for the pool changes made in the block only when it is done, in order.
+ Blocks nest, the outermost one delivers. Returns the block's value.
+*/
+VALUE sr_defer_pool_changes(VALUE self) {
+  SR_NATIVE_ENTRY("defer_pool_changes", 0, 1);
+
+  if (NIL_P(deferred)) {
+    rb_gc_register_address(&deferred);
+    deferred = rb_ary_new();
+  }
+
+  deferring++;
+
+  return rb_ensure(rb_yield, Qnil, deliver_deferred, Qnil);
+}
+
+VALUE sr_pool_generation_value(VALUE self) {
+  SR_NATIVE_ENTRY("pool_generation", 0, 1);
+
+  SR_NATIVE_EXIT("pool_generation", 0);
+  return ULONG2NUM(generation);
+}
+
+/* Calls subscriber with (generation, event, kernel) after every kernel pool change, returns subscriber */
+VALUE sr_subscribe_pool(VALUE self, VALUE subscriber) {
+  SR_NATIVE_ENTRY("subscribe_pool", 1, 1);
+
+  if (!rb_respond_to(subscriber, rb_intern("call"))) rb_raise(rb_eArgError, "subscriber must respond to call");
+
+  if (NIL_P(subscribers)) {
+    rb_gc_register_address(&subscribers);
+    subscribers = rb_ary_new();
+  }
+
+  rb_ary_push(subscribers, subscriber);
+
+  SR_NATIVE_EXIT("subscribe_pool", 0);
+  return subscriber;
+}
+
+/* Removes a subscriber, returns it or nil when it was not subscribed */
+VALUE sr_unsubscribe_pool(VALUE self, VALUE subscriber) {
+  SR_NATIVE_ENTRY("unsubscribe_pool", 1, 1);
+
+  if (NIL_P(subscribers)) {
+    SR_NATIVE_EXIT("unsubscribe_pool", 0);
+    return Qnil;
+  }
+
+  SR_NATIVE_EXIT("unsubscribe_pool", 0);
+  return rb_ary_delete(subscribers, subscriber);
+}
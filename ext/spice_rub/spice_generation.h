@@ -0,0 +1,27 @@
+#ifndef SPICE_GENERATION_H
+#define SPICE_GENERATION_H
+
+#include "ruby.h"
+#include "SpiceUsr.h"
+#include <stdbool.h>
+#include "spice_rub_utils.h"
+#include "spice_probes.h"
+
+//Kinds of kernel pool changes
+#define SR_POOL_FURNSH  0
+#define SR_POOL_UNLOAD  1
+#define SR_POOL_KCLEAR  2
+#define SR_POOL_RESTORE 3
+
+//Native listeners get the kind of change and the kernel involved, NULL for kclear and restores
+typedef void (*sr_pool_listener)(int event, const char * kernel);
+
+//Generation of the kernel pool, bumped by every change and never 0
+unsigned long sr_pool_generation(void);
+
+void sr_pool_listen(sr_pool_listener listener);
+
+//Called by the kernel loading functions after CSPICE changed the pool
+void sr_pool_changed(int event, const char * kernel);
+
+#endif
@@ -1,11 +1,14 @@
 #include "spice_geometry.h"
 
 VALUE sr_latrec(VALUE self, VALUE radius, VALUE longitude, VALUE latitude) {
-  double vector[3];
+  VALUE rb_vector = sr_dense_alloc(3, 1);
+
+  SR_NATIVE_ENTRY("latrec", 3, 1);
   
-  latrec_c(NUM2DBL(radius), NUM2DBL(longitude), NUM2DBL(latitude),  vector);
+  latrec_c(NUM2DBL(radius), NUM2DBL(longitude), NUM2DBL(latitude), sr_dense_elements(rb_vector));
   
-  return rb_nmatrix_dense_create(FLOAT64, (size_t *) GEO_VECTOR_SHAPE, 2, (void *) vector, 3);
+  SR_NATIVE_EXIT("latrec", 0);
+  return rb_vector;
 }
 
 VALUE sr_reclat(VALUE self, VALUE rectangular_point) {
@@ -13,8 +16,11 @@ VALUE sr_reclat(VALUE self, VALUE rectangular_point) {
          longitude, 
          latitude;
 
-  reclat_c(NM_STORAGE_DENSE(rectangular_point)->elements, &radius, &longitude, &latitude);
+  SR_NATIVE_ENTRY("reclat", 1, 1);
+
+  reclat_c(sr_dense_buffer(rectangular_point, 3), &radius, &longitude, &latitude);
   
+  SR_NATIVE_EXIT("reclat", 0);
   return rb_ary_new3(3, DBL2NUM(radius), DBL2NUM(longitude), DBL2NUM(latitude));
 }
 
@@ -23,8 +29,11 @@ VALUE sr_reclat(VALUE self, VALUE rectangular_point) {
 VALUE sr_lspcn(int argc, VALUE *argv, VALUE self) {
   double result;
 
+  SR_NATIVE_ENTRY("lspcn", -1, 1);
+
   result = lspcn_c(RB_SYM2STR(argv[0]), NUM2DBL(argv[1]), RB_SYM2STR(argv[2]));
 
+  SR_NATIVE_EXIT("lspcn", failed_c());
   if(spice_error(SPICE_ERROR_SHORT)) return Qnil;
 
   return DBL2NUM(result); 
@@ -67,15 +76,17 @@ VALUE sr_sincpt(VALUE self, VALUE method, VALUE target, VALUE et, VALUE fixref,
   */
   //Output parameters
   SpiceBoolean found;
-  double intercept_epoch,
-         surface_point[3],
-         surface_vector[3];
+  double intercept_epoch;
+
+  //Matrices that we return to Ruby, SPICE writes straight into them
+  VALUE rb_point = sr_dense_alloc(3, 1);
+  VALUE rb_vector = sr_dense_alloc(3, 1);
 
-  //Arrays that we return to Ruby
-  VALUE rb_vector;
-  VALUE rb_point;
+  SR_NATIVE_ENTRY("sincpt", 8, 1);
 
-  sincpt_c(StringValuePtr(method), StringValuePtr(target), NUM2DBL(et), StringValuePtr(fixref), StringValuePtr(abcorr), StringValuePtr(obsrvr), StringValuePtr(dref), NM_STORAGE_DENSE(dvec)->elements, surface_point, &intercept_epoch, surface_vector, &found);
+  sincpt_c(StringValuePtr(method), StringValuePtr(target), NUM2DBL(et), StringValuePtr(fixref), StringValuePtr(abcorr), StringValuePtr(obsrvr), StringValuePtr(dref), sr_dense_buffer(dvec, 3), sr_dense_elements(rb_point), &intercept_epoch, sr_dense_elements(rb_vector), &found);
+
+  SR_NATIVE_EXIT("sincpt", failed_c());
 
   if(!found) {
     return Qfalse;
@@ -84,10 +95,6 @@ VALUE sr_sincpt(VALUE self, VALUE method, VALUE target, VALUE et, VALUE fixref,
   else if(spice_error(SPICE_ERROR_SHORT)) {
     return Qnil;
   }
-  
-  rb_point = rb_nmatrix_dense_create(FLOAT64, (size_t *) GEO_VECTOR_SHAPE, 2, (void *) surface_point, 3);
-  rb_vector = rb_nmatrix_dense_create(FLOAT64, (size_t *) GEO_VECTOR_SHAPE, 2, (void *) surface_vector, 3);
-
 
   return rb_ary_new3(3, rb_point, rb_vector, DBL2NUM(intercept_epoch));
 }
@@ -108,21 +115,19 @@ VALUE sr_sincpt(VALUE self, VALUE method, VALUE target, VALUE et, VALUE fixref,
 
 VALUE sr_subpnt(VALUE self, VALUE method, VALUE target, VALUE et, VALUE fixref, VALUE abcorr, VALUE obsrvr) {
   //Output
-  double observer_epoch,
-         surface_point[3],
-         surface_vector[3];
+  double observer_epoch;
+
+  //Matrices that we return to Ruby, SPICE writes straight into them
+  VALUE rb_vector = sr_dense_alloc(3, 1);
+  VALUE rb_point = sr_dense_alloc(3, 1);
 
-  //Arrays that we return to Ruby
-  VALUE rb_vector;
-  VALUE rb_point;
+  SR_NATIVE_ENTRY("subpnt", 6, 1);
 
-  subpnt_c(StringValuePtr(method), RB_SYM2STR(target), NUM2DBL(et), RB_SYM2STR(fixref), RB_SYM2STR(abcorr), RB_SYM2STR(obsrvr), surface_point, &observer_epoch, surface_vector);
+  subpnt_c(StringValuePtr(method), RB_SYM2STR(target), NUM2DBL(et), RB_SYM2STR(fixref), RB_SYM2STR(abcorr), RB_SYM2STR(obsrvr), sr_dense_elements(rb_vector), &observer_epoch, sr_dense_elements(rb_point));
 
+  SR_NATIVE_EXIT("subpnt", failed_c());
   if(spice_error(SPICE_ERROR_SHORT)) return Qnil;
-  
-  rb_vector = rb_nmatrix_dense_create(FLOAT64, (size_t *) GEO_VECTOR_SHAPE, 2, (void *) surface_point, 3);
-  rb_point = rb_nmatrix_dense_create(FLOAT64, (size_t *) GEO_VECTOR_SHAPE, 2, (void *) surface_vector, 3);
-  
+
   return rb_ary_new3(3, rb_point, rb_vector, DBL2NUM(observer_epoch));
 }
 
@@ -142,20 +147,18 @@ VALUE sr_subpnt(VALUE self, VALUE method, VALUE target, VALUE et, VALUE fixref,
 
 VALUE sr_subslr(VALUE self, VALUE method, VALUE target, VALUE et, VALUE fixref, VALUE abcorr, VALUE obsrvr) {
   //Output
-  double sub_solar_epoch,
-         surface_point[3],
-         surface_vector[3];
+  double sub_solar_epoch;
 
-  //Arrays that we return to Ruby
-  VALUE rb_vector = rb_ary_new();
-  VALUE rb_point  = rb_ary_new();
+  //Matrices that we return to Ruby, SPICE writes straight into them
+  VALUE rb_point = sr_dense_alloc(3, 1);
+  VALUE rb_vector = sr_dense_alloc(3, 1);
 
-  subslr_c(StringValuePtr(method), RB_SYM2STR(target), NUM2DBL(et), RB_SYM2STR(fixref), RB_SYM2STR(abcorr), RB_SYM2STR(obsrvr), surface_point, &sub_solar_epoch, surface_vector);
+  SR_NATIVE_ENTRY("subslr", 6, 1);
 
-  if(spice_error(SPICE_ERROR_SHORT)) return Qnil;
+  subslr_c(StringValuePtr(method), RB_SYM2STR(target), NUM2DBL(et), RB_SYM2STR(fixref), RB_SYM2STR(abcorr), RB_SYM2STR(obsrvr), sr_dense_elements(rb_point), &sub_solar_epoch, sr_dense_elements(rb_vector));
 
-  rb_point = rb_nmatrix_dense_create(FLOAT64, (size_t *) GEO_VECTOR_SHAPE, 2, (void *) surface_point, 3);
-  rb_vector = rb_nmatrix_dense_create(FLOAT64, (size_t *) GEO_VECTOR_SHAPE, 2, (void *) surface_vector, 3);
+  SR_NATIVE_EXIT("subslr", failed_c());
+  if(spice_error(SPICE_ERROR_SHORT)) return Qnil;
 
   return rb_ary_new3(3, rb_point, rb_vector, DBL2NUM(sub_solar_epoch));
 }
@@ -181,25 +184,28 @@ VALUE sr_getfov(VALUE self, VALUE instid, VALUE room, VALUE shapelen, VALUE fram
   char * frame = ALLOC_N(char, framelen);
   
   //Upper bound on boundary vectors is uncertain
-  double boundary_sight[3];
   double boundary_vectors [10][3];
   
   VALUE rb_bounds; 
-  VALUE rb_sight_vector = rb_ary_new();
+  VALUE rb_sight_vector = sr_dense_alloc(3, 1);
   VALUE rb_shape, rb_frame;
 
-  getfov_c(FIX2INT(instid), FIX2INT(room), FIX2INT(shapelen), FIX2INT(framelen), shape, frame, boundary_sight, &vector_count, boundary_vectors);
+  SR_NATIVE_ENTRY("getfov", 4, 1);
+
+  getfov_c(FIX2INT(instid), FIX2INT(room), FIX2INT(shapelen), FIX2INT(framelen), shape, frame, sr_dense_elements(rb_sight_vector), &vector_count, boundary_vectors);
   
+  SR_NATIVE_EXIT("getfov", failed_c());
   if(spice_error(SPICE_ERROR_SHORT)) {
     return Qnil;
   }
   
-  rb_sight_vector = rb_nmatrix_dense_create(FLOAT64, (size_t *) GEO_VECTOR_SHAPE, 2, (void *) boundary_sight, 3); 
-
   rb_bounds = rb_ary_new2(vector_count);
 
   for (count = 0; count < vector_count; count++) {
-    rb_ary_push(rb_bounds, rb_nmatrix_dense_create(FLOAT64, (size_t *) GEO_VECTOR_SHAPE, 2, (void *) boundary_vectors[count], 3));
+    VALUE rb_bound = sr_dense_alloc(3, 1);
+
+    memcpy(sr_dense_elements(rb_bound), boundary_vectors[count], 3 * sizeof(double));
+    rb_ary_push(rb_bounds, rb_bound);
   }
 
   rb_shape = RB_STR2SYM(shape);
@@ -218,17 +224,23 @@ VALUE sr_recsph(VALUE self, VALUE rectangular) {
          colatitude, 
          longitude;  
 
-  recsph_c(NM_STORAGE_DENSE(rectangular)->elements, &radius, &colatitude, &longitude);
+  SR_NATIVE_ENTRY("recsph", 1, 1);
 
+  recsph_c(sr_dense_buffer(rectangular, 3), &radius, &colatitude, &longitude);
+
+  SR_NATIVE_EXIT("recsph", 0);
   return rb_ary_new3(3, DBL2NUM(radius), DBL2NUM(colatitude), DBL2NUM(longitude));
 }
 
 VALUE sr_sphrec(VALUE self, VALUE radius, VALUE colatitude, VALUE longitude) {
-  double vector[3];
+  VALUE rb_vector = sr_dense_alloc(3, 1);
+
+  SR_NATIVE_ENTRY("sphrec", 3, 1);
 
-  sphrec_c(NUM2DBL(radius), NUM2DBL(colatitude), NUM2DBL(longitude), vector);
+  sphrec_c(NUM2DBL(radius), NUM2DBL(colatitude), NUM2DBL(longitude), sr_dense_elements(rb_vector));
   
-  return rb_nmatrix_dense_create(FLOAT64, (size_t *) GEO_VECTOR_SHAPE, 2, (void *) vector, 3);
+  SR_NATIVE_EXIT("sphrec", 0);
+  return rb_vector;
 }
 
 /*
@@ -242,8 +254,11 @@ SpiceDouble phaseq_c ( SpiceDouble       et,
 VALUE sr_phaseq(VALUE self, VALUE et, VALUE target, VALUE illmn, VALUE obsrvr, VALUE abcorr) {
   double phase_angle;
 
+  SR_NATIVE_ENTRY("phaseq", 5, 1);
+
   phase_angle = phaseq_c(NUM2DBL(et), RB_SYM2STR(target), RB_SYM2STR(illmn), RB_SYM2STR(obsrvr), RB_SYM2STR(abcorr));
 
+  SR_NATIVE_EXIT("phaseq", failed_c());
   if(spice_error(SPICE_ERROR_SHORT)) return Qnil;
 
   return DBL2NUM(phase_angle);
@@ -254,17 +269,23 @@ VALUE sr_recrad(VALUE self, VALUE rectangular) {
          right_ascension,
          declination;
 
-  recrad_c(NM_STORAGE_DENSE(rectangular)->elements, &range, &right_ascension, &declination);
+  SR_NATIVE_ENTRY("recrad", 1, 1);
+
+  recrad_c(sr_dense_buffer(rectangular, 3), &range, &right_ascension, &declination);
 
+  SR_NATIVE_EXIT("recrad", 0);
   return rb_ary_new3(3, DBL2NUM(range), DBL2NUM(right_ascension), DBL2NUM(declination));
 }
 
 VALUE sr_radrec(VALUE self, VALUE range, VALUE right_ascension, VALUE declination) {
-  double vector[3];
+  VALUE rb_vector = sr_dense_alloc(3, 1);
 
-  radrec_c(NUM2DBL(range), NUM2DBL(right_ascension), NUM2DBL(declination), vector);
+  SR_NATIVE_ENTRY("radrec", 3, 1);
+
+  radrec_c(NUM2DBL(range), NUM2DBL(right_ascension), NUM2DBL(declination), sr_dense_elements(rb_vector));
   
-  return rb_nmatrix_dense_create(FLOAT64, (size_t *) GEO_VECTOR_SHAPE, 2, (void *) vector, 3);
+  SR_NATIVE_EXIT("radrec", 0);
+  return rb_vector;
 }
 
 VALUE sr_recgeo(VALUE self, VALUE rectangular, VALUE radius_equatorial, VALUE flattening) {
@@ -272,21 +293,27 @@ VALUE sr_recgeo(VALUE self, VALUE rectangular, VALUE radius_equatorial, VALUE fl
          latitude,
          altitude;
 
-  recgeo_c(NM_STORAGE_DENSE(rectangular)->elements, NUM2DBL(radius_equatorial), NUM2DBL(flattening), &longitude, &latitude, &altitude);       
+  SR_NATIVE_ENTRY("recgeo", 3, 1);
+
+  recgeo_c(sr_dense_buffer(rectangular, 3), NUM2DBL(radius_equatorial), NUM2DBL(flattening), &longitude, &latitude, &altitude);       
   
+  SR_NATIVE_EXIT("recgeo", failed_c());
   if(spice_error(SPICE_ERROR_SHORT)) return Qnil;
 
   return rb_ary_new3(3, DBL2NUM(longitude), DBL2NUM(latitude), DBL2NUM(altitude));
 }
 
 VALUE sr_georec(VALUE self, VALUE longitude, VALUE latitude, VALUE altitude, VALUE radius_equatorial, VALUE flattening) {
-  double vector[3];
+  VALUE rb_vector = sr_dense_alloc(3, 1);
 
-  georec_c(NUM2DBL(longitude), NUM2DBL(latitude), NUM2DBL(altitude), NUM2DBL(radius_equatorial), NUM2DBL(flattening), vector);
+  SR_NATIVE_ENTRY("georec", 5, 1);
+
+  georec_c(NUM2DBL(longitude), NUM2DBL(latitude), NUM2DBL(altitude), NUM2DBL(radius_equatorial), NUM2DBL(flattening), sr_dense_elements(rb_vector));
   
+  SR_NATIVE_EXIT("georec", failed_c());
   if(spice_error(SPICE_ERROR_SHORT)) return Qnil;
 
-  return rb_nmatrix_dense_create(FLOAT64, (size_t *) GEO_VECTOR_SHAPE, 2, (void *) vector, 3);
+  return rb_vector;
 }
 
 VALUE sr_recpgr(VALUE self, VALUE body, VALUE rectangular, VALUE radius_equatorial, VALUE flattening) {
@@ -294,38 +321,53 @@ VALUE sr_recpgr(VALUE self, VALUE body, VALUE rectangular, VALUE radius_equatori
          latitude,
          altitude;
 
-  recpgr_c(RB_SYM2STR(body), NM_STORAGE_DENSE(rectangular)->elements, NUM2DBL(radius_equatorial), NUM2DBL(flattening), &longitude, &latitude, &altitude);
+  SR_NATIVE_ENTRY("recpgr", 4, 1);
+
+  recpgr_c(RB_SYM2STR(body), sr_dense_buffer(rectangular, 3), NUM2DBL(radius_equatorial), NUM2DBL(flattening), &longitude, &latitude, &altitude);
   
+  SR_NATIVE_EXIT("recpgr", failed_c());
   if(spice_error(SPICE_ERROR_SHORT)) return Qnil;
 
   return rb_ary_new3(3, DBL2NUM(longitude), DBL2NUM(latitude), DBL2NUM(altitude));
 }
 
 VALUE sr_pgrrec(VALUE self, VALUE body, VALUE longitude, VALUE latitude, VALUE altitude, VALUE radius_equatorial, VALUE flattening) {
-  double vector[3];
+  VALUE rb_vector = sr_dense_alloc(3, 1);
 
-  pgrrec_c(RB_SYM2STR(body), NUM2DBL(longitude), NUM2DBL(latitude), NUM2DBL(altitude), NUM2DBL(radius_equatorial), NUM2DBL(flattening),  vector);
+  SR_NATIVE_ENTRY("pgrrec", 6, 1);
 
+  pgrrec_c(RB_SYM2STR(body), NUM2DBL(longitude), NUM2DBL(latitude), NUM2DBL(altitude), NUM2DBL(radius_equatorial), NUM2DBL(flattening), sr_dense_elements(rb_vector));
+
+  SR_NATIVE_EXIT("pgrrec", failed_c());
   if(spice_error(SPICE_ERROR_SHORT)) return Qnil;
 
-  return rb_nmatrix_dense_create(FLOAT64, (size_t *) GEO_VECTOR_SHAPE, 2, (void *) vector, 3);
+  return rb_vector;
 }
 
 VALUE sr_srfrec(VALUE self, VALUE body, VALUE longitude, VALUE latitude) {
-  double vector[3];
+  VALUE rb_vector = sr_dense_alloc(3, 1);
+
+  SR_NATIVE_ENTRY("srfrec", 3, 1);
 
-  srfrec_c(FIX2INT(body), NUM2DBL(longitude), NUM2DBL(latitude), vector);
+  srfrec_c(FIX2INT(body), NUM2DBL(longitude), NUM2DBL(latitude), sr_dense_elements(rb_vector));
 
+  SR_NATIVE_EXIT("srfrec", failed_c());
   if(spice_error(SPICE_ERROR_SHORT)) return Qnil;
 
-  return rb_nmatrix_dense_create(FLOAT64, (size_t *) GEO_VECTOR_SHAPE, 2, (void *) vector, 3);
+  return rb_vector;
 }
 
 VALUE sr_dpr(VALUE self) {
+  SR_NATIVE_ENTRY("dpr", 0, 1);
+
+  SR_NATIVE_EXIT("dpr", 0);
   return DBL2NUM(dpr_c());
 }
 
 VALUE sr_rpd(VALUE self) {
+  SR_NATIVE_ENTRY("rpd", 0, 1);
+
+  SR_NATIVE_EXIT("rpd", 0);
   return DBL2NUM(rpd_c());
 }
 
@@ -334,6 +376,8 @@ VALUE sr_bodvrd(VALUE self, VALUE bodynm, VALUE item, VALUE maxn) {
   double * values = ALLOC_N(double, maxn); 
   VALUE rb_values = rb_ary_new();
 
+  SR_NATIVE_ENTRY("bodvrd", 3, 1);
+
   bodvrd_c(RB_SYM2STR(bodynm), RB_SYM2STR(item), FIX2INT(maxn), &dim, values);
   
   for(count = 0 ; count < dim ; count++) {
@@ -342,6 +386,7 @@ VALUE sr_bodvrd(VALUE self, VALUE bodynm, VALUE item, VALUE maxn) {
   
   xfree(values);
 
+  SR_NATIVE_EXIT("bodvrd", 0);
   return rb_ary_new3(2, INT2FIX(dim), rb_values);
 }
 
@@ -350,6 +395,8 @@ VALUE sr_bodvcd(VALUE self, VALUE bodynm, VALUE item, VALUE maxn) {
   double * values = ALLOC_N(double, maxn); 
   VALUE rb_values = rb_ary_new();
 
+  SR_NATIVE_ENTRY("bodvcd", 3, 1);
+
   bodvcd_c(FIX2INT(bodynm), RB_SYM2STR(item), FIX2INT(maxn), &dim, values);
   
   for(count = 0 ; count < dim ; count++) {
@@ -358,6 +405,7 @@ VALUE sr_bodvcd(VALUE self, VALUE bodynm, VALUE item, VALUE maxn) {
   
   xfree(values);
 
+  SR_NATIVE_EXIT("bodvcd", 0);
   return rb_ary_new3(2, INT2FIX(dim), rb_values);
 }
 
@@ -366,8 +414,11 @@ VALUE sr_latsph(VALUE self, VALUE radius, VALUE longitude, VALUE latitude) {
          colat, 
          lons;
 
+  SR_NATIVE_ENTRY("latsph", 3, 1);
+
   latsph_c(NUM2DBL(radius), NUM2DBL(longitude), NUM2DBL(latitude),  &rho, &colat, &lons);
   
+  SR_NATIVE_EXIT("latsph", 0);
   return rb_ary_new3(3, DBL2NUM(rho), DBL2NUM(colat), DBL2NUM(lons));
 }
 
@@ -376,7 +427,10 @@ VALUE sr_sphlat(VALUE self, VALUE radius, VALUE colatitude, VALUE longitude) {
          lat_longitude,
          lat_latitude;
 
+  SR_NATIVE_ENTRY("sphlat", 3, 1);
+
   sphlat_c(NUM2DBL(radius), NUM2DBL(colatitude), NUM2DBL(longitude), &lat_radius, &lat_longitude, &lat_latitude);
 
+  SR_NATIVE_EXIT("sphlat", 0);
   return rb_ary_new3(3, DBL2NUM(lat_radius), DBL2NUM(lat_longitude), DBL2NUM(lat_latitude));
 }
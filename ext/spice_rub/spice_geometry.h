@@ -2,6 +2,6 @@
 #include "SpiceUsr.h"
 #include <stdbool.h>
 #include "spice_rub_utils.h"
+#include "spice_probes.h"
 #include "nmatrix.h"
-
-const size_t GEO_VECTOR_SHAPE[2] = {3,1};
+#include "spice_buffer.h"
\ No newline at end of file
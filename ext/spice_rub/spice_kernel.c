@@ -1,47 +1,170 @@
 #include "spice_kernel.h"
+#include "spice_generation.h"
+#include "spice_probes.h"
 
 VALUE sr_furnsh(VALUE self, VALUE kernel) {
   sigset_t old_mask = block_signals();
 
+  SR_NATIVE_ENTRY("furnsh", 1, 1);
+
+  SR_PROBE1(kernel__load__start, StringValuePtr(kernel));
   furnsh_c(StringValuePtr(kernel));
+  SR_PROBE2(kernel__load__done, StringValuePtr(kernel), !failed_c());
 
   restore_signals(old_mask);
   
+  SR_NATIVE_EXIT("furnsh", failed_c());
   if(spice_error(SPICE_ERROR_SHORT)) return Qfalse;
 
+  sr_pool_changed(SR_POOL_FURNSH, StringValuePtr(kernel));
+
   return Qtrue;
 }
 
 VALUE sr_unload(VALUE self, VALUE kernel) {
   sigset_t old_mask = block_signals();
 
+  SR_NATIVE_ENTRY("unload", 1, 1);
+
   unload_c(StringValuePtr(kernel));
+  SR_PROBE1(kernel__unload, StringValuePtr(kernel));
   
   restore_signals(old_mask);
   
+  SR_NATIVE_EXIT("unload", failed_c());
   if(spice_error(SPICE_ERROR_SHORT)) return Qfalse;
 
+  sr_pool_changed(SR_POOL_UNLOAD, StringValuePtr(kernel));
+
   return Qtrue;
 }
 
 VALUE sr_ktotal(int argc, VALUE *argv, VALUE self) {
   SpiceInt kernel_count;
+
+  SR_NATIVE_ENTRY("ktotal", -1, 1);
   
   if(argc == 0) ktotal_c("ALL", &kernel_count);
 
   //Else convert Symbol to ID, ID to string if category argument supplied
   else ktotal_c(RB_SYM2STR(argv[0]), &kernel_count);
 
+  SR_NATIVE_EXIT("ktotal", failed_c());
   spice_error(SPICE_ERROR_SHORT);
 
   return INT2FIX(kernel_count);
 }
 
 VALUE sr_kclear(VALUE self) {
+  SR_NATIVE_ENTRY("kclear", 0, 1);
   
   kclear_c();
   
+  SR_NATIVE_EXIT("kclear", failed_c());
   if(spice_error(SPICE_ERROR_SHORT)) return Qfalse;
 
+  sr_pool_changed(SR_POOL_KCLEAR, NULL);
+
   return Qtrue;
-}
\ No newline at end of file
+}
+/* Highest descriptor worth looking at when /proc/self/fd cannot be listed */
+#define SR_REOPEN_MAX_FD 65536
+
+/* Gives fd an open file description of its own on the same file, at the same offset and with the same flags */
+static bool reopen_descriptor(int fd, const char * path) {
+  int reopened, descriptor_flags = fcntl(fd, F_GETFD), status_flags = fcntl(fd, F_GETFL);
+  off_t offset = lseek(fd, 0, SEEK_CUR);
+
+  if (descriptor_flags < 0 || status_flags < 0) return false;
+
+  reopened = open(path, status_flags & O_ACCMODE);
+  if (reopened < 0) return false;
+
+  if (offset >= 0) lseek(reopened, offset, SEEK_SET);
+
+  if (dup2(reopened, fd) < 0) {
+    close(reopened);
+    return false;
+  }
+
+  close(reopened);
+  fcntl(fd, F_SETFD, descriptor_flags);
+
+  return true;
+}
+
+/* Reopens fd when it is open on one of the files, returns 1 the first time a file is reopened */
+static long reopen_matching(int fd, long count, const char ** names, struct stat * files, bool * matched) {
+  struct stat status;
+  long index;
+
+  if (fstat(fd, &status) || !S_ISREG(status.st_mode)) return 0;
+
+  for (index = 0; index < count; index++) {
+    if (files[index].st_dev != status.st_dev || files[index].st_ino != status.st_ino) continue;
+    if (!reopen_descriptor(fd, names[index]) || matched[index]) return 0;
+
+    matched[index] = true;
+    return 1;
+  }
+
+  return 0;
+}
+
+/*
+ Gives the open descriptors of the kernel files in paths file descriptions of their own. A forked process
+ shares the file offsets of its parent, CSPICE seeking in one would move the other's reads. Reopening
+ below CSPICE keeps its handles, indexes and the kernel pool as they are. Returns the number of files
+ reopened.
+*/
+VALUE sr_reopen_kernels(VALUE self, VALUE paths) {
+  struct stat * files;
+  const char ** names;
+  bool * matched;
+  long count, index, reopened = 0;
+  int fd;
+  DIR * descriptors;
+  struct dirent * entry;
+  VALUE path, buffer, names_buffer, matched_buffer;
+
+  SR_NATIVE_ENTRY("reopen_kernels", 1, 1);
+
+  Check_Type(paths, T_ARRAY);
+  count = RARRAY_LEN(paths);
+
+  files = ALLOCV_N(struct stat, buffer, count + 1);
+  names = ALLOCV_N(const char *, names_buffer, count + 1);
+  matched = ALLOCV_N(bool, matched_buffer, count + 1);
+
+  for (index = 0; index < count; index++) {
+    path = RARRAY_AREF(paths, index);
+    names[index] = StringValueCStr(path);
+    matched[index] = false;
+
+    if (stat(names[index], files + index)) {
+      files[index].st_dev = 0;
+      files[index].st_ino = 0;
+    }
+  }
+
+  descriptors = opendir("/proc/self/fd");
+
+  if (descriptors) {
+    while ((entry = readdir(descriptors))) {
+      fd = atoi(entry->d_name);
+      if (entry->d_name[0] != '.' && fd > 2 && fd != dirfd(descriptors)) reopened += reopen_matching(fd, count, names, files, matched);
+    }
+    closedir(descriptors);
+  }
+  else {
+    for (fd = 3; fd < SR_REOPEN_MAX_FD; fd++) reopened += reopen_matching(fd, count, names, files, matched);
+  }
+
+  ALLOCV_END(buffer);
+  ALLOCV_END(names_buffer);
+  ALLOCV_END(matched_buffer);
+  RB_GC_GUARD(paths);
+
+  SR_NATIVE_EXIT("reopen_kernels", 0);
+  return LONG2NUM(reopened);
+}
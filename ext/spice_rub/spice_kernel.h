@@ -2,3 +2,7 @@
 #include "SpiceUsr.h"
 #include <stdbool.h>
 #include "spice_rub_utils.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
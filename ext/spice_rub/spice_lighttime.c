@@ -0,0 +1,202 @@
+#include "spice_lighttime.h"
+#include <math.h>
+
+/* Warm started light time corrections.
+
+ spkpos_c solves the light time equation from scratch at every epoch: a geometric state to get a first
+ light time, then one (LT) or up to three more (CN) evaluations of the target at the retarded epoch. Along
+ a dense epoch series the light times of the two previous epochs extrapolate to a guess that is already
+ converged to well below a microsecond, so one evaluation of the target at the guessed retarded epoch
+ settles it:
+
+  - CN iterates from the guess until the light time stops changing, normally two evaluations where
+    spkpos_c makes up to four. A repeated retarded epoch is served from the cached state.
+  - LT evaluates once at the guess. Its result is closer to the converged solution than spkpos_c's
+    single iteration from the geometric light time; both differ by about lt * (v/c)^2, around ten
+    microseconds for planets, under a meter in position.
+
+ The first two epochs, and any epoch whose guess turns out to be poor, fall back to spkpos_c's own
+ sequence. Stellar aberration is applied with stelab_c, and non-inertial frames are evaluated at the
+ epoch minus the light time to their center, tracked the same way as the target.
+*/
+
+//Iterations of CN after the first light time, as in spkpos_c
+#define SR_LT_MAX_ITERATIONS 3
+//Light time changes below this fraction count as converged
+#define SR_LT_CONVERGED 1.0e-15
+//LT keeps a warm guess when its single evaluation moved it by less than this, in seconds
+#define SR_LT_WARM_LIMIT 1.0e-6
+
+typedef struct {
+  bool converged, transmission, stellar;
+} lt_correction;
+
+/* A body whose light time is tracked along the epoch series */
+typedef struct {
+  SpiceInt code;
+  long known;
+  double et[2], light_time[2];
+  //Last state evaluated, to serve a repeated retarded epoch
+  double cached_et, cached[6];
+  bool cached_valid;
+  long evaluations;
+} lt_track;
+
+static void parse_correction(const char * text, lt_correction * correction) {
+  char normalized[16];
+  int length = 0;
+
+  for (; *text && length < 15; text++)
+    if (!isspace((unsigned char) *text)) normalized[length++] = toupper((unsigned char) *text);
+  normalized[length] = '\0';
+
+  correction->transmission = normalized[0] == 'X';
+  text = normalized + correction->transmission;
+
+  if (strncmp(text, "CN", 2) == 0) correction->converged = true;
+  else if (strncmp(text, "LT", 2) == 0) correction->converged = false;
+  else rb_raise(rb_eArgError, "light time correction expected, got %s", normalized);
+
+  if (strcmp(text + 2, "+S") == 0) correction->stellar = true;
+  else if (text[2] == '\0') correction->stellar = false;
+  else rb_raise(rb_eArgError, "unknown aberration correction %s", normalized);
+}
+
+static const double * retarded_state(lt_track * track, double et) {
+  if (!track->cached_valid || track->cached_et != et) {
+    spkssb_c(track->code, et, "J2000", track->cached);
+    track->cached_et = et;
+    track->cached_valid = !failed_c();
+    track->evaluations++;
+  }
+
+  return track->cached;
+}
+
+/* Light time from the observer to a body state, leaving the relative position in position */
+static double light_time_to(const double * state, const double * observer, double position[3]) {
+  vsub_c(state, observer, position);
+
+  return vnorm_c(position) / clight_c();
+}
+
+/*
+ Solves for the light time from the observer state to a tracked body at et and leaves the position of the
+ body relative to the observer, at the last retarded epoch evaluated, in position.
+*/
+static double solve(lt_track * track, const lt_correction * correction, double et, const double * observer, double position[3]) {
+  double sign = correction->transmission ? 1.0 : -1.0, light_time, previous, guess, slope;
+  int iteration, iterations = correction->converged ? SR_LT_MAX_ITERATIONS : 1;
+  bool warm = track->known == 2 && track->et[1] != track->et[0];
+
+  if (warm) {
+    slope = (track->light_time[1] - track->light_time[0]) / (track->et[1] - track->et[0]);
+    guess = track->light_time[1] + slope * (et - track->et[1]);
+
+    light_time = light_time_to(retarded_state(track, et + sign * guess), observer, position);
+
+    if (!correction->converged && fabs(light_time - guess) > SR_LT_WARM_LIMIT) warm = false;
+  }
+
+  //Cold start, as spkpos_c does it: the geometric light time first
+  if (!warm) light_time = light_time_to(retarded_state(track, et), observer, position);
+
+  for (iteration = warm ? 1 : 0; iteration < iterations; iteration++) {
+    previous = light_time;
+    light_time = light_time_to(retarded_state(track, et + sign * light_time), observer, position);
+
+    if (correction->converged && fabs(light_time - previous) <= SR_LT_CONVERGED * light_time) break;
+  }
+
+  track->et[0] = track->et[1];
+  track->light_time[0] = track->light_time[1];
+  track->et[1] = et;
+  track->light_time[1] = light_time;
+  if (track->known < 2) track->known++;
+
+  return light_time;
+}
+
+static bool frame_rotation_needed(const char * frame, SpiceInt * center, bool * inertial) {
+  SpiceInt code, frame_class, class_id;
+  SpiceBoolean found;
+
+  namfrm_c(frame, &code);
+  if (!code) rb_raise(rb_eArgError, "unknown frame %s", frame);
+
+  frinfo_c(code, center, &frame_class, &class_id, &found);
+  if (!found) rb_raise(rb_eArgError, "no frame information for %s", frame);
+
+  *inertial = frame_class == 1;
+
+  return !eqstr_c(frame, "J2000");
+}
+
+/*
+ Light time corrected positions of targ relative to obs at every epoch of ets, like sr_spkpos_batch but
+ warm starting each epoch from its neighbours. abcorr must be a light time correction. Returns
+ [N x 3 positions, N x 1 light times, number of target state evaluations].
+*/
+VALUE sr_spkpos_lt_batch(VALUE self, VALUE targ, VALUE ets, VALUE ref, VALUE abcorr, VALUE obs, VALUE out) {
+  lt_correction correction;
+  lt_track target, center;
+  SpiceInt observer_code, center_code;
+  long count, index;
+  bool rotate, inertial;
+  double observer[6], velocity[3], position[3], corrected[3], rotation[3][3], center_position[3], center_light_time;
+  const char * frame = RB_SYM2STR(ref);
+  VALUE rb_epochs = sr_epochs_from(ets, &count);
+  VALUE rb_positions = sr_dense_output(out, count, 3);
+  VALUE rb_light_times = sr_dense_alloc(count, 1);
+  double * epochs = sr_dense_elements(rb_epochs),
+         * positions = sr_dense_elements(rb_positions),
+         * light_times = sr_dense_elements(rb_light_times);
+
+  parse_correction(RB_SYM2STR(abcorr), &correction);
+
+  memset(&target, 0, sizeof(target));
+  memset(&center, 0, sizeof(center));
+  target.code = sr_body_code(targ);
+  observer_code = sr_body_code(obs);
+
+  rotate = frame_rotation_needed(frame, &center_code, &inertial);
+  center.code = center_code;
+  if (rotate && inertial) pxform_c("J2000", frame, 0.0, rotation);
+
+  SR_PROBE4(spk__batch, "spkpos_lt_batch", target.code, observer_code, count);
+  SR_NATIVE_ENTRY("spkpos_lt_batch", 6, count);
+
+  for (index = 0; index < count && !failed_c(); index++) {
+    spkssb_c(observer_code, epochs[index], "J2000", observer);
+
+    light_times[index] = solve(&target, &correction, epochs[index], observer, position);
+
+    //Transmission aberration is the reception one for the opposite observer velocity
+    if (correction.stellar) {
+      if (correction.transmission) vminus_c(observer + 3, velocity);
+      else vequ_c(observer + 3, velocity);
+
+      stelab_c(position, velocity, corrected);
+      vequ_c(corrected, position);
+    }
+
+    if (rotate && !inertial) {
+      //The frame is seen as it was when light left its center
+      if (center_code == observer_code) center_light_time = 0.0;
+      else if (center_code == target.code) center_light_time = light_times[index];
+      else center_light_time = solve(&center, &correction, epochs[index], observer, center_position);
+
+      pxform_c("J2000", frame, epochs[index] + (correction.transmission ? 1.0 : -1.0) * center_light_time, rotation);
+    }
+
+    if (rotate) mxv_c(rotation, position, positions + 3 * index);
+    else vequ_c(position, positions + 3 * index);
+  }
+
+  SR_NATIVE_EXIT("spkpos_lt_batch", failed_c());
+  if(spice_error(SPICE_ERROR_SHORT)) return Qnil;
+
+  RB_GC_GUARD(rb_epochs);
+
+  return rb_ary_new3(3, rb_positions, rb_light_times, LONG2NUM(target.evaluations));
+}
@@ -0,0 +1,8 @@
+#include "ruby.h"
+#include "SpiceUsr.h"
+#include <stdbool.h>
+#include <ctype.h>
+#include "spice_rub_utils.h"
+#include "nmatrix.h"
+#include "spice_buffer.h"
+#include "spice_tensor.h"
@@ -0,0 +1,86 @@
+#include "spice_parallel.h"
+#include <unistd.h>
+
+/* Batch evaluation outside the GVL.
+
+ The native evaluators only read memory mapped kernels and indexes that are frozen for the duration of a
+ batch, so a batch can be split into contiguous chunks evaluated by a small pool of pthreads while the GVL
+ is released. The calling thread works on the first chunk itself and joins the others before returning.
+*/
+
+typedef struct {
+  long begin, end;
+  sr_parallel_fn work;
+  void * data;
+} parallel_chunk;
+
+typedef struct {
+  long count;
+  int threads;
+  sr_parallel_fn work;
+  void * data;
+} parallel_batch;
+
+static void * run_chunk(void * argument) {
+  parallel_chunk * chunk = argument;
+
+  chunk->work(chunk->begin, chunk->end, chunk->data);
+
+  return NULL;
+}
+
+static void * run_batch(void * argument) {
+  parallel_batch * batch = argument;
+  parallel_chunk chunks[SR_PARALLEL_MAX_THREADS];
+  pthread_t workers[SR_PARALLEL_MAX_THREADS];
+  bool started[SR_PARALLEL_MAX_THREADS];
+  long size = (batch->count + batch->threads - 1) / batch->threads;
+  int index;
+
+  for (index = 0; index < batch->threads; index++) {
+    chunks[index].begin = index * size;
+    chunks[index].end = (index + 1) * size < batch->count ? (index + 1) * size : batch->count;
+    chunks[index].work = batch->work;
+    chunks[index].data = batch->data;
+    started[index] = false;
+  }
+
+  //Chunk 0 runs on this thread, a worker that fails to start has its chunk run here too
+  for (index = 1; index < batch->threads; index++) {
+    if (chunks[index].begin < chunks[index].end)
+      started[index] = !pthread_create(&workers[index], NULL, run_chunk, &chunks[index]);
+  }
+
+  run_chunk(&chunks[0]);
+
+  for (index = 1; index < batch->threads; index++) {
+    if (started[index]) pthread_join(workers[index], NULL);
+    else if (chunks[index].begin < chunks[index].end) run_chunk(&chunks[index]);
+  }
+
+  return NULL;
+}
+
+/* Number of threads for a batch, nil means one per online CPU */
+int sr_parallel_threads(VALUE threads) {
+  long count = NIL_P(threads) ? sysconf(_SC_NPROCESSORS_ONLN) : NUM2LONG(threads);
+
+  if (count < 1) count = 1;
+  if (count > SR_PARALLEL_MAX_THREADS) count = SR_PARALLEL_MAX_THREADS;
+
+  return (int) count;
+}
+
+/* Evaluates count items with up to threads threads, with the GVL released */
+void sr_parallel_run(long count, int threads, sr_parallel_fn work, void * data) {
+  parallel_batch batch;
+
+  if (count <= 0) return;
+
+  batch.count = count;
+  batch.threads = threads < count ? threads : (int) count;
+  batch.work = work;
+  batch.data = data;
+
+  rb_thread_call_without_gvl(run_batch, &batch, NULL, NULL);
+}
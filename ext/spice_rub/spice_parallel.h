@@ -0,0 +1,18 @@
+#include "ruby.h"
+#include "ruby/thread.h"
+#include <stdbool.h>
+#include <pthread.h>
+
+#ifndef SPICE_PARALLEL_H
+#define SPICE_PARALLEL_H
+
+//Upper bound on worker threads for a single batch
+#define SR_PARALLEL_MAX_THREADS 64
+
+//Evaluates items [begin, end) of a batch, must not touch Ruby or CSPICE
+typedef void (* sr_parallel_fn)(long begin, long end, void * data);
+
+int sr_parallel_threads(VALUE threads);
+void sr_parallel_run(long count, int threads, sr_parallel_fn work, void * data);
+
+#endif
@@ -0,0 +1,393 @@
+#include "spice_pck.h"
+#include <math.h>
+
+/* Native binary PCK evaluator.
+
+ High rate frame rotations (MOON_PA and friends) otherwise go through pxform_c one epoch at a time, with
+ the GVL held. Binary PCK segments hold Chebyshev fits of the three Euler angles (phi, delta, w) of a body
+ fixed frame relative to an inertial base frame, so the rotation can be evaluated straight from a memory
+ mapped file in the same way the native SPK reader evaluates positions:
+
+   R(base -> body) = [w]_3 [delta]_1 [phi]_3
+
+ Frames built on top of a PCK frame by TK frames (MOON_ME_DE421 over MOON_PA_DE421) only add a constant
+ rotation. Each frame is resolved once into that constant part and the PCK class it rests on, following the
+ TKFRAME_<frame>_RELATIVE chain, and the resolution is cached until kernels change. Inertial frames resolve
+ to a constant rotation from J2000 and no PCK class.
+
+ Segment types 2 (angles) and 3 (angles and rates) are supported. Segments are indexed and locked by
+ spice_daf_index.c, like the SPK reader's.
+*/
+
+#define SR_PCK_NAMELEN 33
+#define SR_PCK_MAX_CHAIN 100
+#define SR_PCK_CACHE 64
+
+//A frame resolved to outer * R(J2000 -> PCK class frame), with pck_class 0 for inertial frames
+typedef struct {
+  int frame, pck_class;
+  double outer[3][3];
+} frame_chain;
+
+//Kernel pool generation the frame chains were resolved for
+static unsigned long chains_for = 0;
+static frame_chain chains[SR_PCK_CACHE];
+static long chain_count = 0;
+
+/* ---- Rotation helpers ---- */
+
+static void multiply(double left[3][3], double right[3][3], double result[3][3]) {
+  double product[3][3];
+  int row, column;
+
+  for (row = 0; row < 3; row++)
+    for (column = 0; column < 3; column++)
+      product[row][column] = left[row][0] * right[0][column] + left[row][1] * right[1][column] + left[row][2] * right[2][column];
+
+  memcpy(result, product, sizeof(product));
+}
+
+/* [w]_3 [delta]_1 [phi]_3, the same rotation eul2m_c builds for axes 3, 1, 3 */
+static void euler_313(double phi, double delta, double w, double rotation[3][3]) {
+  double cp = cos(phi), sp = sin(phi), cd = cos(delta), sd = sin(delta), cw = cos(w), sw = sin(w);
+
+  rotation[0][0] =  cw * cp - sw * cd * sp;
+  rotation[0][1] =  cw * sp + sw * cd * cp;
+  rotation[0][2] =  sw * sd;
+  rotation[1][0] = -sw * cp - cw * cd * sp;
+  rotation[1][1] = -sw * sp + cw * cd * cp;
+  rotation[1][2] =  cw * sd;
+  rotation[2][0] =  sd * sp;
+  rotation[2][1] = -sd * cp;
+  rotation[2][2] =  cd;
+}
+
+/* ---- Segment evaluation ---- */
+
+/* Euler angles (phi, delta, w) and their rates from a type 2 or 3 segment */
+static int evaluate_angles(const sr_daf_segment * segment, double et, double angles[6]) {
+  if (!segment->usable) return SR_DAF_UNSUPPORTED;
+
+  return sr_daf_chebyshev(segment, et, angles);
+}
+
+/* Rotation from J2000 to the frame of a PCK class at et */
+static int class_rotation(const sr_daf_index * index, int class_id, double et, double rotation[3][3]) {
+  const sr_daf_segment * segment = sr_daf_index_segment(index, class_id, et);
+  double angles[6];
+  int status;
+
+  if (!segment) return SR_DAF_NO_DATA;
+
+  status = evaluate_angles(segment, et, angles);
+  if (status != SR_DAF_OK) return status;
+
+  euler_313(angles[0], angles[1], angles[2], rotation);
+  if (segment->rotate) multiply(rotation, (double (*)[3]) segment->rotation, rotation);
+
+  return SR_DAF_OK;
+}
+
+/* Rotation from J2000 to a resolved frame at et */
+static int chain_rotation(const sr_daf_index * index, const frame_chain * chain, double et, double rotation[3][3]) {
+  int status;
+
+  if (!chain->pck_class) {
+    memcpy(rotation, chain->outer, 9 * sizeof(double));
+    return SR_DAF_OK;
+  }
+
+  status = class_rotation(index, chain->pck_class, et, rotation);
+  if (status != SR_DAF_OK) return status;
+
+  multiply((double (*)[3]) chain->outer, rotation, rotation);
+
+  return SR_DAF_OK;
+}
+
+/* ---- Index callbacks, run with the GVL ---- */
+
+static bool describe_segment(sr_daf_segment * segment, const int * ints) {
+  segment->body = ints[0];
+  segment->frame = ints[1];
+  segment->type = ints[2];
+
+  return segment->type == 2 || segment->type == 3;
+}
+
+/* Base frames are inertial, their constant rotation from J2000 is read once from CSPICE */
+static void resolve_base(sr_daf_segment * segment) {
+  char name[SR_PCK_NAMELEN];
+
+  if (segment->frame == 1) return;
+
+  frmnam_c(segment->frame, SR_PCK_NAMELEN, name);
+  pxform_c("J2000", name, 0.5 * (segment->start + segment->end), segment->rotation);
+
+  if (failed_c() || !name[0]) {
+    reset_c();
+    segment->usable = false;
+    return;
+  }
+
+  segment->rotate = true;
+}
+
+static sr_daf_kind pck_kind = SR_DAF_KIND("PCK", 2, 5, SR_DAF_NO_CACHE, describe_segment, resolve_base);
+
+/* ---- Frame chains, resolved with the GVL and cached ---- */
+
+/* Code of the frame a TK frame is defined relative to, 0 if the kernel pool does not say */
+static int tk_relative(int frame, const char * name) {
+  char key[2 * SR_PCK_NAMELEN], relative[SR_PCK_NAMELEN];
+  SpiceInt count, code = 0;
+  SpiceBoolean found;
+
+  //The pool key may use the frame ID or its name
+  snprintf(key, sizeof(key), "TKFRAME_%d_RELATIVE", frame);
+  gcpool_c(key, 0, 1, SR_PCK_NAMELEN, &count, relative, &found);
+
+  if (!found) {
+    snprintf(key, sizeof(key), "TKFRAME_%s_RELATIVE", name);
+    gcpool_c(key, 0, 1, SR_PCK_NAMELEN, &count, relative, &found);
+  }
+
+  if (found) namfrm_c(relative, &code);
+
+  return code;
+}
+
+/*
+ The constant part of a chain is read from CSPICE at et for inertial frames and inside the highest priority
+ segment of the PCK class otherwise, never at an epoch the loaded kernels may not cover
+*/
+static const frame_chain * resolve_chain(VALUE frame, double et) {
+  SpiceInt code, center, frame_class, class_id, depth;
+  SpiceBoolean found;
+  char name[SR_PCK_NAMELEN], target[SR_PCK_NAMELEN];
+  const sr_daf_body * entry;
+  const sr_daf_segment * segment;
+  frame_chain * chain;
+  long cached;
+
+  namfrm_c(RB_SYM2STR(frame), &code);
+  spice_error(SPICE_ERROR_SHORT);
+  if (!code) rb_raise(rb_eArgError, "unknown frame %s", RB_SYM2STR(frame));
+
+  if (chains_for != sr_pool_generation()) {
+    chain_count = 0;
+    chains_for = sr_pool_generation();
+  }
+
+  for (cached = 0; cached < chain_count; cached++) {
+    if (chains[cached].frame != code) continue;
+
+    sr_cache_count(SR_CACHE_FRAME_CHAINS, true);
+    return &chains[cached];
+  }
+
+  sr_cache_count(SR_CACHE_FRAME_CHAINS, false);
+
+  //A full cache simply starts over, chains are cheap to resolve
+  if (chain_count == SR_PCK_CACHE) chain_count = 0;
+
+  chain = &chains[chain_count];
+  chain->frame = code;
+  frmnam_c(code, SR_PCK_NAMELEN, target);
+
+  for (depth = 0; depth < SR_PCK_MAX_CHAIN; depth++) {
+    frinfo_c(code, &center, &frame_class, &class_id, &found);
+    spice_error(SPICE_ERROR_SHORT);
+    if (!found) rb_raise(rb_eArgError, "no frame information for %s", RB_SYM2STR(frame));
+
+    frmnam_c(code, SR_PCK_NAMELEN, name);
+
+    if (frame_class == 1) {
+      chain->pck_class = 0;
+      pxform_c("J2000", target, et, chain->outer);
+      break;
+    }
+    else if (frame_class == 2) {
+      //Text PCK frames (IAU_*) are class 2 as well, but have no segments here
+      entry = sr_daf_index_body(pck_kind.current, class_id);
+      if (!entry) rb_raise(rb_eArgError, "no binary PCK data for %s", name);
+
+      segment = &pck_kind.current->segments[entry->first];
+      chain->pck_class = class_id;
+      pxform_c(name, target, 0.5 * (segment->start + segment->end), chain->outer);
+      break;
+    }
+    else if (frame_class == 4) {
+      code = tk_relative(code, name);
+      if (!code) rb_raise(rb_eArgError, "cannot find the frame %s is defined relative to", name);
+    }
+    else {
+      rb_raise(rb_eArgError, "%s is not built from inertial, binary PCK and TK frames", RB_SYM2STR(frame));
+    }
+  }
+
+  if (depth == SR_PCK_MAX_CHAIN) rb_raise(rb_eArgError, "frame chain of %s is too deep", RB_SYM2STR(frame));
+  spice_error(SPICE_ERROR_SHORT);
+
+  chain_count++;
+
+  return chain;
+}
+
+/* ---- Batches ---- */
+
+typedef struct {
+  const sr_daf_index * index;
+  frame_chain from, to;
+  int class_id, columns;
+  const double * epochs;
+  double * output;
+  volatile long failed_at;
+  volatile int status;
+} pck_batch;
+
+static void fail(pck_batch * batch, long epoch, int status) {
+  if (__sync_bool_compare_and_swap(&batch->failed_at, -1, epoch)) batch->status = status;
+}
+
+static void rotate_range(long begin, long end, void * data) {
+  pck_batch * batch = data;
+  double from[3][3], to[3][3];
+  double * out;
+  long epoch;
+  int status, row, column;
+
+  for (epoch = begin; epoch < end && batch->failed_at < 0; epoch++) {
+    status = chain_rotation(batch->index, &batch->from, batch->epochs[epoch], from);
+    if (status == SR_DAF_OK) status = chain_rotation(batch->index, &batch->to, batch->epochs[epoch], to);
+
+    if (status != SR_DAF_OK) {
+      fail(batch, epoch, status);
+      return;
+    }
+
+    //R(from -> to) = R(J2000 -> to) R(J2000 -> from)^T
+    out = batch->output + 9 * epoch;
+    for (row = 0; row < 3; row++)
+      for (column = 0; column < 3; column++)
+        out[3 * row + column] = to[row][0] * from[column][0] + to[row][1] * from[column][1] + to[row][2] * from[column][2];
+  }
+}
+
+static void angles_range(long begin, long end, void * data) {
+  pck_batch * batch = data;
+  const sr_daf_segment * segment;
+  double angles[6];
+  long epoch;
+  int status;
+
+  for (epoch = begin; epoch < end && batch->failed_at < 0; epoch++) {
+    segment = sr_daf_index_segment(batch->index, batch->class_id, batch->epochs[epoch]);
+    status = segment ? evaluate_angles(segment, batch->epochs[epoch], angles) : SR_DAF_NO_DATA;
+
+    if (status != SR_DAF_OK) {
+      fail(batch, epoch, status);
+      return;
+    }
+
+    memcpy(batch->output + batch->columns * epoch, angles, batch->columns * sizeof(double));
+  }
+}
+
+static void run(const char * function, pck_batch * batch, long count, int threads, sr_parallel_fn work) {
+  sr_daf_index_refresh(&pck_kind);
+  SR_NATIVE_ENTRY(function, 5, count);
+
+  batch->index = sr_daf_index_acquire(&pck_kind);
+
+  if (batch->index->incomplete) {
+    sr_daf_index_release(&pck_kind);
+    SR_NATIVE_EXIT(function, 1);
+    rb_raise(rb_spice_error, "some loaded binary PCK files are not in the native binary format, use the CSPICE based functions");
+  }
+
+  sr_parallel_run(count, threads, work, batch);
+  sr_daf_index_release(&pck_kind);
+
+  SR_NATIVE_EXIT(function, batch->failed_at >= 0);
+
+  if (batch->failed_at >= 0) {
+    rb_raise(rb_spice_error, "%s at ET %.6f",
+             batch->status == SR_DAF_NO_DATA ? "insufficient binary PCK data" : "unsupported binary PCK segment",
+             batch->epochs[batch->failed_at]);
+  }
+}
+
+/*
+ Rotation matrices from one frame to another at every epoch, evaluated natively on up to threads threads.
+ Each frame must be inertial, a binary PCK frame or a TK frame on top of those. Returns an N x 9 float64
+ NMatrix holding each 3x3 matrix row by row, written into out when given.
+*/
+VALUE sr_pxform_batch(VALUE self, VALUE from, VALUE to, VALUE ets, VALUE threads, VALUE out) {
+  pck_batch batch;
+  long count;
+  int thread_count = sr_parallel_threads(threads);
+  VALUE rb_epochs = sr_epochs_from(ets, &count);
+  VALUE rb_output = sr_dense_output(out, count, 9);
+
+  sr_daf_index_refresh(&pck_kind);
+
+  batch.epochs = sr_dense_elements(rb_epochs);
+  //Chains are copied, a later resolution may reuse their cache slot
+  batch.from = *resolve_chain(from, count ? batch.epochs[0] : 0.0);
+  batch.to = *resolve_chain(to, count ? batch.epochs[0] : 0.0);
+  batch.output = sr_dense_elements(rb_output);
+  batch.failed_at = -1;
+  batch.status = SR_DAF_OK;
+
+  run("pxform_batch", &batch, count, thread_count, rotate_range);
+
+  RB_GC_GUARD(rb_epochs);
+
+  return rb_output;
+}
+
+/*
+ Euler angles (phi, delta, w) of a binary PCK class relative to its base frame at every epoch, followed by
+ their rates when columns is 6. Returns an N x columns float64 NMatrix, written into out when given.
+*/
+VALUE sr_pck_angles(VALUE self, VALUE class_id, VALUE ets, VALUE columns, VALUE threads, VALUE out) {
+  pck_batch batch;
+  long count;
+  int thread_count = sr_parallel_threads(threads);
+  VALUE rb_epochs = sr_epochs_from(ets, &count);
+  VALUE rb_output;
+
+  batch.columns = NUM2INT(columns);
+  if (batch.columns != 3 && batch.columns != 6) rb_raise(rb_eArgError, "columns must be 3 or 6");
+
+  rb_output = sr_dense_output(out, count, batch.columns);
+  batch.class_id = NUM2INT(class_id);
+  batch.epochs = sr_dense_elements(rb_epochs);
+  batch.output = sr_dense_elements(rb_output);
+  batch.failed_at = -1;
+  batch.status = SR_DAF_OK;
+
+  run("pck_angles", &batch, count, thread_count, angles_range);
+
+  RB_GC_GUARD(rb_epochs);
+
+  return rb_output;
+}
+
+/* Code of the frame a TK frame is defined relative to, nil when the pool has no TKFRAME_<frame>_RELATIVE */
+VALUE sr_tkfrm(VALUE self, VALUE frame_code) {
+  char name[SR_PCK_NAMELEN];
+  int code;
+
+  SR_NATIVE_ENTRY("tkfrm", 1, 1);
+
+  frmnam_c(FIX2INT(frame_code), SR_PCK_NAMELEN, name);
+  code = tk_relative(FIX2INT(frame_code), name);
+
+  SR_NATIVE_EXIT("tkfrm", failed_c());
+  if (spice_error(SPICE_ERROR_SHORT)) return Qnil;
+
+  if (code) return INT2FIX(code);
+  else return Qnil;
+}
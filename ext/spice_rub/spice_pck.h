@@ -0,0 +1,7 @@
+#include "ruby.h"
+#include "SpiceUsr.h"
+#include <stdbool.h>
+#include <pthread.h>
+#include "spice_rub_utils.h"
+#include "nmatrix.h"
+#include "spice_spk.h"
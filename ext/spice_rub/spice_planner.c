@@ -0,0 +1,108 @@
+#include "spice_planner.h"
+
+/* Batch query planner.
+
+ Requests joined from other tables come with targets, observers and epochs in no useful order. CSPICE
+ keeps a small buffer of recently used segments per body, so jumping between bodies and far apart epochs
+ evicts and searches segments over and over. The planner sorts the requests by
+
+   (target, observer, kernel serving the target, epoch)
+
+ using the coverage index for the serving kernel, evaluates them in that order and scatters every result
+ back to the row it was asked for. Planning costs one sort, O(n log n) comparisons on plain integers and
+ doubles, which is small next to a segment search.
+*/
+
+typedef struct {
+  SpiceInt target, observer;
+  long source, row;
+  double et;
+} planned_request;
+
+static int compare_requests(const void * a, const void * b) {
+  const planned_request * left = a, * right = b;
+
+  if (left->target != right->target) return left->target < right->target ? -1 : 1;
+  if (left->observer != right->observer) return left->observer < right->observer ? -1 : 1;
+  if (left->source != right->source) return left->source < right->source ? -1 : 1;
+  if (left->et != right->et) return left->et < right->et ? -1 : 1;
+
+  return left->row < right->row ? -1 : (left->row > right->row);
+}
+
+/* Body code for a request row, bodies is either one body for every row (already in code) or an Array */
+static SpiceInt row_body(VALUE bodies, long row, SpiceInt code) {
+  return RB_TYPE_P(bodies, T_ARRAY) ? sr_body_code(RARRAY_AREF(bodies, row)) : code;
+}
+
+static SpiceInt shared_body(VALUE bodies, long count) {
+  if (!RB_TYPE_P(bodies, T_ARRAY)) return sr_body_code(bodies);
+
+  if (RARRAY_LEN(bodies) != count) rb_raise(rb_eArgError, "expected %ld bodies, got %ld", count, RARRAY_LEN(bodies));
+
+  return 0;
+}
+
+/*
+ Evaluates one state (columns 6) or position (columns 3) per request row: targets[i] relative to
+ observers[i] at ets[i], where targets and observers may also be a single body for every row. With plan
+ the rows are evaluated in segment locality order, otherwise in input order. Returns
+ [N x columns NMatrix, N x 1 light times], results in input order either way.
+*/
+VALUE sr_spk_requests(VALUE self, VALUE targets, VALUE observers, VALUE ets, VALUE ref, VALUE abcorr, VALUE columns, VALUE plan, VALUE out) {
+  long count, row;
+  int width = NUM2INT(columns);
+  VALUE rb_epochs = sr_epochs_from(ets, &count), rb_output, rb_light_times, buffer;
+  double * epochs = sr_dense_elements(rb_epochs), * output, * light_times, state[6];
+  const char * frame = RB_SYM2STR(ref), * correction = RB_SYM2STR(abcorr);
+  planned_request * requests;
+  SpiceInt target, observer;
+
+  if (width != 3 && width != 6) rb_raise(rb_eArgError, "columns must be 3 or 6");
+
+  rb_output = sr_dense_output(out, count, width);
+  rb_light_times = sr_dense_alloc(count, 1);
+  output = sr_dense_elements(rb_output);
+  light_times = sr_dense_elements(rb_light_times);
+
+  target = shared_body(targets, count);
+  observer = shared_body(observers, count);
+  requests = ALLOCV_N(planned_request, buffer, count);
+
+  for (row = 0; row < count; row++) {
+    requests[row].target = row_body(targets, row, target);
+    requests[row].observer = row_body(observers, row, observer);
+    requests[row].et = epochs[row];
+    requests[row].row = row;
+    requests[row].source = RTEST(plan) ? sr_coverage_source(SR_COVERAGE_SPK, requests[row].target, epochs[row]) : -1;
+  }
+
+  if (RTEST(plan)) qsort(requests, count, sizeof(planned_request), compare_requests);
+
+  SR_PROBE4(spk__batch, "spk_requests", RB_TYPE_P(targets, T_ARRAY) ? -1 : target,
+            RB_TYPE_P(observers, T_ARRAY) ? -1 : observer, count);
+  SR_NATIVE_ENTRY("spk_requests", 8, count);
+
+  for (row = 0; row < count; row++) {
+    const planned_request * request = &requests[row];
+
+    if (width == 6) {
+      spkez_c(request->target, request->et, frame, correction, request->observer, state, light_times + request->row);
+    }
+    else {
+      spkezp_c(request->target, request->et, frame, correction, request->observer, state, light_times + request->row);
+    }
+    if (failed_c()) break;
+
+    memcpy(output + width * request->row, state, width * sizeof(double));
+  }
+
+  SR_NATIVE_EXIT("spk_requests", failed_c());
+  ALLOCV_END(buffer);
+
+  if(spice_error(SPICE_ERROR_SHORT)) return Qnil;
+
+  RB_GC_GUARD(rb_epochs);
+
+  return rb_ary_new3(2, rb_output, rb_light_times);
+}
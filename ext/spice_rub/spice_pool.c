@@ -0,0 +1,256 @@
+#include "spice_pool.h"
+#include <errno.h>
+
+/* Kernel pool snapshots.
+
+ sr_pool_dump walks every variable in the kernel pool (gnpool_c) and writes its values to a compact binary
+ file. sr_pool_restore puts them back with pdpool_c/pcpool_c, which skips parsing the text kernels the
+ variables originally came from. Every snapshot carries a caller supplied key (the checksums of the source
+ kernels) and is only restored when the key matches.
+
+ Layout, native byte order :
+
+   "SRPOOL01" | key length (u32) | key | variable count (u32)
+   per variable : name length (u32) | name | type ('N' or 'C') | value count (u32) | values
+
+ Numeric values are stored as doubles, character values as a length (u32) followed by the bytes.
+*/
+
+#define SR_POOL_MAGIC "SRPOOL01"
+#define SR_POOL_MAGIC_LENGTH 8
+#define SR_POOL_NAMELEN 33
+#define SR_POOL_VALUELEN 81
+#define SR_POOL_BATCH 256
+
+static void write_u32(FILE * file, uint32_t value) {
+  fwrite(&value, sizeof(uint32_t), 1, file);
+}
+
+static void write_bytes(FILE * file, const char * bytes, uint32_t length) {
+  write_u32(file, length);
+  fwrite(bytes, 1, length, file);
+}
+
+static bool dump_variable(FILE * file, const char * name) {
+  SpiceBoolean found;
+  SpiceInt count, fetched;
+  SpiceChar type;
+  long index;
+
+  dtpool_c(name, &found, &count, &type);
+  if (failed_c() || !found) return false;
+
+  write_bytes(file, name, strlen(name));
+  fputc(type, file);
+  write_u32(file, count);
+
+  if (type == 'N') {
+    double * values = ALLOC_N(double, count);
+
+    gdpool_c(name, 0, count, &fetched, values, &found);
+    fwrite(values, sizeof(double), count, file);
+
+    xfree(values);
+  }
+  else {
+    char (* values)[SR_POOL_VALUELEN] = (char (*)[SR_POOL_VALUELEN]) ALLOC_N(char, count * SR_POOL_VALUELEN);
+
+    gcpool_c(name, 0, count, SR_POOL_VALUELEN, &fetched, values, &found);
+    for (index = 0; index < count; index++) write_bytes(file, values[index], strlen(values[index]));
+
+    xfree(values);
+  }
+
+  return !failed_c();
+}
+
+/*
+ Writes every kernel pool variable to path, returns the number of variables written. The snapshot is written
+ to path.tmp first and renamed into place once complete, a failed write removes it and raises.
+*/
+VALUE sr_pool_dump(VALUE self, VALUE path, VALUE key) {
+  char names[SR_POOL_BATCH][SR_POOL_NAMELEN];
+  SpiceInt start = 0, count, index;
+  SpiceBoolean found = SPICETRUE;
+  uint32_t written = 0;
+  long count_offset;
+  bool incomplete;
+  int error;
+  VALUE temporary = rb_str_plus(path, rb_str_new2(".tmp"));
+  FILE * file = fopen(StringValueCStr(temporary), "wb");
+
+  SR_NATIVE_ENTRY("pool_dump", 2, 1);
+
+  if (!file) rb_sys_fail(StringValueCStr(temporary));
+
+  fwrite(SR_POOL_MAGIC, 1, SR_POOL_MAGIC_LENGTH, file);
+  write_bytes(file, RSTRING_PTR(key), RSTRING_LEN(key));
+
+  //The variable count is patched in once the pool has been walked
+  count_offset = ftell(file);
+  write_u32(file, 0);
+
+  sigset_t old_mask = block_signals();
+
+  while (found) {
+    gnpool_c("*", start, SR_POOL_BATCH, SR_POOL_NAMELEN, &count, names, &found);
+    if (failed_c() || !found) break;
+
+    for (index = 0; index < count; index++) {
+      if (dump_variable(file, names[index])) written++;
+    }
+
+    start += count;
+    if (count < SR_POOL_BATCH) break;
+  }
+
+  restore_signals(old_mask);
+
+  fseek(file, count_offset, SEEK_SET);
+  write_u32(file, written);
+
+  //Write errors stick to the stream, a truncated snapshot must not replace the previous one
+  incomplete = ferror(file) != 0;
+  if (fclose(file)) incomplete = true;
+
+  if (incomplete || failed_c()) {
+    error = errno;
+    remove(StringValueCStr(temporary));
+    errno = error;
+  }
+
+  SR_NATIVE_EXIT("pool_dump", failed_c() || incomplete);
+  if (spice_error(SPICE_ERROR_SHORT)) return Qnil;
+  if (incomplete) rb_sys_fail(StringValueCStr(temporary));
+
+  //Readers never see a half written snapshot
+  if (rename(StringValueCStr(temporary), StringValueCStr(path))) rb_sys_fail(StringValueCStr(path));
+
+  return UINT2NUM(written);
+}
+
+typedef struct {
+  char * cursor;
+  char * end;
+} pool_reader;
+
+static bool read_u32(pool_reader * reader, uint32_t * value) {
+  if (reader->end - reader->cursor < (long) sizeof(uint32_t)) return false;
+
+  memcpy(value, reader->cursor, sizeof(uint32_t));
+  reader->cursor += sizeof(uint32_t);
+
+  return true;
+}
+
+static char * read_bytes(pool_reader * reader, uint32_t length) {
+  char * bytes = reader->cursor;
+
+  if (reader->end - reader->cursor < (long) length) return NULL;
+
+  reader->cursor += length;
+
+  return bytes;
+}
+
+static bool restore_variable(pool_reader * reader) {
+  char name[SR_POOL_NAMELEN];
+  uint32_t length, count, index;
+  char * bytes;
+  char type;
+
+  if (!read_u32(reader, &length) || length >= SR_POOL_NAMELEN || !(bytes = read_bytes(reader, length))) return false;
+  memcpy(name, bytes, length);
+  name[length] = '\0';
+
+  if (!(bytes = read_bytes(reader, 1))) return false;
+  type = *bytes;
+
+  if (!read_u32(reader, &count)) return false;
+
+  if (type == 'N') {
+    double * values;
+
+    if (!(bytes = read_bytes(reader, count * sizeof(double)))) return false;
+
+    //The mapped buffer is not guaranteed to be aligned for doubles
+    values = ALLOC_N(double, count ? count : 1);
+    memcpy(values, bytes, count * sizeof(double));
+    pdpool_c(name, count, values);
+    xfree(values);
+  }
+  else {
+    char * values = ALLOC_N(char, (count ? count : 1) * SR_POOL_VALUELEN);
+
+    memset(values, 0, (count ? count : 1) * SR_POOL_VALUELEN);
+
+    for (index = 0; index < count; index++) {
+      if (!read_u32(reader, &length) || length >= SR_POOL_VALUELEN || !(bytes = read_bytes(reader, length))) {
+        xfree(values);
+        return false;
+      }
+      memcpy(values + index * SR_POOL_VALUELEN, bytes, length);
+    }
+
+    pcpool_c(name, count, SR_POOL_VALUELEN, values);
+    xfree(values);
+  }
+
+  return !failed_c();
+}
+
+/*
+ Restores a snapshot written by sr_pool_dump. Returns the number of variables restored,
+ or false if the file is missing, malformed or was written for a different key.
+*/
+VALUE sr_pool_restore(VALUE self, VALUE path, VALUE key) {
+  FILE * file = fopen(StringValueCStr(path), "rb");
+  pool_reader reader;
+  uint32_t length, count, index;
+  char * buffer, * stored_key;
+  long size;
+  bool valid;
+
+  SR_NATIVE_ENTRY("pool_restore", 2, 1);
+
+  if (!file) {
+    SR_NATIVE_EXIT("pool_restore", 0);
+    return Qfalse;
+  }
+
+  fseek(file, 0, SEEK_END);
+  size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+
+  buffer = ALLOC_N(char, size ? size : 1);
+  valid = fread(buffer, 1, size, file) == (size_t) size;
+  fclose(file);
+
+  reader.cursor = buffer;
+  reader.end = buffer + size;
+
+  valid = valid && size >= SR_POOL_MAGIC_LENGTH && !memcmp(read_bytes(&reader, SR_POOL_MAGIC_LENGTH), SR_POOL_MAGIC, SR_POOL_MAGIC_LENGTH);
+  valid = valid && read_u32(&reader, &length) && (stored_key = read_bytes(&reader, length));
+  valid = valid && length == RSTRING_LEN(key) && !memcmp(stored_key, RSTRING_PTR(key), length);
+  valid = valid && read_u32(&reader, &count);
+
+  if (!valid) {
+    xfree(buffer);
+    SR_NATIVE_EXIT("pool_restore", 0);
+    return Qfalse;
+  }
+
+  sigset_t old_mask = block_signals();
+
+  for (index = 0; index < count && valid; index++) valid = restore_variable(&reader);
+
+  restore_signals(old_mask);
+  xfree(buffer);
+
+  SR_NATIVE_EXIT("pool_restore", failed_c());
+  if (spice_error(SPICE_ERROR_SHORT)) return Qnil;
+
+  sr_pool_changed(SR_POOL_RESTORE, NULL);
+
+  return valid ? UINT2NUM(count) : Qfalse;
+}
@@ -0,0 +1,8 @@
+#include "ruby.h"
+#include "SpiceUsr.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdint.h>
+#include "spice_rub_utils.h"
+#include "spice_probes.h"
+#include "spice_generation.h"
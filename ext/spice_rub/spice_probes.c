@@ -0,0 +1,19 @@
+#include "spice_probes.h"
+
+/* Semaphores of the USDT probes declared in spice_probes.h. Tracers increment them when they attach to a
+ probe, they live in the .probes section where sys/sdt.h expects them. */
+
+#ifdef SR_USDT
+
+#define SR_PROBE_DEFINE(name) unsigned short SR_PROBE_SEMAPHORE(name) __attribute__((section(".probes"))) = 0
+
+SR_PROBE_DEFINE(native__entry);
+SR_PROBE_DEFINE(native__exit);
+SR_PROBE_DEFINE(spk__batch);
+SR_PROBE_DEFINE(gf__search__start);
+SR_PROBE_DEFINE(gf__search__end);
+SR_PROBE_DEFINE(kernel__load__start);
+SR_PROBE_DEFINE(kernel__load__done);
+SR_PROBE_DEFINE(kernel__unload);
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef SPICE_PROBES_H
+#define SPICE_PROBES_H
+
+/* USDT probes, compiled in by extconf.rb --enable-usdt and reduced to nothing otherwise.
+
+ Probes of the spice_rub provider:
+   native__entry(function, argc, batch)     a SpiceRub::Native call, batch is the number of epochs or points
+                                            of a batched call and 1 otherwise
+   native__exit(function, failed)           once the call is done with CSPICE, failed is 1 when it is about
+                                            to raise
+   spk__batch(function, target, observer, count)
+                                            NAIF codes of a batched SPK query, -1 when a batch mixes bodies
+   gf__search__start(function, target, observer, start, end)
+                                            target and observer names as given, the instrument for
+                                            gfrfov and the front body for gfoclt
+   gf__search__end(function, intervals)     intervals is -1 when the search failed
+   kernel__load__start(path)
+   kernel__load__done(path, loaded)
+   kernel__unload(path)
+
+ Every probe has a semaphore, so argument preparation guarded by SR_PROBE_ENABLED only runs while a
+ tracer (perf, bpftrace, systemtap) is attached.
+*/
+
+#ifdef SR_USDT
+
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+
+#define SR_PROBE_SEMAPHORE(name) spice_rub_##name##_semaphore
+#define SR_PROBE_ENABLED(name) __builtin_expect(SR_PROBE_SEMAPHORE(name) != 0, 0)
+
+#define SR_PROBE1(name, a) STAP_PROBE1(spice_rub, name, a)
+#define SR_PROBE2(name, a, b) STAP_PROBE2(spice_rub, name, a, b)
+#define SR_PROBE3(name, a, b, c) STAP_PROBE3(spice_rub, name, a, b, c)
+#define SR_PROBE4(name, a, b, c, d) STAP_PROBE4(spice_rub, name, a, b, c, d)
+#define SR_PROBE5(name, a, b, c, d, e) STAP_PROBE5(spice_rub, name, a, b, c, d, e)
+
+#define SR_NATIVE_ENTRY(function, argc, batch) \
+  do { if (SR_PROBE_ENABLED(native__entry)) SR_PROBE3(native__entry, function, argc, batch); } while (0)
+#define SR_NATIVE_EXIT(function, failed) \
+  do { if (SR_PROBE_ENABLED(native__exit)) SR_PROBE2(native__exit, function, failed); } while (0)
+
+extern unsigned short SR_PROBE_SEMAPHORE(native__entry);
+extern unsigned short SR_PROBE_SEMAPHORE(native__exit);
+extern unsigned short SR_PROBE_SEMAPHORE(spk__batch);
+extern unsigned short SR_PROBE_SEMAPHORE(gf__search__start);
+extern unsigned short SR_PROBE_SEMAPHORE(gf__search__end);
+extern unsigned short SR_PROBE_SEMAPHORE(kernel__load__start);
+extern unsigned short SR_PROBE_SEMAPHORE(kernel__load__done);
+extern unsigned short SR_PROBE_SEMAPHORE(kernel__unload);
+
+#else
+
+#define SR_PROBE_ENABLED(name) 0
+
+#define SR_PROBE1(name, a) do {} while (0)
+#define SR_PROBE2(name, a, b) do {} while (0)
+#define SR_PROBE3(name, a, b, c) do {} while (0)
+#define SR_PROBE4(name, a, b, c, d) do {} while (0)
+#define SR_PROBE5(name, a, b, c, d, e) do {} while (0)
+
+#define SR_NATIVE_ENTRY(function, argc, batch) do {} while (0)
+#define SR_NATIVE_EXIT(function, failed) do {} while (0)
+
+#endif
+
+#endif
@@ -0,0 +1,362 @@
+#include "spice_quantity.h"
+#include <math.h>
+#include <stdint.h>
+
+/* Compiled quantities for user defined GF searches.
+
+ gfuds_c and gfudb_c call the quantity at every step of the search, calling back into Ruby there would
+ cost far more than the geometry itself. A quantity is instead described by a Ruby expression, nested
+ Arrays of an operation and its arguments:
+
+   [:position, target, observer, frame = :J2000, abcorr = :NONE]   vector
+   [:velocity, target, observer, frame = :J2000, abcorr = :NONE]   vector
+   [:vector, x, y, z]                                              constant vector, numbers are scalars
+   [:rotate, vector, from, to]                                     vector rotated between frames at the epoch
+   [:add | :sub, a, b]  [:neg, a]                                  scalars or vectors
+   [:mul, a, b]  [:div, a, scalar]                                 at most one vector
+   [:dot | :angle, a, b]  [:norm, a]  [:component, a, index]       vectors to scalars
+   [:cross, a, b]  [:unit, a]                                      vectors to vectors
+   [:abs | :sqrt | :not, a]  [:lt | :gt | :and | :or, a, b]        scalars, conditions are 1 or 0
+
+ which is compiled into a flat list of nodes, every node after its arguments, so an evaluation is one
+ pass over the list without any Ruby call. Positions and velocities of the same bodies, frame and
+ correction share a single spkez_c call per epoch.
+*/
+
+//Step of the numerical derivative gfuds_c uses to tell whether the quantity is decreasing, in seconds
+#define SR_QUANTITY_DT 1.0
+
+#define SR_Q_CONSTANT 0
+#define SR_Q_STATE 1
+#define SR_Q_POSITION 2
+#define SR_Q_VELOCITY 3
+#define SR_Q_ROTATE 4
+#define SR_Q_COMPONENT 5
+#define SR_Q_ADD 6
+#define SR_Q_SUB 7
+#define SR_Q_MUL 8
+#define SR_Q_DIV 9
+#define SR_Q_NEG 10
+#define SR_Q_DOT 11
+#define SR_Q_ANGLE 12
+#define SR_Q_NORM 13
+#define SR_Q_CROSS 14
+#define SR_Q_UNIT 15
+#define SR_Q_ABS 16
+#define SR_Q_SQRT 17
+#define SR_Q_NOT 18
+#define SR_Q_LT 19
+#define SR_Q_GT 20
+#define SR_Q_AND 21
+#define SR_Q_OR 22
+
+//Operations taking only quantity arguments, with their argument count
+static const struct {
+  const char * name;
+  int op, arguments;
+} OPERATIONS[] = {
+  {"add", SR_Q_ADD, 2}, {"sub", SR_Q_SUB, 2}, {"mul", SR_Q_MUL, 2}, {"div", SR_Q_DIV, 2}, {"neg", SR_Q_NEG, 1},
+  {"dot", SR_Q_DOT, 2}, {"angle", SR_Q_ANGLE, 2}, {"norm", SR_Q_NORM, 1}, {"cross", SR_Q_CROSS, 2},
+  {"unit", SR_Q_UNIT, 1}, {"abs", SR_Q_ABS, 1}, {"sqrt", SR_Q_SQRT, 1}, {"not", SR_Q_NOT, 1},
+  {"lt", SR_Q_LT, 2}, {"gt", SR_Q_GT, 2}, {"and", SR_Q_AND, 2}, {"or", SR_Q_OR, 2}
+};
+
+static sr_quantity * active = NULL;
+
+/* ---- Compilation ---- */
+
+static int add_node(sr_quantity * quantity, const sr_quantity_node * node) {
+  if (quantity->count == SR_QUANTITY_MAX_NODES) rb_raise(rb_eArgError, "quantity has more than %d operations", SR_QUANTITY_MAX_NODES);
+
+  quantity->nodes[quantity->count] = *node;
+
+  return quantity->count++;
+}
+
+static void copy_name(char * name, VALUE value, const char * what) {
+  const char * text;
+
+  if (!RB_TYPE_P(value, T_SYMBOL) && !RB_TYPE_P(value, T_STRING)) rb_raise(rb_eArgError, "%s must be a Symbol or String", what);
+
+  text = RB_TYPE_P(value, T_SYMBOL) ? RB_SYM2STR(value) : StringValueCStr(value);
+  if (strlen(text) >= SR_QUANTITY_NAMELEN) rb_raise(rb_eArgError, "%s %s is too long", what, text);
+
+  strcpy(name, text);
+}
+
+/* State of target relative to observer, shared with every earlier leaf of the same bodies, frame and correction */
+static int state_node(sr_quantity * quantity, VALUE expression) {
+  sr_quantity_node node;
+  long length = RARRAY_LEN(expression);
+  int index;
+
+  if (length < 3 || length > 5) rb_raise(rb_eArgError, "%s takes a target, an observer, a frame and a correction", RB_SYM2STR(RARRAY_AREF(expression, 0)));
+
+  memset(&node, 0, sizeof(node));
+  node.op = SR_Q_STATE;
+  node.width = 6;
+  node.target = sr_body_code(RARRAY_AREF(expression, 1));
+  node.observer = sr_body_code(RARRAY_AREF(expression, 2));
+  strcpy(node.frame, "J2000");
+  strcpy(node.correction, "NONE");
+  if (length > 3) copy_name(node.frame, RARRAY_AREF(expression, 3), "frame");
+  if (length > 4) copy_name(node.correction, RARRAY_AREF(expression, 4), "aberration correction");
+
+  for (index = 0; index < quantity->count; index++) {
+    const sr_quantity_node * other = quantity->nodes + index;
+
+    if (other->op == SR_Q_STATE && other->target == node.target && other->observer == node.observer &&
+        eqstr_c(other->frame, node.frame) && eqstr_c(other->correction, node.correction)) return index;
+  }
+
+  return add_node(quantity, &node);
+}
+
+/* Width of an operation's result for arguments of widths first and second, 0 when they do not fit */
+static int result_width(int op, int first, int second) {
+  switch (op) {
+    case SR_Q_ADD: case SR_Q_SUB: return first == second && first != 6 ? first : 0;
+    case SR_Q_MUL: return first == 1 && second != 6 ? second : (second == 1 && first == 3 ? first : 0);
+    case SR_Q_DIV: return second == 1 && first != 6 ? first : 0;
+    case SR_Q_NEG: return first != 6 ? first : 0;
+    case SR_Q_DOT: case SR_Q_ANGLE: return first == 3 && second == 3 ? 1 : 0;
+    case SR_Q_CROSS: return first == 3 && second == 3 ? 3 : 0;
+    case SR_Q_NORM: return first == 3 ? 1 : 0;
+    case SR_Q_UNIT: return first == 3 ? 3 : 0;
+    default: return first == 1 && (second == 1 || second == 0) ? 1 : 0;
+  }
+}
+
+/* depth counts the enclosing operations, a quantity never nests deeper than it has nodes */
+static int compile(sr_quantity * quantity, VALUE expression, int depth) {
+  sr_quantity_node node;
+  const char * name;
+  long length, operation;
+  int argument;
+
+  memset(&node, 0, sizeof(node));
+  node.arguments[0] = node.arguments[1] = -1;
+
+  if (depth >= SR_QUANTITY_MAX_NODES) rb_raise(rb_eArgError, "quantity is nested more than %d operations deep", SR_QUANTITY_MAX_NODES);
+
+  if (RB_FLOAT_TYPE_P(expression) || RB_INTEGER_TYPE_P(expression)) {
+    node.op = SR_Q_CONSTANT;
+    node.width = 1;
+    node.value[0] = NUM2DBL(expression);
+    return add_node(quantity, &node);
+  }
+
+  if (!RB_TYPE_P(expression, T_ARRAY) || !RARRAY_LEN(expression) || !RB_TYPE_P(RARRAY_AREF(expression, 0), T_SYMBOL)) {
+    rb_raise(rb_eArgError, "quantity expressions are numbers or [:operation, arguments...], got %"PRIsVALUE, rb_inspect(expression));
+  }
+
+  name = RB_SYM2STR(RARRAY_AREF(expression, 0));
+  length = RARRAY_LEN(expression);
+
+  if (!strcmp(name, "position") || !strcmp(name, "velocity")) {
+    node.op = name[0] == 'p' ? SR_Q_POSITION : SR_Q_VELOCITY;
+    node.width = 3;
+    node.arguments[0] = state_node(quantity, expression);
+    return add_node(quantity, &node);
+  }
+
+  if (!strcmp(name, "vector")) {
+    if (length != 4) rb_raise(rb_eArgError, "vector takes 3 components");
+    node.op = SR_Q_CONSTANT;
+    node.width = 3;
+    for (argument = 0; argument < 3; argument++) node.value[argument] = NUM2DBL(RARRAY_AREF(expression, argument + 1));
+    return add_node(quantity, &node);
+  }
+
+  if (!strcmp(name, "rotate")) {
+    if (length != 4) rb_raise(rb_eArgError, "rotate takes a vector, a frame to rotate from and one to rotate to");
+    node.op = SR_Q_ROTATE;
+    node.width = 3;
+    node.arguments[0] = compile(quantity, RARRAY_AREF(expression, 1), depth + 1);
+    if (quantity->nodes[node.arguments[0]].width != 3) rb_raise(rb_eArgError, "rotate needs a vector");
+    copy_name(node.frame, RARRAY_AREF(expression, 2), "frame");
+    copy_name(node.to, RARRAY_AREF(expression, 3), "frame");
+    return add_node(quantity, &node);
+  }
+
+  if (!strcmp(name, "component")) {
+    if (length != 3) rb_raise(rb_eArgError, "component takes a vector and an index");
+    node.op = SR_Q_COMPONENT;
+    node.width = 1;
+    node.arguments[0] = compile(quantity, RARRAY_AREF(expression, 1), depth + 1);
+    node.index = NUM2INT(RARRAY_AREF(expression, 2));
+    if (quantity->nodes[node.arguments[0]].width != 3) rb_raise(rb_eArgError, "component needs a vector");
+    if (node.index < 0 || node.index > 2) rb_raise(rb_eArgError, "component index must be 0, 1 or 2");
+    return add_node(quantity, &node);
+  }
+
+  for (operation = 0; operation < (long) (sizeof(OPERATIONS) / sizeof(OPERATIONS[0])); operation++) {
+    if (strcmp(name, OPERATIONS[operation].name)) continue;
+
+    if (length != OPERATIONS[operation].arguments + 1) rb_raise(rb_eArgError, "%s takes %d arguments", name, OPERATIONS[operation].arguments);
+
+    node.op = OPERATIONS[operation].op;
+    for (argument = 0; argument < OPERATIONS[operation].arguments; argument++) {
+      node.arguments[argument] = compile(quantity, RARRAY_AREF(expression, argument + 1), depth + 1);
+    }
+
+    node.width = result_width(node.op, quantity->nodes[node.arguments[0]].width,
+                              node.arguments[1] < 0 ? 0 : quantity->nodes[node.arguments[1]].width);
+    if (!node.width) rb_raise(rb_eArgError, "%s cannot take these arguments, got %"PRIsVALUE, name, rb_inspect(expression));
+
+    return add_node(quantity, &node);
+  }
+
+  rb_raise(rb_eArgError, "unknown quantity operation %s", name);
+}
+
+void sr_quantity_compile(sr_quantity * quantity, VALUE expression) {
+  quantity->count = 0;
+  quantity->memo = NULL;
+
+  compile(quantity, expression, 0);
+
+  if (quantity->nodes[quantity->count - 1].width != 1) rb_raise(rb_eArgError, "a GF quantity must be a scalar");
+}
+
+/* ---- Evaluation ---- */
+
+static void evaluate(sr_quantity * quantity, double et) {
+  double rotation[3][3], light_time;
+  const double * first, * second;
+  sr_quantity_node * node;
+  int index, component;
+
+  for (index = 0; index < quantity->count && !failed_c(); index++) {
+    node = quantity->nodes + index;
+    first = node->arguments[0] < 0 ? NULL : quantity->nodes[node->arguments[0]].value;
+    second = node->arguments[1] < 0 ? NULL : quantity->nodes[node->arguments[1]].value;
+
+    switch (node->op) {
+      case SR_Q_CONSTANT: break;
+      case SR_Q_STATE: spkez_c(node->target, et, node->frame, node->correction, node->observer, node->value, &light_time); break;
+      case SR_Q_POSITION: vequ_c(first, node->value); break;
+      case SR_Q_VELOCITY: vequ_c(first + 3, node->value); break;
+      case SR_Q_ROTATE:
+        pxform_c(node->frame, node->to, et, rotation);
+        mxv_c(rotation, first, node->value);
+        break;
+      case SR_Q_COMPONENT: node->value[0] = first[node->index]; break;
+      case SR_Q_ADD: for (component = 0; component < node->width; component++) node->value[component] = first[component] + second[component]; break;
+      case SR_Q_SUB: for (component = 0; component < node->width; component++) node->value[component] = first[component] - second[component]; break;
+      case SR_Q_MUL:
+        //The scalar is the first argument unless the vector is
+        if (quantity->nodes[node->arguments[0]].width == 1) for (component = 0; component < node->width; component++) node->value[component] = first[0] * second[component];
+        else for (component = 0; component < node->width; component++) node->value[component] = first[component] * second[0];
+        break;
+      case SR_Q_DIV: for (component = 0; component < node->width; component++) node->value[component] = first[component] / second[0]; break;
+      case SR_Q_NEG: for (component = 0; component < node->width; component++) node->value[component] = -first[component]; break;
+      case SR_Q_DOT: node->value[0] = vdot_c(first, second); break;
+      case SR_Q_ANGLE: node->value[0] = vsep_c(first, second); break;
+      case SR_Q_NORM: node->value[0] = vnorm_c(first); break;
+      case SR_Q_CROSS: vcrss_c(first, second, node->value); break;
+      case SR_Q_UNIT: vhat_c(first, node->value); break;
+      case SR_Q_ABS: node->value[0] = fabs(first[0]); break;
+      case SR_Q_SQRT: node->value[0] = sqrt(first[0]); break;
+      case SR_Q_NOT: node->value[0] = first[0] == 0.0; break;
+      case SR_Q_LT: node->value[0] = first[0] < second[0]; break;
+      case SR_Q_GT: node->value[0] = first[0] > second[0]; break;
+      case SR_Q_AND: node->value[0] = first[0] != 0.0 && second[0] != 0.0; break;
+      case SR_Q_OR: node->value[0] = first[0] != 0.0 || second[0] != 0.0; break;
+    }
+  }
+}
+
+/* ---- Memo ---- */
+
+/*
+ Open addressing table of epoch and value pairs, empty slots hold a NaN epoch. It stops taking new epochs
+ once half full so probes stay short, later epochs are simply evaluated.
+*/
+void sr_quantity_memoize(sr_quantity * quantity, double * memo, long capacity) {
+  long slot;
+
+  for (slot = 0; slot < capacity; slot++) memo[2 * slot] = NAN;
+
+  quantity->memo = memo;
+  quantity->memo_capacity = capacity;
+  quantity->memo_size = 0;
+}
+
+static long memo_slot(const sr_quantity * quantity, double et) {
+  uint64_t bits;
+  long slot;
+
+  memcpy(&bits, &et, sizeof(bits));
+  bits ^= bits >> 33;
+  bits *= 0xff51afd7ed558ccdULL;
+  bits ^= bits >> 33;
+
+  for (slot = (long) (bits & (quantity->memo_capacity - 1));
+       !isnan(quantity->memo[2 * slot]) && quantity->memo[2 * slot] != et;
+       slot = (slot + 1) & (quantity->memo_capacity - 1));
+
+  return slot;
+}
+
+/* ---- Use ---- */
+
+void sr_quantity_use(sr_quantity * quantity) {
+  active = quantity;
+}
+
+void sr_quantity_value(SpiceDouble et, SpiceDouble * value) {
+  long slot = active->memo ? memo_slot(active, et) : 0;
+
+  if (active->memo && active->memo[2 * slot] == et) {
+    *value = active->memo[2 * slot + 1];
+    return;
+  }
+
+  evaluate(active, et);
+
+  *value = failed_c() ? 0.0 : active->nodes[active->count - 1].value[0];
+
+  if (active->memo && !failed_c() && 2 * active->memo_size < active->memo_capacity) {
+    active->memo[2 * slot] = et;
+    active->memo[2 * slot + 1] = *value;
+    active->memo_size++;
+  }
+}
+
+void sr_quantity_decreasing(void (* udfuns)(SpiceDouble et, SpiceDouble * value), SpiceDouble et, SpiceBoolean * decreasing) {
+  uddc_c(udfuns, et, SR_QUANTITY_DT, decreasing);
+}
+
+void sr_quantity_condition(void (* udfuns)(SpiceDouble et, SpiceDouble * value), SpiceDouble et, SpiceBoolean * holds) {
+  SpiceDouble value;
+
+  udfuns(et, &value);
+
+  *holds = value != 0.0;
+}
+
+/*
+ Values of a quantity expression at every epoch of ets, as an N x 1 float64 NMatrix. Evaluates exactly what
+ gfuds and gfudb search on.
+*/
+VALUE sr_quantity_values(VALUE self, VALUE expression, VALUE ets) {
+  sr_quantity quantity;
+  long count, index;
+  VALUE rb_epochs = sr_epochs_from(ets, &count);
+  VALUE rb_values = sr_dense_alloc(count, 1);
+  double * epochs = sr_dense_elements(rb_epochs), * values = sr_dense_elements(rb_values);
+
+  sr_quantity_compile(&quantity, expression);
+  sr_quantity_use(&quantity);
+  SR_NATIVE_ENTRY("quantity_values", 2, count);
+
+  for (index = 0; index < count && !failed_c(); index++) sr_quantity_value(epochs[index], values + index);
+
+  SR_NATIVE_EXIT("quantity_values", failed_c());
+  if (spice_error(SPICE_ERROR_SHORT)) return Qnil;
+
+  RB_GC_GUARD(rb_epochs);
+
+  return rb_values;
+}
@@ -0,0 +1,44 @@
+#ifndef SPICE_QUANTITY_H
+#define SPICE_QUANTITY_H
+
+#include "ruby.h"
+#include "SpiceUsr.h"
+#include <stdbool.h>
+#include "spice_rub_utils.h"
+#include "spice_tensor.h"
+
+#define SR_QUANTITY_MAX_NODES 64
+#define SR_QUANTITY_NAMELEN 33
+
+//One operation of a compiled quantity, its value has width 1 (scalar), 3 (vector) or 6 (state) doubles
+typedef struct {
+  int op, width, index;
+  int arguments[2];
+  SpiceInt target, observer;
+  char frame[SR_QUANTITY_NAMELEN], to[SR_QUANTITY_NAMELEN], correction[SR_QUANTITY_NAMELEN];
+  double value[6];
+} sr_quantity_node;
+
+//Quantity expression compiled into nodes in evaluation order, the last one is the result
+typedef struct {
+  int count;
+  sr_quantity_node nodes[SR_QUANTITY_MAX_NODES];
+  double * memo;
+  long memo_capacity, memo_size;
+} sr_quantity;
+
+//Compiles a Ruby quantity expression, raises ArgumentError for malformed ones or non scalar results
+void sr_quantity_compile(sr_quantity * quantity, VALUE expression);
+
+//Memoizes the quantity's values in memo, room for capacity (a power of 2) epoch and value pairs
+void sr_quantity_memoize(sr_quantity * quantity, double * memo, long capacity);
+
+//Quantity evaluated by the functions below, GF callbacks take no user data
+void sr_quantity_use(sr_quantity * quantity);
+
+//udfuns, udqdec and udfunb of gfuds_c and gfudb_c for the quantity in use
+void sr_quantity_value(SpiceDouble et, SpiceDouble * value);
+void sr_quantity_decreasing(void (* udfuns)(SpiceDouble et, SpiceDouble * value), SpiceDouble et, SpiceBoolean * decreasing);
+void sr_quantity_condition(void (* udfuns)(SpiceDouble et, SpiceDouble * value), SpiceDouble et, SpiceBoolean * holds);
+
+#endif
@@ -1,6 +1,8 @@
 
 #include "spice_rub.h"
 #include "spice_rub_utils.h"
+#include "spice_coverage.h"
+#include "spice_stats.h"
 
 /* This is a thread safety mechanism. CSPICE uses various unix signals and it is prudent to block them while 
  kernels are being loaded to ensure two threads do not interfere. This was inspired by similar blocks in place
@@ -83,75 +85,138 @@ void Init_spice_rub() {
   spicerub_nested_module = rb_define_module_under(spicerub_top_module, "Native");
   
   //Attach Kernel Loading functions to module 
-  rb_define_module_function(spicerub_nested_module, "furnsh", sr_furnsh, 1);
-  rb_define_module_function(spicerub_nested_module, "ktotal", sr_ktotal, -1);
-  rb_define_module_function(spicerub_nested_module, "unload", sr_unload, 1);
-  rb_define_module_function(spicerub_nested_module, "kclear", sr_kclear, 0);
+  sr_define_native(spicerub_nested_module, "furnsh", sr_furnsh, 1);
+  sr_define_native(spicerub_nested_module, "ktotal", sr_ktotal, -1);
+  sr_define_native(spicerub_nested_module, "unload", sr_unload, 1);
+  sr_define_native(spicerub_nested_module, "kclear", sr_kclear, 0);
+  sr_define_native(spicerub_nested_module, "reopen_kernels", sr_reopen_kernels, 1);
+
+  //Attach Native Call Statistics functions to module, these are never counted themselves
+  rb_define_module_function(spicerub_nested_module, "stats_enable", sr_stats_enable, 1);
+  rb_define_module_function(spicerub_nested_module, "stats_enabled?", sr_stats_enabled, 0);
+  rb_define_module_function(spicerub_nested_module, "stats_snapshot", sr_stats_snapshot, 0);
+  rb_define_module_function(spicerub_nested_module, "stats_reset", sr_stats_reset, 0);
+  rb_define_module_function(spicerub_nested_module, "cache_stats", sr_cache_stats, 0);
+
+  //Attach Kernel Pool Generation functions to module
+  sr_define_native(spicerub_nested_module, "pool_generation", sr_pool_generation_value, 0);
+  sr_define_native(spicerub_nested_module, "subscribe_pool", sr_subscribe_pool, 1);
+  sr_define_native(spicerub_nested_module, "unsubscribe_pool", sr_unsubscribe_pool, 1);
+  sr_define_native(spicerub_nested_module, "defer_pool_changes", sr_defer_pool_changes, 0);
+  sr_pool_listen(sr_coverage_changed);
+
+  //Attach Kernel Pool Snapshot functions to module
+  sr_define_native(spicerub_nested_module, "pool_dump", sr_pool_dump, 2);
+  sr_define_native(spicerub_nested_module, "pool_restore", sr_pool_restore, 2);
+
+  //Attach Kernel Coverage functions to module
+  sr_define_native(spicerub_nested_module, "spkobj", sr_spkobj, 1);
+  sr_define_native(spicerub_nested_module, "pckfrm", sr_pckfrm, 1);
+  sr_define_native(spicerub_nested_module, "ckobj", sr_ckobj, 1);
+  sr_define_native(spicerub_nested_module, "spkcov", sr_spkcov, 2);
+  sr_define_native(spicerub_nested_module, "pckcov", sr_pckcov, 2);
+  sr_define_native(spicerub_nested_module, "ckcov", sr_ckcov, 6);
+  sr_define_native(spicerub_nested_module, "coverage", sr_coverage, 2);
+  sr_define_native(spicerub_nested_module, "coverage_window", sr_coverage_window, 2);
+  sr_define_native(spicerub_nested_module, "coverage_gaps", sr_coverage_gaps, 3);
+  sr_define_native(spicerub_nested_module, "coverage_kernels", sr_coverage_kernels, 3);
+
+  //Attach Native SPK Reader functions to module
+  sr_define_native(spicerub_nested_module, "spk_batch", sr_spk_batch, 7);
+
+  //Attach Native Binary PCK functions to module
+  sr_define_native(spicerub_nested_module, "pxform_batch", sr_pxform_batch, 5);
+  sr_define_native(spicerub_nested_module, "pck_angles", sr_pck_angles, 5);
+  sr_define_native(spicerub_nested_module, "tkfrm", sr_tkfrm, 1);
 
   //Attach Geometry-Coordinate functions to module
-  rb_define_module_function(spicerub_nested_module, "latrec", sr_latrec, 3);
-  rb_define_module_function(spicerub_nested_module, "reclat", sr_reclat, 1);
-  rb_define_module_function(spicerub_nested_module, "lspcn", sr_lspcn, -1);
-  rb_define_module_function(spicerub_nested_module, "sincpt", sr_sincpt, 8);
-  rb_define_module_function(spicerub_nested_module, "subpnt", sr_subpnt, 6);
-  rb_define_module_function(spicerub_nested_module, "subslr", sr_subslr, 6);
-  rb_define_module_function(spicerub_nested_module, "getfov", sr_getfov, 4);
-  rb_define_module_function(spicerub_nested_module, "recsph", sr_recsph, 1);
-  rb_define_module_function(spicerub_nested_module, "sphrec", sr_sphrec, 3);
-  rb_define_module_function(spicerub_nested_module, "phaseq", sr_phaseq, 5);
-  rb_define_module_function(spicerub_nested_module, "recrad", sr_recrad, 1);
-  rb_define_module_function(spicerub_nested_module, "radrec", sr_radrec, 3);
-  rb_define_module_function(spicerub_nested_module, "recgeo", sr_recgeo, 3);
-  rb_define_module_function(spicerub_nested_module, "georec", sr_georec, 5);
-  rb_define_module_function(spicerub_nested_module, "recpgr", sr_recpgr, 4);
-  rb_define_module_function(spicerub_nested_module, "pgrrec", sr_pgrrec, 6);
-  rb_define_module_function(spicerub_nested_module, "dpr", sr_dpr, 0);
-  rb_define_module_function(spicerub_nested_module, "rpd", sr_rpd, 0);
-  rb_define_module_function(spicerub_nested_module, "bodvrd", sr_bodvrd, 3);
-  rb_define_module_function(spicerub_nested_module, "bodvcd", sr_bodvcd, 3);
-  rb_define_module_function(spicerub_nested_module, "latsph", sr_latsph, 3);
-  rb_define_module_function(spicerub_nested_module, "sphlat", sr_sphlat, 3);
-  rb_define_module_function(spicerub_nested_module, "srfrec", sr_srfrec, 3);
+  sr_define_native(spicerub_nested_module, "latrec", sr_latrec, 3);
+  sr_define_native(spicerub_nested_module, "reclat", sr_reclat, 1);
+  sr_define_native(spicerub_nested_module, "lspcn", sr_lspcn, -1);
+  sr_define_native(spicerub_nested_module, "sincpt", sr_sincpt, 8);
+  sr_define_native(spicerub_nested_module, "subpnt", sr_subpnt, 6);
+  sr_define_native(spicerub_nested_module, "subslr", sr_subslr, 6);
+  sr_define_native(spicerub_nested_module, "getfov", sr_getfov, 4);
+  sr_define_native(spicerub_nested_module, "recsph", sr_recsph, 1);
+  sr_define_native(spicerub_nested_module, "sphrec", sr_sphrec, 3);
+  sr_define_native(spicerub_nested_module, "phaseq", sr_phaseq, 5);
+  sr_define_native(spicerub_nested_module, "recrad", sr_recrad, 1);
+  sr_define_native(spicerub_nested_module, "radrec", sr_radrec, 3);
+  sr_define_native(spicerub_nested_module, "recgeo", sr_recgeo, 3);
+  sr_define_native(spicerub_nested_module, "georec", sr_georec, 5);
+  sr_define_native(spicerub_nested_module, "recpgr", sr_recpgr, 4);
+  sr_define_native(spicerub_nested_module, "pgrrec", sr_pgrrec, 6);
+  sr_define_native(spicerub_nested_module, "dpr", sr_dpr, 0);
+  sr_define_native(spicerub_nested_module, "rpd", sr_rpd, 0);
+  sr_define_native(spicerub_nested_module, "bodvrd", sr_bodvrd, 3);
+  sr_define_native(spicerub_nested_module, "bodvcd", sr_bodvcd, 3);
+  sr_define_native(spicerub_nested_module, "body_constants", sr_body_constants_of, 1);
+  sr_define_native(spicerub_nested_module, "recgeo_batch", sr_recgeo_batch, 3);
+  sr_define_native(spicerub_nested_module, "recpgr_batch", sr_recpgr_batch, 3);
+  sr_define_native(spicerub_nested_module, "latsph", sr_latsph, 3);
+  sr_define_native(spicerub_nested_module, "sphlat", sr_sphlat, 3);
+  sr_define_native(spicerub_nested_module, "srfrec", sr_srfrec, 3);
 
 
   //Atttach Time and Time Conversion functions to module
-  rb_define_module_function(spicerub_nested_module, "str2et", sr_str2et, 1);
-  rb_define_module_function(spicerub_nested_module, "gfdist", sr_gfdist, 9);
-  rb_define_module_function(spicerub_nested_module, "gfsntc", sr_gfsntc, 15);
-  rb_define_module_function(spicerub_nested_module, "gfsep", sr_gfsep, 14);
-  rb_define_module_function(spicerub_nested_module, "gftfov", sr_gftfov, 8);
-  rb_define_module_function(spicerub_nested_module, "gfoclt", sr_gfoclt, 11);
-  rb_define_module_function(spicerub_nested_module, "gfrfov", sr_gfrfov, 7);
-  rb_define_module_function(spicerub_nested_module, "timout", sr_timout, 3);
-  rb_define_module_function(spicerub_nested_module, "sce2c", sr_sce2c, 2);
-  rb_define_module_function(spicerub_nested_module, "sctiks", sr_sctiks, 2);
-  rb_define_module_function(spicerub_nested_module, "scencd", sr_scencd, 2);
-  rb_define_module_function(spicerub_nested_module, "scs2e", sr_scs2e, 2);
-  rb_define_module_function(spicerub_nested_module, "scdecd", sr_scdecd, 3);
-  rb_define_module_function(spicerub_nested_module, "sct2e", sr_sct2e , 2);
-  rb_define_module_function(spicerub_nested_module, "deltet", sr_deltet , 2);
-  rb_define_module_function(spicerub_nested_module, "unitim", sr_unitim , 3);
-  rb_define_module_function(spicerub_nested_module, "j1900", sr_j1900, 0);
-  rb_define_module_function(spicerub_nested_module, "j1950", sr_j1950, 0);
-  rb_define_module_function(spicerub_nested_module, "j2000", sr_j2000, 0);
-  rb_define_module_function(spicerub_nested_module, "j2100", sr_j2100, 0);
-  rb_define_module_function(spicerub_nested_module, "b1900", sr_b1900, 0);
-  rb_define_module_function(spicerub_nested_module, "b1950", sr_b1950, 0);
+  sr_define_native(spicerub_nested_module, "str2et", sr_str2et, 1);
+  sr_define_native(spicerub_nested_module, "gfdist", sr_gfdist, 9);
+  sr_define_native(spicerub_nested_module, "gfsntc", sr_gfsntc, 15);
+  sr_define_native(spicerub_nested_module, "gfsep", sr_gfsep, 14);
+  sr_define_native(spicerub_nested_module, "gftfov", sr_gftfov, 8);
+  sr_define_native(spicerub_nested_module, "gfoclt", sr_gfoclt, 11);
+  sr_define_native(spicerub_nested_module, "gfrfov", sr_gfrfov, 7);
+  sr_define_native(spicerub_nested_module, "gfuds", sr_gfuds, 7);
+  sr_define_native(spicerub_nested_module, "gfudb", sr_gfudb, 3);
+  sr_define_native(spicerub_nested_module, "gfuds_batch", sr_gfuds_batch, 6);
+  sr_define_native(spicerub_nested_module, "gfposc", sr_gfposc, 12);
+  sr_define_native(spicerub_nested_module, "gfilum", sr_gfilum, 14);
+  sr_define_native(spicerub_nested_module, "gfpa", sr_gfpa, 10);
+  sr_define_native(spicerub_nested_module, "gfrr", sr_gfrr, 9);
+  sr_define_native(spicerub_nested_module, "quantity_values", sr_quantity_values, 2);
+  sr_define_native(spicerub_nested_module, "gf_control", sr_gf_control, 2);
+  sr_define_native(spicerub_nested_module, "gf_status", sr_gf_status, 0);
+  sr_define_native(spicerub_nested_module, "gf_release", sr_gf_release, 0);
+  sr_define_native(spicerub_nested_module, "gf_cancel", sr_gf_cancel, 0);
+  sr_define_native(spicerub_nested_module, "timout", sr_timout, 3);
+  sr_define_native(spicerub_nested_module, "sce2c", sr_sce2c, 2);
+  sr_define_native(spicerub_nested_module, "sctiks", sr_sctiks, 2);
+  sr_define_native(spicerub_nested_module, "scencd", sr_scencd, 2);
+  sr_define_native(spicerub_nested_module, "scs2e", sr_scs2e, 2);
+  sr_define_native(spicerub_nested_module, "scdecd", sr_scdecd, 3);
+  sr_define_native(spicerub_nested_module, "sct2e", sr_sct2e , 2);
+  sr_define_native(spicerub_nested_module, "deltet", sr_deltet , 2);
+  sr_define_native(spicerub_nested_module, "unitim", sr_unitim , 3);
+  sr_define_native(spicerub_nested_module, "j1900", sr_j1900, 0);
+  sr_define_native(spicerub_nested_module, "j1950", sr_j1950, 0);
+  sr_define_native(spicerub_nested_module, "j2000", sr_j2000, 0);
+  sr_define_native(spicerub_nested_module, "j2100", sr_j2100, 0);
+  sr_define_native(spicerub_nested_module, "b1900", sr_b1900, 0);
+  sr_define_native(spicerub_nested_module, "b1950", sr_b1950, 0);
 
   //Attach Ephemerides routines to module
-  rb_define_module_function(spicerub_nested_module, "spkpos", sr_spkpos , 5);
-  rb_define_module_function(spicerub_nested_module, "spkezr", sr_spkezr , 5);
-  rb_define_module_function(spicerub_nested_module, "spkcpt", sr_spkcpt , 8);
-  rb_define_module_function(spicerub_nested_module, "spkcvo", sr_spkcvo , 9);
-  rb_define_module_function(spicerub_nested_module, "spkcvt", sr_spkcvt , 9);
-  rb_define_module_function(spicerub_nested_module, "spkcpo", sr_spkcpo , 8);
-  rb_define_module_function(spicerub_nested_module, "pxform", sr_pxform , 3);
-  rb_define_module_function(spicerub_nested_module, "pxfrm2", sr_pxfrm2 , 4);
-  rb_define_module_function(spicerub_nested_module, "sxform", sr_sxform , 3);
-  rb_define_module_function(spicerub_nested_module, "pckfrm", sr_pckfrm , 1);
-  rb_define_module_function(spicerub_nested_module, "spkobj", sr_spkobj , 1);
-  rb_define_module_function(spicerub_nested_module, "bodc2n", sr_bodc2n, 1);
-  rb_define_module_function(spicerub_nested_module, "bodn2c", sr_bodn2c, 1);
+  sr_define_native(spicerub_nested_module, "spkpos", sr_spkpos , 5);
+  sr_define_native(spicerub_nested_module, "spkezr", sr_spkezr , 5);
+  sr_define_native(spicerub_nested_module, "spkpos_batch", sr_spkpos_batch , 6);
+  sr_define_native(spicerub_nested_module, "spkezr_batch", sr_spkezr_batch , 6);
+  sr_define_native(spicerub_nested_module, "spk_tensor", sr_spk_tensor , 7);
+  sr_define_native(spicerub_nested_module, "spk_snapshot", sr_spk_snapshot , 7);
+  sr_define_native(spicerub_nested_module, "spkpos_lt_batch", sr_spkpos_lt_batch , 6);
+  sr_define_native(spicerub_nested_module, "spk_requests", sr_spk_requests , 8);
+  sr_define_native(spicerub_nested_module, "spkcpt", sr_spkcpt , 8);
+  sr_define_native(spicerub_nested_module, "spkcvo", sr_spkcvo , 9);
+  sr_define_native(spicerub_nested_module, "spkcvt", sr_spkcvt , 9);
+  sr_define_native(spicerub_nested_module, "spkcpo", sr_spkcpo , 8);
+  sr_define_native(spicerub_nested_module, "spkopn", sr_spkopn , 3);
+  sr_define_native(spicerub_nested_module, "spkw13", sr_spkw13 , 10);
+  sr_define_native(spicerub_nested_module, "spkcls", sr_spkcls , 1);
+  sr_define_native(spicerub_nested_module, "pxform", sr_pxform , 3);
+  sr_define_native(spicerub_nested_module, "pxfrm2", sr_pxfrm2 , 4);
+  sr_define_native(spicerub_nested_module, "sxform", sr_sxform , 3);
+  sr_define_native(spicerub_nested_module, "namfrm", sr_namfrm, 1);
+  sr_define_native(spicerub_nested_module, "frinfo", sr_frinfo, 1);
+  sr_define_native(spicerub_nested_module, "bodc2n", sr_bodc2n, 1);
+  sr_define_native(spicerub_nested_module, "bodn2c", sr_bodn2c, 1);
   
   rb_spice_error = rb_define_class("SpiceError", rb_eStandardError);
 }
@@ -16,6 +16,37 @@ VALUE sr_furnsh(VALUE self, VALUE kernel);
 VALUE sr_unload(VALUE self, VALUE kernel);
 VALUE sr_ktotal(int argc, VALUE *argv, VALUE self);
 VALUE sr_kclear(VALUE self);
+VALUE sr_reopen_kernels(VALUE self, VALUE paths);
+
+//Kernel Pool Generation functions
+VALUE sr_pool_generation_value(VALUE self);
+VALUE sr_subscribe_pool(VALUE self, VALUE subscriber);
+VALUE sr_unsubscribe_pool(VALUE self, VALUE subscriber);
+VALUE sr_defer_pool_changes(VALUE self);
+
+//Kernel Pool Snapshot Functions
+VALUE sr_pool_dump(VALUE self, VALUE path, VALUE key);
+VALUE sr_pool_restore(VALUE self, VALUE path, VALUE key);
+
+//Kernel Coverage Functions
+VALUE sr_spkobj(VALUE self, VALUE spk_file);
+VALUE sr_pckfrm(VALUE self, VALUE pck_file);
+VALUE sr_ckobj(VALUE self, VALUE ck_file);
+VALUE sr_spkcov(VALUE self, VALUE spk_file, VALUE idcode);
+VALUE sr_pckcov(VALUE self, VALUE pck_file, VALUE idcode);
+VALUE sr_ckcov(VALUE self, VALUE ck_file, VALUE idcode, VALUE needav, VALUE level, VALUE tol, VALUE timsys);
+VALUE sr_coverage(VALUE self, VALUE kind, VALUE idcode);
+VALUE sr_coverage_window(VALUE self, VALUE kind, VALUE idcode);
+VALUE sr_coverage_gaps(VALUE self, VALUE kind, VALUE idcodes, VALUE ets);
+VALUE sr_coverage_kernels(VALUE self, VALUE kind, VALUE idcodes, VALUE et);
+
+//Native SPK Reader Functions
+VALUE sr_spk_batch(VALUE self, VALUE target, VALUE observer, VALUE ets, VALUE frame, VALUE columns, VALUE threads, VALUE out);
+
+//Native Binary PCK Functions
+VALUE sr_pxform_batch(VALUE self, VALUE from, VALUE to, VALUE ets, VALUE threads, VALUE out);
+VALUE sr_pck_angles(VALUE self, VALUE class_id, VALUE ets, VALUE columns, VALUE threads, VALUE out);
+VALUE sr_tkfrm(VALUE self, VALUE frame_code);
 
 //Geometry and Co-ordinate System Function
 VALUE sr_latrec(VALUE self, VALUE radius, VALUE longtitude, VALUE latitude);
@@ -41,6 +72,9 @@ VALUE sr_rpd(VALUE self);
 VALUE sr_getfov(VALUE self, VALUE instid, VALUE room, VALUE shapelen, VALUE framelen);
 VALUE sr_bodvrd(VALUE self, VALUE bodynm, VALUE item, VALUE maxn);
 VALUE sr_bodvcd(VALUE self, VALUE bodynm, VALUE item, VALUE maxn);
+VALUE sr_body_constants_of(VALUE self, VALUE body);
+VALUE sr_recgeo_batch(VALUE self, VALUE body, VALUE points, VALUE out);
+VALUE sr_recpgr_batch(VALUE self, VALUE body, VALUE points, VALUE out);
 
 
 //Time and Time Conversions Functions
@@ -58,6 +92,21 @@ VALUE sr_scs2e(VALUE self, VALUE sc, VALUE sclkch);
 VALUE sr_scdecd(VALUE self, VALUE sc, VALUE sclkdp, VALUE lenout);
 VALUE sr_sct2e(VALUE self, VALUE sc, VALUE sclkdp);
 VALUE sr_gfoclt(VALUE self, VALUE occtyp, VALUE front, VALUE fshape, VALUE fframe, VALUE back, VALUE bshape, VALUE bframe, VALUE abcorr, VALUE obsrvr, VALUE step, VALUE confines);
+
+VALUE sr_gfuds(VALUE self, VALUE expression, VALUE relate, VALUE refval, VALUE adjust, VALUE step, VALUE nintvls, VALUE confines);
+VALUE sr_gfudb(VALUE self, VALUE expression, VALUE step, VALUE confines);
+VALUE sr_gfuds_batch(VALUE self, VALUE expression, VALUE thresholds, VALUE adjust, VALUE step, VALUE nintvls, VALUE confines);
+VALUE sr_gfposc(VALUE self, VALUE target, VALUE frame, VALUE abcorr, VALUE obsrvr, VALUE crdsys, VALUE coord, VALUE relate, VALUE refval, VALUE adjust, VALUE step, VALUE nintvls, VALUE confines);
+VALUE sr_gfilum(VALUE self, VALUE method, VALUE angtyp, VALUE target, VALUE illum, VALUE fixref, VALUE abcorr, VALUE obsrvr, VALUE spoint, VALUE relate, VALUE refval, VALUE adjust, VALUE step, VALUE nintvls, VALUE confines);
+VALUE sr_gfpa(VALUE self, VALUE target, VALUE illum, VALUE abcorr, VALUE obsrvr, VALUE relate, VALUE refval, VALUE adjust, VALUE step, VALUE nintvls, VALUE confines);
+VALUE sr_gfrr(VALUE self, VALUE target, VALUE abcorr, VALUE obsrvr, VALUE relate, VALUE refval, VALUE adjust, VALUE step, VALUE nintvls, VALUE confines);
+VALUE sr_quantity_values(VALUE self, VALUE expression, VALUE ets);
+
+//GF Search Control Functions
+VALUE sr_gf_control(VALUE self, VALUE budget, VALUE progress);
+VALUE sr_gf_status(VALUE self);
+VALUE sr_gf_release(VALUE self);
+VALUE sr_gf_cancel(VALUE self);
 VALUE sr_deltet(VALUE self, VALUE epoch, VALUE eptype);
 VALUE sr_unitim(VALUE self, VALUE epoch, VALUE insystem, VALUE outsystem);
 //constants for Time Routines
@@ -72,15 +121,24 @@ VALUE sr_j2100(VALUE self);
 //Ephemerides Function Declarations
 VALUE sr_spkpos(VALUE self, VALUE targ, VALUE et, VALUE ref, VALUE abcorr, VALUE obs);
 VALUE sr_spkezr(VALUE self, VALUE targ, VALUE et, VALUE ref, VALUE abcorr, VALUE obs);
+VALUE sr_spkpos_batch(VALUE self, VALUE targ, VALUE ets, VALUE ref, VALUE abcorr, VALUE obs, VALUE out);
+VALUE sr_spkezr_batch(VALUE self, VALUE targ, VALUE ets, VALUE ref, VALUE abcorr, VALUE obs, VALUE out);
+VALUE sr_spk_tensor(VALUE self, VALUE targets, VALUE observers, VALUE ets, VALUE ref, VALUE abcorr, VALUE columns, VALUE out);
+VALUE sr_spk_snapshot(VALUE self, VALUE ids, VALUE observer, VALUE ets, VALUE ref, VALUE abcorr, VALUE columns, VALUE out);
+VALUE sr_spkpos_lt_batch(VALUE self, VALUE targ, VALUE ets, VALUE ref, VALUE abcorr, VALUE obs, VALUE out);
+VALUE sr_spk_requests(VALUE self, VALUE targets, VALUE observers, VALUE ets, VALUE ref, VALUE abcorr, VALUE columns, VALUE plan, VALUE out);
 VALUE sr_spkcpo(VALUE self, VALUE target, VALUE et, VALUE outref, VALUE refloc, VALUE abcorr, VALUE obspos, VALUE obsctr, VALUE obsref);
 VALUE sr_spkcvo(VALUE self, VALUE target, VALUE et, VALUE outref, VALUE refloc, VALUE abcorr, VALUE obssta, VALUE obsepc, VALUE obsctr, VALUE obsref);
 VALUE sr_spkcpt(VALUE self, VALUE trgpos, VALUE trgctr, VALUE trgref, VALUE et, VALUE outref, VALUE refloc, VALUE abcorr, VALUE obsrvr);
 VALUE sr_spkcvt(VALUE self, VALUE trgsta, VALUE trgepc, VALUE trgctr, VALUE trgref, VALUE et, VALUE outref, VALUE refloc, VALUE abcorr, VALUE obsrvr);
+VALUE sr_spkopn(VALUE self, VALUE path, VALUE internal_name, VALUE comment_characters);
+VALUE sr_spkw13(VALUE self, VALUE handle, VALUE body, VALUE center, VALUE frame, VALUE first, VALUE last, VALUE segid, VALUE degree, VALUE states, VALUE epochs);
+VALUE sr_spkcls(VALUE self, VALUE handle);
 VALUE sr_pxform(VALUE self, VALUE from , VALUE to , VALUE at);
 VALUE sr_sxform(VALUE self, VALUE from , VALUE to , VALUE at);
 VALUE sr_pxfrm2(VALUE self, VALUE from , VALUE to , VALUE epoch_at, VALUE epoch_to);
-VALUE sr_spkobj(VALUE self, VALUE spk_file);
-VALUE sr_pckfrm(VALUE self, VALUE pck_file);
+VALUE sr_namfrm(VALUE self, VALUE frame_name);
+VALUE sr_frinfo(VALUE self, VALUE frame_code);
 VALUE sr_bodn2c(VALUE self, VALUE body_name);
 VALUE sr_bodc2n(VALUE self, VALUE code_name);
 VALUE sr_bods2c(VALUE self, VALUE string_name);
\ No newline at end of file
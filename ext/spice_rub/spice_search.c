@@ -0,0 +1,257 @@
+#include "spice_search.h"
+#include <time.h>
+
+/* GF search control.
+
+ The GF entry points that take report and interrupt functions (gfevnt_c, gfocce_c, gffove_c) call them as
+ the search steps through the confinement window. While Ruby has armed the control (SpiceRub::Search) the
+ report functions track the fraction of the window searched and pass it to a progress callable, and the
+ interrupt function stops the search once it is cancelled or its time budget is spent. An aborted search
+ returns the result window as the finder left it, with the intervals it had completed.
+
+ The callbacks take no user data, so there is one control per process, like CSPICE's GF subsystem which is
+ not reentrant either. It belongs to the thread that armed it, searches of other threads run uncontrolled.
+ Ruby code never unwinds through CSPICE: the progress callable runs under rb_protect, an exception stops the
+ search and is raised again once CSPICE returned. While the callable runs the scheduler may switch to other
+ threads, and the callable may call natives itself, so a GF search started while another is in CSPICE raises
+ instead of re-entering the GF subsystem. Every SR_GF_POLL steps the interrupt function only looks for a
+ pending interrupt (a signal or Thread#raise), which stops the search as cancelled and is handled by Ruby
+ once the native returns.
+*/
+
+#define SR_GF_POLL 64
+//Smallest advance of the searched fraction passed to the progress callable
+#define SR_GF_REPORT_STEP 0.01
+
+//Search status, cancelled and timed out stick until the control is released
+#define SR_GF_IDLE 0
+#define SR_GF_RUNNING 1
+#define SR_GF_COMPLETE 2
+#define SR_GF_TIMED_OUT 3
+#define SR_GF_CANCELLED 4
+
+static const char * GF_STATUSES[5] = {"idle", "running", "complete", "timed_out", "cancelled"};
+
+static struct {
+  bool armed, registered, searching, limited;
+  volatile bool cancelled;
+  int status, pending;
+  //Thread that armed the control, only its searches report and can be interrupted
+  VALUE owner, progress;
+  //CLOCK_MONOTONIC seconds, when limited by a budget
+  double deadline;
+  unsigned long steps;
+  //Window of the current pass, its measure and the measure before the interval being searched
+  SpiceCell * window;
+  double measure, before, interval, fraction, reported;
+  bool interval_known;
+} control;
+
+static double seconds(void) {
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+
+  return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+static VALUE call_progress(VALUE arguments) {
+  VALUE * values = (VALUE *) arguments;
+
+  return rb_funcall(control.progress, rb_intern("call"), 2, values[0], values[1]);
+}
+
+static void report(double fraction, double et) {
+  VALUE arguments[2];
+
+  control.fraction = fraction;
+  if (NIL_P(control.progress) || control.pending) return;
+
+  control.reported = fraction;
+  arguments[0] = DBL2NUM(fraction);
+  arguments[1] = DBL2NUM(et);
+
+  rb_protect(call_progress, (VALUE) arguments, &control.pending);
+}
+
+static bool controlled(void) {
+  return control.armed && control.owner == rb_thread_current();
+}
+
+SpiceBoolean sr_gf_armed(void) {
+  return controlled() ? SPICETRUE : SPICEFALSE;
+}
+
+void sr_gf_begin(void) {
+  if (control.searching) {
+    rb_raise(rb_eRuntimeError, "a GF search is running%s", control.owner == rb_thread_current() ? "" : " in another thread");
+  }
+
+  if (!controlled()) return;
+
+  if (control.status <= SR_GF_COMPLETE) control.status = SR_GF_RUNNING;
+  control.searching = true;
+}
+
+void sr_gf_end(void) {
+  int state = control.pending;
+
+  if (!controlled()) return;
+
+  control.searching = false;
+  if (control.status == SR_GF_RUNNING) control.status = SR_GF_COMPLETE;
+
+  if (state) {
+    control.pending = 0;
+    control.status = SR_GF_CANCELLED;
+    reset_c();
+    rb_jump_tag(state);
+  }
+}
+
+void sr_gf_report_init(SpiceCell * cnfine, ConstSpiceChar * prefix, ConstSpiceChar * suffix) {
+  SpiceInt count = wncard_c(cnfine), index;
+  double start, end, first = 0.0;
+
+  control.window = cnfine;
+  control.measure = 0.0;
+  control.interval_known = false;
+  control.reported = -1.0;
+
+  for (index = 0; index < count; index++) {
+    wnfetd_c(cnfine, index, &start, &end);
+    if (index == 0) first = start;
+    control.measure += end - start;
+  }
+
+  report(0.0, first);
+}
+
+void sr_gf_report_update(SpiceDouble ivbeg, SpiceDouble ivend, SpiceDouble time) {
+  SpiceInt count, index;
+  double start, end, fraction;
+
+  if (!control.interval_known || ivbeg != control.interval) {
+    count = wncard_c(control.window);
+    control.before = 0.0;
+
+    for (index = 0; index < count; index++) {
+      wnfetd_c(control.window, index, &start, &end);
+      if (end <= ivbeg) control.before += end - start;
+    }
+
+    control.interval = ivbeg;
+    control.interval_known = true;
+  }
+
+  fraction = control.measure > 0.0 ? (control.before + time - ivbeg) / control.measure : 1.0;
+  if (fraction < 0.0) fraction = 0.0;
+  if (fraction > 1.0) fraction = 1.0;
+
+  if (fraction - control.reported >= SR_GF_REPORT_STEP) report(fraction, time);
+}
+
+void sr_gf_report_final(void) {
+  SpiceInt count = wncard_c(control.window);
+  double start, end = 0.0;
+
+  //Also called when the search bails, only a finished pass reports 1
+  if (control.status != SR_GF_RUNNING || control.pending) return;
+
+  if (count > 0) wnfetd_c(control.window, count - 1, &start, &end);
+
+  report(1.0, end);
+}
+
+SpiceBoolean sr_gf_bail(void) {
+  if (control.pending) return SPICETRUE;
+
+  if (control.cancelled) {
+    control.status = SR_GF_CANCELLED;
+    return SPICETRUE;
+  }
+
+  if (control.limited && seconds() >= control.deadline) {
+    control.status = SR_GF_TIMED_OUT;
+    return SPICETRUE;
+  }
+
+  if (++control.steps % SR_GF_POLL == 0 && rb_thread_interrupted(rb_thread_current())) {
+    control.status = SR_GF_CANCELLED;
+    return SPICETRUE;
+  }
+
+  return SPICEFALSE;
+}
+
+/*
+ Arms the control for the GF searches that follow: they stop after budget seconds (nil for no limit) or
+ once cancelled, and call progress with (fraction, et) as they advance. Returns nil.
+*/
+VALUE sr_gf_control(VALUE self, VALUE budget, VALUE progress) {
+  SR_NATIVE_ENTRY("gf_control", 2, 1);
+
+  if (control.searching) rb_raise(rb_eRuntimeError, "a GF search is running");
+  if (!NIL_P(budget) && NUM2DBL(budget) < 0) rb_raise(rb_eArgError, "budget must not be negative");
+  if (!NIL_P(progress) && !rb_respond_to(progress, rb_intern("call"))) rb_raise(rb_eArgError, "progress must respond to call");
+
+  if (!control.registered) {
+    rb_gc_register_address(&control.progress);
+    rb_gc_register_address(&control.owner);
+    control.registered = true;
+  }
+
+  control.armed = true;
+  control.owner = rb_thread_current();
+  control.cancelled = false;
+  control.status = SR_GF_IDLE;
+  control.pending = 0;
+  control.steps = 0;
+  control.fraction = 0.0;
+  control.progress = progress;
+  control.limited = !NIL_P(budget);
+  if (control.limited) control.deadline = seconds() + NUM2DBL(budget);
+
+  SR_NATIVE_EXIT("gf_control", 0);
+  return Qnil;
+}
+
+static VALUE status_of(void) {
+  return rb_ary_new3(2, RB_STR2SYM(GF_STATUSES[control.status]), DBL2NUM(control.fraction));
+}
+
+/* [status, fraction searched] of the armed control, status is :idle, :running, :complete, :timed_out or :cancelled */
+VALUE sr_gf_status(VALUE self) {
+  SR_NATIVE_ENTRY("gf_status", 0, 1);
+
+  SR_NATIVE_EXIT("gf_status", 0);
+  return status_of();
+}
+
+/* Disarms the control, returns its final status like gf_status */
+VALUE sr_gf_release(VALUE self) {
+  VALUE status;
+
+  SR_NATIVE_ENTRY("gf_release", 0, 1);
+
+  status = status_of();
+
+  if (control.searching) rb_raise(rb_eRuntimeError, "a GF search is running");
+
+  control.armed = false;
+  control.owner = Qnil;
+  control.progress = Qnil;
+
+  SR_NATIVE_EXIT("gf_release", 0);
+  return status;
+}
+
+/* Stops the running GF search and every later one until the control is released, true when armed */
+VALUE sr_gf_cancel(VALUE self) {
+  SR_NATIVE_ENTRY("gf_cancel", 0, 1);
+
+  control.cancelled = true;
+
+  SR_NATIVE_EXIT("gf_cancel", 0);
+  return control.armed ? Qtrue : Qfalse;
+}
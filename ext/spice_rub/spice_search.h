@@ -0,0 +1,26 @@
+#ifndef SPICE_SEARCH_H
+#define SPICE_SEARCH_H
+
+#include "ruby.h"
+#include "SpiceUsr.h"
+#include <stdbool.h>
+#include "spice_rub_utils.h"
+#include "spice_probes.h"
+
+//Whether the calling thread's GF searches are controlled, the rpt and bail arguments of gfevnt_c, gfocce_c and gffove_c
+SpiceBoolean sr_gf_armed(void);
+
+/*
+ Called around every GF search. The begin raises when another search is in CSPICE, the end raises an exception
+ a progress callback or interrupt left pending
+*/
+void sr_gf_begin(void);
+void sr_gf_end(void);
+
+//Progress report and interrupt functions handed to the GF search
+void sr_gf_report_init(SpiceCell * cnfine, ConstSpiceChar * prefix, ConstSpiceChar * suffix);
+void sr_gf_report_update(SpiceDouble ivbeg, SpiceDouble ivend, SpiceDouble time);
+void sr_gf_report_final(void);
+SpiceBoolean sr_gf_bail(void);
+
+#endif
@@ -0,0 +1,440 @@
+#include "spice_spk.h"
+#include <math.h>
+
+/* Native SPK reader.
+
+ CSPICE keeps global state (file table, segment buffers, error status), so every spkpos_c call has to hold
+ the GVL and a batch can never use more than one core. This reader evaluates SPK data itself, straight
+ from memory mapped DAF files, and keeps no mutable state during an evaluation, so batches run on a
+ pthread pool with the GVL released.
+
+ Segments are indexed by spice_daf_index.c in CSPICE's priority order. Segments of types 1, 2, 3, 13 and 21
+ in inertial frames are evaluated; if the highest priority segment for a body at an epoch is anything else
+ the batch fails instead of silently falling back on lower priority data. Results are geometric states (no aberration
+ corrections), found like spkgeo_c by walking the target and observer center chains to a common node.
+*/
+
+#define SR_SPK_MAX_CHAIN 100
+#define SR_SPK_MAX_WINDOW 64
+#define SR_SPK_MAX_DIM 64
+
+/* ---- Segment evaluation ---- */
+
+/* Hermite interpolation of values and derivatives at n nodes, in Newton form over doubled nodes */
+static void hermite(const double * x, const double * f, const double * df, long stride, long n, double t, double * value, double * derivative) {
+  double z[2 * SR_SPK_MAX_WINDOW], c[2 * SR_SPK_MAX_WINDOW];
+  long m = 2 * n, i, k;
+
+  for (i = 0; i < n; i++) {
+    z[2 * i] = z[2 * i + 1] = x[i];
+    c[2 * i] = c[2 * i + 1] = f[i * stride];
+  }
+
+  for (k = 1; k < m; k++) {
+    for (i = m - 1; i >= k; i--) {
+      if (k == 1 && i % 2) c[i] = df[(i / 2) * stride];
+      else c[i] = (c[i] - c[i - 1]) / (z[i] - z[i - k]);
+    }
+  }
+
+  *value = c[m - 1];
+  *derivative = 0.0;
+
+  for (i = m - 2; i >= 0; i--) {
+    *derivative = *derivative * (t - z[i]) + *value;
+    *value = *value * (t - z[i]) + c[i];
+  }
+}
+
+/* Index of the last epoch <= et, -1 if et precedes them all */
+static long last_at_or_before(const double * epochs, long count, double et) {
+  long low = 0, high = count;
+
+  while (low < high) {
+    long middle = (low + high) / 2;
+
+    if (epochs[middle] <= et) low = middle + 1;
+    else high = middle;
+  }
+
+  return low - 1;
+}
+
+/* Type 13 : Hermite interpolation over unequally spaced states */
+static int evaluate_hermite(const sr_daf_segment * segment, double et, double state[6]) {
+  const double * tail = segment->data + segment->length - 2;
+  long window = (long) tail[0] + 1, count = (long) tail[1], first, component;
+  const double * states = segment->data, * epochs = segment->data + 6 * count;
+  double value, derivative;
+
+  if (count < 1 || window < 1 || window > SR_SPK_MAX_WINDOW) return SR_DAF_UNSUPPORTED;
+  if (window > count) window = count;
+
+  first = last_at_or_before(epochs, count, et);
+
+  //Odd windows are centered on the nearest state, even windows on the pair bracketing et
+  if (window % 2) {
+    if (first < 0 || (first + 1 < count && epochs[first + 1] - et < et - epochs[first])) first++;
+    first -= (window - 1) / 2;
+  }
+  else {
+    first -= window / 2 - 1;
+  }
+
+  if (first > count - window) first = count - window;
+  if (first < 0) first = 0;
+
+  for (component = 0; component < 3; component++) {
+    hermite(epochs + first, states + 6 * first + component, states + 6 * first + component + 3, 6, window, et, &value, &derivative);
+
+    state[component] = value;
+    state[component + 3] = derivative;
+  }
+
+  return SR_DAF_OK;
+}
+
+/* Index of the first epoch >= et, count if et follows them all */
+static long first_at_or_after(const double * epochs, long count, double et) {
+  long low = 0, high = count;
+
+  while (low < high) {
+    long middle = (low + high) / 2;
+
+    if (epochs[middle] < et) low = middle + 1;
+    else high = middle;
+  }
+
+  return low;
+}
+
+/* Types 1 and 21 : modified difference arrays, a port of the SPKE01/SPKE21 integration formulas */
+static int evaluate_difference_line(const sr_daf_segment * segment, double et, double state[6]) {
+  long max_dim = segment->type == 1 ? 15 : (long) segment->data[segment->length - 2];
+  long count = (long) segment->data[segment->length - 1];
+  long line_size = 4 * max_dim + 11, index, kq_max, ks, ks1, jx, i, j, kqq;
+  const double * record, * g, * ref, * dt, * epochs;
+  double fc[SR_SPK_MAX_DIM + 2], wc[SR_SPK_MAX_DIM + 2], w[SR_SPK_MAX_DIM + 4];
+  double delta, tp, sum;
+  int kq[3];
+
+  if (count < 1 || max_dim < 1 || max_dim > SR_SPK_MAX_DIM) return SR_DAF_UNSUPPORTED;
+
+  epochs = segment->data + count * line_size;
+  index = first_at_or_after(epochs, count, et);
+  if (index >= count) index = count - 1;
+
+  record = segment->data + index * line_size;
+
+  //Arrays below are 1-based like the Fortran original, g[j] is record[j]
+  g = record;
+  ref = record + max_dim + 1;
+  dt = record + max_dim + 7;
+  kq_max = (long) record[4 * max_dim + 7];
+  for (i = 0; i < 3; i++) kq[i] = (int) record[4 * max_dim + 8 + i];
+
+  if (kq_max < 3 || kq_max > max_dim + 1) return SR_DAF_UNSUPPORTED;
+
+  delta = et - record[0];
+  tp = delta;
+  fc[1] = 1.0;
+
+  for (j = 1; j <= kq_max - 2; j++) {
+    fc[j + 1] = tp / g[j];
+    wc[j] = delta / g[j];
+    tp = delta + g[j];
+  }
+
+  for (j = 1; j <= kq_max; j++) w[j] = 1.0 / (double) j;
+
+  jx = 0;
+  ks = kq_max - 1;
+  ks1 = ks - 1;
+
+  while (ks >= 2) {
+    jx++;
+    for (j = 1; j <= jx; j++) w[j + ks] = fc[j + 1] * w[j + ks1] - wc[j] * w[j + ks];
+    ks = ks1;
+    ks1--;
+  }
+
+  //Reference position and velocity are interleaved : x, vx, y, vy, z, vz
+  for (i = 0; i < 3; i++) {
+    kqq = kq[i];
+    sum = 0.0;
+    for (j = kqq; j >= 1; j--) sum += dt[i * max_dim + j - 1] * w[j + ks];
+    state[i] = ref[2 * i] + delta * (ref[2 * i + 1] + delta * sum);
+  }
+
+  for (j = 1; j <= jx; j++) w[j + ks] = fc[j + 1] * w[j + ks1] - wc[j] * w[j + ks];
+  ks--;
+
+  for (i = 0; i < 3; i++) {
+    kqq = kq[i];
+    sum = 0.0;
+    for (j = kqq; j >= 1; j--) sum += dt[i * max_dim + j - 1] * w[j + ks];
+    state[i + 3] = ref[2 * i + 1] + delta * sum;
+  }
+
+  return SR_DAF_OK;
+}
+
+static bool supported_type(int type) {
+  return type == 1 || type == 2 || type == 3 || type == 13 || type == 21;
+}
+
+/* State of segment->target relative to segment->center in J2000 */
+static int evaluate_segment(const sr_daf_segment * segment, double et, double state[6]) {
+  double local[6];
+  int status, row;
+
+  if (!segment->usable) return SR_DAF_UNSUPPORTED;
+
+  switch (segment->type) {
+    case 1 :
+    case 21 :
+      status = evaluate_difference_line(segment, et, local);
+      break;
+    case 2 :
+    case 3 :
+      status = sr_daf_chebyshev(segment, et, local);
+      break;
+    case 13 :
+      status = evaluate_hermite(segment, et, local);
+      break;
+    default :
+      return SR_DAF_UNSUPPORTED;
+  }
+
+  if (status != SR_DAF_OK) return status;
+
+  if (!segment->rotate) {
+    memcpy(state, local, 6 * sizeof(double));
+    return SR_DAF_OK;
+  }
+
+  //Inertial frames differ by a constant rotation, positions and velocities rotate alike
+  for (row = 0; row < 3; row++) {
+    state[row] = segment->rotation[row][0] * local[0] + segment->rotation[row][1] * local[1] + segment->rotation[row][2] * local[2];
+    state[row + 3] = segment->rotation[row][0] * local[3] + segment->rotation[row][1] * local[4] + segment->rotation[row][2] * local[5];
+  }
+
+  return SR_DAF_OK;
+}
+
+/* ---- Center chains, all read-only ---- */
+
+/* Follows the center chain of body, nodes[k] is the k-th center and states[k] the body relative to it */
+static int build_chain(const sr_daf_index * index, int body, double et, int * nodes, double (* states)[6], long * length) {
+  const sr_daf_segment * segment;
+  double step[6];
+  int status, component;
+
+  nodes[0] = body;
+  memset(states[0], 0, 6 * sizeof(double));
+  *length = 1;
+
+  while (nodes[*length - 1] != 0 && *length < SR_SPK_MAX_CHAIN) {
+    segment = sr_daf_index_segment(index, nodes[*length - 1], et);
+    if (!segment) return SR_DAF_NO_DATA;
+
+    status = evaluate_segment(segment, et, step);
+    if (status != SR_DAF_OK) return status;
+
+    nodes[*length] = segment->center;
+    for (component = 0; component < 6; component++) states[*length][component] = states[*length - 1][component] + step[component];
+    (*length)++;
+  }
+
+  return SR_DAF_OK;
+}
+
+/* Geometric state of target relative to observer in J2000 */
+static int geometric_state(const sr_daf_index * index, int target, int observer, double et, double state[6]) {
+  int target_nodes[SR_SPK_MAX_CHAIN], observer_nodes[SR_SPK_MAX_CHAIN];
+  double target_states[SR_SPK_MAX_CHAIN][6], observer_states[SR_SPK_MAX_CHAIN][6];
+  long target_length, observer_length, i, j;
+  int target_status, observer_status, component;
+
+  //A chain that stops early can still meet the other one, so only the meeting point decides
+  target_status = build_chain(index, target, et, target_nodes, target_states, &target_length);
+  observer_status = build_chain(index, observer, et, observer_nodes, observer_states, &observer_length);
+
+  for (j = 0; j < observer_length; j++) {
+    for (i = 0; i < target_length; i++) {
+      if (target_nodes[i] == observer_nodes[j]) {
+        for (component = 0; component < 6; component++) state[component] = target_states[i][component] - observer_states[j][component];
+        return SR_DAF_OK;
+      }
+    }
+  }
+
+  if (target_status != SR_DAF_OK) return target_status;
+  if (observer_status != SR_DAF_OK) return observer_status;
+
+  return SR_DAF_NO_DATA;
+}
+
+/* ---- Index callbacks, run with the GVL ---- */
+
+static bool describe_segment(sr_daf_segment * segment, const int * ints) {
+  segment->body = ints[0];
+  segment->center = ints[1];
+  segment->frame = ints[2];
+  segment->type = ints[3];
+
+  return supported_type(segment->type);
+}
+
+/* Only inertial frames are supported, their rotation to J2000 is read once from CSPICE */
+static void resolve_frame(sr_daf_segment * segment) {
+  SpiceInt center, frame_class, class_id;
+  SpiceBoolean found;
+  char name[SR_DAF_TYPLEN];
+
+  if (segment->frame == 1) return;
+
+  frinfo_c(segment->frame, &center, &frame_class, &class_id, &found);
+
+  if (failed_c() || !found || frame_class != 1) {
+    reset_c();
+    segment->usable = false;
+    return;
+  }
+
+  //Constant, but asked for inside the segment so CSPICE never needs data the kernels do not cover
+  frmnam_c(segment->frame, SR_DAF_TYPLEN, name);
+  pxform_c(name, "J2000", 0.5 * (segment->start + segment->end), segment->rotation);
+
+  if (failed_c()) {
+    reset_c();
+    segment->usable = false;
+    return;
+  }
+
+  segment->rotate = true;
+}
+
+static sr_daf_kind spk_kind = SR_DAF_KIND("SPK", 2, 6, SR_CACHE_SPK_INDEX, describe_segment, resolve_frame);
+
+/* ---- Batches ---- */
+
+typedef struct {
+  const sr_daf_index * index;
+  int target, observer, columns;
+  const double * epochs;
+  double * output;
+  bool rotate;
+  double rotation[3][3];
+  //First failing epoch and why, written by whichever thread gets there first
+  volatile long failed_at;
+  volatile int status;
+} spk_batch;
+
+static void evaluate_range(long begin, long end, void * data) {
+  spk_batch * batch = data;
+  double state[6];
+  long epoch;
+  int status, row, column;
+
+  for (epoch = begin; epoch < end && batch->failed_at < 0; epoch++) {
+    status = geometric_state(batch->index, batch->target, batch->observer, batch->epochs[epoch], state);
+
+    if (status != SR_DAF_OK) {
+      if (__sync_bool_compare_and_swap(&batch->failed_at, -1, epoch)) batch->status = status;
+      return;
+    }
+
+    for (column = 0; column < batch->columns; column++) {
+      double * out = batch->output + epoch * batch->columns + column;
+
+      if (!batch->rotate) {
+        *out = state[column];
+      }
+      else {
+        row = column % 3;
+        *out = batch->rotation[row][0] * state[column - row] + batch->rotation[row][1] * state[column - row + 1] + batch->rotation[row][2] * state[column - row + 2];
+      }
+    }
+  }
+}
+
+static int body_code(VALUE body) {
+  SpiceInt code;
+
+  if (FIXNUM_P(body)) return FIX2INT(body);
+
+  if (!sr_bodies_code(RB_SYM2STR(body), &code)) {
+    reset_c();
+    rb_raise(rb_eArgError, "unknown body %s", RB_SYM2STR(body));
+  }
+
+  return code;
+}
+
+/*
+ Geometric states (columns 6) or positions (columns 3) of target relative to observer at every epoch,
+ evaluated natively on up to threads threads with the GVL released. frame must be inertial.
+ Returns an N x columns float64 NMatrix, written into out when given.
+*/
+VALUE sr_spk_batch(VALUE self, VALUE target, VALUE observer, VALUE ets, VALUE frame, VALUE columns, VALUE threads, VALUE out) {
+  spk_batch batch;
+  SpiceInt frame_code, center, frame_class, class_id;
+  SpiceBoolean found;
+  long count;
+  int thread_count = sr_parallel_threads(threads);
+  VALUE rb_epochs = sr_epochs_from(ets, &count);
+  VALUE rb_output;
+
+  batch.columns = NUM2INT(columns);
+  if (batch.columns != 3 && batch.columns != 6) rb_raise(rb_eArgError, "columns must be 3 or 6");
+
+  rb_output = sr_dense_output(out, count, batch.columns);
+  batch.target = body_code(target);
+  batch.observer = body_code(observer);
+  batch.epochs = sr_dense_elements(rb_epochs);
+  batch.output = sr_dense_elements(rb_output);
+  batch.failed_at = -1;
+  batch.status = SR_DAF_OK;
+
+  namfrm_c(RB_SYM2STR(frame), &frame_code);
+  frinfo_c(frame_code, &center, &frame_class, &class_id, &found);
+  if (spice_error(SPICE_ERROR_SHORT)) return Qnil;
+  if (!found || frame_class != 1) rb_raise(rb_eArgError, "native SPK evaluation needs an inertial frame, got %s", RB_SYM2STR(frame));
+
+  batch.rotate = frame_code != 1;
+  if (batch.rotate) {
+    pxform_c("J2000", RB_SYM2STR(frame), count ? batch.epochs[0] : 0.0, batch.rotation);
+    if (spice_error(SPICE_ERROR_SHORT)) return Qnil;
+  }
+
+  sr_daf_index_refresh(&spk_kind);
+
+  SR_PROBE4(spk__batch, "spk_batch", batch.target, batch.observer, count);
+
+  SR_NATIVE_ENTRY("spk_batch", 7, count);
+
+  batch.index = sr_daf_index_acquire(&spk_kind);
+
+  if (batch.index->incomplete) {
+    sr_daf_index_release(&spk_kind);
+    SR_NATIVE_EXIT("spk_batch", 1);
+    rb_raise(rb_spice_error, "some loaded SPK files are not in the native binary format, use the CSPICE based functions");
+  }
+
+  sr_parallel_run(count, thread_count, evaluate_range, &batch);
+
+  sr_daf_index_release(&spk_kind);
+
+  SR_NATIVE_EXIT("spk_batch", batch.failed_at >= 0);
+
+  if (batch.failed_at >= 0) {
+    rb_raise(rb_spice_error, "%s for body %d relative to %d at ET %.6f",
+             batch.status == SR_DAF_NO_DATA ? "insufficient ephemeris data" : "unsupported SPK segment type or frame",
+             batch.target, batch.observer, batch.epochs[batch.failed_at]);
+  }
+
+  RB_GC_GUARD(rb_epochs);
+
+  return rb_output;
+}
@@ -0,0 +1,16 @@
+#include "ruby.h"
+#include "SpiceUsr.h"
+#include <stdbool.h>
+#include <pthread.h>
+#include "spice_rub_utils.h"
+#include "nmatrix.h"
+#include "spice_buffer.h"
+#include "spice_daf_index.h"
+#include "spice_parallel.h"
+#include "spice_bodies.h"
+#include "spice_generation.h"
+#include "spice_stats.h"
+#include "spice_probes.h"
+
+extern VALUE rb_spice_error;
+
@@ -0,0 +1,274 @@
+#include "spice_stats.h"
+#include <time.h>
+
+extern VALUE rb_spice_error;
+
+/* Native call statistics.
+
+ Every module function registered through sr_define_native is recorded here with its C entry point and
+ arity. While statistics are disabled the functions are defined exactly as rb_define_module_function
+ would, so a disabled build pays nothing per call. Enabling redefines all of them on a single counting
+ trampoline that looks the function up by the ID of the called method, calls it under rb_protect and
+ records calls, SpiceError raises, wall time (total and a log2 histogram in nanoseconds), Ruby objects
+ allocated and malloc'd bytes. Disabling puts the direct definitions back.
+
+ Allocation counts come from rb_gc_stat, so they include objects allocated by other threads while a call
+ releases the GVL, and malloc'd bytes are approximate since the malloc counter restarts at every GC.
+ Counters are only touched with the GVL held.
+
+ USDT probes (extconf.rb --enable-usdt) do not change the definitions either: every native fires
+ native__entry and native__exit itself (SR_NATIVE_ENTRY), whether statistics are enabled or not.
+
+ Cache hit and miss counters of the native caches are kept separately and are always on, a lookup costs
+ one increment either way.
+*/
+
+#define SR_STATS_MAX_ARGS 15
+
+typedef struct {
+  const char * name;
+  VALUE module;
+  sr_native_fn function;
+  int argc;
+  unsigned long calls;
+  unsigned long errors;
+  uint64_t total_ns;
+  uint64_t objects;
+  uint64_t bytes;
+  unsigned long histogram[SR_STATS_BUCKETS];
+} native_stats;
+
+typedef struct {
+  native_stats * entry;
+  int argc;
+  VALUE * argv;
+  VALUE self;
+} native_call;
+
+static native_stats * natives = NULL;
+static long native_count = 0;
+static long native_capacity = 0;
+static st_table * by_method = NULL;   //method ID -> index into natives
+static bool enabled = false;
+
+static const char * CACHE_NAMES[SR_CACHE_COUNT] = {"bodies", "constants", "frame_chains", "spk_index"};
+static unsigned long cache_hits[SR_CACHE_COUNT];
+static unsigned long cache_misses[SR_CACHE_COUNT];
+
+static VALUE counted(int argc, VALUE * argv, VALUE self);
+
+static void define(native_stats * entry) {
+  if (enabled) rb_define_module_function(entry->module, entry->name, counted, -1);
+  else rb_define_module_function(entry->module, entry->name, entry->function, entry->argc);
+}
+
+void sr_define_native(VALUE module, const char * name, sr_native_fn function, int argc) {
+  native_stats * entry;
+
+  if (argc > SR_STATS_MAX_ARGS) rb_bug("%s takes more arguments than native statistics can forward", name);
+
+  if (native_count == native_capacity) {
+    native_capacity = native_capacity ? 2 * native_capacity : 128;
+    REALLOC_N(natives, native_stats, native_capacity);
+  }
+
+  if (!by_method) by_method = st_init_numtable();
+
+  entry = natives + native_count;
+  MEMZERO(entry, native_stats, 1);
+  entry->name = name;
+  entry->module = module;
+  entry->function = function;
+  entry->argc = argc;
+
+  st_insert(by_method, (st_data_t) rb_intern(name), (st_data_t) native_count);
+  native_count++;
+
+  define(entry);
+}
+
+/* Calls the C function of a native with the arguments unpacked for its arity */
+static VALUE invoke(VALUE data) {
+  native_call * call = (native_call *) data;
+  sr_native_fn function = call->entry->function;
+  VALUE self = call->self, * a = call->argv;
+
+  switch (call->entry->argc) {
+    case -1 : return ((VALUE (*)(int, VALUE *, VALUE)) function)(call->argc, a, self);
+    case 0  : return ((VALUE (*)(VALUE)) function)(self);
+    case 1  : return ((VALUE (*)(VALUE, VALUE)) function)(self, a[0]);
+    case 2  : return ((VALUE (*)(VALUE, VALUE, VALUE)) function)(self, a[0], a[1]);
+    case 3  : return ((VALUE (*)(VALUE, VALUE, VALUE, VALUE)) function)(self, a[0], a[1], a[2]);
+    case 4  : return ((VALUE (*)(VALUE, VALUE, VALUE, VALUE, VALUE)) function)(self, a[0], a[1], a[2], a[3]);
+    case 5  : return ((VALUE (*)(VALUE, VALUE, VALUE, VALUE, VALUE, VALUE)) function)(self, a[0], a[1], a[2], a[3], a[4]);
+    case 6  : return ((VALUE (*)(VALUE, VALUE, VALUE, VALUE, VALUE, VALUE, VALUE)) function)
+                (self, a[0], a[1], a[2], a[3], a[4], a[5]);
+    case 7  : return ((VALUE (*)(VALUE, VALUE, VALUE, VALUE, VALUE, VALUE, VALUE, VALUE)) function)
+                (self, a[0], a[1], a[2], a[3], a[4], a[5], a[6]);
+    case 8  : return ((VALUE (*)(VALUE, VALUE, VALUE, VALUE, VALUE, VALUE, VALUE, VALUE, VALUE)) function)
+                (self, a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7]);
+    case 9  : return ((VALUE (*)(VALUE, VALUE, VALUE, VALUE, VALUE, VALUE, VALUE, VALUE, VALUE, VALUE)) function)
+                (self, a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8]);
+    case 10 : return ((VALUE (*)(VALUE, VALUE, VALUE, VALUE, VALUE, VALUE, VALUE, VALUE, VALUE, VALUE, VALUE)) function)
+                (self, a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9]);
+    case 11 : return ((VALUE (*)(VALUE, VALUE, VALUE, VALUE, VALUE, VALUE, VALUE, VALUE, VALUE, VALUE, VALUE, VALUE)) function)
+                (self, a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9], a[10]);
+    case 12 : return ((VALUE (*)(VALUE, VALUE, VALUE, VALUE, VALUE, VALUE, VALUE, VALUE, VALUE, VALUE, VALUE, VALUE, VALUE)) function)
+                (self, a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9], a[10], a[11]);
+    case 13 : return ((VALUE (*)(VALUE, VALUE, VALUE, VALUE, VALUE, VALUE, VALUE, VALUE, VALUE, VALUE, VALUE, VALUE, VALUE, VALUE)) function)
+                (self, a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9], a[10], a[11], a[12]);
+    case 14 : return ((VALUE (*)(VALUE, VALUE, VALUE, VALUE, VALUE, VALUE, VALUE, VALUE, VALUE, VALUE, VALUE, VALUE, VALUE, VALUE, VALUE)) function)
+                (self, a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9], a[10], a[11], a[12], a[13]);
+    default : return ((VALUE (*)(VALUE, VALUE, VALUE, VALUE, VALUE, VALUE, VALUE, VALUE, VALUE, VALUE, VALUE, VALUE, VALUE, VALUE, VALUE, VALUE)) function)
+                (self, a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9], a[10], a[11], a[12], a[13], a[14]);
+  }
+}
+
+/* The registered native of the method being called, with its arity checked */
+static native_stats * called_native(int argc) {
+  st_data_t index;
+  native_stats * entry;
+
+  if (!st_lookup(by_method, (st_data_t) rb_frame_this_func(), &index))
+    rb_raise(rb_eNotImpError, "native function is not registered for statistics");
+
+  entry = natives + index;
+  if (entry->argc >= 0) rb_check_arity(argc, entry->argc, entry->argc);
+
+  return entry;
+}
+
+static uint64_t nanoseconds(void) {
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t) now.tv_sec * 1000000000ULL + (uint64_t) now.tv_nsec;
+}
+
+static int bucket_of(uint64_t elapsed) {
+  int bits = 0;
+
+  while (elapsed && bits < SR_STATS_BUCKETS - 1) {
+    elapsed >>= 1;
+    bits++;
+  }
+
+  return bits;
+}
+
+static VALUE counted(int argc, VALUE * argv, VALUE self) {
+  static VALUE objects_key = Qundef, bytes_key = Qundef;
+  native_call call;
+  native_stats * entry = called_native(argc);
+  size_t objects, bytes, bytes_after;
+  uint64_t started, elapsed;
+  VALUE result;
+  int state;
+
+  if (objects_key == Qundef) {
+    objects_key = ID2SYM(rb_intern("total_allocated_objects"));
+    bytes_key = ID2SYM(rb_intern("malloc_increase_bytes"));
+  }
+
+  call.entry = entry;
+  call.argc = argc;
+  call.argv = argv;
+  call.self = self;
+
+  objects = rb_gc_stat(objects_key);
+  bytes = rb_gc_stat(bytes_key);
+  started = nanoseconds();
+
+  result = rb_protect(invoke, (VALUE) &call, &state);
+
+  elapsed = nanoseconds() - started;
+  bytes_after = rb_gc_stat(bytes_key);
+
+  entry->calls++;
+  entry->total_ns += elapsed;
+  entry->histogram[bucket_of(elapsed)]++;
+  entry->objects += rb_gc_stat(objects_key) - objects;
+  if (bytes_after > bytes) entry->bytes += bytes_after - bytes;
+  if (state && rb_obj_is_kind_of(rb_errinfo(), rb_spice_error)) entry->errors++;
+
+  if (state) rb_jump_tag(state);
+
+  return result;
+}
+
+/* Switches counting on or off, returns whether it is on */
+VALUE sr_stats_enable(VALUE self, VALUE on) {
+  long index;
+
+  if (RTEST(on) == enabled) return enabled ? Qtrue : Qfalse;
+
+  enabled = RTEST(on);
+  for (index = 0; index < native_count; index++) define(natives + index);
+
+  return enabled ? Qtrue : Qfalse;
+}
+
+VALUE sr_stats_enabled(VALUE self) {
+  return enabled ? Qtrue : Qfalse;
+}
+
+/*
+ Returns {name => {calls:, errors:, total_ns:, objects:, bytes:, histogram:}} for every native called since
+ the last reset, histogram[b] counting the calls that took less than 2^b nanoseconds.
+*/
+VALUE sr_stats_snapshot(VALUE self) {
+  VALUE snapshot = rb_hash_new(), stats, histogram;
+  native_stats * entry;
+  long index;
+  int bucket;
+
+  for (index = 0; index < native_count; index++) {
+    entry = natives + index;
+    if (!entry->calls) continue;
+
+    histogram = rb_ary_new2(SR_STATS_BUCKETS);
+    for (bucket = 0; bucket < SR_STATS_BUCKETS; bucket++) rb_ary_push(histogram, ULONG2NUM(entry->histogram[bucket]));
+
+    stats = rb_hash_new();
+    rb_hash_aset(stats, ID2SYM(rb_intern("calls")), ULONG2NUM(entry->calls));
+    rb_hash_aset(stats, ID2SYM(rb_intern("errors")), ULONG2NUM(entry->errors));
+    rb_hash_aset(stats, ID2SYM(rb_intern("total_ns")), ULL2NUM(entry->total_ns));
+    rb_hash_aset(stats, ID2SYM(rb_intern("objects")), ULL2NUM(entry->objects));
+    rb_hash_aset(stats, ID2SYM(rb_intern("bytes")), ULL2NUM(entry->bytes));
+    rb_hash_aset(stats, ID2SYM(rb_intern("histogram")), histogram);
+
+    rb_hash_aset(snapshot, ID2SYM(rb_intern(entry->name)), stats);
+  }
+
+  return snapshot;
+}
+
+VALUE sr_stats_reset(VALUE self) {
+  long index;
+
+  for (index = 0; index < native_count; index++) {
+    natives[index].calls = natives[index].errors = 0;
+    natives[index].total_ns = natives[index].objects = natives[index].bytes = 0;
+    MEMZERO(natives[index].histogram, unsigned long, SR_STATS_BUCKETS);
+  }
+
+  return Qnil;
+}
+
+void sr_cache_count(int cache, bool hit) {
+  if (hit) cache_hits[cache]++;
+  else cache_misses[cache]++;
+}
+
+/* Returns {cache => [hits, misses]} since the extension was loaded */
+VALUE sr_cache_stats(VALUE self) {
+  VALUE stats = rb_hash_new();
+  int cache;
+
+  for (cache = 0; cache < SR_CACHE_COUNT; cache++) {
+    rb_hash_aset(stats, ID2SYM(rb_intern(CACHE_NAMES[cache])),
+                 rb_assoc_new(ULONG2NUM(cache_hits[cache]), ULONG2NUM(cache_misses[cache])));
+  }
+
+  return stats;
+}
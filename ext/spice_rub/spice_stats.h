@@ -0,0 +1,33 @@
+#include "ruby.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifndef SPICE_STATS_H
+#define SPICE_STATS_H
+
+//Latency histogram buckets, bucket b counts calls of less than 2^b nanoseconds, the last one the rest
+#define SR_STATS_BUCKETS 40
+
+//Native function signature as taken by rb_define_module_function
+typedef VALUE (* sr_native_fn)(ANYARGS);
+
+//Defines a module function whose calls are counted while statistics are enabled
+void sr_define_native(VALUE module, const char * name, sr_native_fn function, int argc);
+
+//Native caches whose hits and misses are counted, always on
+#define SR_CACHE_BODIES       0
+#define SR_CACHE_CONSTANTS    1
+#define SR_CACHE_FRAME_CHAINS 2
+#define SR_CACHE_SPK_INDEX    3
+#define SR_CACHE_COUNT        4
+
+void sr_cache_count(int cache, bool hit);
+
+//Entry points of the Ruby Stats API
+VALUE sr_stats_enable(VALUE self, VALUE enabled);
+VALUE sr_stats_enabled(VALUE self);
+VALUE sr_stats_snapshot(VALUE self);
+VALUE sr_stats_reset(VALUE self);
+VALUE sr_cache_stats(VALUE self);
+
+#endif
@@ -0,0 +1,284 @@
+#include "spice_tensor.h"
+
+/* Target x observer x epoch geometry.
+
+ spkezr_c derives both ends of every query from the solar system barycenter, so a grid of N targets and
+ M observers repeats the same SSB chains N x M times per epoch. Here every distinct body is evaluated
+ once per epoch with spkssb_c and geometric states are plain differences. With an aberration correction
+ spkaps_c runs the light time and stellar aberration corrections from the shared observer state, which is
+ what spkezr_c ends up doing internally once it has that state.
+
+ Snapshots (many targets, one observer, one or a few epochs) are the same computation laid out as epoch x
+ target tables.
+
+ Output frames other than inertial ones are handled like spkezr_c does: the frame is evaluated at the
+ epoch minus the light time to its center, and the rotation rate is scaled by the rate of that light time.
+*/
+
+//Half width of the central difference for observer accelerations, in seconds
+#define SR_TENSOR_TDELTA 1.0
+
+typedef struct {
+  long targets, observers, epochs, bodies;
+  //Result cell of a (target, observer, epoch) triple is the dot product with these
+  long target_stride, observer_stride, epoch_stride;
+  int columns;
+  SpiceInt center;
+  bool corrected, inertial;
+  const char * frame, * correction;
+  SpiceInt * codes;
+  long * target_slot, * observer_slot;
+  double * ssb, * acceleration;
+} tensor_query;
+
+SpiceInt sr_body_code(VALUE body) {
+  SpiceInt code;
+  const char * name;
+
+  if (RB_INTEGER_TYPE_P(body)) return NUM2INT(body);
+
+  name = RB_TYPE_P(body, T_SYMBOL) ? RB_SYM2STR(body) : StringValueCStr(body);
+
+  if (!sr_bodies_code(name, &code)) {
+    spice_error(SPICE_ERROR_SHORT);
+    rb_raise(rb_eArgError, "unknown body %s", name);
+  }
+
+  return code;
+}
+
+/* Maps bodies onto slots of the shared SSB state table, reusing the slot of a body seen before */
+static void assign_slots(tensor_query * query, VALUE bodies, long * slots) {
+  long index, body;
+  SpiceInt code;
+
+  for (index = 0; index < RARRAY_LEN(bodies); index++) {
+    code = sr_body_code(RARRAY_AREF(bodies, index));
+
+    for (body = 0; body < query->bodies && query->codes[body] != code; body++);
+    if (body == query->bodies) query->codes[query->bodies++] = code;
+
+    slots[index] = body;
+  }
+}
+
+static void frame_details(tensor_query * query) {
+  SpiceInt code, frame_class, class_id;
+  SpiceBoolean found;
+
+  namfrm_c(query->frame, &code);
+  if (!code) rb_raise(rb_eArgError, "unknown frame %s", query->frame);
+
+  frinfo_c(code, &query->center, &frame_class, &class_id, &found);
+  if (!found) rb_raise(rb_eArgError, "no frame information for %s", query->frame);
+
+  query->inertial = frame_class == 1;
+}
+
+/* Shared per epoch work: SSB states of every body, and observer accelerations for corrected velocities */
+static void barycentric_states(tensor_query * query, double et) {
+  double before[6], after[6];
+  long body, observer, slot;
+
+  for (body = 0; body < query->bodies; body++) spkssb_c(query->codes[body], et, "J2000", query->ssb + 6 * body);
+
+  if (!query->corrected || query->columns != 6) return;
+
+  for (observer = 0; observer < query->observers; observer++) {
+    slot = query->observer_slot[observer];
+
+    spkssb_c(query->codes[slot], et - SR_TENSOR_TDELTA, "J2000", before);
+    spkssb_c(query->codes[slot], et + SR_TENSOR_TDELTA, "J2000", after);
+
+    query->acceleration[3 * slot]     = (after[3] - before[3]) / (2 * SR_TENSOR_TDELTA);
+    query->acceleration[3 * slot + 1] = (after[4] - before[4]) / (2 * SR_TENSOR_TDELTA);
+    query->acceleration[3 * slot + 2] = (after[5] - before[5]) / (2 * SR_TENSOR_TDELTA);
+  }
+}
+
+/* State transformation from J2000 to the output frame as seen by an observer at et */
+static void observer_transform(tensor_query * query, long slot, double et, double xform[6][6]) {
+  double center[6], light_time = 0.0, rate = 0.0;
+  int row, column;
+
+  if (query->corrected && query->center != query->codes[slot]) {
+    spkaps_c(query->center, et, "J2000", query->correction, query->ssb + 6 * slot, query->acceleration + 3 * slot, center, &light_time, &rate);
+  }
+
+  sxform_c("J2000", query->frame, et - light_time, xform);
+
+  for (row = 3; row < 6; row++)
+    for (column = 0; column < 3; column++) xform[row][column] *= 1.0 - rate;
+}
+
+static void write_state(tensor_query * query, double * output, const double state[6], double xform[6][6]) {
+  double rotated[6];
+
+  if (xform) {
+    mxvg_c(xform, state, 6, 6, rotated);
+    memcpy(output, rotated, query->columns * sizeof(double));
+  }
+  else {
+    memcpy(output, state, query->columns * sizeof(double));
+  }
+}
+
+/* Slots every body of the query in one buffer, owned by Ruby so an exception leaks nothing */
+static void prepare(tensor_query * query, VALUE targets, VALUE observers, VALUE * buffer) {
+  long bodies = query->targets + query->observers;
+
+  query->ssb = ALLOCV(*buffer, bodies * (9 * sizeof(double) + sizeof(long) + sizeof(SpiceInt)));
+  query->acceleration = query->ssb + 6 * bodies;
+  query->target_slot = (long *) (query->acceleration + 3 * bodies);
+  query->observer_slot = query->target_slot + query->targets;
+  query->codes = (SpiceInt *) (query->observer_slot + query->observers);
+  memset(query->acceleration, 0, 3 * bodies * sizeof(double));
+
+  assign_slots(query, targets, query->target_slot);
+  assign_slots(query, observers, query->observer_slot);
+  frame_details(query);
+}
+
+/* Fills states and light times for every epoch, observer and target */
+static void evaluate(tensor_query * query, const double * epochs, double * states, double * light_times) {
+  double xform[6][6], rotation[6][6], state[6], light_time, rate;
+  bool rotate;
+  long epoch, target, observer, cell;
+
+  //Inertial frames do not depend on the epoch or the observer
+  rotate = !eqstr_c(query->frame, "J2000");
+  if (rotate && query->inertial) sxform_c("J2000", query->frame, 0.0, rotation);
+
+  for (epoch = 0; epoch < query->epochs && !failed_c(); epoch++) {
+    barycentric_states(query, epochs[epoch]);
+
+    for (observer = 0; observer < query->observers && !failed_c(); observer++) {
+      long observer_body = query->observer_slot[observer];
+      const double * observer_state = query->ssb + 6 * observer_body;
+
+      if (rotate && !query->inertial) observer_transform(query, observer_body, epochs[epoch], xform);
+      else if (rotate) memcpy(xform, rotation, sizeof(xform));
+
+      for (target = 0; target < query->targets; target++) {
+        long target_body = query->target_slot[target];
+
+        if (query->corrected) {
+          spkaps_c(query->codes[target_body], epochs[epoch], "J2000", query->correction, observer_state,
+                   query->acceleration + 3 * observer_body, state, &light_time, &rate);
+          if (failed_c()) break;
+        }
+        else {
+          vsubg_c(query->ssb + 6 * target_body, observer_state, 6, state);
+          light_time = vnorm_c(state) / clight_c();
+        }
+
+        cell = target * query->target_stride + observer * query->observer_stride + epoch * query->epoch_stride;
+        write_state(query, states + query->columns * cell, state, rotate ? xform : NULL);
+        light_times[cell] = light_time;
+      }
+    }
+  }
+}
+
+/* Fires spk__batch for a query, with the bodies' codes when it has a single target or observer */
+static void probe_query(const char * function, const tensor_query * query) {
+  SR_PROBE4(spk__batch, function,
+            query->targets == 1 ? query->codes[query->target_slot[0]] : -1,
+            query->observers == 1 ? query->codes[query->observer_slot[0]] : -1,
+            query->targets * query->observers * query->epochs);
+}
+
+static void start_query(tensor_query * query, VALUE ref, VALUE abcorr, VALUE columns) {
+  memset(query, 0, sizeof(tensor_query));
+  query->columns = NUM2INT(columns);
+  query->frame = RB_SYM2STR(ref);
+  query->correction = RB_SYM2STR(abcorr);
+  query->corrected = !eqstr_c(query->correction, "NONE");
+
+  if (query->columns != 3 && query->columns != 6) rb_raise(rb_eArgError, "columns must be 3 or 6");
+}
+
+/*
+ States of every target relative to every observer at every epoch. targets and observers are Arrays of
+ body names or NAIF codes, ets an Array or dense float64 NMatrix of epochs. Returns
+ [N x M x T x columns NMatrix, N x M x T light times], the former written into out when given.
+*/
+VALUE sr_spk_tensor(VALUE self, VALUE targets, VALUE observers, VALUE ets, VALUE ref, VALUE abcorr, VALUE columns, VALUE out) {
+  tensor_query query;
+  VALUE rb_epochs, rb_states, rb_light_times, buffer;
+  size_t shape[4];
+
+  Check_Type(targets, T_ARRAY);
+  Check_Type(observers, T_ARRAY);
+
+  start_query(&query, ref, abcorr, columns);
+  query.targets = RARRAY_LEN(targets);
+  query.observers = RARRAY_LEN(observers);
+
+  rb_epochs = sr_epochs_from(ets, &query.epochs);
+
+  shape[0] = query.targets; shape[1] = query.observers; shape[2] = query.epochs; shape[3] = query.columns;
+  rb_states = sr_dense_output_shape(out, shape, 4);
+  rb_light_times = sr_dense_alloc_shape(shape, 3);
+
+  query.epoch_stride = 1;
+  query.observer_stride = query.epochs;
+  query.target_stride = query.observers * query.epochs;
+
+  prepare(&query, targets, observers, &buffer);
+  probe_query("spk_tensor", &query);
+  SR_NATIVE_ENTRY("spk_tensor", 7, query.targets * query.observers * query.epochs);
+  evaluate(&query, sr_dense_elements(rb_epochs), sr_dense_elements(rb_states), sr_dense_elements(rb_light_times));
+  SR_NATIVE_EXIT("spk_tensor", failed_c());
+
+  ALLOCV_END(buffer);
+
+  if(spice_error(SPICE_ERROR_SHORT)) return Qnil;
+
+  RB_GC_GUARD(rb_epochs);
+
+  return rb_ary_new3(2, rb_states, rb_light_times);
+}
+
+/*
+ States of many targets seen from one observer at one epoch, or at each of a few epochs. ids is an Array
+ of NAIF codes or names. Returns a K x columns NMatrix for a single epoch given as a Float, and a
+ T x K x columns one for an Array or NMatrix of epochs, written into out when given. The observer state
+ and the frame rotation are computed once per epoch for all targets.
+*/
+VALUE sr_spk_snapshot(VALUE self, VALUE ids, VALUE observer, VALUE ets, VALUE ref, VALUE abcorr, VALUE columns, VALUE out) {
+  tensor_query query;
+  VALUE rb_epochs, rb_states, rb_light_times, buffer, observers = rb_ary_new3(1, observer);
+  size_t shape[3];
+  bool single = RB_FLOAT_TYPE_P(ets) || RB_INTEGER_TYPE_P(ets);
+
+  Check_Type(ids, T_ARRAY);
+
+  start_query(&query, ref, abcorr, columns);
+  query.targets = RARRAY_LEN(ids);
+  query.observers = 1;
+
+  rb_epochs = sr_epochs_from(single ? rb_ary_new3(1, ets) : ets, &query.epochs);
+
+  shape[0] = query.epochs; shape[1] = query.targets; shape[2] = query.columns;
+  rb_states = sr_dense_output_shape(out, single ? shape + 1 : shape, single ? 2 : 3);
+  rb_light_times = sr_dense_alloc_shape(shape, 2);
+
+  query.epoch_stride = query.targets;
+  query.target_stride = 1;
+
+  prepare(&query, ids, observers, &buffer);
+  probe_query("spk_snapshot", &query);
+  SR_NATIVE_ENTRY("spk_snapshot", 7, query.targets * query.epochs);
+  evaluate(&query, sr_dense_elements(rb_epochs), sr_dense_elements(rb_states), sr_dense_elements(rb_light_times));
+  SR_NATIVE_EXIT("spk_snapshot", failed_c());
+
+  ALLOCV_END(buffer);
+
+  if(spice_error(SPICE_ERROR_SHORT)) return Qnil;
+
+  RB_GC_GUARD(rb_epochs);
+  RB_GC_GUARD(observers);
+
+  return rb_ary_new3(2, rb_states, rb_light_times);
+}
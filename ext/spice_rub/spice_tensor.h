@@ -0,0 +1,11 @@
+#include "ruby.h"
+#include "SpiceUsr.h"
+#include <stdbool.h>
+#include "spice_rub_utils.h"
+#include "nmatrix.h"
+#include "spice_buffer.h"
+#include "spice_bodies.h"
+#include "spice_probes.h"
+
+//NAIF code of a body given as an Integer, Symbol or String
+SpiceInt sr_body_code(VALUE body);
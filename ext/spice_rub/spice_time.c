@@ -1,233 +1,315 @@
 #include "spice_time.h"
 
-VALUE sr_gfdist(VALUE self, VALUE target, VALUE abcorr, VALUE obsrvr, VALUE relate, VALUE refval, VALUE adjust, VALUE step, VALUE nintvls, VALUE confines) {
-  int count, interval_count;
-  double beginning, end, et0, et1;
+/* Geometry finder searches.
+
+ Every search goes through the GF entry points that take step, report and interrupt functions (gfevnt_c,
+ gfocce_c and gffove_c) with CSPICE's default step and refinement functions, which is what gfdist_c and the
+ other high level entry points do internally. Reporting and interrupts are switched on while the GF search
+ control is armed (spice_search.c), an interrupted search returns the intervals found until then. gfilum
+ and the user defined searches call entry points without those functions, they only mark the search as
+ running and complete for the control.
+
+ Result windows are sized from the nintvls asked for rather than fixed, and live in a buffer of the call.
+*/
+
+//Length of the quantity parameter names and values passed to gfevnt_c
+#define SR_GF_LNSIZE 81
+
+//Least room of a result window, in doubles
+#define SR_GF_RESULT_SIZE 5000
+
+typedef struct {
+  SpiceCell window, intervals;
+  VALUE buffer;
+} gf_windows;
+
+typedef struct {
+  const char * quantity;
+  SpiceInt count;
+  SpiceChar names[SPICE_GFEVNT_MAXPAR][SR_GF_LNSIZE], values[SPICE_GFEVNT_MAXPAR][SR_GF_LNSIZE];
+  SpiceDouble doubles[SPICE_GFEVNT_MAXPAR];
+} gf_quantity;
+
+//Probes around a GF search over [et0, et1], the end one reports the number of intervals found or -1
+#define GF_SEARCH_START(function, target, observer) \
+  do { if (SR_PROBE_ENABLED(gf__search__start)) SR_PROBE5(gf__search__start, function, target, observer, et0, et1); } while (0)
+#define GF_SEARCH_END(function) \
+  SR_PROBE2(gf__search__end, function, failed_c() ? -1 : (int) wncard_c(&windows.intervals))
+
+/* Result window as an Array of [start, end] pairs, nil when empty */
+static VALUE intervals_of(SpiceCell * intervals) {
+  int count, interval_count = wncard_c(intervals);
+  double beginning, end;
   VALUE result;
-  
-  SPICEDOUBLE_CELL(intervals, 5000);
-  SPICEDOUBLE_CELL(window, 5000);
-  
-  et0 = NUM2DBL(RARRAY_AREF(confines, 0));
-  et1 = NUM2DBL(RARRAY_AREF(confines,1));
-
-  wninsd_c(et0, et1, &window);
-  
-  gfdist_c( RB_SYM2STR(target), 
-            RB_SYM2STR(abcorr), 
-            RB_SYM2STR(obsrvr), 
-            RB_SYM2STR(relate), 
-            NUM2DBL(refval), 
-            NUM2DBL(adjust), 
-            NUM2DBL(step), 
-            FIX2INT(nintvls),
-            &window , 
-            &intervals );
-  
-  if (spice_error(SPICE_ERROR_SHORT)) return Qnil;
 
-  interval_count = wncard_c(&intervals);
-  
   if (interval_count == 0) return Qnil;
 
   result = rb_ary_new2(interval_count);
 
   for (count = 0; count < interval_count; count++) {
-    wnfetd_c(&intervals, count, &beginning, &end);
+    wnfetd_c(intervals, count, &beginning, &end);
     rb_ary_push(result, rb_ary_new3(2, DBL2NUM(beginning), DBL2NUM(end)));
   }
 
   return result;
 }
 
+static void double_cell(SpiceCell * cell, SpiceDouble * storage, long size) {
+  SpiceCell initial = { SPICE_DP, 0, size, 0, SPICETRUE, SPICEFALSE, SPICEFALSE, storage, storage + SPICE_CELL_CTRLSZ };
+
+  *cell = initial;
+}
+
+/*
+ Confinement window [et0, et1] and a result window with room for nintvls intervals, at least SR_GF_RESULT_SIZE
+ doubles. Both live in a temporary buffer of this call, unlike SPICEDOUBLE_CELL cells which are static.
+*/
+static void gf_windows_for(gf_windows * windows, VALUE confines, long nintvls, double * et0, double * et1) {
+  long room = 2 * nintvls > SR_GF_RESULT_SIZE ? 2 * nintvls : SR_GF_RESULT_SIZE;
+  SpiceDouble * storage = rb_alloc_tmp_buffer(&windows->buffer, (2 * SPICE_CELL_CTRLSZ + 2 + room) * sizeof(SpiceDouble));
+
+  double_cell(&windows->window, storage, 2);
+  double_cell(&windows->intervals, storage + SPICE_CELL_CTRLSZ + 2, room);
+
+  *et0 = NUM2DBL(RARRAY_AREF(confines, 0));
+  *et1 = NUM2DBL(RARRAY_AREF(confines, 1));
+
+  wninsd_c(*et0, *et1, &windows->window);
+}
+
+/* Intervals found like intervals_of, releasing the windows */
+static VALUE gf_windows_result(gf_windows * windows) {
+  VALUE result = intervals_of(&windows->intervals);
+
+  rb_free_tmp_buffer(&windows->buffer);
+
+  return result;
+}
+
+static void quantity_parameter(gf_quantity * quantity, const char * name, const char * value) {
+  strncpy(quantity->names[quantity->count], name, SR_GF_LNSIZE - 1);
+  strncpy(quantity->values[quantity->count], value, SR_GF_LNSIZE - 1);
+  quantity->count++;
+}
+
+/* gfevnt_c search of a scalar quantity, the way gfdist_c, gfsntc_c and gfsep_c run theirs */
+static void search_quantity(gf_quantity * quantity, const char * relate, double refval, double adjust, double step,
+                            int nintvls, SpiceCell * window, SpiceCell * intervals) {
+  SpiceInt integers[SPICE_GFEVNT_MAXPAR] = {0};
+  SpiceBoolean logicals[SPICE_GFEVNT_MAXPAR] = {0};
+
+  gfsstp_c(step);
+
+  sr_gf_begin();
+  gfevnt_c(gfstep_c, gfrefn_c, quantity->quantity, quantity->count, SR_GF_LNSIZE, quantity->names, quantity->values,
+           quantity->doubles, integers, logicals, relate, refval, SPICE_GF_CNVTOL, adjust,
+           sr_gf_armed(), sr_gf_report_init, sr_gf_report_update, sr_gf_report_final,
+           nintvls, sr_gf_armed(), sr_gf_bail, window, intervals);
+}
+
+VALUE sr_gfdist(VALUE self, VALUE target, VALUE abcorr, VALUE obsrvr, VALUE relate, VALUE refval, VALUE adjust, VALUE step, VALUE nintvls, VALUE confines) {
+  gf_quantity quantity;
+  double et0, et1;
+
+  gf_windows windows;
+
+  SR_NATIVE_ENTRY("gfdist", 9, 1);
+
+  gf_windows_for(&windows, confines, FIX2INT(nintvls), &et0, &et1);
+
+  memset(&quantity, 0, sizeof(quantity));
+  quantity.quantity = "DISTANCE";
+  quantity_parameter(&quantity, "TARGET", RB_SYM2STR(target));
+  quantity_parameter(&quantity, "OBSERVER", RB_SYM2STR(obsrvr));
+  quantity_parameter(&quantity, "ABCORR", RB_SYM2STR(abcorr));
+
+  GF_SEARCH_START("gfdist", RB_SYM2STR(target), RB_SYM2STR(obsrvr));
+
+  search_quantity(&quantity, RB_SYM2STR(relate), NUM2DBL(refval), NUM2DBL(adjust), NUM2DBL(step), FIX2INT(nintvls), &windows.window, &windows.intervals);
+
+  GF_SEARCH_END("gfdist");
+  sr_gf_end();
+
+  SR_NATIVE_EXIT("gfdist", failed_c());
+  if (spice_error(SPICE_ERROR_SHORT)) return Qnil;
+
+  return gf_windows_result(&windows);
+}
+
 VALUE sr_gfsntc(VALUE self, VALUE target, VALUE fixref, VALUE method, VALUE abcorr, VALUE obsrvr, VALUE dref, 
                     VALUE dvec, VALUE crdsys, VALUE coord, VALUE relate, VALUE refval, VALUE adjust, VALUE step, VALUE nintvls, VALUE confines) {
   
-  int count, interval_count;
-  double beginning, end, et0, et1;
-  VALUE result;
-  
-  SPICEDOUBLE_CELL(intervals, 5000);
-  SPICEDOUBLE_CELL(window, 5000);
-  
-  et0 = NUM2DBL(RARRAY_AREF(confines, 0));
-  et1 = NUM2DBL(RARRAY_AREF(confines,1));
+  gf_quantity quantity;
+  double et0, et1;
 
-  wninsd_c(et0, et1, &window);
-  
-  gfsntc_c( RB_SYM2STR(target), 
-            RB_SYM2STR(fixref),
-            RB_SYM2STR(method),
-            RB_SYM2STR(abcorr), 
-            RB_SYM2STR(obsrvr), 
-            RB_SYM2STR(dref),
-            NM_STORAGE_DENSE(dvec)->elements,
-            RB_SYM2STR(crdsys), 
-            RB_SYM2STR(coord),
-            RB_SYM2STR(relate), 
-            NUM2DBL(refval), 
-            NUM2DBL(adjust), 
-            NUM2DBL(step), 
-            FIX2INT(nintvls),
-            &window , 
-            &intervals );
-  
-  if (spice_error(SPICE_ERROR_SHORT)) return Qnil;
+  gf_windows windows;
 
-  interval_count = wncard_c(&intervals);
-  
-  if (interval_count == 0) return Qnil;
+  SR_NATIVE_ENTRY("gfsntc", 15, 1);
 
-  result = rb_ary_new2(interval_count);
+  gf_windows_for(&windows, confines, FIX2INT(nintvls), &et0, &et1);
 
-  for (count = 0; count < interval_count; count++) {
-    wnfetd_c(&intervals, count, &beginning, &end);
-    rb_ary_push(result, rb_ary_new3(2, DBL2NUM(beginning), DBL2NUM(end)));
-  }
+  memset(&quantity, 0, sizeof(quantity));
+  quantity.quantity = "COORDINATE";
+  quantity_parameter(&quantity, "TARGET", RB_SYM2STR(target));
+  quantity_parameter(&quantity, "OBSERVER", RB_SYM2STR(obsrvr));
+  quantity_parameter(&quantity, "ABCORR", RB_SYM2STR(abcorr));
+  quantity_parameter(&quantity, "COORDINATE SYSTEM", RB_SYM2STR(crdsys));
+  quantity_parameter(&quantity, "COORDINATE", RB_SYM2STR(coord));
+  quantity_parameter(&quantity, "REFERENCE FRAME", RB_SYM2STR(fixref));
+  quantity_parameter(&quantity, "VECTOR DEFINITION", "SURFACE INTERCEPT POINT");
+  quantity_parameter(&quantity, "METHOD", RB_SYM2STR(method));
+  quantity_parameter(&quantity, "DREF", RB_SYM2STR(dref));
+  quantity_parameter(&quantity, "DVEC", " ");
+  memcpy(quantity.doubles, sr_dense_buffer(dvec, 3), 3 * sizeof(double));
 
-  return result;
+  GF_SEARCH_START("gfsntc", RB_SYM2STR(target), RB_SYM2STR(obsrvr));
+
+  search_quantity(&quantity, RB_SYM2STR(relate), NUM2DBL(refval), NUM2DBL(adjust), NUM2DBL(step), FIX2INT(nintvls), &windows.window, &windows.intervals);
+
+  GF_SEARCH_END("gfsntc");
+  sr_gf_end();
+
+  SR_NATIVE_EXIT("gfsntc", failed_c());
+  if (spice_error(SPICE_ERROR_SHORT)) return Qnil;
+
+  return gf_windows_result(&windows);
 }
 
 VALUE sr_gfsep(VALUE self, VALUE target1, VALUE shape1, VALUE frame1, VALUE target2, VALUE shape2, VALUE frame2, 
                    VALUE abcorr, VALUE obsrvr, VALUE relate, VALUE refval, VALUE adjust, VALUE step, VALUE nintvls, VALUE confines) {
   
-  int count, interval_count;
-  double beginning, end, et0, et1;
-  VALUE result;
-  
-  SPICEDOUBLE_CELL(intervals, 5000);
-  SPICEDOUBLE_CELL(window, 5000);
-  
-  et0 = NUM2DBL(RARRAY_AREF(confines, 0));
-  et1 = NUM2DBL(RARRAY_AREF(confines,1));
+  gf_quantity quantity;
+  double et0, et1;
 
-  wninsd_c(et0, et1, &window);
-  
-  gfsep_c( RB_SYM2STR(target1),
-            RB_SYM2STR(shape1),
-            RB_SYM2STR(frame1),
-            RB_SYM2STR(target2),
-            RB_SYM2STR(shape2),
-            RB_SYM2STR(frame2), 
-            RB_SYM2STR(abcorr), 
-            RB_SYM2STR(obsrvr), 
-            RB_SYM2STR(relate), 
-            NUM2DBL(refval), 
-            NUM2DBL(adjust), 
-            NUM2DBL(step), 
-            FIX2INT(nintvls),
-            &window , 
-            &intervals );
-  
-  if (spice_error(SPICE_ERROR_SHORT)) return Qnil;
+  gf_windows windows;
 
-  interval_count = wncard_c(&intervals);
-  
-  if (interval_count == 0) return Qnil;
+  SR_NATIVE_ENTRY("gfsep", 14, 1);
 
-  result = rb_ary_new2(interval_count);
+  gf_windows_for(&windows, confines, FIX2INT(nintvls), &et0, &et1);
 
-  for (count = 0; count < interval_count; count++) {
-    wnfetd_c(&intervals, count, &beginning, &end);
-    rb_ary_push(result, rb_ary_new3(2, DBL2NUM(beginning), DBL2NUM(end)));
-  }
+  memset(&quantity, 0, sizeof(quantity));
+  quantity.quantity = "ANGULAR SEPARATION";
+  quantity_parameter(&quantity, "TARGET1", RB_SYM2STR(target1));
+  quantity_parameter(&quantity, "FRAME1", RB_SYM2STR(frame1));
+  quantity_parameter(&quantity, "SHAPE1", RB_SYM2STR(shape1));
+  quantity_parameter(&quantity, "TARGET2", RB_SYM2STR(target2));
+  quantity_parameter(&quantity, "FRAME2", RB_SYM2STR(frame2));
+  quantity_parameter(&quantity, "SHAPE2", RB_SYM2STR(shape2));
+  quantity_parameter(&quantity, "OBSERVER", RB_SYM2STR(obsrvr));
+  quantity_parameter(&quantity, "ABCORR", RB_SYM2STR(abcorr));
 
-  return result;
+  GF_SEARCH_START("gfsep", RB_SYM2STR(target1), RB_SYM2STR(obsrvr));
+
+  search_quantity(&quantity, RB_SYM2STR(relate), NUM2DBL(refval), NUM2DBL(adjust), NUM2DBL(step), FIX2INT(nintvls), &windows.window, &windows.intervals);
+
+  GF_SEARCH_END("gfsep");
+  sr_gf_end();
+
+  SR_NATIVE_EXIT("gfsep", failed_c());
+  if (spice_error(SPICE_ERROR_SHORT)) return Qnil;
+
+  return gf_windows_result(&windows);
 }
 
 VALUE sr_gftfov(VALUE self, VALUE inst, VALUE target, VALUE tshape, VALUE tframe, VALUE abcorr, VALUE obsrvr, VALUE step, VALUE confines) {
-  int count, interval_count;
-  double beginning, end, et0, et1;
-  VALUE result;
-  
-  SPICEDOUBLE_CELL(intervals, 5000);
-  SPICEDOUBLE_CELL(window, 5000);
+  SpiceDouble raydir[3] = {0.0, 0.0, 0.0};
+  double et0, et1;
   
-  et0 = NUM2DBL(RARRAY_AREF(confines, 0));
-  et1 = NUM2DBL(RARRAY_AREF(confines,1));
+  gf_windows windows;
 
-  wninsd_c(et0, et1, &window);
+  SR_NATIVE_ENTRY("gftfov", 8, 1);
   
-  gftfov_c( RB_SYM2STR(inst), 
-            RB_SYM2STR(target), 
+  gf_windows_for(&windows, confines, 0, &et0, &et1);
+  gfsstp_c(NUM2DBL(step));
+
+  GF_SEARCH_START("gftfov", RB_SYM2STR(target), RB_SYM2STR(obsrvr));
+
+  sr_gf_begin();
+  gffove_c( RB_SYM2STR(inst), 
             RB_SYM2STR(tshape), 
+            raydir,
+            RB_SYM2STR(target), 
             RB_SYM2STR(tframe),
             RB_SYM2STR(abcorr),
             RB_SYM2STR(obsrvr), 
-            NUM2DBL(step), 
-            &window , 
-            &intervals );
-  
+            SPICE_GF_CNVTOL,
+            gfstep_c,
+            gfrefn_c,
+            sr_gf_armed(),
+            sr_gf_report_init,
+            sr_gf_report_update,
+            sr_gf_report_final,
+            sr_gf_armed(),
+            sr_gf_bail,
+            &windows.window, 
+            &windows.intervals);
+  
+  GF_SEARCH_END("gftfov");
+  sr_gf_end();
+
+  SR_NATIVE_EXIT("gftfov", failed_c());
   if (spice_error(SPICE_ERROR_SHORT)) return Qnil;
 
-  interval_count = wncard_c(&intervals);
-  
-  if (interval_count == 0) return Qnil;
-
-  result = rb_ary_new2(interval_count);
-
-  for (count = 0; count < interval_count; count++) {
-    wnfetd_c(&intervals, count, &beginning, &end);
-    rb_ary_push(result, rb_ary_new3(2, DBL2NUM(beginning), DBL2NUM(end)));
-  }
-
-  return result;
+  return gf_windows_result(&windows);
 }
 
 VALUE sr_gfrfov(VALUE self, VALUE inst, VALUE raydir, VALUE rframe, VALUE abcorr, VALUE obsrvr, VALUE step, VALUE confines) {
-  int count, interval_count;
-  double beginning, end, et0, et1;
-  VALUE result;
+  double et0, et1, * direction = sr_dense_buffer(raydir, 3);
   
-  SPICEDOUBLE_CELL(intervals, 5000);
-  SPICEDOUBLE_CELL(window, 5000);
-  
-  et0 = NUM2DBL(RARRAY_AREF(confines, 0));
-  et1 = NUM2DBL(RARRAY_AREF(confines,1));
+  gf_windows windows;
 
-  wninsd_c(et0, et1, &window);
+  SR_NATIVE_ENTRY("gfrfov", 7, 1);
   
-  gfrfov_c( RB_SYM2STR(inst), 
-            NM_STORAGE_DENSE(raydir)->elements, 
+  gf_windows_for(&windows, confines, 0, &et0, &et1);
+  gfsstp_c(NUM2DBL(step));
+
+  GF_SEARCH_START("gfrfov", RB_SYM2STR(inst), RB_SYM2STR(obsrvr));
+
+  sr_gf_begin();
+  gffove_c( RB_SYM2STR(inst), 
+            "RAY",
+            direction, 
+            " ",
             RB_SYM2STR(rframe), 
             RB_SYM2STR(abcorr),
             RB_SYM2STR(obsrvr), 
-            NUM2DBL(step), 
-            &window , 
-            &intervals );
-  
+            SPICE_GF_CNVTOL,
+            gfstep_c,
+            gfrefn_c,
+            sr_gf_armed(),
+            sr_gf_report_init,
+            sr_gf_report_update,
+            sr_gf_report_final,
+            sr_gf_armed(),
+            sr_gf_bail,
+            &windows.window, 
+            &windows.intervals);
+  
+  GF_SEARCH_END("gfrfov");
+  sr_gf_end();
+
+  SR_NATIVE_EXIT("gfrfov", failed_c());
   if (spice_error(SPICE_ERROR_SHORT)) return Qnil;
 
-  interval_count = wncard_c(&intervals);
-  
-  if (interval_count == 0) return Qnil;
-
-  result = rb_ary_new2(interval_count);
-
-  for (count = 0; count < interval_count; count++) {
-    wnfetd_c(&intervals, count, &beginning, &end);
-    rb_ary_push(result, rb_ary_new3(2, DBL2NUM(beginning), DBL2NUM(end)));
-  }
-
-  return result;
+  return gf_windows_result(&windows);
 }
 
 VALUE sr_gfoclt(VALUE self, VALUE occtyp, VALUE front, VALUE fshape, VALUE fframe, VALUE back, VALUE bshape, VALUE bframe, 
                     VALUE abcorr, VALUE obsrvr, VALUE step, VALUE confines) {
   
-  int count, interval_count;
-  double beginning, end, et0, et1;
-  VALUE result;
-  
-  SPICEDOUBLE_CELL(intervals, 5000);
-  SPICEDOUBLE_CELL(window, 5000);
+  double et0, et1;
   
-  et0 = NUM2DBL(RARRAY_AREF(confines, 0));
-  et1 = NUM2DBL(RARRAY_AREF(confines,1));
+  gf_windows windows;
 
-  wninsd_c(et0, et1, &window);
+  SR_NATIVE_ENTRY("gfoclt", 11, 1);
   
-  gfoclt_c( RB_SYM2STR(occtyp),
+  gf_windows_for(&windows, confines, 0, &et0, &et1);
+  gfsstp_c(NUM2DBL(step));
+
+  GF_SEARCH_START("gfoclt", RB_SYM2STR(front), RB_SYM2STR(obsrvr));
+
+  sr_gf_begin();
+  gfocce_c( RB_SYM2STR(occtyp),
             RB_SYM2STR(front), 
             RB_SYM2STR(fshape),
             RB_SYM2STR(fframe),
@@ -236,23 +318,286 @@ VALUE sr_gfoclt(VALUE self, VALUE occtyp, VALUE front, VALUE fshape, VALUE ffram
             RB_SYM2STR(bframe),
             RB_SYM2STR(abcorr),
             RB_SYM2STR(obsrvr), 
-            NUM2DBL(step), 
-            &window , 
-            &intervals );
-  
+            SPICE_GF_CNVTOL,
+            gfstep_c,
+            gfrefn_c,
+            sr_gf_armed(),
+            sr_gf_report_init,
+            sr_gf_report_update,
+            sr_gf_report_final,
+            sr_gf_armed(),
+            sr_gf_bail,
+            &windows.window, 
+            &windows.intervals);
+  
+  GF_SEARCH_END("gfoclt");
+  sr_gf_end();
+
+  SR_NATIVE_EXIT("gfoclt", failed_c());
   if (spice_error(SPICE_ERROR_SHORT)) return Qnil;
 
-  interval_count = wncard_c(&intervals);
-  
-  if (interval_count == 0) return Qnil;
+  return gf_windows_result(&windows);
+}
 
-  result = rb_ary_new2(interval_count);
+/* Observer-target position coordinate search, gfposc_c's quantity run through gfevnt_c like gfsntc */
+VALUE sr_gfposc(VALUE self, VALUE target, VALUE frame, VALUE abcorr, VALUE obsrvr, VALUE crdsys, VALUE coord,
+                    VALUE relate, VALUE refval, VALUE adjust, VALUE step, VALUE nintvls, VALUE confines) {
 
-  for (count = 0; count < interval_count; count++) {
-    wnfetd_c(&intervals, count, &beginning, &end);
-    rb_ary_push(result, rb_ary_new3(2, DBL2NUM(beginning), DBL2NUM(end)));
+  gf_quantity quantity;
+  double et0, et1;
+
+  gf_windows windows;
+
+  SR_NATIVE_ENTRY("gfposc", 12, 1);
+
+  gf_windows_for(&windows, confines, FIX2INT(nintvls), &et0, &et1);
+
+  memset(&quantity, 0, sizeof(quantity));
+  quantity.quantity = "COORDINATE";
+  quantity_parameter(&quantity, "TARGET", RB_SYM2STR(target));
+  quantity_parameter(&quantity, "OBSERVER", RB_SYM2STR(obsrvr));
+  quantity_parameter(&quantity, "ABCORR", RB_SYM2STR(abcorr));
+  quantity_parameter(&quantity, "COORDINATE SYSTEM", RB_SYM2STR(crdsys));
+  quantity_parameter(&quantity, "COORDINATE", RB_SYM2STR(coord));
+  quantity_parameter(&quantity, "REFERENCE FRAME", RB_SYM2STR(frame));
+  quantity_parameter(&quantity, "VECTOR DEFINITION", "POSITION");
+  quantity_parameter(&quantity, "METHOD", " ");
+  quantity_parameter(&quantity, "DREF", " ");
+  quantity_parameter(&quantity, "DVEC", " ");
+
+  GF_SEARCH_START("gfposc", RB_SYM2STR(target), RB_SYM2STR(obsrvr));
+
+  search_quantity(&quantity, RB_SYM2STR(relate), NUM2DBL(refval), NUM2DBL(adjust), NUM2DBL(step), FIX2INT(nintvls), &windows.window, &windows.intervals);
+
+  GF_SEARCH_END("gfposc");
+  sr_gf_end();
+
+  SR_NATIVE_EXIT("gfposc", failed_c());
+  if (spice_error(SPICE_ERROR_SHORT)) return Qnil;
+
+  return gf_windows_result(&windows);
+}
+
+/* Illumination angle search, gfilum_c takes no report or interrupt functions */
+VALUE sr_gfilum(VALUE self, VALUE method, VALUE angtyp, VALUE target, VALUE illum, VALUE fixref, VALUE abcorr, VALUE obsrvr,
+                    VALUE spoint, VALUE relate, VALUE refval, VALUE adjust, VALUE step, VALUE nintvls, VALUE confines) {
+
+  double et0, et1, * point = sr_dense_buffer(spoint, 3);
+  double reference = NUM2DBL(refval), adjustment = NUM2DBL(adjust), step_size = NUM2DBL(step);
+
+  gf_windows windows;
+
+  SR_NATIVE_ENTRY("gfilum", 14, 1);
+
+  gf_windows_for(&windows, confines, FIX2INT(nintvls), &et0, &et1);
+
+  GF_SEARCH_START("gfilum", RB_SYM2STR(target), RB_SYM2STR(obsrvr));
+
+  sr_gf_begin();
+  gfilum_c(RB_SYM2STR(method), RB_SYM2STR(angtyp), RB_SYM2STR(target), RB_SYM2STR(illum), RB_SYM2STR(fixref),
+           RB_SYM2STR(abcorr), RB_SYM2STR(obsrvr), point, RB_SYM2STR(relate), reference, adjustment,
+           step_size, FIX2INT(nintvls), &windows.window, &windows.intervals);
+
+  GF_SEARCH_END("gfilum");
+  sr_gf_end();
+
+  SR_NATIVE_EXIT("gfilum", failed_c());
+  if (spice_error(SPICE_ERROR_SHORT)) return Qnil;
+
+  return gf_windows_result(&windows);
+}
+
+/* Phase angle search, gfpa_c's quantity run through gfevnt_c */
+VALUE sr_gfpa(VALUE self, VALUE target, VALUE illum, VALUE abcorr, VALUE obsrvr, VALUE relate, VALUE refval, VALUE adjust,
+                  VALUE step, VALUE nintvls, VALUE confines) {
+
+  gf_quantity quantity;
+  double et0, et1;
+
+  gf_windows windows;
+
+  SR_NATIVE_ENTRY("gfpa", 10, 1);
+
+  gf_windows_for(&windows, confines, FIX2INT(nintvls), &et0, &et1);
+
+  memset(&quantity, 0, sizeof(quantity));
+  quantity.quantity = "PHASE ANGLE";
+  quantity_parameter(&quantity, "TARGET", RB_SYM2STR(target));
+  quantity_parameter(&quantity, "OBSERVER", RB_SYM2STR(obsrvr));
+  quantity_parameter(&quantity, "ILLUM", RB_SYM2STR(illum));
+  quantity_parameter(&quantity, "ABCORR", RB_SYM2STR(abcorr));
+
+  GF_SEARCH_START("gfpa", RB_SYM2STR(target), RB_SYM2STR(obsrvr));
+
+  search_quantity(&quantity, RB_SYM2STR(relate), NUM2DBL(refval), NUM2DBL(adjust), NUM2DBL(step), FIX2INT(nintvls), &windows.window, &windows.intervals);
+
+  GF_SEARCH_END("gfpa");
+  sr_gf_end();
+
+  SR_NATIVE_EXIT("gfpa", failed_c());
+  if (spice_error(SPICE_ERROR_SHORT)) return Qnil;
+
+  return gf_windows_result(&windows);
+}
+
+/* Range rate search, gfrr_c's quantity run through gfevnt_c */
+VALUE sr_gfrr(VALUE self, VALUE target, VALUE abcorr, VALUE obsrvr, VALUE relate, VALUE refval, VALUE adjust,
+                  VALUE step, VALUE nintvls, VALUE confines) {
+
+  gf_quantity quantity;
+  double et0, et1;
+
+  gf_windows windows;
+
+  SR_NATIVE_ENTRY("gfrr", 9, 1);
+
+  gf_windows_for(&windows, confines, FIX2INT(nintvls), &et0, &et1);
+
+  memset(&quantity, 0, sizeof(quantity));
+  quantity.quantity = "RANGE RATE";
+  quantity_parameter(&quantity, "TARGET", RB_SYM2STR(target));
+  quantity_parameter(&quantity, "OBSERVER", RB_SYM2STR(obsrvr));
+  quantity_parameter(&quantity, "ABCORR", RB_SYM2STR(abcorr));
+
+  GF_SEARCH_START("gfrr", RB_SYM2STR(target), RB_SYM2STR(obsrvr));
+
+  search_quantity(&quantity, RB_SYM2STR(relate), NUM2DBL(refval), NUM2DBL(adjust), NUM2DBL(step), FIX2INT(nintvls), &windows.window, &windows.intervals);
+
+  GF_SEARCH_END("gfrr");
+  sr_gf_end();
+
+  SR_NATIVE_EXIT("gfrr", failed_c());
+  if (spice_error(SPICE_ERROR_SHORT)) return Qnil;
+
+  return gf_windows_result(&windows);
+}
+
+/*
+ gfuds_c search of a compiled quantity expression (spice_quantity.c), with the relational conditions of
+ gfdist. The quantity is evaluated natively at every step, its derivative numerically.
+*/
+VALUE sr_gfuds(VALUE self, VALUE expression, VALUE relate, VALUE refval, VALUE adjust, VALUE step, VALUE nintvls, VALUE confines) {
+  sr_quantity quantity;
+  double et0, et1, reference = NUM2DBL(refval), adjustment = NUM2DBL(adjust), step_size = NUM2DBL(step);
+  int intervals_wanted = FIX2INT(nintvls);
+
+  gf_windows windows;
+
+  SR_NATIVE_ENTRY("gfuds", 7, 1);
+
+  gf_windows_for(&windows, confines, intervals_wanted, &et0, &et1);
+  sr_quantity_compile(&quantity, expression);
+  sr_quantity_use(&quantity);
+
+  GF_SEARCH_START("gfuds", "", "");
+
+  sr_gf_begin();
+  gfuds_c(sr_quantity_value, sr_quantity_decreasing, RB_SYM2STR(relate), reference, adjustment, step_size, intervals_wanted, &windows.window, &windows.intervals);
+
+  GF_SEARCH_END("gfuds");
+  sr_gf_end();
+
+  SR_NATIVE_EXIT("gfuds", failed_c());
+  if (spice_error(SPICE_ERROR_SHORT)) return Qnil;
+
+  return gf_windows_result(&windows);
+}
+
+/* gfudb_c search of the times a compiled condition (an expression of :lt, :gt, :and, :or, :not) holds */
+VALUE sr_gfudb(VALUE self, VALUE expression, VALUE step, VALUE confines) {
+  sr_quantity quantity;
+  double et0, et1, step_size = NUM2DBL(step);
+
+  gf_windows windows;
+
+  SR_NATIVE_ENTRY("gfudb", 3, 1);
+
+  gf_windows_for(&windows, confines, 0, &et0, &et1);
+  sr_quantity_compile(&quantity, expression);
+  sr_quantity_use(&quantity);
+
+  GF_SEARCH_START("gfudb", "", "");
+
+  sr_gf_begin();
+  gfudb_c(sr_quantity_value, sr_quantity_condition, step_size, &windows.window, &windows.intervals);
+
+  GF_SEARCH_END("gfudb");
+  sr_gf_end();
+
+  SR_NATIVE_EXIT("gfudb", failed_c());
+  if (spice_error(SPICE_ERROR_SHORT)) return Qnil;
+
+  return gf_windows_result(&windows);
+}
+
+//Values memoized per epoch by gfuds_batch
+#define SR_GF_MEMO_SIZE 65536
+
+/*
+ gfuds_c searches of one compiled quantity against several [relate, refval] thresholds, returning an Array
+ of their intervals in the order given. The searches step over the same epochs, so the quantity's values
+ are memoized across them and each later threshold mostly costs the refinement steps near its own events.
+*/
+VALUE sr_gfuds_batch(VALUE self, VALUE expression, VALUE thresholds, VALUE adjust, VALUE step, VALUE nintvls, VALUE confines) {
+  sr_quantity quantity;
+  double et0, et1, adjustment = NUM2DBL(adjust), step_size = NUM2DBL(step);
+  int intervals_wanted = FIX2INT(nintvls);
+  long threshold, count;
+  const char ** relates;
+  double * refvals;
+  VALUE memo, relate_buffer, refval_buffer, result;
+
+  gf_windows windows;
+
+  Check_Type(thresholds, T_ARRAY);
+  count = RARRAY_LEN(thresholds);
+
+  SR_NATIVE_ENTRY("gfuds_batch", 6, count);
+
+  //Everything that can raise does before the first search, which must not be left running
+  relates = rb_alloc_tmp_buffer(&relate_buffer, (count ? count : 1) * sizeof(const char *));
+  refvals = rb_alloc_tmp_buffer(&refval_buffer, (count ? count : 1) * sizeof(double));
+
+  for (threshold = 0; threshold < count; threshold++) {
+    VALUE pair = RARRAY_AREF(thresholds, threshold);
+
+    if (!RB_TYPE_P(pair, T_ARRAY) || RARRAY_LEN(pair) != 2 || !RB_TYPE_P(RARRAY_AREF(pair, 0), T_SYMBOL)) {
+      rb_raise(rb_eArgError, "thresholds are [relate, refval] pairs");
+    }
+
+    relates[threshold] = RB_SYM2STR(RARRAY_AREF(pair, 0));
+    refvals[threshold] = NUM2DBL(RARRAY_AREF(pair, 1));
+  }
+
+  sr_quantity_compile(&quantity, expression);
+  sr_quantity_memoize(&quantity, rb_alloc_tmp_buffer(&memo, 2 * SR_GF_MEMO_SIZE * sizeof(double)), SR_GF_MEMO_SIZE);
+  sr_quantity_use(&quantity);
+
+  result = rb_ary_new_capa(count);
+
+  for (threshold = 0; threshold < count; threshold++) {
+    gf_windows_for(&windows, confines, intervals_wanted, &et0, &et1);
+
+    GF_SEARCH_START("gfuds", "", "");
+
+    sr_gf_begin();
+    gfuds_c(sr_quantity_value, sr_quantity_decreasing, relates[threshold], refvals[threshold], adjustment, step_size,
+            intervals_wanted, &windows.window, &windows.intervals);
+
+    GF_SEARCH_END("gfuds");
+    sr_gf_end();
+
+    if (failed_c()) SR_NATIVE_EXIT("gfuds_batch", 1);
+    if (spice_error(SPICE_ERROR_SHORT)) return Qnil;
+
+    rb_ary_push(result, gf_windows_result(&windows));
   }
 
+  rb_free_tmp_buffer(&memo);
+  rb_free_tmp_buffer(&relate_buffer);
+  rb_free_tmp_buffer(&refval_buffer);
+
+  SR_NATIVE_EXIT("gfuds_batch", 0);
   return result;
 }
 
@@ -264,18 +609,24 @@ VALUE sr_timout(VALUE self, VALUE et, VALUE pictur, VALUE lenout) {
   VALUE result;
   char * output = ALLOC_N(char, FIX2INT(lenout));
 
+  SR_NATIVE_ENTRY("timout", 3, 1);
+
   timout_c(NUM2DBL(et), StringValuePtr(pictur), FIX2INT(lenout), output);
   result = rb_str_new2(output); 
   xfree(output);
 
+  SR_NATIVE_EXIT("timout", 0);
   return result;
 }
 
 VALUE sr_str2et(VALUE self, VALUE epoch) {
   double ephemeris_time;
 
+  SR_NATIVE_ENTRY("str2et", 1, 1);
+
   str2et_c(StringValuePtr(epoch), &ephemeris_time);
   
+  SR_NATIVE_EXIT("str2et", failed_c());
   if(spice_error(SPICE_ERROR_SHORT)) return Qnil;
   
   return DBL2NUM(ephemeris_time);
@@ -284,8 +635,11 @@ VALUE sr_str2et(VALUE self, VALUE epoch) {
 VALUE sr_sce2c(VALUE self, VALUE sc, VALUE epoch) {
   double result;
 
+  SR_NATIVE_ENTRY("sce2c", 2, 1);
+
   sce2c_c(FIX2INT(sc), NUM2DBL(epoch), &result);
   
+  SR_NATIVE_EXIT("sce2c", failed_c());
   if(spice_error(SPICE_ERROR_SHORT)) return Qnil;
   
   return DBL2NUM(result);
@@ -294,8 +648,11 @@ VALUE sr_sce2c(VALUE self, VALUE sc, VALUE epoch) {
 VALUE sr_sctiks(VALUE self, VALUE sc, VALUE clkstr) {
   double result;
 
+  SR_NATIVE_ENTRY("sctiks", 2, 1);
+
   sctiks_c(FIX2INT(sc), StringValuePtr(clkstr), &result);
   
+  SR_NATIVE_EXIT("sctiks", failed_c());
   if(spice_error(SPICE_ERROR_SHORT)) return Qnil;
   
   return DBL2NUM(result);
@@ -304,8 +661,11 @@ VALUE sr_sctiks(VALUE self, VALUE sc, VALUE clkstr) {
 VALUE sr_scencd(VALUE self, VALUE sc, VALUE sclkch) {
   double result;
 
+  SR_NATIVE_ENTRY("scencd", 2, 1);
+
   scencd_c(FIX2INT(sc), StringValuePtr(sclkch), &result);
   
+  SR_NATIVE_EXIT("scencd", failed_c());
   if(spice_error(SPICE_ERROR_SHORT)) return Qnil;
   
   return DBL2NUM(result);
@@ -314,8 +674,11 @@ VALUE sr_scencd(VALUE self, VALUE sc, VALUE sclkch) {
 VALUE sr_scs2e(VALUE self, VALUE sc, VALUE sclkch) {
   double result;
 
+  SR_NATIVE_ENTRY("scs2e", 2, 1);
+
   scs2e_c(FIX2INT(sc), StringValuePtr(sclkch), &result);
   
+  SR_NATIVE_EXIT("scs2e", failed_c());
   if(spice_error(SPICE_ERROR_SHORT)) return Qnil;
   
   return DBL2NUM(result);
@@ -325,8 +688,11 @@ VALUE sr_scdecd(VALUE self, VALUE sc, VALUE sclkdp, VALUE lenout) {
   char * output = ALLOC_N(char, FIX2INT(lenout));
   VALUE result;
 
+  SR_NATIVE_ENTRY("scdecd", 3, 1);
+
   scdecd_c(FIX2INT(sc), NUM2DBL(sclkdp), FIX2INT(lenout), output);
   
+  SR_NATIVE_EXIT("scdecd", failed_c());
   if(spice_error(SPICE_ERROR_SHORT)) return Qnil;
 
   result = rb_str_new2(output); 
@@ -338,42 +704,66 @@ VALUE sr_scdecd(VALUE self, VALUE sc, VALUE sclkdp, VALUE lenout) {
 VALUE sr_sct2e(VALUE self, VALUE sc, VALUE sclkdp) {
   double output;
 
+  SR_NATIVE_ENTRY("sct2e", 2, 1);
+
   sct2e_c(FIX2INT(sc), NUM2DBL(sclkdp), &output);
   
+  SR_NATIVE_EXIT("sct2e", failed_c());
   if(spice_error(SPICE_ERROR_SHORT)) return Qnil;
 
   return DBL2NUM(output);
 }
 
 VALUE sr_j1900(VALUE self) {
+  SR_NATIVE_ENTRY("j1900", 0, 1);
+
+  SR_NATIVE_EXIT("j1900", 0);
   return DBL2NUM(j1900_c());
 }
 
 VALUE sr_j1950(VALUE self) {
+  SR_NATIVE_ENTRY("j1950", 0, 1);
+
+  SR_NATIVE_EXIT("j1950", 0);
   return DBL2NUM(j1950_c());
 }
 
 VALUE sr_j2000(VALUE self) {
+  SR_NATIVE_ENTRY("j2000", 0, 1);
+
+  SR_NATIVE_EXIT("j2000", 0);
   return DBL2NUM(j2000_c());
 }
 
 VALUE sr_j2100(VALUE self) {
+  SR_NATIVE_ENTRY("j2100", 0, 1);
+
+  SR_NATIVE_EXIT("j2100", 0);
   return DBL2NUM(j2100_c());
 }
 
 VALUE sr_b1900(VALUE self) {
+  SR_NATIVE_ENTRY("b1900", 0, 1);
+
+  SR_NATIVE_EXIT("b1900", 0);
   return DBL2NUM(b1900_c());
 }
 
 VALUE sr_b1950(VALUE self) {
+  SR_NATIVE_ENTRY("b1950", 0, 1);
+
+  SR_NATIVE_EXIT("b1950", 0);
   return DBL2NUM(b1950_c());
 }
 
 VALUE sr_deltet(VALUE self, VALUE epoch, VALUE eptype) {
   double delta;
+
+  SR_NATIVE_ENTRY("deltet", 2, 1);
   
   deltet_c(NUM2DBL(epoch), RB_SYM2STR(eptype), &delta);
 
+  SR_NATIVE_EXIT("deltet", failed_c());
   if(spice_error(SPICE_ERROR_SHORT)) return Qnil;
   
   return DBL2NUM(delta);
@@ -381,9 +771,12 @@ VALUE sr_deltet(VALUE self, VALUE epoch, VALUE eptype) {
 
 VALUE sr_unitim(VALUE self, VALUE epoch, VALUE insystem, VALUE outsystem) {
   double output;
+
+  SR_NATIVE_ENTRY("unitim", 3, 1);
   
   output = unitim_c(NUM2DBL(epoch), RB_SYM2STR(insystem), RB_SYM2STR(outsystem));
 
+  SR_NATIVE_EXIT("unitim", failed_c());
   if(spice_error(SPICE_ERROR_SHORT)) return Qnil;
   
   return DBL2NUM(output);
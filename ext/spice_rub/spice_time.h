@@ -2,4 +2,8 @@
 #include "SpiceUsr.h"
 #include <stdbool.h>
 #include "spice_rub_utils.h"
-#include "nmatrix.h"
\ No newline at end of file
+#include "nmatrix.h"
+#include "spice_buffer.h"
+#include "spice_probes.h"
+#include "spice_search.h"
+#include "spice_quantity.h"
@@ -40,11 +40,37 @@ module SpiceRub
       @frame = frame
     end
     
+    #
+    # call-seq:
+    #     Body[name_or_code] -> Body
+    #
+    # Returns a frozen Body shared by everyone asking for the same body, by name or by
+    # NAIF code, with the default J2000 frame. Names and codes come from the native
+    # body registry. Shared instances are dropped whenever the kernel pool changes,
+    # since kernels may rename bodies.
+    #
+    # Examples :-
+    #   SpiceRub::Body[:earth].equal?(SpiceRub::Body[399]) # => true
+    #
+    def self.[](body)
+      generation = Native.pool_generation
+      unless @registry && @registry_generation == generation
+        @registry = {}
+        @registry_generation = generation
+      end
+
+      @registry[body] ||= begin
+        instance = new(body)
+        @registry[instance.code] ||= instance.freeze
+      end
+    end
+
     def position_at(time, observer: :sun, frame: @frame, aberration_correction: nil, with_light_time: nil)
       raise(ArgumentError, "Expected instance of SpiceRub::Time") unless time.is_a? Time
       
       observer = observer.name if observer.is_a? Body
       aberration_correction = :none unless aberration_correction
+      demand_kernels([self.name, observer], [time], frame)
 
       output = Native.spkpos(self.name, time.et, frame, aberration_correction, observer)
       with_light_time ? output : output[0] 
@@ -57,6 +83,7 @@ module SpiceRub
       
       observer = observer.name if observer.is_a? Body
       aberration_correction = :none unless aberration_correction  
+      demand_kernels([self.name, observer], time, frame)
            
       time.map do |epoch| 
         position = Native.spkpos(self.name, epoch.et, frame, aberration_correction, observer)
@@ -69,6 +96,7 @@ module SpiceRub
 
       observer = observer.name if observer.is_a? Body
       aberration_correction = :none unless aberration_correction
+      demand_kernels([self.name, observer], [time], frame)
       
       output = Native.spkezr(self.name, time.et, frame, aberration_correction, observer)
       with_light_time ? output : output[0]    
@@ -81,6 +109,7 @@ module SpiceRub
 
       observer = observer.name if observer.is_a? Body
       aberration_correction = :none unless aberration_correction
+      demand_kernels([self.name, observer], time, frame)
              
       time.map do |epoch|
         state = Native.spkezr(self.name, epoch.et, frame, aberration_correction, observer)
@@ -88,11 +117,154 @@ module SpiceRub
       end      
     end 
 
+    #
+    # call-seq:
+    #     position_matrix(times, observer: :sun, frame: @frame, aberration_correction: nil, with_light_time: nil, out: nil) -> NMatrix
+    #
+    # Returns the positions at every epoch as the rows of an N x 3 float64 NMatrix,
+    # evaluated in a single native call. +times+ may be an Array of SpiceRub::Time objects
+    # or ephemeris times, or a dense float64 NMatrix of ephemeris times. When +out+ is an
+    # N x 3 float64 NMatrix the positions are written into it instead of a new matrix.
+    #
+    # With +threads+ the positions come from the native SPK reader instead of CSPICE: the
+    # batch is split over that many threads (nil for one per CPU) with the GVL released.
+    # The native reader evaluates geometric states in inertial frames from SPK types
+    # 1, 2, 3, 13 and 21, so it cannot be combined with an aberration correction.
+    #
+    # With +warm_start+ a light time correction (:lt, :"lt+s", :cn, :"cn+s" and their
+    # transmission forms) starts each epoch from the light times of the previous ones,
+    # which suits dense, ordered epochs. :cn results agree with CSPICE to well under a
+    # millimeter, :lt results sit closer to the converged solution than CSPICE's single
+    # iteration, within a meter of it for solar system bodies.
+    #
+    # Examples :-
+    #   earth = SpiceRub::Body.new(:earth)
+    #
+    #   buffer = NMatrix.new([1000, 3], 0.0, dtype: :float64)
+    #   earth.position_matrix(epochs, observer: :moon, out: buffer)
+    #
+    #   earth.position_matrix(epochs, observer: :moon, threads: 8)
+    #
+    #   earth.position_matrix(epochs, observer: :mars, aberration_correction: :"cn+s", warm_start: true)
+    #
+    def position_matrix(times, observer: :sun, frame: @frame, aberration_correction: nil, with_light_time: nil, out: nil, threads: false, warm_start: false)
+      return native_batch(3, times, observer, frame, aberration_correction, with_light_time, out, threads) unless threads == false
+
+      function = warm_start ? :spkpos_lt_batch : :spkpos_batch
+      output = batch(function, times, observer, frame, aberration_correction, out)
+      with_light_time ? output : output[0]
+    end
+
+    # The N x 6 counterpart of position_matrix
+    def state_matrix(times, observer: :sun, frame: @frame, aberration_correction: nil, with_light_time: nil, out: nil, threads: false)
+      return native_batch(6, times, observer, frame, aberration_correction, with_light_time, out, threads) unless threads == false
+
+      output = batch(:spkezr_batch, times, observer, frame, aberration_correction, out)
+      with_light_time ? output : output[0]
+    end
+
+    #
+    # call-seq:
+    #     Body.state_tensor(targets, observers, times, frame: :J2000, aberration_correction: nil, with_light_time: nil, out: nil) -> NMatrix
+    #
+    # Returns the states of every target relative to every observer at every epoch as an
+    # N x M x T x 6 float64 NMatrix. Each body's barycentric state is computed once per
+    # epoch and shared by all the pairs it takes part in. Targets and observers may be
+    # Body objects, names or NAIF codes. With +with_light_time+ the N x M x T light times
+    # are returned as well.
+    #
+    # Examples :-
+    #   stations = [:earth, :moon]
+    #   planets = [:mars, :jupiter_barycenter, :saturn_barycenter]
+    #
+    #   SpiceRub::Body.state_tensor(planets, stations, epochs, aberration_correction: :"LT+S")
+    #
+    def self.state_tensor(targets, observers, times, frame: :J2000, aberration_correction: nil, with_light_time: nil, out: nil)
+      output = tensor(6, targets, observers, times, frame, aberration_correction, out)
+      with_light_time ? output : output[0]
+    end
+
+    # The N x M x T x 3 counterpart of state_tensor
+    def self.position_tensor(targets, observers, times, frame: :J2000, aberration_correction: nil, with_light_time: nil, out: nil)
+      output = tensor(3, targets, observers, times, frame, aberration_correction, out)
+      with_light_time ? output : output[0]
+    end
+
+    #
+    # call-seq:
+    #     Body.query(targets, observers, times, frame: :J2000, aberration_correction: nil, velocities: true, plan: true, with_light_time: nil, out: nil) -> NMatrix
+    #
+    # Evaluates one request per row, the state of targets[i] relative to observers[i] at
+    # times[i], as the rows of an N x 6 float64 NMatrix (N x 3 positions without
+    # +velocities+). +targets+ and +observers+ may be single bodies shared by every row.
+    #
+    # Rows may come in any order. With +plan+ they are evaluated grouped by target,
+    # observer and the kernel covering them, in epoch order, so CSPICE keeps finding
+    # the segments it needs in its buffers; results still come back in input order.
+    #
+    # Examples :-
+    #   SpiceRub::Body.query(rows.map(&:target), :earth, rows.map(&:et), velocities: false)
+    #
+    def self.query(targets, observers, times, frame: :J2000, aberration_correction: nil, velocities: true, plan: true, with_light_time: nil, out: nil)
+      code = ->(body) { body.is_a?(Body) ? body.code : body }
+      targets, observers = [targets, observers].map do |bodies|
+        bodies.is_a?(Array) ? bodies.map(&code) : code.(bodies)
+      end
+      aberration_correction = :none unless aberration_correction
+      times = times.map { |time| time.is_a?(Time) ? time.et : time } if times.is_a? Array
+
+      kernel_pool = KernelPool.instance
+      kernel_pool.demand(Array(targets) | Array(observers), times.to_a.flatten, frames: [frame]) if kernel_pool.lazy?
+
+      output = Native.spk_requests(targets, observers, times, frame, aberration_correction, velocities ? 6 : 3, plan, out)
+      with_light_time ? output : output[0]
+    end
+
+    #
+    # call-seq:
+    #     Body.snapshot(ids, time, observer: :sun, frame: :J2000, aberration_correction: nil, velocities: true, with_light_time: nil, out: nil) -> NMatrix
+    #
+    # Returns the states of every body in +ids+ (NAIF codes or names) at +time+ as a
+    # packed K x 6 float64 NMatrix, one row per body in the order given (K x 3 positions
+    # without +velocities+). No Body objects are built and the observer state and frame
+    # rotation are shared by all rows. When +time+ is an Array of epochs the result is a
+    # T x K x 6 NMatrix holding one table per epoch.
+    #
+    # Examples :-
+    #   SpiceRub::Body.snapshot([199, 299, 399, 499, 301], SpiceRub::Time.parse("2006 JAN 31 01:00"), observer: :earth)
+    #
+    def self.snapshot(ids, time, observer: :sun, frame: :J2000, aberration_correction: nil, velocities: true, with_light_time: nil, out: nil)
+      observer = observer.code if observer.is_a? Body
+      aberration_correction = :none unless aberration_correction
+      times = time.is_a?(Array) ? time.map { |epoch| epoch.is_a?(Time) ? epoch.et : epoch } : (time.is_a?(Time) ? time.et : time)
+
+      kernel_pool = KernelPool.instance
+      kernel_pool.demand(ids + [observer], Array(times), frames: [frame]) if kernel_pool.lazy?
+
+      output = Native.spk_snapshot(ids, observer, times, frame, aberration_correction, velocities ? 6 : 3, out)
+      with_light_time ? output : output[0]
+    end
+
+    def self.tensor(columns, targets, observers, times, frame, aberration_correction, out)
+      targets, observers = [targets, observers].map do |bodies|
+        bodies.map { |body| body.is_a?(Body) ? body.code : body }
+      end
+      aberration_correction = :none unless aberration_correction
+      times = times.map { |time| time.is_a?(Time) ? time.et : time } if times.is_a? Array
+
+      kernel_pool = KernelPool.instance
+      kernel_pool.demand(targets + observers, times.to_a.flatten, frames: [frame]) if kernel_pool.lazy?
+
+      Native.spk_tensor(targets, observers, times, frame, aberration_correction, columns, out)
+    end
+    private_class_method :tensor
+
     def velocity_at(time, observer: :sun, frame: @frame, aberration_correction: nil, with_light_time: nil)
       raise(ArgumentError, "Expected instance of SpiceRub::Time") unless time.is_a? Time
 
       observer = observer.name if observer.is_a? Body
       aberration_correction = :none unless aberration_correction
+      demand_kernels([self.name, observer], [time], frame)
       
       output = Native.spkezr(self.name, time.et, frame, aberration_correction, observer)
       with_light_time ?  [output[0][3..5], output[1]] : output[0][3..5]
@@ -105,6 +277,7 @@ module SpiceRub
 
       observer = observer.name if observer.is_a? Body
       aberration_correction = :none unless aberration_correction
+      demand_kernels([self.name, observer], time, frame)
       
       time.map do |epoch|
         state = Native.spkezr(self.name, epoch.et, frame, aberration_correction, observer)
@@ -117,6 +290,7 @@ module SpiceRub
 
       target = target.name if target.is_a? Body
       aberration_correction = :none unless aberration_correction
+      demand_kernels([target, self.name], [time], frame)
       
       Native.spkpos(target, time.et, frame, aberration_correction, self.name)[1]
     end
@@ -126,6 +300,7 @@ module SpiceRub
 
       target = target.name if target.is_a? Body
       aberration_correction = :none unless aberration_correction
+      demand_kernels([target, self.name], [time], frame)
    
       position = Native.spkpos(target, time.et, frame, aberration_correction, self.name)[0]
       Math.sqrt( (position ** 2).sum[0] )      
@@ -142,6 +317,28 @@ module SpiceRub
       end
     end
 
+    # Radii, GM, pole and prime meridian coefficients from the kernel pool, cached natively
+    def constants
+      Native.body_constants(@code)
+    end
+
+    #
+    # call-seq:
+    #     planetographic(points, out: nil) -> NMatrix
+    #     geodetic(points, out: nil) -> NMatrix
+    #
+    # Converts an N x 3 float64 NMatrix of body fixed rectangular co-ordinates into N x 3
+    # [longitude, latitude, altitude] rows on the body's reference ellipsoid, read once
+    # from the cached body constants.
+    #
+    def planetographic(points, out: nil)
+      Native.recpgr_batch(@code, points, out)
+    end
+
+    def geodetic(points, out: nil)
+      Native.recgeo_batch(@code, points, out)
+    end
+
     def rotate_position(time, target)
       pxform(@frame, target, time)
     end
@@ -150,6 +347,37 @@ module SpiceRub
       sxform(@frame, target, time)
     end
 
+    # Furnshes the catalog kernels a query needs when the kernel pool is lazy
+    def demand_kernels(bodies, times, frame)
+      kernel_pool = KernelPool.instance
+      kernel_pool.demand(bodies, times, frames: [frame]) if kernel_pool.lazy?
+    end
+    private :demand_kernels
+
+    def batch(function, times, observer, frame, aberration_correction, out)
+      observer = observer.name if observer.is_a? Body
+      aberration_correction = :none unless aberration_correction
+      times = times.map { |time| time.is_a?(Time) ? time.et : time } if times.is_a? Array
+      demand_kernels([self.name, observer], times.to_a.flatten, frame) if KernelPool.instance.lazy?
+
+      Native.send(function, self.name, times, frame, aberration_correction, observer, out)
+    end
+    private :batch
+
+    def native_batch(columns, times, observer, frame, aberration_correction, with_light_time, out, threads)
+      unless [nil, :none, :NONE].include?(aberration_correction)
+        raise(ArgumentError, "the native SPK reader computes geometric states only")
+      end
+      raise(ArgumentError, "the native SPK reader does not compute light times") if with_light_time
+
+      observer = observer.is_a?(Body) ? observer.code : observer
+      times = times.map { |time| time.is_a?(Time) ? time.et : time } if times.is_a? Array
+      demand_kernels([self.name, observer], times.to_a.flatten, frame) if KernelPool.instance.lazy?
+
+      Native.spk_batch(@code, observer, times, frame, columns, threads, out)
+    end
+    private :native_batch
+
     def body_type(body_id)
       if body_id > 2000000
         :asteroid
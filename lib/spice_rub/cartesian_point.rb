@@ -19,11 +19,24 @@ module SpiceRub
     end
     
 
-    def to_planetographic(body, equatorial_radius, flattening_coefficient)
-      SpiceRub::Native.recpgr(body, self, equatorial_radius, flattening_coefficient)
+    # Planetographic [longitude, latitude, altitude] on the reference ellipsoid of +body+.
+    # The ellipsoid comes from the cached body constants unless both radius and
+    # flattening are given.
+    def to_planetographic(body, equatorial_radius = nil, flattening_coefficient = nil)
+      return SpiceRub::Native.recpgr(body, self, equatorial_radius, flattening_coefficient) if equatorial_radius and flattening_coefficient
+
+      SpiceRub::Native.recpgr_batch(body, self, nil).to_a.flatten
     end
     alias :to_pgr :to_planetographic
 
+    # Geodetic counterpart of to_planetographic
+    def to_geodetic(body, equatorial_radius = nil, flattening_coefficient = nil)
+      return SpiceRub::Native.recgeo(self, equatorial_radius, flattening_coefficient) if equatorial_radius and flattening_coefficient
+
+      SpiceRub::Native.recgeo_batch(body, self, nil).to_a.flatten
+    end
+    alias :to_geo :to_geodetic
+
     #def to_rec
     #  raise "already in rectangular co-ordinates"
     #end
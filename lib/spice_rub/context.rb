@@ -0,0 +1,292 @@
+#--
+# = SpiceRub
+#
+# A wrapper to the SPICE TOOLKIT for space and astronomomical
+# computation in Ruby.
+#
+#
+# == context.rb
+#
+# Contains the Context class. CSPICE has a single kernel pool per process, so
+# a Context keeps its own kernel set loaded in persistent worker processes and
+# forwards calls to them over a Unix socket pair. Switching between contexts
+# costs one round trip instead of a kclear and a reload, and calls on
+# different contexts run in parallel.
+#
+#++
+
+require 'socket'
+
+module SpiceRub
+  class Context
+    # NMatrix results travel as their shape, dtype and elements
+    Matrix = Struct.new(:shape, :dtype, :elements)
+
+    # Client ends of every open worker socket, closed in newly forked workers
+    # so a worker never keeps another context's connection alive.
+    @sockets = []
+
+    class << self
+      attr_reader :sockets
+    end
+
+    attr_reader :kernels
+
+    #
+    # call-seq:
+    #     new(kernels, path: nil, workers: 1) -> Context
+    #
+    # Starts +workers+ processes that each load +kernels+ (relative to +path+
+    # when given) into an otherwise empty kernel pool. The kernel pool of the
+    # calling process is left untouched. Raises SpiceError when a kernel
+    # cannot be loaded.
+    #
+    # Examples :-
+    #   mission_a = SpiceRub::Context.new(["naif0011.tls", "mission_a_v3.bsp"], path: "data/kernels")
+    #   mission_b = SpiceRub::Context.new(["naif0011.tls", "mission_b_v1.bsp"], path: "data/kernels", workers: 4)
+    #
+    #   mission_a.str2et("2020 JAN 01")
+    #     => 631108869.1839334
+    #
+    def initialize(kernels, path: nil, workers: 1)
+      raise(ArgumentError, "a context needs at least one worker") if workers < 1
+
+      @kernels = Array(kernels).map { |kernel| File.expand_path(path ? File.join(path, kernel) : kernel) }
+      @idle = Queue.new
+      @workers = []
+
+      workers.times { @idle << spawn_worker }
+    rescue StandardError
+      close
+      raise
+    end
+
+    #
+    # call-seq:
+    #     open(kernels, path: nil, workers: 1) { |context| ... } -> Object
+    #
+    # Creates a Context, yields it and closes it when the block returns.
+    #
+    def self.open(*args, **options)
+      context = new(*args, **options)
+      begin
+        yield context
+      ensure
+        context.close
+      end
+    end
+
+    #
+    # call-seq:
+    #     call(function, *args) -> Object
+    #
+    # Calls SpiceRub::Native.+function+ with +args+ in one of the context's
+    # workers and returns its result. Exceptions raised in the worker are
+    # raised again here. Functions of SpiceRub::Native can also be called on
+    # the context directly.
+    #
+    # Examples :-
+    #   context.call(:spkpos, :moon, et, :j2000, :none, :earth)
+    #   context.spkpos(:moon, et, :j2000, :none, :earth)
+    #
+    def call(function, *args)
+      send_to("SpiceRub::Native", function, *args)
+    end
+
+    #
+    # call-seq:
+    #     send_to(receiver, method, *args) -> Object
+    #
+    # Calls +method+ on the constant named +receiver+ inside a worker, for the
+    # Ruby level classes built on the native functions. Arguments and results
+    # must survive Marshal, NMatrix objects are converted on both sides.
+    #
+    # Examples :-
+    #   context.send_to("SpiceRub::Body", :query, [:moon, :mars], [:earth], [0.0, 86400.0])
+    #
+    def send_to(receiver, method, *args)
+      raise(IOError, "context is closed") if closed?
+      raise(SpiceError, "context has no workers left") if @workers.empty?
+
+      worker = @idle.pop
+      begin
+        status, value = worker.request([receiver.to_s, method, self.class.pack(args)])
+      rescue Exception
+        # Interrupted between request and reply, or the worker died: its socket may still hold a stale reply
+        replace(worker)
+        raise
+      end
+      @idle << worker
+
+      raise value if status == :error
+      self.class.unpack(value)
+    end
+
+    def method_missing(name, *args)
+      Native.respond_to?(name) ? call(name, *args) : super
+    end
+
+    def respond_to_missing?(name, include_private = false)
+      Native.respond_to?(name) || super
+    end
+
+    # Process ids of the workers serving this context
+    def pids
+      @workers.map(&:pid)
+    end
+
+    def closed?
+      @closed == true
+    end
+
+    #
+    # call-seq:
+    #     close -> nil
+    #
+    # Stops the workers after their current call and waits for them to exit.
+    #
+    def close
+      return if closed?
+
+      @closed = true
+      Array(@workers).each(&:stop)
+      nil
+    end
+
+    # Converts NMatrix objects in +value+ to transportable Matrix structs
+    def self.pack(value)
+      case value
+      when NMatrix then Matrix.new(value.shape, value.dtype, value.to_flat_a)
+      when Array then value.map { |element| pack(element) }
+      when Hash then value.each_with_object({}) { |(key, element), packed| packed[key] = pack(element) }
+      else value
+      end
+    end
+
+    # Reverses pack
+    def self.unpack(value)
+      case value
+      when Matrix then NMatrix.new(value.shape, value.elements, dtype: value.dtype)
+      when Array then value.map { |element| unpack(element) }
+      when Hash then value.each_with_object({}) { |(key, element), unpacked| unpacked[key] = unpack(element) }
+      else value
+      end
+    end
+
+    private
+
+    def spawn_worker
+      client, server = UNIXSocket.pair
+      pid = fork do
+        client.close
+        self.class.sockets.each { |socket| socket.close unless socket.closed? }
+        Worker.serve(server, @kernels)
+      end
+      server.close
+
+      self.class.sockets << client
+      worker = Worker.new(pid, client)
+      @workers << worker
+
+      status, value = worker.receive
+      raise value if status == :error
+      worker
+    end
+
+    # Kills a worker that did not finish its round trip and puts a fresh one in its place
+    def replace(worker)
+      @workers.delete(worker)
+      worker.kill
+      @idle << spawn_worker unless closed?
+    rescue StandardError
+      # The pool shrinks, send_to raises once it is empty
+      nil
+    end
+
+    # Client side of one worker process, with the framing shared by both ends
+    class Worker
+      attr_reader :pid
+
+      def initialize(pid, socket)
+        @pid = pid
+        @socket = socket
+      end
+
+      def request(message)
+        Worker.write(@socket, message)
+        receive
+      rescue Errno::EPIPE, Errno::ECONNRESET
+        raise(SpiceError, "context worker #{@pid} exited")
+      end
+
+      def receive
+        Worker.read(@socket) or raise(SpiceError, "context worker #{@pid} exited")
+      end
+
+      def stop
+        Context.sockets.delete(@socket)
+        @socket.close unless @socket.closed?
+        Process.wait(@pid)
+      rescue Errno::ECHILD
+        nil
+      end
+
+      # Stops the worker without waiting for its current call
+      def kill
+        Process.kill(:KILL, @pid)
+      rescue Errno::ESRCH
+        nil
+      ensure
+        stop
+      end
+
+      # Messages are a 4 byte length followed by a Marshal dump
+      def self.write(socket, message)
+        data = Marshal.dump(message)
+        socket.write([data.bytesize].pack("N"), data)
+      end
+
+      def self.read(socket)
+        header = socket.read(4)
+        return nil unless header and header.bytesize == 4
+
+        Marshal.load(socket.read(header.unpack("N")[0]))
+      end
+
+      # Runs inside the forked worker, never returns
+      def self.serve(socket, kernels)
+        pool = KernelPool.instance
+        pool.clear! unless pool.empty?
+        pool.clear_path!
+
+        begin
+          kernels.each { |kernel| pool.load(kernel, absolute: true) }
+          write(socket, [:ready, pool.count])
+        rescue StandardError => e
+          write(socket, [:error, e]) rescue nil
+          exit!(1)
+        end
+
+        while (request = read(socket))
+          receiver, method, args = request
+          reply = begin
+                    [:ok, Context.pack(Object.const_get(receiver).public_send(method, *Context.unpack(args)))]
+                  rescue StandardError => e
+                    [:error, e]
+                  end
+
+          begin
+            write(socket, reply)
+          rescue TypeError => e
+            # Results or exceptions that cannot be marshalled
+            write(socket, [:error, RuntimeError.new("#{e.class}: #{e.message}")])
+          end
+        end
+
+        exit!(0)
+      rescue Errno::EPIPE, IOError
+        exit!(0)
+      end
+    end
+  end
+end
@@ -0,0 +1,160 @@
+#--
+# = SpiceRub
+#
+# A wrapper to the SPICE TOOLKIT for space and astronomomical
+# computation in Ruby.
+#
+#
+# == fork_server.rb
+#
+# Contains the ForkServer class, which keeps a process with a fully loaded
+# KernelPool around and forks pre-warmed workers from it on request over a
+# Unix socket, so a job pays for a fork instead of a full kernel load.
+#
+#++
+
+require 'socket'
+require 'json'
+
+module SpiceRub
+  class ForkServer
+    attr_reader :socket_path
+
+    #
+    # call-seq:
+    #     new(socket_path) -> ForkServer
+    #
+    # Creates a fork server listening on +socket_path+. Kernels should be loaded
+    # into the KernelPool before calling serve, every worker inherits them.
+    #
+    # Examples :-
+    #   kernel_pool = SpiceRub::KernelPool.instance
+    #   kernel_pool.load_folder("data/kernels")
+    #
+    #   server = SpiceRub::ForkServer.new("/tmp/spice_rub.sock")
+    #   server.serve
+    #
+    def initialize(socket_path)
+      @socket_path = socket_path
+    end
+
+    #
+    # call-seq:
+    #     serve -> nil
+    #
+    # Accepts requests until stop is called. Each request forks a worker that runs
+    # the requested script with the client's standard output and error, and the
+    # connection is answered with the worker pid and later its exit status.
+    #
+    # Workers run arbitrary scripts as the server's user, so the socket is created
+    # with mode 0600 and connections from processes of any other user are refused.
+    #
+    def serve
+      File.delete(@socket_path) if File.socket?(@socket_path)
+
+      # The socket gets its mode when bound, a chmod afterwards would leave a window open
+      umask = File.umask(0177)
+      begin
+        @server = UNIXServer.new(@socket_path)
+      ensure
+        File.umask(umask)
+      end
+
+      loop do
+        client = begin
+                   @server.accept
+                 rescue IOError, Errno::EBADF
+                   break
+                 end
+
+        Thread.new(client) { |connection| handle(connection) }
+      end
+    ensure
+      File.delete(@socket_path) if File.socket?(@socket_path)
+    end
+
+    # Stops accepting requests, workers that are already running are left alone
+    def stop
+      @server.close if @server and not @server.closed?
+    end
+
+    #
+    # call-seq:
+    #     run(socket_path, script, argv = []) -> Process::Status like Hash
+    #
+    # Asks the fork server at +socket_path+ to run +script+ with +argv+ in a fresh
+    # worker and waits for it. Output of the worker goes to this process' $stdout
+    # and $stderr. Returns a Hash with the worker "pid" and its exit "status".
+    #
+    # Examples :-
+    #   SpiceRub::ForkServer.run("/tmp/spice_rub.sock", "jobs/flyby.rb", ["2030 JAN 01"])
+    #     => {"pid"=>12345, "status"=>0}
+    #
+    def self.run(socket_path, script, argv = [])
+      UNIXSocket.open(socket_path) do |socket|
+        # Descriptors go first, a buffered read of the request line would swallow them
+        socket.send_io($stdout)
+        socket.send_io($stderr)
+        socket.puts({ script: File.expand_path(script), argv: argv, dir: Dir.pwd }.to_json)
+
+        reply = JSON.parse(socket.gets || raise(IOError, "fork server closed the connection"))
+        raise(SpiceError, reply["error"]) if reply["error"]
+
+        reply.merge(JSON.parse(socket.gets || raise(IOError, "fork server closed the connection")))
+      end
+    end
+
+    private
+
+    def handle(connection)
+      stdout = connection.recv_io
+      stderr = connection.recv_io
+      request = JSON.parse(connection.gets)
+
+      # Refused only once the request is read, the client is still writing before that
+      uid, _gid = connection.getpeereid
+      unless uid == Process.euid
+        [stdout, stderr].each(&:close)
+        raise(SpiceError, "connection from uid #{uid} refused")
+      end
+
+      pid = fork { work(request, stdout, stderr) }
+      [stdout, stderr].each(&:close)
+
+      connection.puts({ pid: pid }.to_json)
+      _, status = Process.wait2(pid)
+      connection.puts({ status: status.exitstatus || status.termsig && 128 + status.termsig }.to_json)
+    rescue StandardError => e
+      connection.puts({ error: e.message }.to_json) rescue nil
+    ensure
+      connection.close
+    end
+
+    # Runs inside the forked worker, never returns
+    def work(request, stdout, stderr)
+      @server.close
+      $stdout.reopen(stdout)
+      $stderr.reopen(stderr)
+
+      # Binary kernels share their file offsets with the server after a fork
+      KernelPool.instance.reopen!
+      Dir.chdir(request["dir"])
+
+      status = begin
+                 $0 = request["script"]
+                 ARGV.replace(request["argv"])
+                 load(request["script"])
+                 0
+               rescue SystemExit => e
+                 e.status
+               rescue Exception => e
+                 $stderr.puts "#{e.class}: #{e.message}", e.backtrace
+                 1
+               end
+
+      $stdout.flush
+      $stderr.flush
+      exit!(status)
+    end
+  end
+end
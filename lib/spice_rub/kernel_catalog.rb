@@ -0,0 +1,287 @@
+#--
+# = SpiceRub
+#
+# A wrapper to the SPICE TOOLKIT for space and astronomomical
+# computation in Ruby.
+#
+#
+# == kernel_catalog.rb
+#
+# Contains the KernelCatalog class, which backs the lazy loading mode of
+# KernelPool. A catalog reads the file list of a meta-kernel and the segment
+# summaries of every binary kernel in it, then furnshes kernels only when a
+# query first needs the body, frame or epoch they cover.
+#
+#++
+
+module SpiceRub
+  class KernelCatalog
+    # CSPICE can keep a limited number of DAF files open at once,
+    # stay below the smallest limit of supported toolkit versions.
+    DEFAULT_MAX_OPEN = 1000
+
+    DAF_RECORD_SIZE = 1024
+    DAF_FORMATS = { "LTL-IEEE" => ["E", "l<"], "BIG-IEEE" => ["G", "l>"] }
+
+    # SPK segments are chained through their centers until they reach the
+    # solar system barycenter, deep chains are always a sign of a bad kernel.
+    MAX_CHAIN_DEPTH = 100
+
+    # Catalog entry for one kernel file listed in the meta-kernel
+    Entry = Struct.new(:path, :type, :position, :segments, :kernel, :last_used) do
+      def resident?
+        kernel and kernel.loaded?
+      end
+    end
+
+    # Summary of one binary kernel segment, center is nil for PCK and CK segments
+    Segment = Struct.new(:id, :center, :start, :end)
+
+    attr_reader :entries, :max_open
+
+    def initialize(metakernel, pool, max_open: DEFAULT_MAX_OPEN)
+      @pool = pool
+      @max_open = max_open
+      @clock = 0
+      @index = { spk: Hash.new { |h, k| h[k] = [] },
+                 pck: Hash.new { |h, k| h[k] = [] },
+                 ck:  Hash.new { |h, k| h[k] = [] } }
+
+      @entries = self.class.kernels_in(metakernel).each_with_index.map do |path, position|
+        Entry.new(path, self.class.kernel_type(path), position, [])
+      end
+
+      # Text kernels hold no file handles and are needed for name and frame lookups
+      @entries.reject(&:type).each { |entry| furnsh(entry) }
+      @entries.select(&:type).each { |entry| summarize(entry) }
+    end
+
+    #
+    # call-seq:
+    #     demand(bodies, times = nil, frames: []) -> List of SpiceKernel objects
+    #
+    # Furnshes every catalog kernel needed to evaluate +bodies+ (and their SPK center
+    # chains down to the solar system barycenter) and to rotate into +frames+ over the
+    # span of +times+. When +times+ is nil every kernel covering the bodies is loaded.
+    # Returns the kernels that had to be loaded.
+    #
+    def demand(bodies, times = nil, frames: [])
+      epochs = times && times.map { |time| time.is_a?(Time) ? time.et : time }
+      range = epochs && (epochs.min..epochs.max)
+      needed = []
+
+      Array(bodies).each { |body| needed.concat(spk_entries(naif_id(body), range)) }
+      Array(frames).each { |frame| needed.concat(frame_entries(frame, range)) }
+
+      needed.uniq!
+      needed.each { |entry| entry.last_used = (@clock += 1) }
+
+      missing = needed.reject(&:resident?).sort_by(&:position)
+      make_room(missing.length, needed)
+      missing.each { |entry| furnsh_in_priority(entry) }
+
+      missing.map(&:kernel)
+    end
+
+    def resident
+      @entries.select(&:resident?)
+    end
+
+    # Reads the KERNELS_TO_LOAD list of a meta-kernel, expanding PATH_SYMBOLS
+    def self.kernels_in(metakernel)
+      assignments = Hash.new { |h, k| h[k] = [] }
+      name = nil
+      in_data = false
+
+      File.foreach(metakernel) do |line|
+        stripped = line.strip
+
+        if stripped.start_with?('\begindata')
+          in_data = true
+        elsif stripped.start_with?('\begintext')
+          in_data = false
+        elsif in_data
+          if stripped =~ /\A(\w+)\s*\+?=\s*(.*)\z/
+            name = $1.upcase
+            stripped = $2
+          end
+          assignments[name].concat(stripped.scan(/'((?:[^']|'')*)'/).flatten.map { |s| s.gsub("''", "'") }) if name
+        end
+      end
+
+      symbols = assignments["PATH_SYMBOLS"].zip(assignments["PATH_VALUES"]).to_h
+
+      # Strings ending in + continue on the next element
+      files = assignments["KERNELS_TO_LOAD"].each_with_object([""]) do |part, joined|
+        if part.end_with?("+")
+          joined[-1] += part.chomp("+")
+        else
+          joined[-1] += part
+          joined << ""
+        end
+      end
+      files.pop if files.last.empty?
+
+      # Like furnsh_c, relative paths are taken relative to the working directory
+      files.map { |file| file.gsub(/\$(\w+)/) { symbols[$1] || "$#{$1}" } }
+    end
+
+    # Whether path is a text kernel, its id word is KPL/... or at least not
+    # the DAF or DAS one of a binary kernel
+    def self.text_kernel?(path)
+      File.open(path, "rb") { |io| io.read(8) }.to_s !~ /\A(NAIF\/)?DA[FS]/
+    end
+
+    # Whether path is a meta-kernel, from its KPL/MK id word
+    def self.metakernel?(path)
+      text_kernel?(path) && File.open(path, "rb") { |io| io.gets.to_s.strip.start_with?("KPL/MK") }
+    end
+
+    # Returns :spk, :pck or :ck for SPK, PCK and CK files, nil for any other kernel
+    def self.kernel_type(path)
+      id_word = File.open(path, "rb") { |io| io.read(8) }.to_s
+
+      case id_word
+      when /\ADAF\/SPK/ then :spk
+      when /\ADAF\/PCK/ then :pck
+      when /\ADAF\/CK/  then :ck
+      when /\ANAIF\/DAF/
+        { ".bsp" => :spk, ".bpc" => :pck, ".bc" => :ck }[File.extname(path).downcase]
+      end
+    end
+
+    # Reads the segment descriptors of a DAF without furnshing it,
+    # yielding the double and integer components of each summary
+    def self.each_daf_summary(path)
+      File.open(path, "rb") do |io|
+        file_record = io.read(DAF_RECORD_SIZE)
+        double, int = DAF_FORMATS.fetch(file_record[88, 8]) { raise(SpiceError, "unsupported binary format in #{path}") }
+
+        nd, ni = file_record[8, 8].unpack("#{int}2")
+        forward = file_record[76, 4].unpack1(int)
+        summary_size = nd + (ni + 1) / 2
+
+        record = forward
+        while record > 0
+          io.seek((record - 1) * DAF_RECORD_SIZE)
+          data = io.read(DAF_RECORD_SIZE)
+          following, _previous, count = data[0, 24].unpack("#{double}3")
+
+          count.to_i.times do |i|
+            summary = data[24 + i * summary_size * 8, summary_size * 8]
+            yield summary[0, nd * 8].unpack("#{double}#{nd}"), summary[nd * 8, ni * 4].unpack("#{int}#{ni}")
+          end
+
+          record = following.to_i
+        end
+      end
+    end
+
+    private
+
+    def summarize(entry)
+      case entry.type
+      when :spk
+        self.class.each_daf_summary(entry.path) do |times, ints|
+          entry.segments << Segment.new(ints[0], ints[1], times[0], times[1])
+        end
+      when :pck
+        self.class.each_daf_summary(entry.path) do |times, ints|
+          entry.segments << Segment.new(ints[0], nil, times[0], times[1])
+        end
+      when :ck
+        # CK descriptors are in SCLK ticks, let CSPICE convert them with the loaded SCLK kernels
+        (Native.ckobj(entry.path) || []).each do |id|
+          (Native.ckcov(entry.path, id, false, :INTERVAL, 0.0, :TDB) || []).each do |start, finish|
+            entry.segments << Segment.new(id, nil, start, finish)
+          end
+        end
+      end
+
+      entry.segments.map(&:id).uniq.each { |id| @index[entry.type][id] << entry }
+    end
+
+    # Entries with SPK data for id over the epoch range, following segment centers down to the barycenter
+    def spk_entries(id, range, visited = {})
+      return [] if id == 0 or visited[id] or visited.size > MAX_CHAIN_DEPTH
+      visited[id] = true
+
+      @index[:spk][id].flat_map do |entry|
+        segments = entry.segments.select { |s| s.id == id and overlaps?(s, range) }
+        next [] if segments.empty?
+
+        [entry] + segments.map(&:center).uniq.flat_map { |center| spk_entries(center, range, visited) }
+      end
+    end
+
+    # Entries backing a frame over the epoch range. PCK (class 2) and CK (class 3) frames are backed by
+    # binary kernels, TK frames (class 4) are followed down the TKFRAME_<frame>_RELATIVE chain
+    def frame_entries(frame, range)
+      code = frame.is_a?(Integer) ? frame : Native.namfrm(frame)
+
+      MAX_CHAIN_DEPTH.times do
+        info = code && Native.frinfo(code)
+        return [] unless info
+
+        case info[1]
+        when 2 then return class_entries(:pck, info[2], range)
+        when 3 then return class_entries(:ck, info[2], range)
+        when 4 then code = Native.tkfrm(code)
+        else return []
+        end
+      end
+
+      []
+    end
+
+    def class_entries(type, id, range)
+      @index[type][id].select do |entry|
+        entry.segments.any? { |s| s.id == id and overlaps?(s, range) }
+      end
+    end
+
+    def overlaps?(segment, range)
+      range.nil? or (segment.start <= range.last and range.first <= segment.end)
+    end
+
+    # Loads an entry while keeping the catalog order as CSPICE priority: any resident kernel
+    # listed after it that shares an ID is unloaded and furnshed again on top.
+    def furnsh_in_priority(entry)
+      ids = entry.segments.map(&:id).uniq
+      later = resident.select do |other|
+        other.type == entry.type and other.position > entry.position and
+          other.segments.any? { |s| ids.include? s.id }
+      end.sort_by(&:position)
+
+      later.each { |other| @pool.release(other.kernel) }
+      furnsh(entry)
+      later.each { |other| furnsh(other) }
+    end
+
+    def furnsh(entry)
+      entry.kernel = @pool[@pool.load(entry.path, absolute: true)]
+      entry.last_used = (@clock += 1)
+    end
+
+    # Evicts least recently used binary kernels so that +incoming+ more fit below max_open
+    def make_room(incoming, keep)
+      binaries = resident.select(&:type)
+      excess = binaries.length + incoming - @max_open
+      return if excess <= 0
+
+      (binaries - keep).sort_by(&:last_used).first(excess).each do |entry|
+        @pool.release(entry.kernel)
+        entry.kernel = nil
+      end
+    end
+
+    def naif_id(body)
+      case body
+      when Integer then body
+      when Body then body.code
+      else
+        Native.bodn2c(body) or raise(SpiceError, "body not found in SPICE data")
+      end
+    end
+  end
+end
@@ -13,6 +13,7 @@
 #++
 
 require 'singleton'
+require 'digest'
 
 module SpiceRub
   # KernelPool class, the Ruby interface to kernel loading functions such as
@@ -28,6 +29,15 @@ module SpiceRub
     # are in the same file directory, nil by default.
     attr_accessor :path
 
+    # KernelCatalog backing lazy loading, nil unless a catalog was loaded
+    attr_reader :catalog
+
+    # Name of the kernel set last switched to with switch_to, nil before
+    attr_reader :current_set
+
+    # Outcome of switch_to, kernel paths in the order they were handled
+    Switch = Struct.new(:set, :kept, :unloaded, :loaded, :seconds)
+
     #
     # call-seq:
     #     [kernel] -> SpiceKernel
@@ -99,8 +109,10 @@ module SpiceRub
       @pool ||= []
 
       file = File.join(@path, file) if @path and not absolute
-      loaded_kernel = SpiceKernel.load(file)
-      @pool << loaded_kernel if loaded_kernel
+      Native.defer_pool_changes do
+        loaded_kernel = SpiceKernel.load(file)
+        @pool << loaded_kernel if loaded_kernel
+      end
       @pool.length - 1
     end
 
@@ -112,14 +124,194 @@ module SpiceRub
       #TODO : Refine to only read valid kernel extensions
       kernels = Dir[File.join(folder, "*.*")]
       
-      kernels.each do |kernel|
-        loaded_kernel = SpiceKernel.load(kernel)
-        @pool << loaded_kernel if loaded_kernel
+      Native.defer_pool_changes do
+        kernels.each do |kernel|
+          loaded_kernel = SpiceKernel.load(kernel)
+          @pool << loaded_kernel if loaded_kernel
+        end
       end
       
       self.count
     end
 
+    #
+    # call-seq:
+    #     load_snapshot(files, snapshot) -> :restored/:loaded
+    #
+    # Loads a list of kernels, restoring the kernel pool variables of its text kernels
+    # from +snapshot+ instead of parsing them when the snapshot was written for exactly
+    # these files (by SHA-256 of their contents). Otherwise the text kernels are furnshed
+    # and a fresh snapshot is written for the next process. Binary kernels (SPK, PCK, CK,
+    # DSK, EK) are always furnshed, their data does not live in the kernel pool.
+    # Meta-kernels are replaced by the kernels they list, which may not be meta-kernels
+    # themselves.
+    #
+    # Restored variables are not tied to kernel files, so the text kernels do not show
+    # up in the pool or in +count+ and cannot be unloaded individually. The snapshot
+    # captures the whole kernel pool, write it from a process that loads only +files+.
+    #
+    # * *Arguments* :
+    #   - +files+    -> Kernel files, relative to +path+ if set
+    #   - +snapshot+ -> Path of the snapshot file
+    #
+    # Examples :-
+    #   kernel_pool.load_snapshot(["naif0011.tls", "pck00010.tpc"], "tmp/pool.snapshot")
+    #     => :loaded
+    #
+    #   # In the next worker process
+    #   kernel_pool.load_snapshot(["naif0011.tls", "pck00010.tpc"], "tmp/pool.snapshot")
+    #     => :restored
+    #
+    def load_snapshot(files, snapshot)
+      @pool ||= []
+
+      files = expand_metakernels(files.map { |file| @path ? File.join(@path, file) : file })
+      text, binary = files.partition { |file| KernelCatalog.text_kernel?(file) }
+      key = snapshot_key(text)
+
+      status = if Native.pool_restore(snapshot, key)
+                 # Restored variables belong to no kernel file, ktotal does not count them
+                 @restored = true
+                 :restored
+               else
+                 text.each { |file| load(file, absolute: true) }
+                 Native.pool_dump(snapshot, key)
+                 :loaded
+               end
+
+      binary.each { |file| load(file, absolute: true) }
+      status
+    end
+
+    #
+    # call-seq:
+    #     load_catalog(metakernel, max_open: 1000) -> KernelCatalog
+    #
+    # Switches the pool to lazy loading. The meta-kernel is read but not furnshed:
+    # its text kernels are loaded right away, while binary kernels are only summarised
+    # and get furnshed the first time a query needs a body, frame or epoch they cover.
+    # Binary kernels are unloaded least recently used first to stay under +max_open+.
+    #
+    # * *Arguments* :
+    #   - +metakernel+ -> Path to a meta-kernel listing KERNELS_TO_LOAD
+    #   - +max_open+   -> Maximum number of binary kernels kept loaded at once
+    #
+    # Examples :-
+    #   kernel_pool.load_catalog("data/mission.tm")
+    #
+    #   kernel_pool.demand([:europa, :jupiter], [SpiceRub::Time.parse("2030 JAN 01")])
+    #     => [#<SpiceRub::SpiceKernel:0xMEM @loaded=true, @path_to="data/spk/jup365.bsp">]
+    #
+    def load_catalog(metakernel, max_open: KernelCatalog::DEFAULT_MAX_OPEN)
+      @pool ||= []
+      @catalog = KernelCatalog.new(metakernel, self, max_open: max_open)
+    end
+
+    def lazy?
+      !@catalog.nil?
+    end
+
+    #
+    # call-seq:
+    #     demand(bodies, times = nil, frames: []) -> List of SpiceKernel objects
+    #
+    # Makes sure the catalog kernels needed for +bodies+ and +frames+ over +times+ are
+    # loaded, returns the kernels that were loaded. Does nothing unless the pool is lazy.
+    #
+    def demand(bodies, times = nil, frames: [])
+      lazy? ? @catalog.demand(bodies, times, frames: frames) : []
+    end
+
+    #
+    # call-seq:
+    #     define_set(name, files, absolute: nil) -> List of paths
+    #
+    # Names a list of kernel files, relative to +path+ unless +absolute+ is set,
+    # that switch_to can later make the loaded kernel set. Files are kept in
+    # load order, later files take priority as usual.
+    #
+    # Examples :-
+    #   kernel_pool.define_set(:cruise, ["naif0011.tls", "de430.bsp", "cruise_v2.bsp"])
+    #   kernel_pool.define_set(:flyby, ["naif0011.tls", "de430.bsp", "flyby_v5.bsp"])
+    #
+    def define_set(name, files, absolute: nil)
+      @sets ||= {}
+      @sets[name] = files.map { |file| File.expand_path(@path && !absolute ? File.join(@path, file) : file) }.uniq.freeze
+    end
+
+    # Names of the kernel sets defined with define_set
+    def sets
+      @sets ? @sets.keys : []
+    end
+
+    #
+    # call-seq:
+    #     switch_to(name) -> KernelPool::Switch
+    #
+    # Makes the kernel set +name+ the loaded kernels of the pool with as few
+    # unloads and furnshes as possible. Priority only matters between kernels of
+    # the same kind (text, SPK, binary PCK, CK), so for each kind the longest
+    # leading run of the set that is already loaded in the right relative order
+    # stays loaded; every other kernel of that kind is unloaded and the rest of
+    # the set furnshed after the kept ones, leaving the same priorities as
+    # loading the set into an empty pool. Kernels loaded outside the pool are
+    # left alone.
+    #
+    # Returns a Switch with the kept, unloaded and furnshed paths and the
+    # seconds the switch took.
+    #
+    # Examples :-
+    #   kernel_pool.switch_to(:cruise)
+    #   kernel_pool.switch_to(:flyby)
+    #     => #<struct SpiceRub::KernelPool::Switch set=:flyby,
+    #          kept=["/data/naif0011.tls", "/data/de430.bsp"], unloaded=["/data/cruise_v2.bsp"],
+    #          loaded=["/data/flyby_v5.bsp"], seconds=0.0021>
+    #
+    def switch_to(name)
+      target = (@sets || {}).fetch(name) { raise(ArgumentError, "no kernel set named #{name}") }
+      raise(ArgumentError, "kernel sets cannot be switched in a lazy pool") if lazy?
+
+      started = Process.clock_gettime(Process::CLOCK_MONOTONIC)
+      @pool ||= []
+
+      # Reading the kinds first also fails on a missing file before the pool changes
+      kinds = target.each_with_object({}) { |file, types| types[file] = KernelCatalog.kernel_type(file) }
+      current = loaded
+      kept = kept_kernels(current, target, kinds)
+      kept_paths = kept.map { |kernel| File.expand_path(kernel.path) }
+      unloaded = current - kept
+
+      unloaded.each { |kernel| release(kernel) }
+      furnshed = (target - kept_paths).map { |file| @pool[load(file, absolute: true)] }
+      @current_set = name
+
+      Switch.new(name, kept.map(&:path), unloaded.map(&:path), furnshed.map(&:path),
+                 Process.clock_gettime(Process::CLOCK_MONOTONIC) - started)
+    end
+
+    #
+    # call-seq:
+    #     reopen! -> FixNum
+    #
+    # Gives every loaded binary kernel a file description of its own. A forked
+    # process shares open file offsets with its parent, reopening them below
+    # CSPICE keeps its handles, the native indexes and the pool generation
+    # untouched, so it costs a few system calls rather than a reload. Paths
+    # relative to the working directory must be reopened before changing it.
+    # Returns the number of kernels reopened.
+    #
+    def reopen!
+      binaries = loaded.select { |kernel| KernelCatalog.kernel_type(kernel.path) }
+
+      Native.reopen_kernels(binaries.map(&:path))
+    end
+
+    # Unloads a kernel and forgets about it
+    def release(kernel)
+      kernel.unload! if kernel.loaded?
+      @pool.delete(kernel)
+    end
+
     #
     # call-seq:
     #     clear! -> TrueClass/FalseClass
@@ -136,10 +328,14 @@ module SpiceRub
     #
     def clear!
       unless empty?
-        if SpiceRub::Native.kclear
-          self.loaded.each { |kernel| kernel.mark_unloaded }
-          @pool = []
-          return true
+        Native.defer_pool_changes do
+          if SpiceRub::Native.kclear
+            self.loaded.each { |kernel| kernel.mark_unloaded }
+            @pool = []
+            @catalog = nil
+            @restored = false
+            return true
+          end
         end
       end
       false
@@ -169,7 +365,8 @@ module SpiceRub
     # call-seq:
     #     empty? -> TrueClass/FalseClass
     # 
-    # Returns true if the number of loaded kernels is 0       
+    # Returns true if the number of loaded kernels is 0 and no snapshot has
+    # been restored since the last clear!
     #
     # Examples :-
     #   kernel_pool.clear!
@@ -179,28 +376,209 @@ module SpiceRub
     #     => true
     #
     def empty?
-      count.zero?
+      count.zero? && !@restored
+    end
+
+    #
+    # call-seq:
+    #     generation -> Integer
+    #
+    # Returns the kernel pool generation, which increases with every load,
+    # unload, clear! and snapshot restore. Values computed from the pool can
+    # be kept for as long as the generation they were computed at is current.
+    #
+    # Examples :-
+    #   generation = kernel_pool.generation
+    #   kernel_pool.load("naif0011.tls")
+    #   kernel_pool.generation > generation
+    #     => true
+    #
+    def generation
+      SpiceRub::Native.pool_generation
+    end
+
+    #
+    # call-seq:
+    #     on_change { |generation, event, kernel| ... } -> Proc
+    #
+    # Calls the block after every kernel pool change with the new generation,
+    # the event (:furnsh, :unload, :kclear or :restore) and the kernel path,
+    # nil for :kclear and :restore. Native caches are already up to date
+    # when the block runs. Returns the subscription, which can be passed to
+    # #cancel_on_change.
+    #
+    # Examples :-
+    #   kernel_pool.on_change { |generation, event, kernel| puts "#{event} #{kernel}" }
+    #   kernel_pool.load("naif0011.tls")
+    #     furnsh spec/data/kernels/naif0011.tls
+    #
+    def on_change(&block)
+      raise ArgumentError, "on_change needs a block" unless block
+
+      SpiceRub::Native.subscribe_pool(block)
+    end
+
+    # Stops calls to a block registered with #on_change
+    def cancel_on_change(subscription)
+      SpiceRub::Native.unsubscribe_pool(subscription)
     end
 
     def clear_path!
       @path = nil
     end
+
+    #
+    # call-seq:
+    #     coverage(body, kind: :spk) -> Array
+    #
+    # Returns the coverage of a body, frame class or CK instrument across the loaded
+    # binary kernels as [kernel, start, end] triples, highest priority kernel first.
+    # Coverage is indexed natively whenever a kernel is loaded, so this never reads the files.
+    #
+    # * *Arguments* :
+    #   - +body+ -> NAIF ID or body name (frame class ID for :pck, instrument ID for :ck)
+    #   - +kind+ -> One of :spk, :pck or :ck
+    #
+    # Examples :-
+    #   kernel_pool.load("moon_pa_de421_1900-2050.bpc")
+    #
+    #   kernel_pool.coverage(31006, kind: :pck)
+    #     => [["spec/data/kernels/moon_pa_de421_1900-2050.bpc", -3155716800.0, 1609416000.0]]
+    #
+    def coverage(body, kind: :spk)
+      Native.coverage(kind, naif_id(body))
+    end
+
+    #
+    # call-seq:
+    #     covers?(bodies, times, kind: :spk) -> TrueClass/FalseClass
+    #
+    # Returns true if every body has coverage at every epoch. The check runs natively
+    # against the merged coverage windows of each body, so large epoch batches are cheap.
+    #
+    # * *Arguments* :
+    #   - +bodies+ -> A body or list of bodies (NAIF IDs, names or SpiceRub::Body objects)
+    #   - +times+  -> A list of SpiceRub::Time objects or ephemeris times
+    #
+    # Examples :-
+    #   kernel_pool.covers?([:europa, :jupiter], SpiceRub::Time.linear_time_series(from, to, 1000000))
+    #     => true
+    #
+    def covers?(bodies, times, kind: :spk)
+      uncovered(bodies, times, kind: kind).empty?
+    end
+
+    # Returns the indices of the epochs in +times+ that at least one of +bodies+ does not cover
+    def uncovered(bodies, times, kind: :spk)
+      Native.coverage_gaps(kind, naif_ids(bodies), epochs(times))
+    end
+
+    #
+    # call-seq:
+    #     kernels_for(bodies, at: nil, kind: :spk) -> List of SpiceKernel objects
+    #
+    # Returns the loaded kernels that carry data for any of the bodies, optionally
+    # restricted to kernels covering the epoch +at+.
+    #
+    def kernels_for(bodies, at: nil, kind: :spk)
+      files = Native.coverage_kernels(kind, naif_ids(bodies), at && epochs([at]).first)
+      loaded.select { |kernel| files.include? kernel.path }
+    end
+
+    #
+    # call-seq:
+    #     unload_unneeded!(bodies, kind: :spk) -> List of SpiceKernel objects
+    #
+    # Unloads every loaded kernel of +kind+ that holds no data for +bodies+ and returns
+    # the kernels that were unloaded. Text kernels are never touched.
+    #
+    # Examples :-
+    #   kernel_pool.load_folder("data/mission")
+    #
+    #   kernel_pool.unload_unneeded!([:europa, :jupiter, :io])
+    #
+    def unload_unneeded!(bodies, kind: :spk)
+      needed = Native.coverage_kernels(kind, naif_ids(bodies), nil)
+      unneeded = Native.coverage_kernels(kind, nil, nil) - needed
+
+      loaded.select { |kernel| unneeded.include?(kernel.path) and kernel.unload! }
+    end
+
+    private
+
+    # For every kernel kind, the loaded kernels matching the longest leading run of
+    # +target+ that they already hold in order
+    def kept_kernels(current, target, kinds)
+      current.group_by { |kernel| kinds.fetch(File.expand_path(kernel.path)) { (KernelCatalog.kernel_type(kernel.path) rescue nil) } }
+             .flat_map do |kind, kernels|
+        paths = kernels.map { |kernel| File.expand_path(kernel.path) }
+        position = 0
+
+        target.select { |file| kinds[file] == kind }.each_with_object([]) do |file, kept|
+          index = paths[position..-1].index(file)
+          break kept unless index
+
+          kept << kernels[position + index]
+          position += index + 1
+        end
+      end
+    end
+
+    # Replaces meta-kernels by their KERNELS_TO_LOAD, a restored pool would
+    # otherwise hold the list without the kernels being loaded
+    def expand_metakernels(files)
+      files.flat_map do |file|
+        next [file] unless KernelCatalog.metakernel?(file)
+
+        KernelCatalog.kernels_in(file).each do |listed|
+          raise(ArgumentError, "nested meta-kernel #{listed} in #{file}") if KernelCatalog.metakernel?(listed)
+        end
+      end
+    end
+
+    def snapshot_key(files)
+      files.map { |file| "#{file}:#{Digest::SHA256.file(file).hexdigest}" }.join("\n")
+    end
+
+    def naif_ids(bodies)
+      Array(bodies).map { |body| naif_id(body) }
+    end
+
+    def naif_id(body)
+      case body
+      when Integer then body
+      when Body then body.code
+      else
+        Native.bodn2c(body) or raise(SpiceError, "body not found in SPICE data")
+      end
+    end
+
+    def epochs(times)
+      times.map { |time| time.is_a?(Time) ? time.et : time }
+    end
   end
 
   # SpiceKernel class, a helper object used by KernelPool to track
   # kernel files
   class SpiceKernel
     attr_reader :path_to, :loaded
+
+    # Seconds furnsh_c took to load the kernel, nil when not loaded through load
+    attr_reader :load_seconds
     
     alias :path :path_to
 
     def self.load(kernel)
-      SpiceRub::Native.furnsh(kernel) ? SpiceKernel.new(kernel) : nil
+      started = Process.clock_gettime(Process::CLOCK_MONOTONIC)
+      return nil unless SpiceRub::Native.furnsh(kernel)
+
+      SpiceKernel.new(kernel, Process.clock_gettime(Process::CLOCK_MONOTONIC) - started)
     end
 
-    def initialize(path)
+    def initialize(path, load_seconds = nil)
       @path_to = path
       @loaded  = true
+      @load_seconds = load_seconds
     end
   
     #
@@ -223,11 +601,13 @@ module SpiceRub
     #     => 2
     #   
     def unload!
-      if Native.unload(@path_to)
-        @loaded = false
-        true
-      else
-        false
+      Native.defer_pool_changes do
+        if Native.unload(@path_to)
+          @loaded = false
+          true
+        else
+          false
+        end
       end
     end
     
@@ -0,0 +1,168 @@
+#--
+# = SpiceRub
+#
+# A wrapper to the SPICE TOOLKIT for space and astronomomical
+# computation in Ruby.
+#
+#
+# == metrics.rb
+#
+# Contains the Metrics module, which renders the runtime metrics of
+# SpiceRub (native call statistics, GF search durations, loaded kernels,
+# native cache hit rates and kernel load times) as OpenMetrics text for a
+# local scraper.
+#
+#++
+
+module SpiceRub
+  module Metrics
+    # ktotal_c categories reported as spice_rub_kernels
+    KERNEL_CATEGORIES = [:SPK, :CK, :PCK, :EK, :TEXT, :META]
+
+    # Quantiles of the latency summaries
+    QUANTILES = [0.5, 0.9, 0.99]
+
+    # Geometry finder searches, reported again as their own family
+    GF_FUNCTION = /\Agf/
+
+    module_function
+
+    #
+    # call-seq:
+    #     render(pool: KernelPool.instance) -> String
+    #
+    # Returns the current metrics as OpenMetrics text. Native call metrics
+    # are only present for functions called while SpiceRub::Stats was enabled.
+    #
+    # Examples :-
+    #   SpiceRub::Stats.enable!
+    #   # ...
+    #   puts SpiceRub::Metrics.render
+    #     # TYPE spice_rub_native_calls counter
+    #     # HELP spice_rub_native_calls Calls of SpiceRub::Native functions.
+    #     spice_rub_native_calls_total{function="spkpos"} 8761
+    #     ...
+    #     # EOF
+    #
+    def render(pool: KernelPool.instance)
+      # Taken first, the ktotal calls below would otherwise show up in it
+      stats = Native.stats_snapshot
+      out = []
+
+      native_metrics(out, stats)
+      gf_metrics(out, stats.select { |function, _| function =~ GF_FUNCTION })
+      kernel_metrics(out, pool)
+      cache_metrics(out, Native.cache_stats)
+
+      out << "# EOF\n"
+      out.join
+    end
+
+    #
+    # call-seq:
+    #     write(path, pool: KernelPool.instance) -> String
+    #
+    # Renders the metrics into +path+, replacing the file atomically so a
+    # scraper never reads a partial exposition. Returns +path+.
+    #
+    def write(path, pool: KernelPool.instance)
+      temporary = "#{path}.#{Process.pid}.tmp"
+      File.write(temporary, render(pool: pool))
+      File.rename(temporary, path)
+      path
+    end
+
+    def native_metrics(out, stats)
+      family(out, "spice_rub_native_calls", :counter, "Calls of SpiceRub::Native functions.")
+      stats.each { |function, stat| sample(out, "spice_rub_native_calls_total", stat[:calls], function: function) }
+
+      family(out, "spice_rub_native_errors", :counter, "SpiceErrors raised by SpiceRub::Native functions.")
+      stats.each { |function, stat| sample(out, "spice_rub_native_errors_total", stat[:errors], function: function) }
+
+      family(out, "spice_rub_native_allocated_objects", :counter, "Ruby objects allocated during native calls.")
+      stats.each { |function, stat| sample(out, "spice_rub_native_allocated_objects_total", stat[:objects], function: function) }
+
+      family(out, "spice_rub_native_allocated_bytes", :counter, "Bytes malloc'd during native calls, approximate.")
+      stats.each { |function, stat| sample(out, "spice_rub_native_allocated_bytes_total", stat[:bytes], function: function) }
+
+      histogram(out, "spice_rub_native_call_duration_seconds", "Wall time of native calls.", stats)
+      summary(out, "spice_rub_native_call_latency_seconds", "Latency quantiles of native calls, bucket upper bounds.", stats)
+    end
+
+    def gf_metrics(out, stats)
+      histogram(out, "spice_rub_gf_search_duration_seconds", "Wall time of geometry finder searches.", stats)
+    end
+
+    def kernel_metrics(out, pool)
+      family(out, "spice_rub_kernels", :gauge, "Loaded kernels by ktotal category.")
+      KERNEL_CATEGORIES.each { |category| sample(out, "spice_rub_kernels", Native.ktotal(category), category: category) }
+
+      family(out, "spice_rub_kernel_pool_generation", :gauge, "Kernel pool generation.")
+      sample(out, "spice_rub_kernel_pool_generation", Native.pool_generation)
+
+      family(out, "spice_rub_kernel_load_seconds", :gauge, "Time furnsh took for each kernel loaded through the pool.", unit: :seconds)
+      (pool.pool || []).select { |kernel| kernel.loaded? and kernel.load_seconds }.each do |kernel|
+        sample(out, "spice_rub_kernel_load_seconds", kernel.load_seconds, kernel: kernel.path)
+      end
+    end
+
+    def cache_metrics(out, caches)
+      family(out, "spice_rub_cache_hits", :counter, "Hits of the native caches.")
+      caches.each { |cache, (hits, _)| sample(out, "spice_rub_cache_hits_total", hits, cache: cache) }
+
+      family(out, "spice_rub_cache_misses", :counter, "Misses of the native caches.")
+      caches.each { |cache, (_, misses)| sample(out, "spice_rub_cache_misses_total", misses, cache: cache) }
+
+      family(out, "spice_rub_cache_hit_ratio", :gauge, "Share of native cache lookups that hit.")
+      caches.each do |cache, (hits, misses)|
+        sample(out, "spice_rub_cache_hit_ratio", hits + misses > 0 ? hits.to_f / (hits + misses) : 0.0, cache: cache)
+      end
+    end
+
+    # Histogram buckets of the native statistics, bucket b ends at 2**b ns and the last one is +Inf
+    def histogram(out, name, help, stats)
+      family(out, name, :histogram, help, unit: :seconds)
+
+      stats.each do |function, stat|
+        cumulative = 0
+        stat[:histogram][0...-1].each_with_index do |count, bucket|
+          cumulative += count
+          sample(out, "#{name}_bucket", cumulative, function: function, le: (2 ** bucket) * 1e-9)
+        end
+        sample(out, "#{name}_bucket", stat[:calls], function: function, le: "+Inf")
+        sample(out, "#{name}_count", stat[:calls], function: function)
+        sample(out, "#{name}_sum", stat[:total_ns] * 1e-9, function: function)
+      end
+    end
+
+    def summary(out, name, help, stats)
+      family(out, name, :summary, help, unit: :seconds)
+
+      stats.each do |function, stat|
+        QUANTILES.each do |quantile|
+          sample(out, name, Stats.percentile(stat[:histogram], quantile) * 1e-9, function: function, quantile: quantile)
+        end
+        sample(out, "#{name}_count", stat[:calls], function: function)
+        sample(out, "#{name}_sum", stat[:total_ns] * 1e-9, function: function)
+      end
+    end
+
+    def family(out, name, type, help, unit: nil)
+      out << "# TYPE #{name} #{type}\n"
+      out << "# UNIT #{name} #{unit}\n" if unit
+      out << "# HELP #{name} #{help}\n"
+    end
+
+    def sample(out, name, value, labels = {})
+      pairs = labels.map { |label, text| "#{label}=\"#{escape(text.to_s)}\"" }
+      out << "#{name}#{pairs.empty? ? "" : "{#{pairs.join(",")}}"} #{value}\n"
+    end
+
+    def escape(text)
+      text.gsub("\\", "\\\\\\\\").gsub("\"", "\\\"").gsub("\n", "\\n")
+    end
+
+    private_class_method :native_metrics, :gf_metrics, :kernel_metrics, :cache_metrics,
+                         :histogram, :summary, :family, :sample, :escape
+  end
+end
@@ -0,0 +1,113 @@
+#--
+# = SpiceRub
+#
+# A wrapper to the SPICE TOOLKIT for space and astronomomical
+# computation in Ruby.
+#
+#
+# == quantity.rb
+#
+# Contains the Quantity module, which builds the quantity expressions
+# searched by the user defined geometry finder natives (gfuds, gfudb,
+# gfuds_batch).
+# Expressions are compiled and evaluated natively, a search never calls
+# back into Ruby.
+#
+#++
+
+module SpiceRub
+  module Quantity
+    module_function
+
+    #
+    # call-seq:
+    #     position(target, observer, frame: :J2000, abcorr: :NONE) -> expression
+    #
+    # Position of +target+ relative to +observer+, a vector. Bodies are names
+    # or NAIF codes.
+    #
+    def position(target, observer, frame: :J2000, abcorr: :NONE)
+      [:position, target, observer, frame, abcorr]
+    end
+
+    def velocity(target, observer, frame: :J2000, abcorr: :NONE)
+      [:velocity, target, observer, frame, abcorr]
+    end
+
+    def vector(x, y, z)
+      [:vector, x, y, z]
+    end
+
+    # +vector+ rotated from frame +from+ to frame +to+ at the epoch evaluated
+    def rotate(vector, from, to)
+      [:rotate, vector, from, to]
+    end
+
+    #
+    # call-seq:
+    #     range_rate(target, observer, frame: :J2000, abcorr: :NONE) -> expression
+    #
+    # Rate of change of the distance between +target+ and +observer+, in km/s.
+    #
+    # Examples :-
+    #   receding = SpiceRub::Quantity.range_rate(:MOON, :EARTH)
+    #   SpiceRub::Native.gfuds(receding, :>, 0, 0, spd, 100, confines)
+    #
+    def range_rate(target, observer, frame: :J2000, abcorr: :NONE)
+      dot(velocity(target, observer, frame: frame, abcorr: abcorr), unit(position(target, observer, frame: frame, abcorr: abcorr)))
+    end
+
+    #
+    # call-seq:
+    #     phase_angle(target, illum, observer, abcorr: :NONE) -> expression
+    #
+    # Angle at +target+ between +observer+ and +illum+, in radians, the
+    # quantity gfpa searches without aberration corrections.
+    #
+    def phase_angle(target, illum, observer, abcorr: :NONE)
+      angle(position(observer, target, abcorr: abcorr), position(illum, target, abcorr: abcorr))
+    end
+
+    [:add, :sub, :mul, :div, :dot, :angle, :cross, :lt, :gt, :and, :or].each do |operation|
+      define_method(operation) { |first, second| [operation, first, second] }
+      module_function operation
+    end
+
+    [:neg, :norm, :unit, :abs, :sqrt, :not].each do |operation|
+      define_method(operation) { |argument| [operation, argument] }
+      module_function operation
+    end
+
+    def component(vector, index)
+      [:component, vector, index]
+    end
+
+    #
+    # call-seq:
+    #     values(expression, ets) -> N x 1 NMatrix
+    #
+    # Evaluates +expression+ at every epoch of +ets+, exactly as the GF
+    # searches do.
+    #
+    def values(expression, ets)
+      Native.quantity_values(expression, ets)
+    end
+
+    #
+    # call-seq:
+    #     search(expression, thresholds, confines, step:, adjust: 0, intervals: 100) -> Array of intervals
+    #
+    # Searches +expression+ against every [relate, refval] pair of
+    # +thresholds+ in one native call, the values computed for one threshold
+    # are reused by the others. Returns the intervals of each threshold, in
+    # order.
+    #
+    # Examples :-
+    #   distance = SpiceRub::Quantity.norm(SpiceRub::Quantity.position(:MOON, :EARTH))
+    #   near, far = SpiceRub::Quantity.search(distance, [[:<, 370000], [:>, 400000]], confines, step: spd)
+    #
+    def search(expression, thresholds, confines, step:, adjust: 0, intervals: 100)
+      Native.gfuds_batch(expression, thresholds, adjust, step, intervals, confines)
+    end
+  end
+end
@@ -0,0 +1,113 @@
+#--
+# = SpiceRub
+#
+# A wrapper to the SPICE TOOLKIT for space and astronomomical
+# computation in Ruby.
+#
+#
+# == search.rb
+#
+# Contains the Search class, which runs geometry finder searches
+# (SpiceRub::Native.gfdist, gfoclt, ...) with progress reporting,
+# cancellation and a time budget.
+#
+#++
+
+module SpiceRub
+  class Search
+    # CSPICE's geometry finder is global, one controlled search at a time
+    LOCK = Mutex.new
+
+    attr_reader :budget
+
+    #
+    # call-seq:
+    #     new(budget: nil) { |fraction, et| ... } -> Search
+    #
+    # A search control stopping the GF searches it runs after +budget+
+    # seconds (no limit for nil). The block, when given, is called with the
+    # fraction of the confinement window searched and the epoch reached, at
+    # least every hundredth of the window. Searches made of several passes
+    # report each pass from 0 to 1.
+    #
+    def initialize(budget: nil, &progress)
+      @budget = budget
+      @progress = progress
+      @status = :idle
+      @fraction = 0.0
+      @running = false
+      @cancelled = false
+    end
+
+    #
+    # call-seq:
+    #     run { |search| ... } -> result of the block
+    #
+    # Runs the GF searches of the block under this control. Once cancelled or
+    # out of budget, the running search returns the intervals found so far and
+    # later ones in the block return at once; #status tells which happened.
+    # An exception raised by the progress block stops the search and is raised
+    # from run. Other threads may run while the progress block does, but
+    # CSPICE's geometry finder is not reentrant: a GF search started then,
+    # from another thread or the block itself, raises RuntimeError. Searches
+    # other threads run between the searches of the block are not controlled.
+    # A signal or Thread#raise pending for this thread stops the search as
+    # cancelled and is raised once it returned.
+    #
+    # Examples :-
+    #   search = SpiceRub::Search.new(budget: 60) { |fraction, _| print "\r#{(fraction * 100).round}%" }
+    #   windows = search.run do
+    #     SpiceRub::Native.gfdist(:MOON, :NONE, :EARTH, :<, 400000, 0, spd, 100, confines)
+    #   end
+    #   search.status
+    #     => :complete
+    #
+    def run
+      raise ArgumentError, "no block given" unless block_given?
+
+      LOCK.synchronize do
+        Native.gf_control(@budget, @progress)
+        @running = true
+        Native.gf_cancel if @cancelled
+
+        begin
+          yield self
+        ensure
+          @running = false
+          @status, @fraction = Native.gf_release
+        end
+      end
+    end
+
+    # Stops the running search from the progress block, or the searches
+    # that follow from another thread
+    def cancel
+      @cancelled = true
+      Native.gf_cancel if @running
+      self
+    end
+
+    # :idle, :running, :complete, :timed_out or :cancelled
+    def status
+      @running ? Native.gf_status[0] : @status
+    end
+
+    # Fraction of the confinement window the current or last search covered
+    def fraction
+      @running ? Native.gf_status[1] : @fraction
+    end
+
+    def cancelled?
+      @cancelled
+    end
+
+    def complete?
+      status == :complete
+    end
+
+    # Whether the searches returned partial results
+    def partial?
+      [:timed_out, :cancelled].include?(status)
+    end
+  end
+end
@@ -12,8 +12,16 @@ end
 
 #Load all Ruby classes
 require_relative './kernel_pool.rb'
+require_relative './kernel_catalog.rb'
 require_relative './base_point.rb'
 require_relative './cartesian_point.rb'
 require_relative './body.rb'
 require_relative './time.rb'
+require_relative './fork_server.rb'
+require_relative './context.rb'
+require_relative './stats.rb'
+require_relative './metrics.rb'
+require_relative './search.rb'
+require_relative './survey.rb'
+require_relative './quantity.rb'
 
@@ -0,0 +1,103 @@
+#--
+# = SpiceRub
+#
+# A wrapper to the SPICE TOOLKIT for space and astronomomical
+# computation in Ruby.
+#
+#
+# == stats.rb
+#
+# Contains the Stats module, the Ruby interface to the native call
+# statistics: per function call and SpiceError counts, wall time with a
+# log2 latency histogram, and Ruby objects and bytes allocated.
+#
+#++
+
+module SpiceRub
+  module Stats
+    module_function
+
+    #
+    # call-seq:
+    #     enable! -> true
+    #
+    # Starts counting calls of SpiceRub::Native functions. While disabled the
+    # natives are called directly and cost nothing extra. Setting the
+    # SPICE_RUB_STATS environment variable enables counting at load time.
+    #
+    def enable!
+      Native.stats_enable(true)
+    end
+
+    def disable!
+      Native.stats_enable(false)
+    end
+
+    def enabled?
+      Native.stats_enabled?
+    end
+
+    #
+    # call-seq:
+    #     snapshot -> Hash
+    #
+    # Returns the statistics of every native function called since the last
+    # reset, keyed by function name. histogram[b] counts the calls that took
+    # less than 2**b nanoseconds.
+    #
+    # Examples :-
+    #   SpiceRub::Stats.snapshot[:spkpos]
+    #     => {:calls=>8761, :errors=>0, :total_ns=>61250311, :objects=>26283, :bytes=>1472128,
+    #         :histogram=>[0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 8580, 170, 11, 0, ...]}
+    #
+    def snapshot
+      Native.stats_snapshot
+    end
+
+    def reset
+      Native.stats_reset
+    end
+
+    #
+    # call-seq:
+    #     measure { ... } -> Hash
+    #
+    # Counts the native calls made by the block alone and returns their
+    # snapshot, leaving counting as it was before.
+    #
+    def measure
+      was_enabled = enabled?
+      enable!
+      reset
+      yield
+      snapshot
+    ensure
+      disable! unless was_enabled
+    end
+
+    #
+    # call-seq:
+    #     percentile(histogram, quantile) -> Integer
+    #
+    # Upper bound in nanoseconds of the histogram bucket holding +quantile+
+    # (0.0 to 1.0) of the calls, nil for an empty histogram.
+    #
+    # Examples :-
+    #   SpiceRub::Stats.percentile(SpiceRub::Stats.snapshot[:spkpos][:histogram], 0.99)
+    #     => 16384
+    #
+    def percentile(histogram, quantile)
+      total = histogram.sum
+      return nil if total.zero?
+
+      rank = (quantile * total).ceil.clamp(1, total)
+      seen = 0
+      histogram.each_with_index do |count, bucket|
+        seen += count
+        return 2 ** bucket if seen >= rank
+      end
+    end
+  end
+
+  Stats.enable! if ENV['SPICE_RUB_STATS']
+end
@@ -0,0 +1,149 @@
+#--
+# = SpiceRub
+#
+# A wrapper to the SPICE TOOLKIT for space and astronomomical
+# computation in Ruby.
+#
+#
+# == survey.rb
+#
+# Contains the Survey class, which runs a long geometry finder search
+# chunk by chunk over its confinement window and keeps the results found so
+# far in a checkpoint file, so an interrupted survey resumes where it
+# stopped instead of starting over.
+#
+#++
+
+require 'json'
+
+module SpiceRub
+  class Survey
+    CHECKPOINT_VERSION = 1
+
+    attr_reader :path, :confines, :chunk, :key, :cursor, :intervals
+
+    #
+    # call-seq:
+    #     new(path, confines, chunk:, key: nil) { |window| ... } -> Survey
+    #
+    # A survey of +confines+ ([start, end] in ET seconds) in chunks of
+    # +chunk+ seconds. The block runs the search over one chunk, given as
+    # [start, end], and returns its intervals like the GF natives do. +key+
+    # names the search in the checkpoint so a file left by another survey is
+    # never resumed by mistake.
+    #
+    # Chunks start at fixed offsets from the start of +confines+, so a
+    # resumed survey returns exactly what an uninterrupted one does, and
+    # intervals ending at a chunk boundary are joined with the ones that
+    # continue into the next chunk. Results agree with a single search over
+    # the whole window within the GF convergence tolerance. Searches for
+    # absolute extrema do not split into chunks, and the search step must
+    # be smaller than a chunk.
+    #
+    # An existing checkpoint at +path+ is resumed.
+    #
+    # Examples :-
+    #   survey = SpiceRub::Survey.new("occultations.json", decade, chunk: 90 * spd, key: "moon-sun") do |window|
+    #     SpiceRub::Native.gfoclt(:any, :MOON, :Ellipsoid, :IAU_MOON, :Sun, :Ellipsoid, :IAU_SUN,
+    #                             :lt, :earth, 180.0, window)
+    #   end
+    #   survey.run
+    #
+    def initialize(path, confines, chunk:, key: nil, &search)
+      raise ArgumentError, "no search block given" unless search
+      raise ArgumentError, "chunk must be positive" unless chunk > 0
+
+      @path = path
+      @confines = confines.map(&:to_f)
+      @chunk = chunk.to_f
+      @key = key && key.to_s
+      @search = search
+      @cursor = @confines[0]
+      @intervals = []
+
+      resume if File.exist?(path)
+    end
+
+    #
+    # call-seq:
+    #     run(control = nil) -> Array of [start, end] intervals
+    #
+    # Searches the remaining chunks, writing the checkpoint after each one,
+    # and returns every interval found. With a SpiceRub::Search as +control+
+    # every chunk runs under it, and once it is cancelled or out of budget
+    # run returns the intervals of the chunks completed so far; the partial
+    # chunk is searched again on the next run.
+    #
+    def run(control = nil)
+      until complete?
+        window = [@cursor, [@confines[0] + chunks_done.succ * @chunk, @confines[1]].min]
+
+        found = control ? control.run { @search.call(window) } : @search.call(window)
+        break if control and not control.complete?
+
+        add(found)
+        @cursor = window[1]
+        save
+      end
+
+      @intervals
+    end
+
+    def complete?
+      @cursor >= @confines[1]
+    end
+
+    # Fraction of the confinement window searched
+    def fraction
+      span = @confines[1] - @confines[0]
+      span > 0 ? (@cursor - @confines[0]) / span : 1.0
+    end
+
+    # Deletes the checkpoint file
+    def discard
+      File.delete(@path) if File.exist?(@path)
+    end
+
+    private
+
+    def chunks_done
+      ((@cursor - @confines[0]) / @chunk).round
+    end
+
+    # Appends a chunk's intervals, joining one that continues an interval ending at the chunk boundary
+    def add(found)
+      Array(found).each do |start, finish|
+        if @intervals.any? and @intervals.last[1] == start
+          @intervals.last[1] = finish
+        else
+          @intervals << [start, finish]
+        end
+      end
+    end
+
+    def resume
+      checkpoint = JSON.parse(File.read(@path))
+
+      unless checkpoint["version"] == CHECKPOINT_VERSION and checkpoint["confines"] == @confines and
+             checkpoint["chunk"] == @chunk and checkpoint["key"] == @key
+        raise ArgumentError, "#{@path} is the checkpoint of another survey"
+      end
+
+      @cursor = checkpoint["cursor"]
+      @intervals = checkpoint["intervals"]
+    end
+
+    # Replaces the checkpoint atomically, synced so it survives the machine going down
+    def save
+      temporary = "#{@path}.#{Process.pid}.tmp"
+
+      File.open(temporary, "w") do |file|
+        file.write(JSON.generate(version: CHECKPOINT_VERSION, key: @key, confines: @confines, chunk: @chunk,
+                                 cursor: @cursor, intervals: @intervals))
+        file.fsync
+      end
+
+      File.rename(temporary, @path)
+    end
+  end
+end
@@ -45,6 +45,31 @@ describe SpiceRub::Body do
     end
   end   
   
+  describe ".[]" do
+    context "When asking for the same body by name and by code" do
+      subject { SpiceRub::Body[:earth] }
+
+      it { is_expected.to equal SpiceRub::Body[399] }
+      it { is_expected.to be_frozen }
+      its(:code) { is_expected.to eq 399 }
+    end
+
+    context "When the kernel pool changes" do
+      let!(:shared) { SpiceRub::Body[:moon] }
+
+      before { @moon_frames = kernel_pool[kernel_pool.load(TEST_MOON_FRAME_KERNEL, absolute: true)] }
+      after { kernel_pool.release(@moon_frames) }
+
+      it { expect(SpiceRub::Body[:moon]).not_to equal shared }
+    end
+
+    context "When the body is unknown" do
+      subject { SpiceRub::Body[:not_a_body] }
+
+      it { expect { subject }.to raise_error(SpiceError) }
+    end
+  end
+
   describe "#name" do
     subject { test_body.name }
 
@@ -117,116 +142,292 @@ describe SpiceRub::Body do
       it { is_expected.to ary_be_within(0.00001).of expected } 
     end
   end
+
+  describe "#position_matrix" do
+    let(:epochs) { [SpiceRub::Time.new(63115264.183926724), SpiceRub::Time.from_tuple(2003)] }
+    let(:expected) { [[-26468759.987443946 , 132758515.23566052 ,57556707.27832857 ],
+                      [-25809909.67316544  , 132873488.07979764 ,57606479.637514375]] }
+
+    context "When computing positions at multiple epochs" do
+      subject { test_body.position_matrix(epochs) }
+
+      its(:shape) { is_expected.to eq [2, 3] }
+      it { expect(subject.to_a).to ary_be_within(0.00001).of expected }
+    end
+
+    context "When epochs are a float64 NMatrix" do
+      subject { test_body.position_matrix(NMatrix.new([2, 1], epochs.map(&:et), dtype: :float64)) }
+
+      it { expect(subject.to_a).to ary_be_within(0.00001).of expected }
+    end
+
+    context "When an output matrix is given" do
+      let(:out) { NMatrix.new([2, 3], 0.0, dtype: :float64) }
+      subject { test_body.position_matrix(epochs, out: out) }
+
+      it { is_expected.to equal out }
+      it { subject; expect(out.to_a).to ary_be_within(0.00001).of expected }
+    end
+
+    context "When there are no epochs" do
+      it { expect(test_body.position_matrix([]).shape).to eq [0, 3] }
+      it { expect(test_body.state_matrix([]).shape).to eq [0, 6] }
+    end
+
+    context "When the output matrix has the wrong shape" do
+      subject { test_body.position_matrix(epochs, out: NMatrix.new([3, 2], 0.0, dtype: :float64)) }
+
+      it { expect { subject }.to raise_error(ArgumentError) }
+    end
+
+    context "When the output matrix is not float64" do
+      subject { test_body.position_matrix(epochs, out: NMatrix.new([2, 3], 0.0, dtype: :float32)) }
+
+      it { expect { subject }.to raise_error(TypeError) }
+    end
+  end
+
+  describe ".snapshot" do
+    let(:ids) { [199, 299, 399, 499, 301, 10, 5] }
+    let(:epoch) { SpiceRub::Time.parse("2006 JAN 31 01:00") }
+
+    context "When taking a snapshot at one epoch" do
+      subject { SpiceRub::Body.snapshot(ids, epoch, observer: :earth, frame: :ECLIPJ2000) }
+
+      its(:shape) { is_expected.to eq [7, 6] }
+
+      it "matches each body's state" do
+        ids.each_with_index do |id, row|
+          expected = SpiceRub::Body.new(id).state_matrix([epoch], observer: :earth, frame: :ECLIPJ2000)
+          expect(subject.to_a[row]).to ary_be_within(0.000001).of expected.to_a[0]
+        end
+      end
+    end
+
+    context "When taking snapshots at several epochs" do
+      let(:epochs) { [epoch.et, epoch.et + 86400.0] }
+      subject { SpiceRub::Body.snapshot(ids, epochs, observer: :sun, velocities: false, aberration_correction: :lt) }
+
+      its(:shape) { is_expected.to eq [2, 7, 3] }
+      it { expect(subject[1, 4, 0..2].to_a.flatten).to ary_be_within(0.000001).of SpiceRub::Body.new(301).position_matrix([epochs[1]], aberration_correction: :lt).to_a[0] }
+    end
+  end
+
+  describe ".query" do
+    let(:random) { Random.new(7) }
+    let(:targets) { Array.new(200) { [:mars, 301, 5, :earth].sample(random: random) } }
+    let(:epochs) { Array.new(200) { 63115264.183926724 + random.rand * 1.0e8 } }
+
+    context "When rows come in random order" do
+      let(:expected) { SpiceRub::Body.query(targets, :sun, epochs, plan: false) }
+      subject { SpiceRub::Body.query(targets, :sun, epochs) }
+
+      it { expect(subject.to_a).to eq expected.to_a }
+
+      it "returns rows in input order" do
+        [0, 57, 199].each do |row|
+          expect(subject.to_a[row]).to ary_be_within(0.000001).of SpiceRub::Body.new(targets[row]).state_matrix([epochs[row]]).to_a[0]
+        end
+      end
+    end
+
+    context "When observers differ per row" do
+      let(:observers) { Array.new(200) { |i| i.even? ? :sun : SpiceRub::Body.new(:moon) } }
+      subject { SpiceRub::Body.query(targets, observers, epochs, velocities: false, with_light_time: true) }
+
+      it { expect(subject[0].shape).to eq [200, 3] }
+      it { expect(subject[1].to_a.flatten[1]).to be_within(0.000001).of SpiceRub::Body.new(targets[1]).position_matrix([epochs[1]], observer: :moon, with_light_time: true)[1][0] }
+    end
+
+    context "When there are fewer targets than epochs" do
+      subject { SpiceRub::Body.query(targets.first(10), :sun, epochs) }
+
+      it { expect { subject }.to raise_error(ArgumentError) }
+    end
+  end
+
+  describe "warm started light time" do
+    let(:mars) { SpiceRub::Body.new(:mars) }
+    let(:epochs) { (0...300).map { |i| 63115264.183926724 + i * 600.0 } }
+
+    [[:cn, 0.000001], [:"XCN+S", 0.000001], [:lt, 0.001], [:"lt+s", 0.001]].each do |correction, tolerance|
+      context "When correcting for #{correction}" do
+        let(:expected) { mars.position_matrix(epochs, observer: :earth, aberration_correction: correction, with_light_time: true) }
+        subject { mars.position_matrix(epochs, observer: :earth, aberration_correction: correction, with_light_time: true, warm_start: true) }
+
+        it { expect(subject[0].to_a).to ary_be_within(tolerance).of expected[0].to_a }
+        it { expect(subject[1].to_a).to ary_be_within(tolerance / 100000).of expected[1].to_a }
+      end
+    end
+
+    context "When the output frame rotates" do
+      let(:expected) { mars.position_matrix(epochs, observer: :earth, frame: :IAU_EARTH, aberration_correction: :cn) }
+      subject { mars.position_matrix(epochs, observer: :earth, frame: :IAU_EARTH, aberration_correction: :cn, warm_start: true) }
+
+      it { expect(subject.to_a).to ary_be_within(0.000001).of expected.to_a }
+    end
+
+    context "When evaluating a dense series" do
+      subject { SpiceRub::Native.spkpos_lt_batch(:mars, epochs, :J2000, :cn, :earth, nil)[2] }
+
+      it { is_expected.to be < 2.5 * epochs.length }
+    end
+
+    context "When no light time correction is requested" do
+      subject { mars.position_matrix(epochs, aberration_correction: :none, warm_start: true) }
+
+      it { expect { subject }.to raise_error(ArgumentError) }
+    end
+  end
+
+  describe "native SPK reader" do
+    let(:epochs) { (0...500).map { |i| 63115264.183926724 + i * 3600.0 } }
+
+    context "When computing positions on several threads" do
+      let(:expected) { test_body.position_matrix(epochs, observer: :moon) }
+      subject { test_body.position_matrix(epochs, observer: :moon, threads: 4) }
+
+      it { expect(subject.to_a).to ary_be_within(0.000001).of expected.to_a }
+    end
+
+    context "When computing states in another inertial frame" do
+      let(:expected) { test_body.state_matrix(epochs, frame: :ECLIPJ2000) }
+      subject { test_body.state_matrix(epochs, frame: :ECLIPJ2000, threads: nil) }
+
+      it { expect(subject.to_a).to ary_be_within(0.000001).of expected.to_a }
+    end
+
+    context "When an epoch is outside the loaded ephemerides" do
+      subject { test_body.position_matrix([1.0e12], threads: 2) }
+
+      it { expect { subject }.to raise_error(SpiceError) }
+    end
+
+    context "When an aberration correction is requested" do
+      subject { test_body.position_matrix(epochs, aberration_correction: :lt, threads: 2) }
+
+      it { expect { subject }.to raise_error(ArgumentError) }
+    end
+  end
+
+  describe ".state_tensor" do
+    let(:targets) { [:mars, SpiceRub::Body.new(:moon), 5] }
+    let(:observers) { [test_body, :sun] }
+    let(:epochs) { [SpiceRub::Time.new(63115264.183926724), SpiceRub::Time.from_tuple(2003), SpiceRub::Time.from_tuple(2004)] }
+    let(:names) { [:mars, :moon, :jupiter_barycenter] }
+
+    [[:J2000, :none], [:ECLIPJ2000, :"lt+s"], [:IAU_EARTH, :cn]].each do |frame, correction|
+      context "When computing #{correction} states in #{frame}" do
+        subject { SpiceRub::Body.state_tensor(targets, observers, epochs, frame: frame, aberration_correction: correction, with_light_time: true) }
+
+        it "matches pairwise state matrices" do
+          states, light_times = subject
+          expect(states.shape).to eq [3, 2, 3, 6]
+
+          names.each_with_index do |name, i|
+            [:earth, :sun].each_with_index do |observer, j|
+              expected, expected_light_times = SpiceRub::Body.new(name).state_matrix(epochs, observer: observer, frame: frame, aberration_correction: correction, with_light_time: true)
+
+              expect(states[i, j, 0..2, 0..5].to_a.flatten).to ary_be_within(0.0001).of expected.to_a.flatten
+              expect(light_times[i, j, 0..2].to_a.flatten).to ary_be_within(0.000001).of expected_light_times.to_a.flatten
+            end
+          end
+        end
+      end
+    end
+
+    context "When an output tensor has the wrong shape" do
+      subject { SpiceRub::Body.position_tensor(targets, observers, epochs, out: NMatrix.new([3, 2, 3, 6], 0.0, dtype: :float64)) }
+
+      it { expect { subject }.to raise_error(ArgumentError) }
+    end
+  end
+
+  #Velocity of target by a central difference of spkpos over two seconds, good to well under a metre per second
+  def velocity_by_difference(target, et, observer: :sun, frame: :J2000)
+    before, after = [et - 1, et + 1].map { |epoch| SpiceRub::Native.spkpos(target, epoch, frame, :none, observer)[0].to_a.flatten }
+    after.zip(before).map { |a, b| (a - b) / 2 }
+  end
+
+  #State of target from spkpos, the position at et followed by velocity_by_difference
+  def state_by_difference(target, et, observer: :sun, frame: :J2000)
+    SpiceRub::Native.spkpos(target, et, frame, :none, observer)[0].to_a.flatten + velocity_by_difference(target, et, observer: observer, frame: frame)
+  end
+
   describe "#state_at" do
 
     context "When all parameters are specified" do
-      let(:expected) {  NMatrix.new([6,1], [
-                                            -97579460.22494915, 
-                                            -111325884.19041583, 
-                                            -53609500.96053864,
-                                             191941265.18476546, 
-                                                              0, 
-                                                              0
-                                           ] ) 
-                     }
-      
-      subject { SpiceRub::Body.new(:moon).state_at(SpiceRub::Time.parse("2006 JAN 31 01:00"), observer: :MARS, frame: :J2000, aberration_correction: :NONE) }
-      
-      it { is_expected.to be_within(0.00000001).of expected }
+      let(:time) { SpiceRub::Time.parse("2006 JAN 31 01:00") }
+      let(:expected) { state_by_difference(:moon, time.et, observer: :mars) }
+
+      subject { SpiceRub::Body.new(:moon).state_at(time, observer: :MARS, frame: :J2000, aberration_correction: :NONE) }
+
+      it { expect(subject.to_a.flatten).to ary_be_within(0.0001).of expected }
     end
 
     context "When computing state of a body at an epoch" do
-      let(:expected) { [
-                        NMatrix.new([6,1] , [
-                                              -26468760.60299247,
-                                              132758515.52645776,
-                                               57556706.30607039,
-                                              63115264.183926724,
-                                                               0,
-                                                               0
-                                            ] ) ,
-                        490.6703256499084
-                       ]
-                     }
+      let(:expected) { state_by_difference(:earth, 63115264.183926724) }
 
       context "when epoch is a time tuple" do
         subject { test_body.state_at(SpiceRub::Time.from_tuple(2002), with_light_time: true) }
-      
-        it { is_expected.to ary_be_within(0.00001).of expected }
+
+        it { expect(subject[0].to_a.flatten).to ary_be_within(0.0001).of expected }
+        it { expect(subject[1]).to be_within(0.00001).of 490.6703256499084 }
       end
 
       context "when epoch is seconds past J2000 Epoch" do
         subject { test_body.state_at(SpiceRub::Time.new(63115264.183926724), with_light_time: true) }
-      
-        it { is_expected.to ary_be_within(0.00001).of expected }
-      end      
+
+        it { expect(subject[0].to_a.flatten).to ary_be_within(0.0001).of expected }
+        it { expect(subject[1]).to be_within(0.00001).of 490.6703256499084 }
+      end
     end
   end
 
   describe "#states_at" do
     context "When computing states of a body at multiple epochs in input array" do
-      let(:expected) { [
-                        NMatrix.new([6,1] ,[-26468759.987443946 , 132758515.23566052 ,57556707.27832857 , 0,0,0 ]),
-                        NMatrix.new([6,1] ,[-25809909.67316544  , 132873488.07979764 ,57606479.637514375, 0,0,0 ])
-                       ]
-                      }
+      let(:epochs) { [SpiceRub::Time.new(63115264.183926724), SpiceRub::Time.from_tuple(2003)] }
+      subject { test_body.states_at(epochs) }
 
-      subject { test_body.states_at([SpiceRub::Time.new(63115264.183926724), SpiceRub::Time.from_tuple(2003)]) }
-
-      it { is_expected.to ary_be_within(0.00001).of expected } 
+      it { expect(subject.map { |state| state.to_a.flatten }).to ary_be_within(0.0001).of epochs.map { |epoch| state_by_difference(:earth, epoch.et) } }
     end
-  end    
+  end
 
   describe "#velocity_at" do
     context "When all parameters are specified" do
-      let(:expected) {  NMatrix.new([3,1], [ 
-                                             91941265.18476546, 
-                                             0, 
-                                             0
-                                           ]  ) 
-                     }
-      
-      subject { SpiceRub::Body.new(:moon).velocity_at(SpiceRub::Time.parse("2006 JAN 31 01:00"), observer: :MARS, frame: :J2000, aberration_correction: :NONE) }
-      
-      it { is_expected.to be_within(0.00000001).of expected }
+      let(:time) { SpiceRub::Time.parse("2006 JAN 31 01:00") }
+
+      subject { SpiceRub::Body.new(:moon).velocity_at(time, observer: :MARS, frame: :J2000, aberration_correction: :NONE) }
+
+      it { expect(subject.to_a.flatten).to ary_be_within(0.0001).of velocity_by_difference(:moon, time.et, observer: :mars) }
     end
 
     context "When computing velocity of a body at an epoch" do
-      let(:expected) { [
-                        NMatrix.new([3,1] , [
-                                            63115264.183926724,
-                                                             0,
-                                                             0
-                                            ] ) ,
-                        490.6703256499084
-                       ]
-                     }
+      let(:expected) { velocity_by_difference(:earth, 63115264.183926724) }
 
       context "when epoch is a time tuple" do
         subject { test_body.velocity_at(SpiceRub::Time.from_tuple(2002), with_light_time: true) }
-      
-        it { is_expected.to ary_be_within(0.00001).of expected }
+
+        it { expect(subject[0].to_a.flatten).to ary_be_within(0.0001).of expected }
+        it { expect(subject[1]).to be_within(0.00001).of 490.6703256499084 }
       end
 
       context "when epoch is seconds past J2000 Epoch" do
         subject { test_body.velocity_at(SpiceRub::Time.new(63115264.183926724), with_light_time: true) }
-      
-        it { is_expected.to ary_be_within(0.00001).of expected }
+
+        it { expect(subject[0].to_a.flatten).to ary_be_within(0.0001).of expected }
+        it { expect(subject[1]).to be_within(0.00001).of 490.6703256499084 }
       end
     end
   end
 
   describe "#velocities_at" do
     context "When computing velocities of a body at multiple epochs in input array" do
-      let(:expected) { [ NMatrix.new([3,1], 0.0),
-                         NMatrix.new([3,1], 0.0)
-                       ] 
-                     }
+      let(:epochs) { [SpiceRub::Time.new(63115264.183926724), SpiceRub::Time.from_tuple(2003)] }
 
-      subject { test_body.velocities_at([SpiceRub::Time.new(63115264.183926724), 
-                                       SpiceRub::Time.from_tuple(2003)]) }
-      
-      it { is_expected.to ary_be_within(0.00001).of expected } 
+      subject { test_body.velocities_at(epochs) }
+
+      it { expect(subject.map { |velocity| velocity.to_a.flatten }).to ary_be_within(0.0001).of epochs.map { |epoch| velocity_by_difference(:earth, epoch.et) } }
     end
   end
 
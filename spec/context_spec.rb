@@ -0,0 +1,102 @@
+# == context_spec.rb
+#
+# Tests for the Context class, every context forks its own workers from the
+# spec process and the spec process' kernel pool must stay untouched
+
+require "spec_helper"
+require "timeout"
+
+describe SpiceRub::Context do
+  let(:kernel_pool) { SpiceRub::KernelPool.instance }
+  let(:path) { 'spec/data/kernels' }
+
+  before do
+    kernel_pool.clear! unless kernel_pool.empty?
+    kernel_pool.path = path
+    kernel_pool.load(TEST_TLS_KERNEL)
+  end
+
+  after { kernel_pool.clear! }
+
+  context "When two contexts hold different kernel sets" do
+    let(:times) { SpiceRub::Context.new([TEST_TLS_KERNEL], path: path) }
+    let(:moon) { SpiceRub::Context.new([TEST_TLS_KERNEL, TEST_PCK_KERNEL[0]], path: path, workers: 2) }
+
+    after do
+      times.close
+      moon.close
+    end
+
+    it { expect(times.ktotal(:all)).to eq 1 }
+    it { expect(moon.call(:ktotal, :all)).to eq 2 }
+    it { expect(moon.pids.uniq.length).to eq 2 }
+    it { expect(moon.pids).not_to include Process.pid }
+
+    it "leaves the calling process' kernel pool alone" do
+      times.ktotal(:all)
+      moon.ktotal(:all)
+
+      expect(kernel_pool.count).to eq 1
+    end
+
+    it "serves calls from several threads" do
+      results = 4.times.map { |day| Thread.new { moon.str2et("2006 JAN #{day + 1}") } }.map(&:value)
+
+      expect(results).to eq 4.times.map { |day| SpiceRub::Native.str2et("2006 JAN #{day + 1}") }
+    end
+
+    it "returns NMatrix results" do
+      rotation = moon.pxform(:J2000, :ECLIPJ2000, 0.0)
+
+      expect(rotation).to eq SpiceRub::Native.pxform(:J2000, :ECLIPJ2000, 0.0)
+    end
+
+    it "raises errors from the workers" do
+      expect { times.pxform(:J2000, :NOT_A_FRAME, 0.0) }.to raise_error(SpiceError)
+      expect(times.ktotal(:all)).to eq 1
+    end
+  end
+
+  context "When a call does not finish its round trip" do
+    subject { SpiceRub::Context.new([TEST_TLS_KERNEL], path: path) }
+
+    after { subject.close }
+
+    it "replaces a worker interrupted before its reply" do
+      pid = subject.pids[0]
+
+      expect { Timeout.timeout(0.2) { subject.send_to("Kernel", :sleep, 2) } }.to raise_error(Timeout::Error)
+      expect(subject.ktotal(:all)).to eq 1
+      expect(subject.pids).not_to include pid
+    end
+
+    it "replaces a worker that died" do
+      Process.kill(:KILL, subject.pids[0])
+
+      expect { subject.ktotal(:all) }.to raise_error(SpiceError)
+      expect(subject.ktotal(:all)).to eq 1
+    end
+  end
+
+  context "When a kernel cannot be loaded" do
+    subject { SpiceRub::Context.new([TEST_SPK_KERNEL + ".missing"], path: path) }
+
+    it { expect { subject }.to raise_error(SpiceError) }
+  end
+
+  context "When the context is closed" do
+    subject { SpiceRub::Context.new([TEST_TLS_KERNEL], path: path) }
+    before { subject.close }
+
+    it { is_expected.to be_closed }
+    it { expect { subject.ktotal(:all) }.to raise_error(IOError) }
+  end
+
+  describe ".open" do
+    it "closes the context after the block" do
+      context = SpiceRub::Context.open([TEST_TLS_KERNEL], path: path) { |opened| opened }
+
+      expect(context).to be_closed
+    end
+  end
+end
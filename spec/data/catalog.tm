@@ -0,0 +1,15 @@
+KPL/MK
+
+   Meta-kernel used by the lazy KernelPool specs. Paths are relative
+   to the repository root, where the spec suite is run from.
+
+\begindata
+
+   PATH_VALUES     = ( 'spec/data/kernels' )
+   PATH_SYMBOLS    = ( 'KERNELS' )
+   KERNELS_TO_LOAD = ( '$KERNELS/naif0011.tls',
+                       '$KERNELS/pck00010.tpc',
+                       'spec/data/moon.tf',
+                       '$KERNELS/moon_pa_de421_1900-2050.bpc' )
+
+\begintext
@@ -0,0 +1,53 @@
+KPL/FK
+
+   Lunar frames for the DE421 based lunar orientation data in
+   moon_pa_de421_1900-2050.bpc, reduced from NAIF's moon_080317.tf.
+
+   MOON_PA and MOON_ME are fixed aliases of the DE421 principal axes
+   and mean Earth/polar axis frames.
+
+\begindata
+
+   FRAME_MOON_PA_DE421        = 31006
+   FRAME_31006_NAME           = 'MOON_PA_DE421'
+   FRAME_31006_CLASS          = 2
+   FRAME_31006_CLASS_ID       = 31006
+   FRAME_31006_CENTER         = 301
+
+   FRAME_MOON_ME_DE421        = 31007
+   FRAME_31007_NAME           = 'MOON_ME_DE421'
+   FRAME_31007_CLASS          = 4
+   FRAME_31007_CLASS_ID       = 31007
+   FRAME_31007_CENTER         = 301
+
+   TKFRAME_31007_SPEC         = 'ANGLES'
+   TKFRAME_31007_RELATIVE     = 'MOON_PA_DE421'
+   TKFRAME_31007_ANGLES       = (   67.92   78.56   0.30 )
+   TKFRAME_31007_AXES         = (   3,      2,      1    )
+   TKFRAME_31007_UNITS        = 'ARCSECONDS'
+
+   FRAME_MOON_PA              = 31000
+   FRAME_31000_NAME           = 'MOON_PA'
+   FRAME_31000_CLASS          = 4
+   FRAME_31000_CLASS_ID       = 31000
+   FRAME_31000_CENTER         = 301
+
+   TKFRAME_31000_SPEC         = 'MATRIX'
+   TKFRAME_31000_RELATIVE     = 'MOON_PA_DE421'
+   TKFRAME_31000_MATRIX       = ( 1 0 0
+                                  0 1 0
+                                  0 0 1 )
+
+   FRAME_MOON_ME              = 31001
+   FRAME_31001_NAME           = 'MOON_ME'
+   FRAME_31001_CLASS          = 4
+   FRAME_31001_CLASS_ID       = 31001
+   FRAME_31001_CENTER         = 301
+
+   TKFRAME_31001_SPEC         = 'MATRIX'
+   TKFRAME_31001_RELATIVE     = 'MOON_ME_DE421'
+   TKFRAME_31001_MATRIX       = ( 1 0 0
+                                  0 1 0
+                                  0 0 1 )
+
+\begintext
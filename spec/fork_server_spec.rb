@@ -0,0 +1,75 @@
+# == fork_server_spec.rb
+#
+# Tests for the ForkServer class, workers are forked from the spec process
+# and report back through files in a temporary directory
+
+require "spec_helper"
+require "tmpdir"
+
+describe SpiceRub::ForkServer do
+  let(:kernel_pool) { SpiceRub::KernelPool.instance }
+  let(:dir) { Dir.mktmpdir }
+  let(:socket) { File.join(dir, "spice_rub.sock") }
+  let(:output) { File.join(dir, "output") }
+  let(:server) { SpiceRub::ForkServer.new(socket) }
+
+  before do
+    kernel_pool.clear! unless kernel_pool.empty?
+    kernel_pool.path = 'spec/data/kernels'
+    kernel_pool.load(TEST_TLS_KERNEL)
+    kernel_pool.load(TEST_SPK_KERNEL)
+
+    @thread = Thread.new { server.serve }
+    sleep 0.01 until File.socket?(socket)
+  end
+
+  after do
+    server.stop
+    @thread.join
+    kernel_pool.clear!
+    FileUtils.remove_entry(dir)
+  end
+
+  def write_script(body)
+    File.join(dir, "job.rb").tap { |script| File.write(script, body) }
+  end
+
+  context "When a worker uses the inherited kernels" do
+    let(:script) { write_script(<<-RUBY) }
+      et = SpiceRub::Native.str2et(ARGV[0])
+      File.write(ARGV[1], SpiceRub::KernelPool.instance.count.to_s + " " + et.to_s)
+    RUBY
+
+    subject { SpiceRub::ForkServer.run(socket, script, ["2006 JAN 31 01:00", output]) }
+
+    its(["status"]) { is_expected.to eq 0 }
+    it { expect(subject["pid"]).not_to eq Process.pid }
+    it { subject; expect(File.read(output)).to eq "2 #{SpiceRub::Native.str2et("2006 JAN 31 01:00")}" }
+  end
+
+  it "only lets its own user connect" do
+    expect(File.stat(socket).mode & 0o777).to eq 0o600
+  end
+
+  context "When the client runs as another user" do
+    let(:script) { write_script("exit 0") }
+    before { allow(Process).to receive(:euid).and_return(Process.euid + 1) }
+    subject { SpiceRub::ForkServer.run(socket, script) }
+
+    it { expect { subject }.to raise_error(SpiceError, /refused/) }
+  end
+
+  context "When a worker exits with a status" do
+    let(:script) { write_script("exit 3") }
+    subject { SpiceRub::ForkServer.run(socket, script) }
+
+    its(["status"]) { is_expected.to eq 3 }
+  end
+
+  context "When a worker raises" do
+    let(:script) { write_script("$stderr.reopen(File::NULL); raise 'failed job'") }
+    subject { SpiceRub::ForkServer.run(socket, script) }
+
+    its(["status"]) { is_expected.to eq 1 }
+  end
+end
@@ -104,6 +104,279 @@ describe SpiceRub::KernelPool do
     it { is_expected.to eq expected }
   end
 
+  describe "#coverage" do
+    before { kernel_pool.load(TEST_PCK_KERNEL[0]) }
+
+    context "When a binary PCK is loaded" do
+      subject { kernel_pool.coverage(31006, kind: :pck) }
+
+      it { is_expected.to eq [[File.join(kernel_pool.path, TEST_PCK_KERNEL[0]), -3155716800.0, 1609416000.0]] }
+    end
+
+    context "When the kernel is unloaded" do
+      before { kernel_pool[0].unload! }
+      subject { kernel_pool.coverage(31006, kind: :pck) }
+
+      it { is_expected.to be_empty }
+    end
+
+    context "When checking a batch of epochs" do
+      subject { kernel_pool.uncovered(31006, [0.0, -4.0e9, 1.0e9, 2.0e9], kind: :pck) }
+
+      it { is_expected.to eq [1, 3] }
+    end
+  end
+
+  describe "#generation" do
+    let!(:generation) { kernel_pool.generation }
+
+    it "increases when a kernel is loaded, unloaded or the pool cleared" do
+      kernel_pool.load(TEST_TLS_KERNEL)
+      loaded = kernel_pool.generation
+      expect(loaded).to be > generation
+
+      kernel_pool[0].unload!
+      expect(kernel_pool.generation).to be > loaded
+
+      kernel_pool.load(TEST_TLS_KERNEL)
+      cleared = kernel_pool.generation
+      kernel_pool.clear!
+      expect(kernel_pool.generation).to be > cleared
+    end
+
+    it "follows kernels loaded outside the pool" do
+      SpiceRub::Native.furnsh(File.join(kernel_pool.path, TEST_TLS_KERNEL))
+
+      expect(kernel_pool.generation).to eq generation + 1
+    end
+
+    it "does not change when a load fails" do
+      expect { kernel_pool.load(TEST_INVALID_KERNEL) rescue nil }.not_to change { kernel_pool.generation }
+    end
+  end
+
+  describe "#on_change" do
+    let(:events) { [] }
+    let!(:subscription) { kernel_pool.on_change { |*event| events << event } }
+    after { kernel_pool.cancel_on_change(subscription) }
+
+    it "yields the generation, event and kernel" do
+      kernel_pool.load(TEST_TLS_KERNEL)
+      kernel_pool.clear!
+
+      expect(events).to eq [[events[0][0], :furnsh, File.join(kernel_pool.path, TEST_TLS_KERNEL)],
+                            [kernel_pool.generation, :kclear, nil]]
+    end
+
+    it "records the kernel when a subscriber raises" do
+      failing = kernel_pool.on_change { raise ArgumentError, "subscriber" }
+
+      begin
+        expect { kernel_pool.load(TEST_TLS_KERNEL) }.to raise_error(ArgumentError, "subscriber")
+      ensure
+        kernel_pool.cancel_on_change(failing)
+      end
+
+      expect(kernel_pool.loaded.map(&:path)).to eq [File.join(kernel_pool.path, TEST_TLS_KERNEL)]
+      expect(events.map { |event| event[1] }).to eq [:furnsh]
+    end
+
+    it "stops after the subscription is cancelled" do
+      kernel_pool.cancel_on_change(subscription)
+      kernel_pool.load(TEST_TLS_KERNEL)
+
+      expect(events).to be_empty
+    end
+  end
+
+  describe "#switch_to" do
+    let(:tls) { File.expand_path(File.join(kernel_pool.path, TEST_TLS_KERNEL)) }
+    let(:bpc) { File.expand_path(File.join(kernel_pool.path, TEST_PCK_KERNEL[0])) }
+    let(:tpc) { File.expand_path(File.join(kernel_pool.path, TEST_PCK_KERNEL[1])) }
+    let(:loaded_paths) { kernel_pool.loaded.map { |kernel| File.expand_path(kernel.path) } }
+
+    before do
+      kernel_pool.define_set(:first, [TEST_TLS_KERNEL, TEST_PCK_KERNEL[0], TEST_PCK_KERNEL[1]])
+      kernel_pool.define_set(:reordered, [TEST_TLS_KERNEL, TEST_PCK_KERNEL[1], TEST_PCK_KERNEL[0]])
+      kernel_pool.define_set(:swapped, [TEST_PCK_KERNEL[1], TEST_TLS_KERNEL])
+      kernel_pool.switch_to(:first)
+    end
+
+    it { expect(kernel_pool.current_set).to eq :first }
+    it { expect(loaded_paths).to eq [tls, bpc, tpc] }
+
+    context "When only kernels of different kinds change order" do
+      subject { kernel_pool.switch_to(:reordered) }
+
+      its(:kept) { is_expected.to match_array [tls, tpc, bpc].map { |path| File.join(kernel_pool.path, File.basename(path)) } }
+      its(:loaded) { is_expected.to be_empty }
+      its(:unloaded) { is_expected.to be_empty }
+      its(:seconds) { is_expected.to be >= 0 }
+    end
+
+    context "When kernels of one kind change order" do
+      subject! { kernel_pool.switch_to(:swapped) }
+
+      its(:unloaded) { is_expected.to match_array [File.join(kernel_pool.path, TEST_TLS_KERNEL), File.join(kernel_pool.path, TEST_PCK_KERNEL[0])] }
+      its(:loaded) { is_expected.to eq [tls] }
+      it { expect(loaded_paths).to eq [tpc, tls] }
+      it { expect(kernel_pool.count).to eq 2 }
+    end
+
+    context "When the set is unknown" do
+      it { expect { kernel_pool.switch_to(:unknown) }.to raise_error(ArgumentError) }
+    end
+  end
+
+  describe "#unload_unneeded!" do
+    before do
+      kernel_pool.load(TEST_PCK_KERNEL[0])
+      kernel_pool.load(TEST_TLS_KERNEL)
+    end
+
+    context "When the kernel holds data for the bodies" do
+      subject { kernel_pool.unload_unneeded!([31006], kind: :pck) }
+
+      it { is_expected.to be_empty }
+    end
+
+    context "When the kernel holds no data for the bodies" do
+      subject { kernel_pool.unload_unneeded!([31007], kind: :pck).map(&:path) }
+
+      it { is_expected.to eq [File.join(kernel_pool.path, TEST_PCK_KERNEL[0])] }
+    end
+  end
+
+  describe "#reopen!" do
+    before do
+      kernel_pool.load(TEST_TLS_KERNEL)
+      kernel_pool.load(TEST_SPK_KERNEL)
+    end
+
+    it "reopens the binary kernels without touching the pool" do
+      generation = kernel_pool.generation
+      epoch = SpiceRub::Native.str2et("2006 JAN 31 01:00")
+      position = SpiceRub::Native.spkpos(:MOON, epoch, :J2000, :NONE, :EARTH)[0].to_a.flatten
+
+      expect(kernel_pool.reopen!).to eq 1
+      expect(kernel_pool.generation).to eq generation
+      expect(SpiceRub::Native.spkpos(:MOON, epoch + 3600, :J2000, :NONE, :EARTH)[0].to_a.flatten).not_to eq position
+      expect(SpiceRub::Native.spkpos(:MOON, epoch, :J2000, :NONE, :EARTH)[0].to_a.flatten).to eq position
+    end
+  end
+
+  describe "#load_snapshot" do
+    let(:snapshot) { "spec/data/pool.snapshot" }
+    let(:files) { [TEST_TLS_KERNEL, TEST_PCK_KERNEL[1]] }
+    let(:radii) { SpiceRub::Native.bodvrd(:earth, :radii, 3) }
+    let(:epoch) { SpiceRub::Native.str2et("2006 JAN 31 01:00") }
+
+    before { File.delete(snapshot) if File.exist?(snapshot) }
+    after { File.delete(snapshot) if File.exist?(snapshot) }
+
+    context "When no snapshot exists" do
+      subject { kernel_pool.load_snapshot(files, snapshot) }
+
+      it { is_expected.to eq :loaded }
+      it { subject; expect(File).to exist(snapshot) }
+    end
+
+    context "When a matching snapshot exists" do
+      before do
+        kernel_pool.load_snapshot(files, snapshot)
+        @radii, @epoch = radii, epoch
+        kernel_pool.clear!
+      end
+
+      subject { kernel_pool.load_snapshot(files, snapshot) }
+
+      it { is_expected.to eq :restored }
+      it { subject; expect(radii).to eq @radii }
+      it { subject; expect(epoch).to eq @epoch }
+    end
+
+    context "When a restored pool is cleared" do
+      before do
+        kernel_pool.load_snapshot(files, snapshot)
+        kernel_pool.clear!
+        kernel_pool.load_snapshot(files, snapshot)
+      end
+
+      it { expect(kernel_pool).not_to be_empty }
+      it { expect(kernel_pool.clear!).to be true }
+      it { kernel_pool.clear!; expect { SpiceRub::Native.str2et("2006 JAN 31 01:00") }.to raise_error(SpiceError) }
+    end
+
+    context "When given a meta-kernel" do
+      let(:files) { ["../catalog.tm"] }
+
+      before do
+        kernel_pool.load_snapshot(files, snapshot)
+        kernel_pool.clear!
+      end
+
+      subject! { kernel_pool.load_snapshot(files, snapshot) }
+
+      it { is_expected.to eq :restored }
+      it { expect(kernel_pool.count(:pck)).to eq 1 }
+      it { expect(SpiceRub::Native.bodvrd(:earth, :radii, 3)[0]).to eq 3 }
+    end
+
+    it "only snapshots text kernels" do
+      expect(SpiceRub::KernelCatalog.text_kernel?("spec/data/kernels/#{TEST_IK_KERNEL}")).to be true
+      expect(SpiceRub::KernelCatalog.text_kernel?("spec/data/kernels/#{TEST_PCK_KERNEL[0]}")).to be false
+    end
+
+    context "When the kernel list changed" do
+      before do
+        kernel_pool.load_snapshot(files, snapshot)
+        kernel_pool.clear!
+      end
+
+      subject { kernel_pool.load_snapshot([TEST_TLS_KERNEL], snapshot) }
+
+      it { is_expected.to eq :loaded }
+    end
+  end
+
+  describe "#load_catalog" do
+    before { kernel_pool.load_catalog(TEST_CATALOG) }
+    after { kernel_pool.clear! }
+
+    context "When the catalog is loaded" do
+      subject { kernel_pool }
+
+      it { is_expected.to be_lazy }
+      its(:count) { is_expected.to eq 3 }
+      it { expect(kernel_pool.count(:pck)).to eq 0 }
+    end
+
+    context "When a query needs a frame from a binary kernel" do
+      subject { kernel_pool.demand([], [0.0], frames: [:MOON_PA_DE421]) }
+
+      it { expect(subject.map(&:path)).to eq ["spec/data/kernels/moon_pa_de421_1900-2050.bpc"] }
+    end
+
+    context "When a query needs a TK frame on top of a binary kernel frame" do
+      subject { kernel_pool.demand([], [0.0], frames: [:MOON_ME]) }
+
+      it { expect(subject.map(&:path)).to eq ["spec/data/kernels/moon_pa_de421_1900-2050.bpc"] }
+    end
+
+    context "When the epochs are outside the binary kernel coverage" do
+      subject { kernel_pool.demand([], [2.0e9], frames: [:MOON_PA_DE421]) }
+
+      it { is_expected.to be_empty }
+    end
+
+    context "When the kernel is already resident" do
+      before { kernel_pool.demand([], [0.0], frames: [:MOON_PA_DE421]) }
+      subject { kernel_pool.demand([], [1.0e8], frames: [:MOON_PA_DE421]) }
+
+      it { is_expected.to be_empty }
+    end
+  end
+
   # Failing test
   context "When a SpiceKernel gets unloaded" do
 
@@ -0,0 +1,65 @@
+# == metrics_spec.rb
+#
+# Tests for the OpenMetrics rendering of the Metrics module
+
+require "spec_helper"
+require "tmpdir"
+
+describe SpiceRub::Metrics do
+  let(:kernel_pool) { SpiceRub::KernelPool.instance }
+  let(:spice) { SpiceRub::Native }
+
+  before do
+    kernel_pool.clear! unless kernel_pool.empty?
+    kernel_pool.path = 'spec/data/kernels'
+    kernel_pool.load(TEST_TLS_KERNEL)
+    kernel_pool.load(TEST_PCK_KERNEL[0])
+
+    SpiceRub::Stats.enable!
+    SpiceRub::Stats.reset
+    2.times { spice.str2et("2006 JAN 31 01:00") }
+    spice.bodn2c(:moon)
+    spice.bodn2c(:moon)
+  end
+
+  after do
+    SpiceRub::Stats.disable!
+    kernel_pool.clear!
+  end
+
+  describe ".render" do
+    subject { SpiceRub::Metrics.render }
+
+    it { is_expected.to end_with "# EOF\n" }
+    it { is_expected.to include "# TYPE spice_rub_native_calls counter\n" }
+    it { is_expected.to include "spice_rub_native_calls_total{function=\"str2et\"} 2\n" }
+    it { is_expected.to include "spice_rub_native_call_duration_seconds_bucket{function=\"str2et\",le=\"+Inf\"} 2\n" }
+    it { is_expected.to include "spice_rub_native_call_duration_seconds_count{function=\"str2et\"} 2\n" }
+    it { is_expected.to match(/^spice_rub_native_call_latency_seconds\{function="str2et",quantile="0.99"\} \S+$/) }
+    it { is_expected.to include "spice_rub_kernels{category=\"TEXT\"} 1\n" }
+    it { is_expected.to include "spice_rub_kernels{category=\"PCK\"} 1\n" }
+    it { is_expected.to match(/^spice_rub_kernel_load_seconds\{kernel="spec\/data\/kernels\/naif0011.tls"\} \S+$/) }
+    it { is_expected.to match(/^spice_rub_cache_hit_ratio\{cache="bodies"\} (0|1)\.\d+/) }
+    it { is_expected.not_to include "spice_rub_native_calls_total{function=\"ktotal\"}" }
+
+    it "keeps histogram buckets cumulative" do
+      counts = subject.scan(/^spice_rub_native_call_duration_seconds_bucket\{function="str2et",le="[^"]+"\} (\d+)$/).flatten.map(&:to_i)
+
+      expect(counts).to eq counts.sort
+      expect(counts.last).to eq 2
+    end
+  end
+
+  describe ".write" do
+    let(:dir) { Dir.mktmpdir }
+    let(:path) { File.join(dir, "spice_rub.prom") }
+    after { FileUtils.remove_entry(dir) }
+
+    it "writes the rendered metrics" do
+      SpiceRub::Metrics.write(path)
+
+      expect(File.read(path)).to include "spice_rub_native_calls_total{function=\"bodn2c\"} 2\n"
+      expect(Dir.children(dir)).to eq ["spice_rub.prom"]
+    end
+  end
+end
@@ -1,4 +1,5 @@
 require 'spec_helper'
+require 'tmpdir'
                
 # TODO
 # test spice.furnsh, spice.ktotal, spice.kclear spice.unload
@@ -28,6 +29,26 @@ describe "SpiceRub::Native" do
         it { is_expected.to ary_be_within(0.0000000001).of(EXAMPLE_COORDINATES[:lat]) }
       end
 
+      describe "argument checks" do
+        context "when the NMatrix is not float64" do
+          subject { spice.reclat(NMatrix.new([3,1], [0, 1, 0], dtype: :int32)) }
+
+          it { expect { subject }.to raise_error(TypeError) }
+        end
+
+        context "when the NMatrix has the wrong number of elements" do
+          subject { spice.reclat(NMatrix.new([2,1], [0.0, 1.0])) }
+
+          it { expect { subject }.to raise_error(ArgumentError) }
+        end
+
+        context "when the argument is not an NMatrix" do
+          subject { spice.reclat([0.0, 1.0, 0.0]) }
+
+          it { expect { subject }.to raise_error(TypeError) }
+        end
+      end
+
       describe ".recsph" do
         subject { spice.recsph(EXAMPLE_COORDINATES[:rec]) }     
         
@@ -68,6 +89,42 @@ describe "SpiceRub::Native" do
 
         it { is_expected.to ary_be_within(0.000001).of expected }
       end
+
+      describe "batch conversions with cached body constants" do
+        let(:point) { [1.604650025e-13, -2.620678915e+03, 2.592408909e+03] }
+        let(:points) { NMatrix.new([2, 3], point + [3396.19, 0.0, 0.0], dtype: :float64) }
+
+        before do
+          kernel_pool = SpiceRub::KernelPool.instance
+          kernel_pool.clear! unless kernel_pool.empty?
+          kernel_pool.load(TEST_PCK_KERNEL[1])
+        end
+
+        it { expect(spice.body_constants(:mars)[:radii]).to ary_be_within(0.000001).of [3396.19, 3396.19, 3376.20] }
+        it { expect(spice.body_constants(499).keys).to include(:gm, :pole_ra, :pole_dec, :pm) }
+
+        it "matches .recpgr" do
+          expect(spice.recpgr_batch(:mars, points, nil).to_a[0]).to ary_be_within(0.000001).of [90.0 * spice.rpd, 45.0 * spice.rpd, 300]
+        end
+
+        it "matches .recgeo" do
+          expected = spice.recgeo(NMatrix.new([3,1], point), 3396.19, 0.005886007555525526)
+          expect(spice.recgeo_batch(499, points, nil).to_a[0]).to ary_be_within(0.000001).of expected
+        end
+
+        it "converts a CartesianPoint without manual radii" do
+          expect(SpiceRub::CartesianPoint.new(point).to_planetographic(:mars)).to ary_be_within(0.000001).of [90.0 * spice.rpd, 45.0 * spice.rpd, 300]
+        end
+
+        it { expect { spice.recpgr_batch(:mars, NMatrix.new([2, 2], 0.0, dtype: :float64), nil) }.to raise_error(ArgumentError) }
+
+        context "when a body has no rotation model" do
+          before { SpiceRub::KernelPool.instance.load(TEST_BODIES_KERNEL, absolute: true) }
+
+          it { expect(spice.recgeo_batch(-999999, points, nil).shape).to eq [2, 3] }
+          it { expect { spice.recpgr_batch(-999999, points, nil) }.to raise_error(SpiceError, /MISSINGDATA/) }
+        end
+      end
     end
 
     context "when co-ordinates are spherical" do
@@ -368,6 +425,14 @@ describe "SpiceRub::Native" do
 
         it { is_expected.to ary_be_within(0.0000001).of(expected) }
       end
+
+      context "when called again with another confinement window" do
+        before { spice.gfdist(:MOON, :NONE, :EARTH, :<, 400000, 0, spice.spd, 100, [spice.str2et("2007 JAN 1"), spice.str2et("2007 APR 1")]) }
+
+        subject { spice.gfdist(:MOON, :NONE, :EARTH, :<, 400000, 0, spice.spd, 100, [spice.str2et("2007 MAR 1"), spice.str2et("2007 APR 1")]) }
+
+        it { expect(subject.flatten.min).to be >= spice.str2et("2007 MAR 1") }
+      end
     end
     
     describe ".gfsntc" do
@@ -549,13 +614,45 @@ describe "SpiceRub::Native" do
     end
 
     describe ".spkezr" do
-      let(:expected) { [ NMatrix.new([6,1], [-97579460.22494915, -111325884.19041583, -53609500.96053864, 191941265.18476546, 0, 0]) , 525.182681546206 ] }
-      
-      subject { spice.spkezr(:MOON, spice.str2et("2006 JAN 31 01:00"), :J2000, :NONE, :MARS) }
-      
-      it { is_expected.to ary_be_within(0.00000001).of expected }
+      let(:et) { spice.str2et("2006 JAN 31 01:00") }
+      let(:position) { [-97579460.22494915, -111325884.19041583, -53609500.96053864] }
+
+      #Central difference of spkpos over two seconds, good to well under a metre per second
+      let(:velocity) do
+        before, after = [et - 1, et + 1].map { |epoch| spice.spkpos(:MOON, epoch, :J2000, :NONE, :MARS)[0].to_a.flatten }
+        after.zip(before).map { |a, b| (a - b) / 2 }
+      end
+
+      subject { spice.spkezr(:MOON, et, :J2000, :NONE, :MARS) }
+
+      it { expect(subject[0].to_a.flatten[0..2]).to ary_be_within(0.00000001).of position }
+      it { expect(subject[0].to_a.flatten[3..5]).to ary_be_within(0.0001).of velocity }
+      it { expect(subject[1]).to be_within(0.00000001).of 525.182681546206 }
     end
     
+    describe ".spkopn, .spkw13 and .spkcls" do
+      let(:path) { File.join(Dir.tmpdir, "spice_rub_spec_#{Process.pid}.bsp") }
+      let(:epochs) { [0.0, 100.0, 200.0, 300.0] }
+      let(:states) { NMatrix.new([4, 6], epochs.flat_map { |et| [7000.0 + et, 2.0 * et, 0.0, 1.0, 2.0, 0.0] }, dtype: :float64) }
+
+      before do
+        File.delete(path) if File.exist?(path)
+        handle = spice.spkopn(path, "spice_rub spec", 0)
+        spice.spkw13(handle, -999100, 399, :J2000, 0.0, 300.0, "SPEC ORBIT", 3, states, epochs)
+        spice.spkcls(handle)
+        spice.furnsh(path)
+      end
+
+      after do
+        spice.unload(path)
+        File.delete(path)
+      end
+
+      subject { spice.spkpos(:"-999100", 150.0, :J2000, :NONE, :EARTH)[0] }
+
+      it { expect(subject.to_a.flatten).to ary_be_within(1e-9).of [7150.0, 300.0, 0.0] }
+    end
+
     describe ".sxform" do
       let(:expected) { NMatrix.new( [6,6], 
             [
@@ -600,6 +697,99 @@ describe "SpiceRub::Native" do
       it { is_expected.to be_within(0.00000001).of expected }
     end
 
+    describe ".bodn2c and .bodc2n" do
+      let(:kernel_pool) { SpiceRub::KernelPool.instance }
+
+      before { @bodies = kernel_pool[kernel_pool.load(TEST_BODIES_KERNEL, absolute: true)] }
+      after { kernel_pool.release(@bodies) }
+
+      it { expect(spice.bodn2c(:EARTH)).to eq 399 }
+      it { expect(spice.bodn2c(:"  solar   system barycenter ")).to eq 0 }
+      it { expect(spice.bodn2c(:spice_rub_probe)).to eq -999999 }
+      it { expect(spice.bodn2c(:"spice rub relay")).to eq -999998 }
+      it { expect(spice.bodn2c(:not_a_body)).to be_nil }
+      it { expect(spice.bodc2n(-999998)).to eq :"SPICE RUB  RELAY" }
+      it { expect(spice.bodc2n(-123456789)).to be_nil }
+
+      it "keeps answers until the kernel pool changes" do
+        generation = spice.pool_generation
+
+        expect(spice.bodc2n(399)).to equal spice.bodc2n(399)
+        expect(spice.pool_generation).to eq generation
+
+        kernel_pool.release(@bodies)
+        expect(spice.pool_generation).to be > generation
+        expect(spice.bodn2c(:spice_rub_probe)).to be_nil
+      end
+    end
+
+    describe ".pxform_batch" do
+      before(:all) do
+        kernel_pool = SpiceRub::KernelPool.instance
+        @kernels = [kernel_pool[kernel_pool.load(TEST_PCK_KERNEL[0])],
+                    kernel_pool[kernel_pool.load(TEST_MOON_FRAME_KERNEL, absolute: true)]]
+      end
+
+      after(:all) { @kernels.each { |kernel| SpiceRub::KernelPool.instance.release(kernel) } }
+
+      let(:epochs) { (0...200).map { |i| 63115264.183926724 + i * 60.0 } }
+      let(:rows) { subject.to_a }
+
+      [[:J2000, :MOON_PA_DE421], [:MOON_ME_DE421, :J2000], [:ECLIPJ2000, :MOON_ME], [:MOON_PA, :MOON_ME_DE421]].each do |from, to|
+        context "When rotating from #{from} to #{to}" do
+          subject { spice.pxform_batch(from, to, epochs, 4, nil) }
+
+          it "matches .pxform at every epoch" do
+            epochs.each_with_index do |et, i|
+              expect(rows[i]).to ary_be_within(0.0000000001).of spice.pxform(from, to, et).to_a.flatten
+            end
+          end
+        end
+      end
+
+      context "When an epoch is outside the binary PCK" do
+        subject { spice.pxform_batch(:J2000, :MOON_PA_DE421, [1.0e12], 2, nil) }
+
+        it { expect { subject }.to raise_error(SpiceError) }
+      end
+
+      context "When a frame is not built from PCK and TK frames" do
+        subject { spice.pxform_batch(:J2000, :IAU_EARTH, epochs, 2, nil) }
+
+        it { expect { subject }.to raise_error(ArgumentError) }
+      end
+    end
+
+    describe ".pck_angles" do
+      before(:all) do
+        kernel_pool = SpiceRub::KernelPool.instance
+        @pck = kernel_pool[kernel_pool.load(TEST_PCK_KERNEL[0])]
+      end
+
+      after(:all) { SpiceRub::KernelPool.instance.release(@pck) }
+
+      let(:et) { 63115264.183926724 }
+      let(:angles) { spice.pck_angles(31006, [et], 6, nil, nil).to_a.flatten }
+
+      it "rebuilds the MOON_PA_DE421 rotation" do
+        phi, delta, w = angles
+        rotation = NMatrix.new([3,3], [ cos(w) * cos(phi) - sin(w) * cos(delta) * sin(phi),  cos(w) * sin(phi) + sin(w) * cos(delta) * cos(phi), sin(w) * sin(delta),
+                                       -sin(w) * cos(phi) - cos(w) * cos(delta) * sin(phi), -sin(w) * sin(phi) + cos(w) * cos(delta) * cos(phi), cos(w) * sin(delta),
+                                        sin(delta) * sin(phi),                              -sin(delta) * cos(phi),                              cos(delta) ])
+
+        expect(rotation.to_a.flatten).to ary_be_within(0.0000000001).of spice.pxform(:J2000, :MOON_PA_DE421, et).to_a.flatten
+      end
+    end
+
+    describe ".tkfrm" do
+      before(:all) { @frames = SpiceRub::KernelPool.instance.load(TEST_MOON_FRAME_KERNEL, absolute: true) }
+      after(:all) { SpiceRub::KernelPool.instance.release(SpiceRub::KernelPool.instance[@frames]) }
+
+      it { expect(spice.tkfrm(31001)).to eq 31007 }
+      it { expect(spice.tkfrm(31007)).to eq 31006 }
+      it { expect(spice.tkfrm(31006)).to be_nil }
+    end
+
 
   end
 end
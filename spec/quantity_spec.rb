@@ -0,0 +1,112 @@
+# == quantity_spec.rb
+#
+# Tests for compiled quantity expressions and the user defined GF searches
+# (gfuds, gfudb, gfuds_batch) running them, checked against the native GF
+# families searching the same quantities
+
+require "spec_helper"
+
+describe SpiceRub::Quantity do
+  let(:spice) { SpiceRub::Native }
+  let(:quantity) { SpiceRub::Quantity }
+  let(:confines) { [spice.str2et("2007 JAN 1"), spice.str2et("2007 APR 1")] }
+  let(:distance) { quantity.norm(quantity.position(:MOON, :EARTH)) }
+
+  before(:all) do
+    kernel_pool = SpiceRub::KernelPool.instance
+    kernel_pool.clear! unless kernel_pool.empty?
+    kernel_pool.path = 'spec/data/kernels'
+    kernel_pool.load(TEST_TLS_KERNEL)
+    kernel_pool.load(TEST_SPK_KERNEL)
+  end
+
+  describe ".values" do
+    let(:et) { spice.str2et("2007 FEB 1") }
+
+    def value_at(expression, et)
+      quantity.values(expression, [et]).to_a.flatten[0]
+    end
+
+    it "evaluates the distance" do
+      position, _ = spice.spkpos(:MOON, et, :J2000, :NONE, :EARTH)
+
+      expect(value_at(distance, et)).to be_within(1e-6).of(position.to_a.flatten.map { |x| x * x }.sum ** 0.5)
+    end
+
+    it "evaluates the range rate as the derivative of the distance" do
+      rate = value_at(quantity.range_rate(:MOON, :EARTH), et)
+      before, after = quantity.values(distance, [et - 1, et + 1]).to_a.flatten
+
+      expect(rate).to be_within(1e-4).of((after - before) / 2)
+    end
+
+    it "evaluates conditions to 1 or 0" do
+      expect(value_at(quantity.lt(distance, 1e9), et)).to eq(1.0)
+      expect(value_at(quantity.not(quantity.lt(distance, 1e9)), et)).to eq(0.0)
+    end
+  end
+
+  describe "Native.gfuds" do
+    subject { spice.gfuds(distance, :<, 400000, 0, spice.spd, 100, confines) }
+
+    it { is_expected.to ary_be_within(0.001).of(spice.gfdist(:MOON, :NONE, :EARTH, :<, 400000, 0, spice.spd, 100, confines)) }
+  end
+
+  describe "Native.gfudb" do
+    subject { spice.gfudb(quantity.lt(distance, 400000), spice.spd, confines) }
+
+    it { is_expected.to ary_be_within(0.001).of(spice.gfdist(:MOON, :NONE, :EARTH, :<, 400000, 0, spice.spd, 100, confines)) }
+  end
+
+  describe ".search" do
+    let(:thresholds) { [[:<, 370000], [:>, 400000], [:LOCMIN, 0]] }
+
+    subject { quantity.search(distance, thresholds, confines, step: spice.spd) }
+
+    it "finds the intervals of every threshold" do
+      expected = thresholds.map { |relate, refval| spice.gfuds(distance, relate, refval, 0, spice.spd, 100, confines) }
+
+      expect(subject.length).to eq(3)
+      subject.zip(expected).each { |found, alone| expect(found).to ary_be_within(0.001).of(alone) }
+    end
+
+    it { expect { quantity.search(distance, [[:<]], confines, step: spice.spd) }.to raise_error(ArgumentError) }
+
+    it "checks every threshold before searching" do
+      search = SpiceRub::Search.new
+      bad = [[:<, 370000], [:>, "far"]]
+
+      expect { search.run { quantity.search(distance, bad, confines, step: spice.spd) } }.to raise_error(TypeError)
+      expect { SpiceRub::Search.new.run { } }.not_to raise_error
+    end
+  end
+
+  describe "Native.gfrr" do
+    subject { spice.gfrr(:MOON, :NONE, :EARTH, :>, 0, 0, spice.spd, 100, confines) }
+
+    it { is_expected.to ary_be_within(0.01).of(spice.gfuds(quantity.range_rate(:MOON, :EARTH), :>, 0, 0, spice.spd, 100, confines)) }
+  end
+
+  describe "Native.gfpa" do
+    subject { spice.gfpa(:MOON, :SUN, :NONE, :EARTH, :<, 1, 0, spice.spd, 100, confines) }
+
+    it { is_expected.to ary_be_within(0.01).of(spice.gfuds(quantity.phase_angle(:MOON, :SUN, :EARTH), :<, 1, 0, spice.spd, 100, confines)) }
+  end
+
+  describe "Native.gfposc" do
+    let(:z) { quantity.component(quantity.position(:MOON, :EARTH), 2) }
+
+    subject { spice.gfposc(:MOON, :J2000, :NONE, :EARTH, :LATITUDINAL, :LATITUDE, :>, 0, 0, spice.spd, 100, confines) }
+
+    it { is_expected.to ary_be_within(0.01).of(spice.gfuds(z, :>, 0, 0, spice.spd, 100, confines)) }
+  end
+
+  context "when the expression is malformed" do
+    it { expect { quantity.values([:norm], [0.0]) }.to raise_error(ArgumentError) }
+    it { expect { quantity.values([:volume, 1], [0.0]) }.to raise_error(ArgumentError) }
+    it { expect { quantity.values(quantity.dot(1, 2), [0.0]) }.to raise_error(ArgumentError) }
+    it { expect { spice.gfuds(quantity.position(:MOON, :EARTH), :<, 0, 0, spice.spd, 100, confines) }.to raise_error(ArgumentError) }
+    it { expect { quantity.values(100.times.inject(1.0) { |nested| [:neg, nested] }, [0.0]) }.to raise_error(ArgumentError) }
+    it { expect { quantity.values([:neg].tap { |cycle| cycle << cycle }, [0.0]) }.to raise_error(ArgumentError) }
+  end
+end
@@ -0,0 +1,131 @@
+# == search_spec.rb
+#
+# Tests for GF searches run under a Search control: progress reports,
+# cancellation and time budgets
+
+require "spec_helper"
+
+describe SpiceRub::Search do
+  let(:spice) { SpiceRub::Native }
+  let(:confines) { [spice.str2et("2007 JAN 1"), spice.str2et("2007 APR 1")] }
+
+  before(:all) do
+    kernel_pool = SpiceRub::KernelPool.instance
+    kernel_pool.clear! unless kernel_pool.empty?
+    kernel_pool.path = 'spec/data/kernels'
+    kernel_pool.load(TEST_TLS_KERNEL)
+    kernel_pool.load(TEST_SPK_KERNEL)
+  end
+
+  def moon_closer_than(distance)
+    spice.gfdist(:MOON, :NONE, :EARTH, :<, distance, 0, spice.spd, 100, confines)
+  end
+
+  context "when left to finish" do
+    let(:fractions) { [] }
+    let(:search) { SpiceRub::Search.new { |fraction, _| fractions << fraction } }
+
+    subject! { search.run { moon_closer_than(400000) } }
+
+    it { is_expected.to eq(moon_closer_than(400000)) }
+    it { expect(search.status).to eq(:complete) }
+    it { expect(search).not_to be_partial }
+    it { expect(fractions.first).to eq(0.0) }
+    it { expect(fractions.last).to eq(1.0) }
+    it "only goes back to start a new pass" do
+      expect(fractions.each_cons(2).all? { |before, after| after >= before || after == 0.0 }).to be true
+    end
+  end
+
+  context "when cancelled halfway" do
+    #Passes of an uncontrolled search, each reports from 0, the last one builds the result window
+    let(:passes) do
+      fractions = []
+      SpiceRub::Search.new { |fraction, _| fractions << fraction }.run { moon_closer_than(400000) }
+      fractions.count(0.0)
+    end
+    let(:search) do
+      pass = 0
+      SpiceRub::Search.new do |fraction, _|
+        pass += 1 if fraction == 0.0
+        search.cancel if pass == passes && fraction >= 0.5
+      end
+    end
+
+    def measure(intervals)
+      intervals.sum { |start, finish| finish - start }
+    end
+
+    subject! { passes; search.run { moon_closer_than(400000) } }
+
+    it { expect(search.status).to eq(:cancelled) }
+    it { expect(search).to be_partial }
+    it { expect(search.fraction).to be < 1.0 }
+    it { is_expected.not_to be_empty }
+    it { expect(subject.to_a.flatten).to all(be_between(*confines)) }
+    it { expect(measure(subject)).to be < measure(moon_closer_than(400000)) }
+  end
+
+  context "when cancelled before running" do
+    let(:search) { SpiceRub::Search.new.cancel }
+
+    it "returns every search of the block at once" do
+      search.run { moon_closer_than(400000); moon_closer_than(380000) }
+
+      expect(search.status).to eq(:cancelled)
+    end
+  end
+
+  context "when out of budget" do
+    let(:search) { SpiceRub::Search.new(budget: 0) }
+
+    before { search.run { moon_closer_than(400000) } }
+
+    it { expect(search.status).to eq(:timed_out) }
+  end
+
+  context "when the progress block raises" do
+    let(:search) { SpiceRub::Search.new { |fraction, _| raise ArgumentError, "stop" if fraction > 0.2 } }
+
+    it { expect { search.run { moon_closer_than(400000) } }.to raise_error(ArgumentError, "stop") }
+
+    it "leaves later searches untouched" do
+      search.run { moon_closer_than(400000) } rescue nil
+
+      expect(moon_closer_than(400000).length).to eq(4)
+    end
+  end
+
+  context "when a GF search starts from the progress block" do
+    let(:errors) { [] }
+    let(:search) do
+      SpiceRub::Search.new do |fraction, _|
+        next unless errors.empty? && fraction > 0.2
+
+        Thread.new do
+          begin
+            moon_closer_than(380000)
+          rescue RuntimeError => error
+            errors << error.message
+          end
+        end.join
+      end
+    end
+
+    subject! { search.run { moon_closer_than(400000) } }
+
+    it { expect(errors).to eq(["a GF search is running in another thread"]) }
+    it { is_expected.to eq(moon_closer_than(400000)) }
+    it { expect(search.status).to eq(:complete) }
+
+    it "raises when the block searches itself" do
+      nested = SpiceRub::Search.new { |fraction, _| moon_closer_than(380000) if fraction > 0.2 }
+
+      expect { nested.run { moon_closer_than(400000) } }.to raise_error(RuntimeError, "a GF search is running")
+    end
+  end
+
+  context "when given a negative budget" do
+    it { expect { SpiceRub::Search.new(budget: -1).run { } }.to raise_error(ArgumentError) }
+  end
+end
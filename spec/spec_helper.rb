@@ -13,6 +13,11 @@ TEST_INVALID_KERNEL = "invalid_kernel.txt"
 TEST_IK_KERNEL = "instrument.ti"
 TEST_FRAME_KERNEL = "sem.tf"
 
+#Kept outside spec/data/kernels so load_folder counts stay stable
+TEST_MOON_FRAME_KERNEL = "spec/data/moon.tf"
+TEST_CATALOG = "spec/data/catalog.tm"
+TEST_BODIES_KERNEL = "spec/data/bodies.tk"
+
 #Obtained from the Galileo mission
 TEST_SCLK_KERNEL = "mk00062a.tsc"
 
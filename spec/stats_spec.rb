@@ -0,0 +1,74 @@
+# == stats_spec.rb
+#
+# Tests for the Stats module and the native call counters behind it
+
+require "spec_helper"
+
+describe SpiceRub::Stats do
+  let(:stats) { SpiceRub::Stats }
+  let(:spice) { SpiceRub::Native }
+
+  before(:all) do
+    kernel_pool = SpiceRub::KernelPool.instance
+    kernel_pool.clear! unless kernel_pool.empty?
+    kernel_pool.path = 'spec/data/kernels'
+    kernel_pool.load(TEST_TLS_KERNEL)
+  end
+
+  after { stats.disable! }
+
+  context "When enabled" do
+    before do
+      stats.enable!
+      stats.reset
+      3.times { spice.str2et("2006 JAN 31 01:00") }
+      spice.bodn2c(:moon)
+    end
+
+    subject { stats.snapshot }
+
+    it { is_expected.to include(:str2et, :bodn2c) }
+    it { expect(subject[:str2et][:calls]).to eq 3 }
+    it { expect(subject[:str2et][:histogram].sum).to eq 3 }
+    it { expect(subject[:str2et][:total_ns]).to be > 0 }
+    it { expect(subject[:str2et][:errors]).to eq 0 }
+
+    it "counts SpiceErrors and still raises them" do
+      expect { spice.str2et("not a time") }.to raise_error(SpiceError)
+      expect(stats.snapshot[:str2et][:errors]).to eq 1
+    end
+
+    it "checks the arity of the native" do
+      expect { spice.str2et }.to raise_error(ArgumentError)
+    end
+
+    it "forgets everything on reset" do
+      stats.reset
+      expect(stats.snapshot).to be_empty
+    end
+  end
+
+  context "When disabled" do
+    before do
+      stats.disable!
+      stats.reset
+      spice.str2et("2006 JAN 31 01:00")
+    end
+
+    it { expect(stats.snapshot).to be_empty }
+    it { expect(spice.method(:str2et).arity).to eq 1 }
+  end
+
+  describe ".measure" do
+    subject { stats.measure { 2.times { spice.j2000 } } }
+
+    its([:j2000]) { is_expected.to include(calls: 2) }
+    it { subject; expect(stats).not_to be_enabled }
+  end
+
+  describe ".percentile" do
+    it { expect(stats.percentile([0, 2, 6, 2], 0.5)).to eq 4 }
+    it { expect(stats.percentile([0, 2, 6, 2], 1.0)).to eq 8 }
+    it { expect(stats.percentile([0, 0], 0.5)).to be_nil }
+  end
+end
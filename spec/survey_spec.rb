@@ -0,0 +1,91 @@
+# == survey_spec.rb
+#
+# Tests for chunked GF surveys and resuming them from their checkpoint
+
+require "spec_helper"
+require "tmpdir"
+
+describe SpiceRub::Survey do
+  let(:spice) { SpiceRub::Native }
+  let(:confines) { [spice.str2et("2007 JAN 1"), spice.str2et("2007 JUL 1")] }
+  let(:chunk) { 20 * spice.spd }
+  let(:checkpoint) { File.join(@directory, "survey.json") }
+
+  before(:all) do
+    kernel_pool = SpiceRub::KernelPool.instance
+    kernel_pool.clear! unless kernel_pool.empty?
+    kernel_pool.path = 'spec/data/kernels'
+    kernel_pool.load(TEST_TLS_KERNEL)
+    kernel_pool.load(TEST_SPK_KERNEL)
+  end
+
+  around do |example|
+    Dir.mktmpdir { |directory| @directory = directory; example.run }
+  end
+
+  def moon_closer_than(window)
+    spice.gfdist(:MOON, :NONE, :EARTH, :<, 400000, 0, spice.spd, 100, window)
+  end
+
+  def survey(&block)
+    SpiceRub::Survey.new(checkpoint, confines, chunk: chunk, key: "moon", &(block || method(:moon_closer_than)))
+  end
+
+  context "when run uninterrupted" do
+    subject { survey.run }
+
+    it { is_expected.to ary_be_within(0.001).of(moon_closer_than(confines)) }
+    it { expect(subject.length).to eq(moon_closer_than(confines).length) }
+  end
+
+  context "when resumed after dying halfway" do
+    let(:expected) { SpiceRub::Survey.new(File.join(@directory, "other.json"), confines, chunk: chunk, key: "moon", &method(:moon_closer_than)).run }
+
+    it "searches only the remaining chunks and returns the same intervals" do
+      searched = []
+      dying = survey do |window|
+        raise Interrupt if searched.length == 4
+        searched << window
+        moon_closer_than(window)
+      end
+
+      expect { dying.run }.to raise_error(Interrupt)
+
+      resumed = survey { |window| searched << window; moon_closer_than(window) }
+
+      expect(resumed.fraction).to be_within(1e-9).of(4 * chunk / (confines[1] - confines[0]))
+      expect(resumed.run).to eq(expected)
+      expect(searched.map(&:first)).to eq(searched.map(&:first).uniq)
+    end
+  end
+
+  context "when the checkpoint belongs to another survey" do
+    before { survey.run }
+
+    it { expect { SpiceRub::Survey.new(checkpoint, confines, chunk: chunk, key: "sun") { } }.to raise_error(ArgumentError) }
+  end
+
+  context "when run under a control over a user defined search" do
+    let(:distance) { SpiceRub::Quantity.norm(SpiceRub::Quantity.position(:MOON, :EARTH)) }
+
+    subject do
+      SpiceRub::Survey.new(checkpoint, confines, chunk: chunk, key: "quantity") do |window|
+        spice.gfuds(distance, :<, 400000, 0, spice.spd, 100, window)
+      end
+    end
+
+    it "completes every chunk" do
+      expect(subject.run(SpiceRub::Search.new)).to ary_be_within(0.001).of(moon_closer_than(confines))
+      expect(subject).to be_complete
+    end
+  end
+
+  context "when the control runs out of budget" do
+    subject { survey }
+
+    before { subject.run(SpiceRub::Search.new(budget: 0)) }
+
+    it { is_expected.not_to be_complete }
+    it { expect(subject.fraction).to eq(0.0) }
+  end
+end